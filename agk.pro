@@ -6,9 +6,24 @@ CONFIG -= qt
 SOURCES += \
     quaternion.c \
     vector3.c \
-    matrix44.c
+    matrix44.c \
+    dualquat.c \
+    skinning.c \
+    hierarchy.c \
+    quatpack.c \
+    vec3pack.c \
+    arrayfile.c \
+    integrate.c \
+    arena.c \
+    container.c \
+    dispatch.c \
+    instrument.c \
+    quatindex.c \
+    vec3index.c \
+    parallel.c
 
-QMAKE_LFLAGS += -pg
+# Counts and times the calls of the batch functions, see instrument.h
+# DEFINES += AGK_INSTRUMENT
 
 QMAKE_CFLAGS        += -v -std=c11 -pedantic -Wextra -Wall -W -Wdeclaration-after-statement \
     -Weffc++ -Wpointer-arith -Wcast-qual -Wmissing-prototypes \
@@ -38,11 +53,11 @@ QMAKE_CFLAGS        += -v -std=c11 -pedantic -Wextra -Wall -W -Wdeclaration-afte
     -Wundef -Wnested-externs -Wshadow \
     -Wlogical-op -Wfloat-equal \
     -Wold-style-definition -Wno-padded \
-    -g -pg -g3 -ggdb3 \
-    -O0 \
+    -g -g3 -ggdb3 \
     -fno-omit-frame-pointer -fno-common -fstrict-aliasing -fstrict-overflow \
     -I/usr/include/glib-2.0/ -I/usr/include/glib-2.0/glib/ -I/usr/lib/x86_64-linux-gnu/glib-2.0/include \
-    -Wno-aggregate-return
+    -Wno-aggregate-return \
+    -Wno-psabi
 
 
 LIBS += -I/usr/include/glib-2.0/ -I/usr/include/glib-2.0/glib/ -I/usr/lib/x86_64-linux-gnu/glib-2.0/include -L/usr/local/lib -pthread -lglib-2.0 -lpcre -lm -lc
@@ -51,11 +66,31 @@ CONFIG += link_pkgconfig
 PKGCONFIG += glib-2.0
 
 
+include(simd.pri)
 include(deployment.pri)
 qtcAddDeployment()
 
 HEADERS += \
     quaternion.h \
     vector3.h \
-    matrix44.h
+    matrix44.h \
+    dualquat.h \
+    skinning.h \
+    hierarchy.h \
+    quatpack.h \
+    vec3pack.h \
+    arrayfile.h \
+    integrate.h \
+    arena.h \
+    container.h \
+    dispatch.h \
+    instrument.h \
+    quatindex.h \
+    vec3index.h \
+    simd.h \
+    quaternion_impl.h \
+    vector3_impl.h \
+    index_impl.h \
+    agk_tgmath.h \
+    parallel.h
 
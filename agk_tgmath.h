@@ -0,0 +1,101 @@
+//
+//
+//
+//
+//
+//
+// Type-generic quat_ / vec3_ names, in the spirit of <tgmath.h>.
+// After including this header quat_mul(a, b) calls quatf_mul when [a] is a Quaternionf and quat_mul otherwise,
+// and likewise for every function whose first argument (second for quat_from_angle_axis) tells the precision.
+// Constructors taking only scalars (quat_from_values, vec3_from_zeroes, ...) can not be dispatched and keep
+// their double meaning.
+//
+// Do not include this header in the library sources themselves, the macros would rewrite the definitions.
+
+#if ! defined AGK_TGMATH_H
+#define AGK_TGMATH_H
+
+#include "vector3.h"
+#include "quaternion.h"
+
+
+//===============================================================================================================
+// Vector3 / Vector3f
+//---------------------------------------------------------------------------------------------------------------
+#define vec3_from_points(from, to)      _Generic((from), Vector3f: vec3f_from_points, default: vec3_from_points)(from, to)
+#define vec3_from_array(buffer) \
+    _Generic((buffer), float *: vec3f_from_array, const float *: vec3f_from_array, default: vec3_from_array)(buffer)
+#define vec3_scalar_div(vec, scalar)    _Generic((vec), Vector3f: vec3f_scalar_div, default: vec3_scalar_div)(vec, scalar)
+#define vec3_scalar_mul(vec, scalar)    _Generic((vec), Vector3f: vec3f_scalar_mul, default: vec3_scalar_mul)(vec, scalar)
+#define vec3_len_squared(vec)           _Generic((vec), Vector3f: vec3f_len_squared, default: vec3_len_squared)(vec)
+#define vec3_len(vec)                   _Generic((vec), Vector3f: vec3f_len, default: vec3_len)(vec)
+#define vec3_norm(vec)                  _Generic((vec), Vector3f: vec3f_norm, default: vec3_norm)(vec)
+#define vec3_renorm(vec, epsilon)       _Generic((vec), Vector3f: vec3f_renorm, default: vec3_renorm)(vec, epsilon)
+#define vec3_dot(a, b)                  _Generic((a), Vector3f: vec3f_dot, default: vec3_dot)(a, b)
+#define vec3_cross(a, b)                _Generic((a), Vector3f: vec3f_cross, default: vec3_cross)(a, b)
+#define vec3_add(a, b)                  _Generic((a), Vector3f: vec3f_add, default: vec3_add)(a, b)
+#define vec3_equal(a, b)                _Generic((a), Vector3f: vec3f_equal, default: vec3_equal)(a, b)
+#define vec3_project_plane(vec, normal) _Generic((vec), Vector3f: vec3f_project_plane, default: vec3_project_plane)(vec, normal)
+#define vec3_print(a)                   _Generic((a), Vector3f: vec3f_print, default: vec3_print)(a)
+
+//---------------------------------------------------------------------------------------------------------------
+#define vec3_norm_array(in, out, count) \
+    _Generic((out), Vector3f *: vec3f_norm_array, default: vec3_norm_array)(in, out, count)
+#define vec3_renorm_array(vec, count, epsilon) \
+    _Generic((vec), Vector3f *: vec3f_renorm_array, default: vec3_renorm_array)(vec, count, epsilon)
+
+
+
+//===============================================================================================================
+// Quaternion / Quaternionf
+//---------------------------------------------------------------------------------------------------------------
+#define quat_from_angle_axis(angle, axis)   _Generic((axis), Vector3f: quatf_from_angle_axis, default: quat_from_angle_axis)(angle, axis)
+#define quat_from_vec3(a, b)                _Generic((a), Vector3f: quatf_from_vec3, default: quat_from_vec3)(a, b)
+#define quat_to_euler_angles(q, order)      _Generic((q), Quaternionf: quatf_to_euler_angles, default: quat_to_euler_angles)(q, order)
+
+//---------------------------------------------------------------------------------------------------------------
+#define quat_copy(q)                _Generic((q), Quaternionf: quatf_copy, default: quat_copy)(q)
+#define quat_len_squared(q)         _Generic((q), Quaternionf: quatf_len_squared, default: quat_len_squared)(q)
+#define quat_len(q)                 _Generic((q), Quaternionf: quatf_len, default: quat_len)(q)
+#define quat_norm(q)                _Generic((q), Quaternionf: quatf_norm, default: quat_norm)(q)
+#define quat_norm_fast(q)           _Generic((q), Quaternionf: quatf_norm_fast, default: quat_norm_fast)(q)
+#define quat_renorm(q, epsilon)     _Generic((q), Quaternionf: quatf_renorm, default: quat_renorm)(q, epsilon)
+#define quat_negate(q)              _Generic((q), Quaternionf: quatf_negate, default: quat_negate)(q)
+#define quat_conjugate(q)           _Generic((q), Quaternionf: quatf_conjugate, default: quat_conjugate)(q)
+#define quat_inverse(q)             _Generic((q), Quaternionf: quatf_inverse, default: quat_inverse)(q)
+
+//---------------------------------------------------------------------------------------------------------------
+#define quat_equal(a, b)            _Generic((a), Quaternionf: quatf_equal, default: quat_equal)(a, b)
+#define quat_matching(a, b)         _Generic((a), Quaternionf: quatf_matching, default: quat_matching)(a, b)
+#define quat_dot(a, b)              _Generic((a), Quaternionf: quatf_dot, default: quat_dot)(a, b)
+#define quat_mul(a, b)              _Generic((a), Quaternionf: quatf_mul, default: quat_mul)(a, b)
+#define quat_rotate_vec3(q, v)      _Generic((q), Quaternionf: quatf_rotate_vec3, default: quat_rotate_vec3)(q, v)
+#define quat_to_matrix44(q, buffer) _Generic((q), Quaternionf: quatf_to_matrix44, default: quat_to_matrix44)(q, buffer)
+#define quat_print(q)               _Generic((q), Quaternionf: quatf_print, default: quat_print)(q)
+
+//---------------------------------------------------------------------------------------------------------------
+#define quat_nlerp(a, b, t)         _Generic((a), Quaternionf: quatf_nlerp, default: quat_nlerp)(a, b, t)
+#define quat_slerp(a, b, t)         _Generic((a), Quaternionf: quatf_slerp, default: quat_slerp)(a, b, t)
+#define quat_slerp_fast(a, b, t)    _Generic((a), Quaternionf: quatf_slerp_fast, default: quat_slerp_fast)(a, b, t)
+
+//---------------------------------------------------------------------------------------------------------------
+#define quat_exp(q)                 _Generic((q), Quaternionf: quatf_exp, default: quat_exp)(q)
+#define quat_log(q)                 _Generic((q), Quaternionf: quatf_log, default: quat_log)(q)
+#define quat_pow(q, t)              _Generic((q), Quaternionf: quatf_pow, default: quat_pow)(q, t)
+
+//---------------------------------------------------------------------------------------------------------------
+#define quat_rotate_vec3_array(q, in, out, count) \
+    _Generic((q), Quaternionf: quatf_rotate_vec3_array, default: quat_rotate_vec3_array)(q, in, out, count)
+#define quat_rotate_vec3_soa(q, x, y, z, out_x, out_y, out_z, count) \
+    _Generic((q), Quaternionf: quatf_rotate_vec3_soa, default: quat_rotate_vec3_soa)(q, x, y, z, out_x, out_y, out_z, count)
+#define quat_norm_array(in, out, count) \
+    _Generic((out), Quaternionf *: quatf_norm_array, default: quat_norm_array)(in, out, count)
+#define quat_renorm_array(q, count, epsilon) \
+    _Generic((q), Quaternionf *: quatf_renorm_array, default: quat_renorm_array)(q, count, epsilon)
+#define quat_interpolate_array(method, a, b, t, out, count) \
+    _Generic((out), Quaternionf *: quatf_interpolate_array, default: quat_interpolate_array)(method, a, b, t, out, count)
+#define quat_interpolate_samples(method, a, b, t, out, count) \
+    _Generic((a), Quaternionf: quatf_interpolate_samples, default: quat_interpolate_samples)(method, a, b, t, out, count)
+
+
+#endif      // AGK_TGMATH_H
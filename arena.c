@@ -0,0 +1,219 @@
+//
+//
+//
+//
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+
+
+// Blocks are single aligned_alloc calls: this header, padded to ARENA_ALIGN, then the data.
+typedef struct arena_block {
+    struct arena_block * next;
+    size_t size;                        // bytes of data
+} ArenaBlock;
+
+#define ARENA_HEADER_SIZE       ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN)
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret a block of at least [size] bytes, a multiple of ARENA_ALIGN; NULL if out of memory or too large
+static ArenaBlock * arena_new_block(size_t size)
+{
+    ArenaBlock * b;
+
+    if (size > SIZE_MAX - ARENA_HEADER_SIZE) {
+        return NULL;
+    }
+    b = aligned_alloc( ARENA_ALIGN, ARENA_HEADER_SIZE + size );
+    if (b != NULL) {
+        b->next = NULL;
+        b->size = size;
+    }
+    return b;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline unsigned char * arena_block_data(ArenaBlock * b)
+{
+    return (unsigned char *) b + ARENA_HEADER_SIZE;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool arena_init(Arena * a, size_t block_size)
+{
+    memset( a, 0, sizeof(*a) );
+    if (block_size == 0) {
+        block_size = ARENA_BLOCK_SIZE;
+    }
+    a->block_size = (block_size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    a->first = a->current = arena_new_block( a->block_size );
+    return a->first != NULL;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void arena_free(Arena * a)
+{
+    ArenaBlock * b = a->first, * next;
+
+    while (b != NULL) {
+        next = b->next;
+        free( b );
+        b = next;
+    }
+    memset( a, 0, sizeof(*a) );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void * arena_alloc(Arena * a, size_t bytes)
+{
+    ArenaBlock * b;
+    size_t size;
+
+    if (bytes > SIZE_MAX - ARENA_ALIGN) {
+        return NULL;
+    }
+    size = (bytes + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+
+    // The blocks after current are all empty: move on to the first that is large enough
+    while (a->current != NULL && size > a->current->size - a->offset) {
+        if (a->current->next == NULL) {
+            b = arena_new_block( (size > a->block_size) ? size : a->block_size );
+            if (b == NULL) {
+                return NULL;
+            }
+            a->current->next = b;
+        }
+        a->current = a->current->next;
+        a->offset = 0;
+    }
+    if (a->current == NULL) {
+        // arena_init failed, or was not called after arena_free
+        return NULL;
+    }
+
+    a->offset += size;
+    return arena_block_data( a->current ) + a->offset - size;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void arena_reset(Arena * a)
+{
+    a->current = a->first;
+    a->offset = 0;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+size_t arena_used(const Arena * a)
+{
+    const ArenaBlock * b;
+    size_t used = a->offset;
+
+    for (b = a->first; b != NULL && b != a->current; b = b->next) {
+        used += b->size;
+    }
+    return used;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+size_t arena_capacity(const Arena * a)
+{
+    const ArenaBlock * b;
+    size_t capacity = 0;
+
+    for (b = a->first; b != NULL; b = b->next) {
+        capacity += b->size;
+    }
+    return capacity;
+}
+
+
+
+//==========================================================================================================================================
+//==========================================================================================================================================
+//==========================================================================================================================================
+#ifdef ARENA_UNITTEST
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Every allocation is aligned and inside the arena, including one larger than a block. After a reset the same sequence
+// of allocations gets the same addresses, without adding blocks.
+void test_arena_alloc(void)
+{
+    const size_t sizes[6] = {1, 100, 0, 3000, 10000, 64};
+    void * first[6], * p;
+    Arena a;
+    size_t capacity;
+    int frame, i;
+
+    g_assert_true(  arena_init(&a, 4096)  );
+    g_assert_cmpuint(  arena_capacity(&a), ==, 4096  );
+
+    for (frame = 0; frame < 3; frame++) {
+        for (i = 0; i < 6; i++) {
+            p = arena_alloc( &a, sizes[i] );
+            g_assert_nonnull(  p  );
+            g_assert_cmpuint(  (uintptr_t) p % ARENA_ALIGN, ==, 0  );
+            memset( p, i, sizes[i] );
+            if (frame == 0) {
+                first[i] = p;
+            } else {
+                g_assert_true(  p == first[i]  );
+            }
+        }
+        // 3200 bytes in the first block, 10000 in a block of its own, then 64 in a new one
+        g_assert_cmpuint(  arena_used(&a), ==, 4096 + 10048 + 64  );
+        if (frame == 0) {
+            capacity = arena_capacity(&a);
+            g_assert_cmpuint(  capacity, ==, 4096 + 10048 + 4096  );
+        }
+        g_assert_cmpuint(  arena_capacity(&a), ==, capacity  );
+        arena_reset( &a );
+        g_assert_cmpuint(  arena_used(&a), ==, 0  );
+    }
+
+    // Consecutive allocations are packed
+    p = arena_alloc( &a, 100 );
+    g_assert_true(  arena_alloc(&a, 1) == (unsigned char *) p + 128  );
+
+    g_assert_null(  arena_alloc(&a, SIZE_MAX)  );
+    arena_free( &a );
+    g_assert_null(  arena_alloc(&a, 1)  );
+}
+
+
+
+void setuptests(void)
+{
+    g_test_add_func("/set_arena/test_arena_alloc", test_arena_alloc);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // ARENA_UNITTEST
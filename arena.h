@@ -0,0 +1,60 @@
+//
+//
+//
+//
+//
+
+#if ! defined ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+#define ARENA_ALIGN             64              // a cache line, enough for any vector load
+#define ARENA_BLOCK_SIZE        (1 << 20)       // default block size, in bytes
+
+
+// Bump allocator for per-frame data. Allocations are carved out of large blocks, aligned on ARENA_ALIGN and never freed
+// one by one: arena_reset releases all of them at once and keeps the blocks, so that a frame allocating the same
+// amount as the previous one makes no call to malloc at all. A request that does not fit the current block moves on
+// to the next one, or allocates a new block of at least the requested size.
+// The fields are private.
+typedef struct arena {
+    struct arena_block * first;
+    struct arena_block * current;
+    size_t offset;                      // bytes used in current
+    size_t block_size;
+} Arena;
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Allocates the first block up front.
+// @param [block_size] bytes per block, 0 for ARENA_BLOCK_SIZE
+// @ret false if out of memory
+bool arena_init(Arena * a, size_t block_size);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Frees every block. Everything allocated from [a] becomes invalid.
+void arena_free(Arena * a);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret [bytes] of uninitialised memory aligned on ARENA_ALIGN, valid until the next arena_reset; NULL if out of memory
+void * arena_alloc(Arena * a, size_t bytes);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Releases every allocation at once, keeping the blocks for the next ones. Constant time.
+void arena_reset(Arena * a);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret bytes currently allocated from [a], including the alignment padding and the unused ends of the blocks left behind
+size_t arena_used(const Arena * a);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret bytes held in blocks, what arena_used can grow to without a call to malloc
+size_t arena_capacity(const Arena * a);
+
+
+#endif      // ARENA_H
@@ -0,0 +1,642 @@
+//
+//
+//
+//
+//
+
+#define _POSIX_C_SOURCE 200809L         // mmap, posix_madvise, sysconf
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>             // for static_assert of the on-disk sizes
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "arrayfile.h"
+#include "quatpack.h"
+#include "vec3pack.h"
+
+
+static_assert( sizeof(ArrayFileHeader) == 64, "Error: ArrayFileHeader does not match the file format!\n" );
+static_assert( sizeof(ArrayFileSection) == 128, "Error: ArrayFileSection does not match the file format!\n" );
+
+
+#define ARRAYFILE_CHUNK     4096        // bytes of the buffer the writer transposes SoA components through
+
+
+// Element size of each type, and its component count in SoA (0 when it can only be stored AoS)
+static const struct {
+    size_t size;
+    unsigned components;
+} arrayfile_types[ARRAYFILE_TYPE_COUNT] = {
+    [ARRAYFILE_DOUBLE]      = { sizeof(double), 1 },
+    [ARRAYFILE_FLOAT]       = { sizeof(float), 1 },
+    [ARRAYFILE_VECTOR3]     = { sizeof(Vector3), 3 },
+    [ARRAYFILE_VECTOR3F]    = { sizeof(Vector3f), 3 },
+    [ARRAYFILE_QUATERNION]  = { sizeof(Quaternion), 4 },
+    [ARRAYFILE_QUATERNIONF] = { sizeof(Quaternionf), 4 },
+    [ARRAYFILE_QUATPACK32]  = { sizeof(QuatPack32), 0 },
+    [ARRAYFILE_QUATPACK48]  = { sizeof(QuatPack48), 0 },
+    [ARRAYFILE_QUATPACK64]  = { sizeof(QuatPack64), 0 },
+    [ARRAYFILE_VECTOR3H]    = { sizeof(Vector3h), 0 },
+    [ARRAYFILE_VECTOR3Q16]  = { sizeof(Vector3q16), 0 },
+    [ARRAYFILE_VECTOR3Q21]  = { sizeof(Vector3q21), 0 }
+};
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline uint64_t arrayfile_align(uint64_t bytes)
+{
+    return (bytes + ARRAYFILE_ALIGN - 1) & ~(uint64_t) (ARRAYFILE_ALIGN - 1);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Writes zeros from [pos] up to [to]
+static bool arrayfile_pad(FILE * file, uint64_t * pos, uint64_t to)
+{
+    static const uint8_t zeros[ARRAYFILE_ALIGN];
+    size_t n;
+
+    while (*pos < to) {
+        n = (to - *pos < ARRAYFILE_ALIGN) ? (size_t) (to - *pos) : ARRAYFILE_ALIGN;
+        if (fwrite(zeros, 1, n, file) != n) {
+            return false;
+        }
+        *pos += n;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Fills the section of [stream] to be written at [offset]
+static bool arrayfile_section(const ArrayFileStream * stream, uint64_t offset, ArrayFileSection * s)
+{
+    size_t name_len = (stream->name != NULL) ? strlen(stream->name) : ARRAYFILE_NAME_SIZE;
+    uint64_t array_bytes;
+
+    if (name_len >= ARRAYFILE_NAME_SIZE || (unsigned) stream->type >= ARRAYFILE_TYPE_COUNT) {
+        return false;
+    }
+
+    memset( s, 0, sizeof(*s) );
+    memcpy( s->name, stream->name, name_len );
+    s->type = (uint32_t) stream->type;
+    s->layout = (uint32_t) stream->layout;
+    s->count = stream->count;
+    s->offset = offset;
+
+    switch (stream->layout) {
+    case ARRAYFILE_AOS:
+        s->components = 1;
+        break;
+    case ARRAYFILE_SOA:
+        s->components = arrayfile_types[stream->type].components;
+        break;
+    default:
+        return false;
+    }
+    if (s->components == 0) {
+        return false;
+    }
+
+    array_bytes = (uint64_t) stream->count * (arrayfile_types[stream->type].size / s->components);
+    s->component_stride = arrayfile_align( array_bytes );
+    s->bytes = s->component_stride * s->components;
+
+    if (stream->type >= ARRAYFILE_QUATPACK32) {
+        s->flags |= ARRAYFILE_COMPRESSED;
+    }
+    memcpy( s->bounds_min, stream->bounds_min.v, sizeof(s->bounds_min) );
+    memcpy( s->bounds_max, stream->bounds_max.v, sizeof(s->bounds_max) );
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Writes the data of [stream], transposing it for SoA
+static bool arrayfile_write_data(FILE * file, const ArrayFileStream * stream, const ArrayFileSection * s, uint64_t * pos)
+{
+    uint8_t buffer[ARRAYFILE_CHUNK];
+    const uint8_t * src = stream->data;
+    size_t size = arrayfile_types[stream->type].size;
+    size_t csize = size / s->components;
+    size_t per_chunk = ARRAYFILE_CHUNK / csize;
+    size_t k, j, n;
+    unsigned c;
+
+    if (s->components == 1) {
+        if (stream->count > 0 && fwrite(src, size, stream->count, file) != stream->count) {
+            return false;
+        }
+        *pos += (uint64_t) size * stream->count;
+        return arrayfile_pad( file, pos, s->offset + s->component_stride );
+    }
+
+    for (c = 0; c < s->components; c++) {
+        for (k = 0; k < stream->count; k += n) {
+            n = (stream->count - k < per_chunk) ? stream->count - k : per_chunk;
+            for (j = 0; j < n; j++) {
+                memcpy( buffer + j * csize, src + (k + j) * size + c * csize, csize );
+            }
+            if (fwrite(buffer, csize, n, file) != n) {
+                return false;
+            }
+            *pos += (uint64_t) csize * n;
+        }
+        if (!arrayfile_pad(file, pos, s->offset + (c + 1) * s->component_stride)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool arrayfile_write(const char * path, const ArrayFileStream * streams, size_t stream_count)
+{
+    ArrayFileSection * sections = calloc( (stream_count > 0) ? stream_count : 1, sizeof(ArrayFileSection) );
+    ArrayFileHeader header;
+    FILE * file = NULL;
+    uint64_t offset, pos = 0;
+    bool ok = (sections != NULL);
+    size_t k;
+
+    offset = arrayfile_align( sizeof(header) + stream_count * sizeof(ArrayFileSection) );
+    for (k = 0; ok && k < stream_count; k++) {
+        ok = arrayfile_section( &streams[k], offset, &sections[k] );
+        offset += sections[k].bytes;
+    }
+
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.magic, ARRAYFILE_MAGIC, sizeof(header.magic) );
+    header.version = ARRAYFILE_VERSION;
+    header.byte_order = ARRAYFILE_BYTE_ORDER;
+    header.section_count = (uint32_t) stream_count;
+    header.section_size = sizeof(ArrayFileSection);
+    header.file_size = offset;
+
+    if (ok) {
+        file = fopen( path, "wb" );
+        ok = (file != NULL);
+    }
+    if (ok) {
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(sections, sizeof(ArrayFileSection), stream_count, file) == stream_count;
+        pos = sizeof(header) + stream_count * sizeof(ArrayFileSection);
+    }
+    for (k = 0; ok && k < stream_count; k++) {
+        ok = arrayfile_pad( file, &pos, sections[k].offset ) && arrayfile_write_data( file, &streams[k], &sections[k], &pos );
+    }
+
+    if (file != NULL && fclose(file) != 0) {
+        ok = false;
+    }
+    free( sections );
+    return ok;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Validates the header and every section of the mapping in [f]
+static bool arrayfile_check(ArrayFile * f)
+{
+    const ArrayFileHeader * header = (const ArrayFileHeader *) f->map;
+    const ArrayFileSection * s;
+    uint64_t array_bytes;
+    size_t k;
+
+    if (memcmp(header->magic, ARRAYFILE_MAGIC, sizeof(header->magic)) != 0 || header->version != ARRAYFILE_VERSION ||
+        header->byte_order != ARRAYFILE_BYTE_ORDER || header->section_size != sizeof(ArrayFileSection) ||
+        header->file_size > f->size ||
+        header->section_count > (f->size - sizeof(ArrayFileHeader)) / sizeof(ArrayFileSection)) {
+        return false;
+    }
+
+    f->sections = (const ArrayFileSection *) (f->map + sizeof(ArrayFileHeader));
+    f->section_count = header->section_count;
+
+    for (k = 0; k < f->section_count; k++) {
+        s = &f->sections[k];
+        if (memchr(s->name, '\0', sizeof(s->name)) == NULL || s->type >= ARRAYFILE_TYPE_COUNT ||
+            s->components != ((s->layout == ARRAYFILE_SOA) ? arrayfile_types[s->type].components : 1) ||
+            s->components == 0 || s->layout > ARRAYFILE_SOA ||
+            s->offset % ARRAYFILE_ALIGN != 0 || s->component_stride % ARRAYFILE_ALIGN != 0 ||
+            s->count > f->size / arrayfile_types[s->type].size ||
+            s->offset > f->size || s->bytes > f->size - s->offset ||
+            s->component_stride > s->bytes / s->components) {
+            return false;
+        }
+        array_bytes = s->count * (arrayfile_types[s->type].size / s->components);
+        if (array_bytes > s->component_stride) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool arrayfile_open(ArrayFile * f, const char * path)
+{
+    struct stat st;
+    void * map;
+    int fd;
+
+    memset( f, 0, sizeof(*f) );
+
+    fd = open( path, O_RDONLY );
+    if (fd < 0) {
+        return false;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(ArrayFileHeader)) {
+        close( fd );
+        return false;
+    }
+
+    map = mmap( NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );                        // the mapping keeps its own reference to the file
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    f->map = map;
+    f->size = (size_t) st.st_size;
+    if (!arrayfile_check(f)) {
+        arrayfile_close( f );
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void arrayfile_close(ArrayFile * f)
+{
+    if (f->map != NULL) {
+        munmap( (void *) (uintptr_t) f->map, f->size );
+    }
+    memset( f, 0, sizeof(*f) );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+const ArrayFileSection * arrayfile_find(const ArrayFile * f, const char * name)
+{
+    size_t k;
+
+    for (k = 0; k < f->section_count; k++) {
+        if (strncmp(f->sections[k].name, name, ARRAYFILE_NAME_SIZE) == 0) {
+            return &f->sections[k];
+        }
+    }
+    return NULL;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void arrayfile_prefetch(const ArrayFile * f, const ArrayFileSection * s)
+{
+    uint64_t page = (uint64_t) sysconf( _SC_PAGESIZE );
+    uint64_t start = s->offset / page * page;
+
+    posix_madvise( (void *) (uintptr_t) (f->map + start), (size_t) (s->offset + s->bytes - start), POSIX_MADV_WILLNEED );
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+const void * arrayfile_data(const ArrayFile * f, const ArrayFileSection * s, unsigned component)
+{
+    if (component >= s->components) {
+        return NULL;
+    }
+    return f->map + s->offset + component * s->component_stride;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Section of the AoS stream [name] of [type], NULL if there is none
+static const ArrayFileSection * arrayfile_find_aos(const ArrayFile * f, const char * name, ArrayFileType type,
+                                                   size_t * count)
+{
+    const ArrayFileSection * s = arrayfile_find( f, name );
+
+    if (s == NULL || s->type != (uint32_t) type || s->layout != ARRAYFILE_AOS) {
+        return NULL;
+    }
+    if (count != NULL) {
+        *count = s->count;
+    }
+    return s;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+const Quaternion * arrayfile_quaternions(const ArrayFile * f, const char * name, size_t * count)
+{
+    const ArrayFileSection * s = arrayfile_find_aos( f, name, ARRAYFILE_QUATERNION, count );
+
+    return (s != NULL) ? arrayfile_data( f, s, 0 ) : NULL;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+const Vector3 * arrayfile_vectors(const ArrayFile * f, const char * name, size_t * count)
+{
+    const ArrayFileSection * s = arrayfile_find_aos( f, name, ARRAYFILE_VECTOR3, count );
+
+    return (s != NULL) ? arrayfile_data( f, s, 0 ) : NULL;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Interleaves elements [first, first + count) of the SoA components of [s], doubles or floats, into [out] as doubles
+// with [n] components per element
+static void arrayfile_gather(const ArrayFile * f, const ArrayFileSection * s, size_t first, size_t count,
+                             bool single, unsigned n, double * out)
+{
+    const double * d;
+    const float * fl;
+    unsigned c;
+    size_t k;
+
+    for (c = 0; c < n; c++) {
+        if (single) {
+            fl = (const float *) arrayfile_data( f, s, c ) + first;
+            for (k = 0; k < count; k++) {
+                out[k * n + c] = (double) fl[k];
+            }
+        } else {
+            d = (const double *) arrayfile_data( f, s, c ) + first;
+            for (k = 0; k < count; k++) {
+                out[k * n + c] = d[k];
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool arrayfile_read_quaternions(const ArrayFile * f, const ArrayFileSection * s, size_t first, size_t count,
+                                Quaternion * out)
+{
+    const uint8_t * data = arrayfile_data( f, s, 0 );
+    size_t k;
+
+    if (first > s->count || count > s->count - first) {
+        return false;
+    }
+
+    switch ((ArrayFileType) s->type) {
+    case ARRAYFILE_QUATERNION:
+        if (s->layout == ARRAYFILE_SOA) {
+            arrayfile_gather( f, s, first, count, false, 4, out->q );
+        } else {
+            memcpy( out, (const Quaternion *) data + first, count * sizeof(Quaternion) );
+        }
+        return true;
+    case ARRAYFILE_QUATERNIONF:
+        if (s->layout == ARRAYFILE_SOA) {
+            arrayfile_gather( f, s, first, count, true, 4, out->q );
+        } else {
+            for (k = 0; k < count; k++) {
+                out[k] = quat_from_quatf( ((const Quaternionf *) data)[first + k] );
+            }
+        }
+        return true;
+    case ARRAYFILE_QUATPACK32:
+        quat_unpack32_array( (const QuatPack32 *) data + first, out, count );
+        return true;
+    case ARRAYFILE_QUATPACK48:
+        quat_unpack48_array( (const QuatPack48 *) data + first, out, count );
+        return true;
+    case ARRAYFILE_QUATPACK64:
+        quat_unpack64_array( (const QuatPack64 *) data + first, out, count );
+        return true;
+    case ARRAYFILE_DOUBLE:
+    case ARRAYFILE_FLOAT:
+    case ARRAYFILE_VECTOR3:
+    case ARRAYFILE_VECTOR3F:
+    case ARRAYFILE_VECTOR3H:
+    case ARRAYFILE_VECTOR3Q16:
+    case ARRAYFILE_VECTOR3Q21:
+    case ARRAYFILE_TYPE_COUNT:
+    default:
+        return false;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool arrayfile_read_vectors(const ArrayFile * f, const ArrayFileSection * s, size_t first, size_t count, Vector3 * out)
+{
+    const uint8_t * data = arrayfile_data( f, s, 0 );
+    Vector3 bmin, bmax;
+    size_t k;
+
+    if (first > s->count || count > s->count - first) {
+        return false;
+    }
+    memcpy( bmin.v, s->bounds_min, sizeof(bmin.v) );
+    memcpy( bmax.v, s->bounds_max, sizeof(bmax.v) );
+
+    switch ((ArrayFileType) s->type) {
+    case ARRAYFILE_VECTOR3:
+        if (s->layout == ARRAYFILE_SOA) {
+            arrayfile_gather( f, s, first, count, false, 3, out->v );
+        } else {
+            memcpy( out, (const Vector3 *) data + first, count * sizeof(Vector3) );
+        }
+        return true;
+    case ARRAYFILE_VECTOR3F:
+        if (s->layout == ARRAYFILE_SOA) {
+            arrayfile_gather( f, s, first, count, true, 3, out->v );
+        } else {
+            for (k = 0; k < count; k++) {
+                out[k] = vec3_from_vec3f( ((const Vector3f *) data)[first + k] );
+            }
+        }
+        return true;
+    case ARRAYFILE_VECTOR3H:
+        vec3_from_vec3h_array( (const Vector3h *) data + first, out, count );
+        return true;
+    case ARRAYFILE_VECTOR3Q16:
+        vec3_from_vec3q16_array( (const Vector3q16 *) data + first,
+                                 vec3_quantization_from_bounds(bmin, bmax, VEC3_Q16_BITS), out, count );
+        return true;
+    case ARRAYFILE_VECTOR3Q21:
+        vec3_from_vec3q21_array( (const Vector3q21 *) data + first,
+                                 vec3_quantization_from_bounds(bmin, bmax, VEC3_Q21_BITS), out, count );
+        return true;
+    case ARRAYFILE_DOUBLE:
+    case ARRAYFILE_FLOAT:
+    case ARRAYFILE_QUATERNION:
+    case ARRAYFILE_QUATERNIONF:
+    case ARRAYFILE_QUATPACK32:
+    case ARRAYFILE_QUATPACK48:
+    case ARRAYFILE_QUATPACK64:
+    case ARRAYFILE_TYPE_COUNT:
+    default:
+        return false;
+    }
+}
+
+
+
+
+
+
+
+
+
+//==========================================================================================================================================
+// Unit testing facilities
+#ifdef ARRAYFILE_UNITTEST
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+
+
+
+#define TESTCOUNT   517
+#define TESTFILE    "arrayfile_unittest.bin"
+
+static Quaternion testq[TESTCOUNT];
+static Vector3 testv[TESTCOUNT];
+static QuatPack32 testp[TESTCOUNT];
+static Vector3q16 testc[TESTCOUNT];
+
+static void test_data(void)
+{
+    Vec3Quantization quant = vec3_quantization_from_bounds( vec3_from_values(-10.0, -10.0, -10.0),
+                                                            vec3_from_values(10.0, 10.0, 10.0), VEC3_Q16_BITS );
+    size_t k;
+
+    for (k = 0; k < TESTCOUNT; k++) {
+        testq[k] = quat_norm( quat_from_euler_angles(0.01 * (double) k, 1.0 - 0.003 * (double) k, 0.5) );
+        testv[k] = vec3_from_values( 0.01 * (double) k, -5.0 + 0.02 * (double) k, 3.0 );
+    }
+    quat_pack32_array( testq, testp, TESTCOUNT );
+    vec3q16_from_vec3_array( testv, quant, testc, TESTCOUNT );
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_arrayfile_roundtrip(void)
+{
+    ArrayFileStream streams[5] = {
+        { "rotations",  ARRAYFILE_QUATERNION, ARRAYFILE_AOS, testq, TESTCOUNT, {{0}}, {{0}} },
+        { "positions",  ARRAYFILE_VECTOR3,    ARRAYFILE_SOA, testv, TESTCOUNT, {{0}}, {{0}} },
+        { "packed",     ARRAYFILE_QUATPACK32, ARRAYFILE_AOS, testp, TESTCOUNT, {{0}}, {{0}} },
+        { "quantized",  ARRAYFILE_VECTOR3Q16, ARRAYFILE_AOS, testc, TESTCOUNT,
+          {{-10.0, -10.0, -10.0}}, {{10.0, 10.0, 10.0}} },
+        { "empty",      ARRAYFILE_VECTOR3,    ARRAYFILE_AOS, NULL, 0, {{0}}, {{0}} }
+    };
+    Vec3Quantization quant = vec3_quantization_from_bounds( streams[3].bounds_min, streams[3].bounds_max, VEC3_Q16_BITS );
+    Quaternion q[TESTCOUNT];
+    Vector3 v[TESTCOUNT];
+    const ArrayFileSection * s;
+    const double * x;
+    size_t count = 0;
+    ArrayFile f;
+
+    test_data();
+    g_assert_true(  arrayfile_write(TESTFILE, streams, 5)  );
+    g_assert_true(  arrayfile_open(&f, TESTFILE)  );
+    g_assert_cmpuint( f.section_count, ==, 5 );
+
+    // In place views, aligned
+    g_assert_nonnull(  arrayfile_quaternions(&f, "rotations", &count)  );
+    g_assert_cmpuint( count, ==, TESTCOUNT );
+    g_assert_cmpuint( (uintptr_t) arrayfile_quaternions(&f, "rotations", NULL) % ARRAYFILE_ALIGN, ==, 0 );
+    g_assert_true(  memcmp(arrayfile_quaternions(&f, "rotations", NULL), testq, sizeof(testq)) == 0  );
+    g_assert_null(  arrayfile_vectors(&f, "positions", NULL)  );                  // SoA
+    g_assert_null(  arrayfile_vectors(&f, "missing", NULL)  );
+
+    s = arrayfile_find( &f, "positions" );
+    g_assert_nonnull( s );
+    x = arrayfile_data( &f, s, 1 );
+    g_assert_cmpuint( (uintptr_t) x % ARRAYFILE_ALIGN, ==, 0 );
+    g_assert_cmpfloat( x[7], ==, testv[7].y );
+    g_assert_null(  arrayfile_data(&f, s, 3)  );
+    arrayfile_prefetch( &f, s );
+
+    // Copies and decoding
+    g_assert_true(  arrayfile_read_vectors(&f, s, 0, TESTCOUNT, v)  );
+    g_assert_true(  memcmp(v, testv, sizeof(testv)) == 0  );
+    g_assert_true(  arrayfile_read_vectors(&f, s, 10, 5, v)  );
+    g_assert_true(  memcmp(v, testv + 10, 5 * sizeof(Vector3)) == 0  );
+    g_assert_false(  arrayfile_read_vectors(&f, s, 10, TESTCOUNT, v)  );
+    g_assert_false(  arrayfile_read_quaternions(&f, s, 0, 1, q)  );
+
+    g_assert_true(  arrayfile_read_quaternions(&f, arrayfile_find(&f, "packed"), 0, TESTCOUNT, q)  );
+    g_assert_cmpuint( arrayfile_find(&f, "packed")->flags & ARRAYFILE_COMPRESSED, ==, ARRAYFILE_COMPRESSED );
+    g_assert_true(  quat_equal(q[100], quat_unpack32(testp[100]))  );
+    g_assert_true(  arrayfile_read_vectors(&f, arrayfile_find(&f, "quantized"), 0, TESTCOUNT, v)  );
+    g_assert_true(  vec3_equal(v[200], vec3_from_vec3q16(testc[200], quant))  );
+
+    g_assert_cmpuint( arrayfile_find(&f, "empty")->count, ==, 0 );
+    arrayfile_close( &f );
+    remove( TESTFILE );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Files that are not containers, or truncated ones, are refused
+void test_arrayfile_invalid(void)
+{
+    ArrayFileStream stream = { "rotations", ARRAYFILE_QUATERNION, ARRAYFILE_AOS, testq, TESTCOUNT, {{0}}, {{0}} };
+    ArrayFileStream bad = { "packed", ARRAYFILE_QUATPACK32, ARRAYFILE_SOA, testp, TESTCOUNT, {{0}}, {{0}} };
+    uint8_t buffer[4096];
+    ArrayFile f;
+    FILE * file;
+    size_t n;
+
+    test_data();
+    g_assert_false(  arrayfile_open(&f, "arrayfile_missing.bin")  );
+    g_assert_false(  arrayfile_write(TESTFILE, &bad, 1)  );
+
+    g_assert_true(  arrayfile_write(TESTFILE, &stream, 1)  );
+    file = fopen( TESTFILE, "rb" );
+    n = fread( buffer, 1, sizeof(buffer), file );
+    fclose( file );
+
+    file = fopen( TESTFILE, "wb" );
+    fwrite( buffer, 1, n, file );                               // the first 4096 bytes of a 16 KB stream
+    fclose( file );
+    g_assert_false(  arrayfile_open(&f, TESTFILE)  );
+
+    buffer[0] = 'X';
+    file = fopen( TESTFILE, "wb" );
+    fwrite( buffer, 1, n, file );
+    fclose( file );
+    g_assert_false(  arrayfile_open(&f, TESTFILE)  );
+    g_assert_null( f.map );
+
+    remove( TESTFILE );
+}
+
+
+
+void setuptests(void)
+{
+    g_test_add_func("/set_arrayfile/test_arrayfile_roundtrip", test_arrayfile_roundtrip);
+    g_test_add_func("/set_arrayfile/test_arrayfile_invalid", test_arrayfile_invalid);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // ARRAYFILE_UNITTEST
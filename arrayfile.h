@@ -0,0 +1,158 @@
+//
+//
+//
+//
+//
+
+#if ! defined ARRAYFILE_H
+#define ARRAYFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector3.h"
+#include "quaternion.h"
+
+
+// Binary container for named arrays (streams) of the agk types, read through mmap so that opening a file costs the
+// same whatever its size and the arrays are used in place by the batch functions, without parsing or copying.
+//
+// File layout, little endian, every offset from the start of the file:
+//      ArrayFileHeader                     64 bytes
+//      ArrayFileSection * section_count    128 bytes each, one per stream
+//      stream data                         each stream, and each SoA component array, starts on ARRAYFILE_ALIGN bytes
+//
+// A stream is stored either as an array of its elements (AoS) or, for the vector and quaternion types, as one array
+// per component (SoA: all x, then all y, ...) for the _soa functions. The packed types of quatpack.h and vec3pack.h
+// are flagged ARRAYFILE_COMPRESSED; arrayfile_read_quaternions / arrayfile_read_vectors decode them.
+#define ARRAYFILE_MAGIC         "AGKARRAY"
+#define ARRAYFILE_VERSION       1
+#define ARRAYFILE_BYTE_ORDER    0x01020304u     // as written by the writer, read back differently on the other byte order
+#define ARRAYFILE_ALIGN         64              // a cache line, enough for any vector load
+#define ARRAYFILE_NAME_SIZE     32              // including the terminating NUL
+#define ARRAYFILE_COMPRESSED    1u              // ArrayFileSection flags: the elements use a packed encoding
+
+
+typedef enum arrayfile_type {
+    ARRAYFILE_DOUBLE,
+    ARRAYFILE_FLOAT,
+    ARRAYFILE_VECTOR3,
+    ARRAYFILE_VECTOR3F,
+    ARRAYFILE_QUATERNION,
+    ARRAYFILE_QUATERNIONF,
+    ARRAYFILE_QUATPACK32,
+    ARRAYFILE_QUATPACK48,
+    ARRAYFILE_QUATPACK64,
+    ARRAYFILE_VECTOR3H,
+    ARRAYFILE_VECTOR3Q16,
+    ARRAYFILE_VECTOR3Q21,
+    ARRAYFILE_TYPE_COUNT
+} ArrayFileType;
+
+typedef enum arrayfile_layout {
+    ARRAYFILE_AOS,
+    ARRAYFILE_SOA
+} ArrayFileLayout;
+
+
+typedef struct arrayfile_header {
+    char magic[8];                          // ARRAYFILE_MAGIC, no NUL
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t section_count;
+    uint32_t section_size;                  // sizeof(ArrayFileSection) of the writer
+    uint64_t file_size;
+    uint8_t reserved[32];
+} ArrayFileHeader;
+
+typedef struct arrayfile_section {
+    char name[ARRAYFILE_NAME_SIZE];
+    uint32_t type;                          // ArrayFileType
+    uint32_t layout;                        // ArrayFileLayout
+    uint32_t flags;
+    uint32_t components;                    // arrays of the stream: 1 for AoS, 3 or 4 for SoA
+    uint64_t count;                         // elements
+    uint64_t offset;                        // of the first array
+    uint64_t component_stride;              // bytes from one SoA component array to the next
+    uint64_t bytes;                         // of all the arrays, padding included
+    double bounds_min[3];                   // box of the ARRAYFILE_VECTOR3Q16 / Q21 codes, see vec3pack.h
+    double bounds_max[3];
+} ArrayFileSection;
+
+
+// A stream to write. [data] always holds [count] elements of [type] as an array, the writer transposes it for SoA.
+typedef struct arrayfile_stream {
+    const char * name;
+    ArrayFileType type;
+    ArrayFileLayout layout;
+    const void * data;
+    size_t count;
+    Vector3 bounds_min;                     // only for ARRAYFILE_VECTOR3Q16 / Q21, as given to vec3_quantization_from_bounds
+    Vector3 bounds_max;
+} ArrayFileStream;
+
+
+// An open file. The fields are read-only.
+typedef struct arrayfile {
+    const uint8_t * map;
+    size_t size;
+    const ArrayFileSection * sections;
+    size_t section_count;
+} ArrayFile;
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Writes [stream_count] streams to [path], replacing the file.
+// @ret false on a write error, a name that does not fit ARRAYFILE_NAME_SIZE, or SoA asked for a type without components
+bool arrayfile_write(const char * path, const ArrayFileStream * streams, size_t stream_count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Maps [path] read-only. Every section is checked against the file size, so the views below never point outside it.
+// @ret false if the file can not be mapped, is not a container of this version and byte order, or is truncated
+bool arrayfile_open(ArrayFile * f, const char * path);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Unmaps [f]. The views taken from it become invalid.
+void arrayfile_close(ArrayFile * f);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret the section of the stream called [name], NULL if there is none
+const ArrayFileSection * arrayfile_find(const ArrayFile * f, const char * name);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Asks the kernel to start reading the pages of [s] in the background, ahead of the first access.
+void arrayfile_prefetch(const ArrayFile * f, const ArrayFileSection * s);
+
+
+
+//==========================================================================================================================================
+// Zero copy views into the mapping, valid until arrayfile_close.
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @param [component] 0 for AoS; the component array (x y z or w x y z) for SoA
+// @ret start of the array, aligned on ARRAYFILE_ALIGN, NULL if [component] is out of range
+const void * arrayfile_data(const ArrayFile * f, const ArrayFileSection * s, unsigned component);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Typed views of AoS streams, NULL if the stream is missing or of another type or layout.
+// @param [count] receives the element count, may be NULL
+const Quaternion * arrayfile_quaternions(const ArrayFile * f, const char * name, size_t * count);
+const Vector3 * arrayfile_vectors(const ArrayFile * f, const char * name, size_t * count);
+
+
+
+//==========================================================================================================================================
+// Copies for the streams that can not be used in place: decodes elements [first, first + count) of any quaternion,
+// respectively vector, stream whatever its precision, layout or packing, into [out].
+// @ret false if [s] holds another kind of element or the range is outside the stream
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool arrayfile_read_quaternions(const ArrayFile * f, const ArrayFileSection * s, size_t first, size_t count,
+                                Quaternion * out);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool arrayfile_read_vectors(const ArrayFile * f, const ArrayFileSection * s, size_t first, size_t count, Vector3 * out);
+
+
+#endif      // ARRAYFILE_H
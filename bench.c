@@ -0,0 +1,694 @@
+//
+//
+//
+//
+//
+//
+// Micro benchmarks of the quat_ / vec3_ / mat44_ / dualquat_ functions. Built by bench.pro, not part of the library.
+//
+// Every function is timed over arrays of 4 sizes, chosen so that the working set of a typical benchmark
+// (two 32 byte inputs and one output per item) sits in L1, L2, L3 and main memory respectively.
+// For each function and size the best of several repetitions is reported as ns/op, items/s and GB/s, where GB/s
+// counts the bytes of the inputs read and outputs written per item.
+//
+// Usage: bench [filter]
+//   [filter] only runs the benchmarks whose name contains this string.
+// Results are printed as a table and written tab separated to bench_output.txt, one line per function and size,
+// so that two runs can be compared with diff or a spreadsheet.
+// The batch kernels run at the best instruction set tier of the CPU; AGK_SIMD=scalar|sse2|avx2|avx512 picks a lower one
+// to compare them (see dispatch.h).
+
+#define _POSIX_C_SOURCE 200809L         // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "vector3.h"
+#include "quaternion.h"
+#include "matrix44.h"
+#include "dualquat.h"
+#include "skinning.h"
+#include "hierarchy.h"
+#include "quatpack.h"
+#include "vec3pack.h"
+#include "arrayfile.h"
+#include "integrate.h"
+#include "arena.h"
+#include "container.h"
+#include "parallel.h"
+#include "dispatch.h"
+#include "quatindex.h"
+#include "vec3index.h"
+
+
+#define BENCH_OUTPUT            "bench_output.txt"
+#define BENCH_ARRAYFILE         "bench_arrayfile.bin"     // written on first use, removed at exit
+#define BENCH_MAX_ITEMS         (1u << 20)
+#define BENCH_MIN_REPS          5
+#define BENCH_MIN_SECONDS       0.02    // per function and size
+#define BENCH_BONES             64      // skeleton size of the skinning benchmarks, bones taken from dqa
+#define BENCH_MIN_SAMPLE_ITEMS  65536   // small sizes are run several times per timed sample to stay above timer resolution
+
+
+typedef void (*BenchKernel)(size_t count);
+
+typedef struct bench {
+    const char * name;
+    BenchKernel kernel;
+    size_t bytes;                       // bytes read and written per item
+} Bench;
+
+
+static const struct {
+    const char * level;
+    size_t items;
+} bench_sizes[] = {
+    { "L1",   256 },                    //  24 KB for two quaternion inputs and one output
+    { "L2",   4096 },                   // 384 KB
+    { "L3",   65536 },                  //   6 MB
+    { "DRAM", BENCH_MAX_ITEMS }         //  96 MB
+};
+
+
+// Inputs (a, b) and outputs (o) of every benchmark, BENCH_MAX_ITEMS long
+static double *ra, *ro, *rt;
+static float *rfa, *rfo, *rft;
+static bool *bo;
+static Vector3 *va, *vb, *vo;
+static Vector3f *vfa, *vfb, *vfo;
+static Quaternion *qa, *qb, *qo;
+static Quaternionf *qfa, *qfb, *qfo;
+static Matrix44 *mo, *mr;
+static float *mfo;                      // upload destination, 16 floats per item
+static DualQuaternion *dqa, *dqb, *dqo;
+static uint16_t *bi;                    // SKIN_INFLUENCES bone indices and weights per item
+static float *bw;
+static Vector3 *vno;                    // skinned normals
+static QuatPack32 *qp32;                // qa packed, inputs of the unpack benchmarks
+static QuatPack48 *qp48;
+static QuatPack64 *qp64;
+static Vector3h *vha, *vhb, *vho;       // va, vb in half precision
+static Vector3q16 *vq16;                // va in fixed point over bq16, bq21
+static Vector3q21 *vq21;
+static Vec3Quantization bq16, bq21;     // the [-1, 1] box of the inputs
+static double *sx, *sy, *sz, *sox, *soy, *soz;
+static float *sfx, *sfy, *sfz, *sfox, *sfoy, *sfoz;
+static Vector3 *vsm;                    // va scaled into the Taylor range of the exponential map, angles below 0.03
+static Quaternion *qsm;                 // quat_exp of vsm, rotations close to the identity
+static double *iw, *ix, *iy, *iz;       // qa as SoA, advanced in place by the integrate benchmarks under the velocities sx, sy, sz
+static Hierarchy bh;                    // 4-ary tree of the hierarchy benchmarks, rebuilt when the size changes
+static Arena ba;                        // per-frame arena of the frame_scratch benchmarks
+static QuatIndex bqi;                   // index of qa, built on first use
+static QuatIndexMatch *bqm;             // matches of the quat_index benchmarks, one per query
+static Vec3Index bvi;                   // index of va, built on first use
+static Vec3IndexMatch *bvm;             // matches of the vec3_index benchmarks, one per query
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Marks [node] of a [count] node hierarchy dirty and updates it. Node 0 is the root, so marking it updates everything.
+static void bench_hierarchy_update(size_t count, size_t node)
+{
+    size_t k;
+
+    if (bh.count != count) {
+        hierarchy_free( &bh );
+        if (!hierarchy_init( &bh, count )) {
+            return;
+        }
+        for (k = 0; k < count; k++) {
+            hierarchy_add( &bh, (k == 0) ? HIERARCHY_NONE : (uint32_t) ((k - 1) / 4), qa[k], va[k] );
+        }
+    }
+
+    hierarchy_set_local_rotation( &bh, (uint32_t) node, qb[node] );
+    hierarchy_update( &bh );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// One frame of a [count] point temporary: allocates it, rotates va into it and releases it, with malloc / free or with
+// an arena that is reset every frame.
+static void bench_frame_scratch(size_t count, bool arena)
+{
+    Vec3Array scratch;
+    Vector3 * p;
+
+    if (!arena) {
+        p = malloc( sizeof(Vector3) * count );
+        if (p != NULL) {
+            quat_rotate_vec3_array( qa[0], va, p, count );
+            vo[0] = p[count - 1];
+        }
+        free( p );
+        return;
+    }
+
+    arena_reset( &ba );
+    if (vec3_array_init( &scratch, &ba, ARRAY_AOS, count )) {
+        quat_rotate_vec3_array( qa[0], va, scratch.v, count );
+        vo[0] = scratch.v[count - 1];
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret the index of all of qa, empty if out of memory
+static const QuatIndex * bench_quat_index(void)
+{
+    if (bqi.count == 0) {
+        quat_index_build_parallel( &bqi, qa, BENCH_MAX_ITEMS );
+    }
+    return &bqi;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Builds the index of the first [count] elements of qa and releases it.
+static void bench_build_quat_index(size_t count)
+{
+    QuatIndex index;
+
+    if (quat_index_build( &index, qa, count )) {
+        quat_index_free( &index );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret the index of all of va, empty if out of memory
+static const Vec3Index * bench_vec3_index(void)
+{
+    if (bvi.count == 0) {
+        vec3_index_build_parallel( &bvi, va, BENCH_MAX_ITEMS );
+    }
+    return &bvi;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Builds the index of the first [count] elements of va and releases it.
+static void bench_build_vec3_index(size_t count)
+{
+    Vec3Index index;
+
+    if (vec3_index_build( &index, va, count )) {
+        vec3_index_free( &index );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Copies the first [count] elements of the SoA inputs sx, sy, sz into sox, soy, soz, the operand of the _soa_inplace
+// benchmarks.
+static void bench_soa_copy(size_t count)
+{
+    memcpy( sox, sx, sizeof(double) * count );
+    memcpy( soy, sy, sizeof(double) * count );
+    memcpy( soz, sz, sizeof(double) * count );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Maps the container holding qa as quaternions ("raw") and packed 32 bit quaternions ("packed"), and passes the first
+// [count] elements of [name] through quat_norm_array into qo, straight from the mapping for "raw".
+static void bench_arrayfile(size_t count, const char * name)
+{
+    static bool written = false;
+    ArrayFileStream streams[2] = {
+        { "raw",    ARRAYFILE_QUATERNION, ARRAYFILE_AOS, qa,   BENCH_MAX_ITEMS, {{0}}, {{0}} },
+        { "packed", ARRAYFILE_QUATPACK32, ARRAYFILE_AOS, qp32, BENCH_MAX_ITEMS, {{0}}, {{0}} }
+    };
+    const Quaternion * view;
+    ArrayFile f;
+
+    if (!written) {
+        written = arrayfile_write( BENCH_ARRAYFILE, streams, 2 );
+    }
+    if (!arrayfile_open(&f, BENCH_ARRAYFILE)) {
+        return;
+    }
+
+    view = arrayfile_quaternions( &f, name, NULL );
+    if (view != NULL) {
+        quat_norm_array( view, qo, count );
+    } else {
+        arrayfile_read_quaternions( &f, arrayfile_find(&f, name), 0, count, qo );
+        quat_norm_array( qo, qo, count );
+    }
+    arrayfile_close( &f );
+}
+
+
+
+//==========================================================================================================================================
+// Benchmark bodies. BENCH_ITEMS loops the expression over [0, count) with the index k, BENCH_BATCH calls a batch function once.
+// X(name, bytes per item, expression)
+// The _renorm batch benchmarks work in place on the output of the _norm benchmark before them, so they time the drift
+// check of a buffer that is already unit.
+// The _inplace benchmarks that would drift towards zero or infinity over repeated runs (cross, project_plane) first copy
+// their operand from the input buffer, which their byte counts include; the others run on the output buffer as it is.
+// The _large exponential map benchmarks take angles beyond the Taylor range, so they time the libm path.
+// quat_integrate_calls times the from_angle_axis, mul and norm sequence that quat_integrate (QUAT_INTEGRATE_EXP) replaces.
+// The arrayfile benchmarks include opening and closing the container, whose pages stay in the page cache between runs.
+// hierarchy_update_partial dirties a leaf halfway through, so it times the sweep over the dirty flags of the later half.
+// frame_scratch_malloc and frame_scratch_arena differ by the allocator calls only: glibc raises its mmap threshold after
+// the first large free, so in a steady loop malloc hands back the same pages too. The arena keeps that guarantee
+// whatever the allocator and the interleaving of sizes, and aligns on ARENA_ALIGN.
+// The quat_index_knn benchmarks run [count] queries against the index of all of qa, BENCH_MAX_ITEMS orientations, where
+// a scan of quat_dot over the same orientations takes about 7 ms per query. The vec3_index_knn benchmarks do the same
+// against the index of all of va.
+#define BENCH_ITEMS(X) \
+    X(vec3_from_zeroes,         sizeof(Vector3),                            vo[k] = vec3_from_zeroes()) \
+    X(vec3_from_values,         3*sizeof(double) + sizeof(Vector3),         vo[k] = vec3_from_values(ra[k], ra[k], ra[k])) \
+    X(vec3_from_points,         3*sizeof(Vector3),                          vo[k] = vec3_from_points(va[k], vb[k])) \
+    X(vec3_from_array,          2*sizeof(Vector3),                          vo[k] = vec3_from_array(va[k].v)) \
+    X(vec3_scalar_div,          sizeof(double) + 2*sizeof(Vector3),         vo[k] = vec3_scalar_div(va[k], ra[k])) \
+    X(vec3_scalar_mul,          sizeof(double) + 2*sizeof(Vector3),         vo[k] = vec3_scalar_mul(va[k], ra[k])) \
+    X(vec3_len_squared,         sizeof(Vector3) + sizeof(double),           ro[k] = vec3_len_squared(va[k])) \
+    X(vec3_len,                 sizeof(Vector3) + sizeof(double),           ro[k] = vec3_len(va[k])) \
+    X(vec3_norm,                2*sizeof(Vector3),                          vo[k] = vec3_norm(va[k])) \
+    X(vec3_renorm,              2*sizeof(Vector3),                          vo[k] = vec3_renorm(va[k], 1e-12)) \
+    X(vec3_dot,                 2*sizeof(Vector3) + sizeof(double),         ro[k] = vec3_dot(va[k], vb[k])) \
+    X(vec3_cross,               3*sizeof(Vector3),                          vo[k] = vec3_cross(va[k], vb[k])) \
+    X(vec3_add,                 3*sizeof(Vector3),                          vo[k] = vec3_add(va[k], vb[k])) \
+    X(vec3_equal,               2*sizeof(Vector3) + sizeof(bool),           bo[k] = vec3_equal(va[k], vb[k])) \
+    X(vec3_project_plane,       3*sizeof(Vector3),                          vo[k] = vec3_project_plane(va[k], vb[k])) \
+    \
+    X(vec3f_from_zeroes,        sizeof(Vector3f),                           vfo[k] = vec3f_from_zeroes()) \
+    X(vec3f_from_values,        3*sizeof(float) + sizeof(Vector3f),         vfo[k] = vec3f_from_values(rfa[k], rfa[k], rfa[k])) \
+    X(vec3f_from_points,        3*sizeof(Vector3f),                         vfo[k] = vec3f_from_points(vfa[k], vfb[k])) \
+    X(vec3f_from_array,         2*sizeof(Vector3f),                         vfo[k] = vec3f_from_array(vfa[k].v)) \
+    X(vec3f_from_vec3,          sizeof(Vector3) + sizeof(Vector3f),         vfo[k] = vec3f_from_vec3(va[k])) \
+    X(vec3_from_vec3f,          sizeof(Vector3f) + sizeof(Vector3),         vo[k] = vec3_from_vec3f(vfa[k])) \
+    X(vec3f_scalar_div,         sizeof(float) + 2*sizeof(Vector3f),         vfo[k] = vec3f_scalar_div(vfa[k], rfa[k])) \
+    X(vec3f_scalar_mul,         sizeof(float) + 2*sizeof(Vector3f),         vfo[k] = vec3f_scalar_mul(vfa[k], rfa[k])) \
+    X(vec3f_len_squared,        sizeof(Vector3f) + sizeof(float),           rfo[k] = vec3f_len_squared(vfa[k])) \
+    X(vec3f_len,                sizeof(Vector3f) + sizeof(float),           rfo[k] = vec3f_len(vfa[k])) \
+    X(vec3f_norm,               2*sizeof(Vector3f),                         vfo[k] = vec3f_norm(vfa[k])) \
+    X(vec3f_renorm,             2*sizeof(Vector3f),                         vfo[k] = vec3f_renorm(vfa[k], 1e-6f)) \
+    X(vec3f_dot,                2*sizeof(Vector3f) + sizeof(float),         rfo[k] = vec3f_dot(vfa[k], vfb[k])) \
+    X(vec3f_cross,              3*sizeof(Vector3f),                         vfo[k] = vec3f_cross(vfa[k], vfb[k])) \
+    X(vec3f_add,                3*sizeof(Vector3f),                         vfo[k] = vec3f_add(vfa[k], vfb[k])) \
+    X(vec3f_equal,              2*sizeof(Vector3f) + sizeof(bool),          bo[k] = vec3f_equal(vfa[k], vfb[k])) \
+    X(vec3f_project_plane,      3*sizeof(Vector3f),                         vfo[k] = vec3f_project_plane(vfa[k], vfb[k])) \
+    \
+    X(quat_from_identity,       sizeof(Quaternion),                         qo[k] = quat_from_identity()) \
+    X(quat_from_values,         4*sizeof(double) + sizeof(Quaternion),      qo[k] = quat_from_values(ra[k], ra[k], ra[k], ra[k])) \
+    X(quat_from_angle_axis,     sizeof(double) + sizeof(Vector3) + sizeof(Quaternion), \
+                                                                            qo[k] = quat_from_angle_axis(ra[k], va[k])) \
+    X(quat_from_vec3,           2*sizeof(Vector3) + sizeof(Quaternion),     qo[k] = quat_from_vec3(va[k], vb[k])) \
+    X(quat_from_euler_angles,   sizeof(Vector3) + sizeof(Quaternion),       qo[k] = quat_from_euler_angles(va[k].x, va[k].y, va[k].z)) \
+    X(quat_to_euler_angles,     sizeof(Quaternion) + sizeof(Vector3),       vo[k] = quat_to_euler_angles(qa[k], QUAT_EULER_ZXY)) \
+    X(quat_copy,                2*sizeof(Quaternion),                       qo[k] = quat_copy(qa[k])) \
+    X(quat_len_squared,         sizeof(Quaternion) + sizeof(double),        ro[k] = quat_len_squared(qa[k])) \
+    X(quat_len,                 sizeof(Quaternion) + sizeof(double),        ro[k] = quat_len(qa[k])) \
+    X(quat_norm,                2*sizeof(Quaternion),                       qo[k] = quat_norm(qa[k])) \
+    X(quat_renorm,              2*sizeof(Quaternion),                       qo[k] = quat_renorm(qa[k], 1e-12)) \
+    X(quat_exp,                 2*sizeof(Quaternion),                       qo[k] = quat_exp(qa[k])) \
+    X(quat_log,                 2*sizeof(Quaternion),                       qo[k] = quat_log(qa[k])) \
+    X(quat_pow,                 2*sizeof(Quaternion) + sizeof(double),      qo[k] = quat_pow(qa[k], rt[k])) \
+    X(mat44_to_quat,            sizeof(Matrix44) + sizeof(Quaternion),      qo[k] = mat44_to_quat(mo[k])) \
+    X(quat_integrate_calls,     2*sizeof(Quaternion) + sizeof(Vector3), \
+        qo[k] = quat_norm(quat_mul(quat_from_angle_axis(0.01 * vec3_len(va[k]), va[k]), qa[k]))) \
+    X(quat_integrate,           2*sizeof(Quaternion) + sizeof(Vector3),     qo[k] = quat_integrate(QUAT_INTEGRATE_EXP, qa[k], va[k], 0.01)) \
+    X(quat_norm_fast,           2*sizeof(Quaternion),                       qo[k] = quat_norm_fast(qa[k])) \
+    X(quat_negate,              2*sizeof(Quaternion),                       qo[k] = quat_negate(qa[k])) \
+    X(quat_conjugate,           2*sizeof(Quaternion),                       qo[k] = quat_conjugate(qa[k])) \
+    X(quat_inverse,             2*sizeof(Quaternion),                       qo[k] = quat_inverse(qa[k])) \
+    X(quat_equal,               2*sizeof(Quaternion) + sizeof(bool),        bo[k] = quat_equal(qa[k], qb[k])) \
+    X(quat_matching,            2*sizeof(Quaternion) + sizeof(bool),        bo[k] = quat_matching(qa[k], qb[k])) \
+    X(quat_dot,                 2*sizeof(Quaternion) + sizeof(double),      ro[k] = quat_dot(qa[k], qb[k])) \
+    X(quat_mul,                 3*sizeof(Quaternion),                       qo[k] = quat_mul(qa[k], qb[k])) \
+    X(quat_rotate_vec3,         sizeof(Quaternion) + 2*sizeof(Vector3),     vo[k] = quat_rotate_vec3(qa[k], va[k])) \
+    X(quat_to_matrix44,         sizeof(Quaternion) + sizeof(Matrix44),      quat_to_matrix44(qa[k], mo[k].m)) \
+    X(quat_nlerp,               3*sizeof(Quaternion) + sizeof(double),      qo[k] = quat_nlerp(qa[k], qb[k], rt[k])) \
+    X(quat_slerp,               3*sizeof(Quaternion) + sizeof(double),      qo[k] = quat_slerp(qa[k], qb[k], rt[k])) \
+    X(quat_slerp_fast,          3*sizeof(Quaternion) + sizeof(double),      qo[k] = quat_slerp_fast(qa[k], qb[k], rt[k])) \
+    \
+    X(quatf_from_identity,      sizeof(Quaternionf),                        qfo[k] = quatf_from_identity()) \
+    X(quatf_from_values,        4*sizeof(float) + sizeof(Quaternionf),      qfo[k] = quatf_from_values(rfa[k], rfa[k], rfa[k], rfa[k])) \
+    X(quatf_from_angle_axis,    sizeof(float) + sizeof(Vector3f) + sizeof(Quaternionf), \
+                                                                            qfo[k] = quatf_from_angle_axis(rfa[k], vfa[k])) \
+    X(quatf_from_vec3,          2*sizeof(Vector3f) + sizeof(Quaternionf),   qfo[k] = quatf_from_vec3(vfa[k], vfb[k])) \
+    X(quatf_from_euler_angles,  sizeof(Vector3f) + sizeof(Quaternionf),     qfo[k] = quatf_from_euler_angles(vfa[k].x, vfa[k].y, vfa[k].z)) \
+    X(quatf_from_quat,          sizeof(Quaternion) + sizeof(Quaternionf),   qfo[k] = quatf_from_quat(qa[k])) \
+    X(quat_from_quatf,          sizeof(Quaternionf) + sizeof(Quaternion),   qo[k] = quat_from_quatf(qfa[k])) \
+    X(quatf_copy,               2*sizeof(Quaternionf),                      qfo[k] = quatf_copy(qfa[k])) \
+    X(quatf_len_squared,        sizeof(Quaternionf) + sizeof(float),        rfo[k] = quatf_len_squared(qfa[k])) \
+    X(quatf_len,                sizeof(Quaternionf) + sizeof(float),        rfo[k] = quatf_len(qfa[k])) \
+    X(quatf_norm,               2*sizeof(Quaternionf),                      qfo[k] = quatf_norm(qfa[k])) \
+    X(quatf_renorm,             2*sizeof(Quaternionf),                      qfo[k] = quatf_renorm(qfa[k], 1e-6f)) \
+    X(quatf_exp,                2*sizeof(Quaternionf),                      qfo[k] = quatf_exp(qfa[k])) \
+    X(quatf_log,                2*sizeof(Quaternionf),                      qfo[k] = quatf_log(qfa[k])) \
+    X(quatf_pow,                2*sizeof(Quaternionf) + sizeof(float),      qfo[k] = quatf_pow(qfa[k], rft[k])) \
+    X(quatf_norm_fast,          2*sizeof(Quaternionf),                      qfo[k] = quatf_norm_fast(qfa[k])) \
+    X(quatf_negate,             2*sizeof(Quaternionf),                      qfo[k] = quatf_negate(qfa[k])) \
+    X(quatf_conjugate,          2*sizeof(Quaternionf),                      qfo[k] = quatf_conjugate(qfa[k])) \
+    X(quatf_inverse,            2*sizeof(Quaternionf),                      qfo[k] = quatf_inverse(qfa[k])) \
+    X(quatf_equal,              2*sizeof(Quaternionf) + sizeof(bool),       bo[k] = quatf_equal(qfa[k], qfb[k])) \
+    X(quatf_matching,           2*sizeof(Quaternionf) + sizeof(bool),       bo[k] = quatf_matching(qfa[k], qfb[k])) \
+    X(quatf_dot,                2*sizeof(Quaternionf) + sizeof(float),      rfo[k] = quatf_dot(qfa[k], qfb[k])) \
+    X(quatf_mul,                3*sizeof(Quaternionf),                      qfo[k] = quatf_mul(qfa[k], qfb[k])) \
+    X(quatf_rotate_vec3,        sizeof(Quaternionf) + 2*sizeof(Vector3f),   vfo[k] = quatf_rotate_vec3(qfa[k], vfa[k])) \
+    X(quatf_to_matrix44,        sizeof(Quaternionf) + 16*sizeof(float),     quatf_to_matrix44(qfa[k], mfo + 16*k)) \
+    X(quatf_nlerp,              3*sizeof(Quaternionf) + sizeof(float),      qfo[k] = quatf_nlerp(qfa[k], qfb[k], rft[k])) \
+    X(quatf_slerp,              3*sizeof(Quaternionf) + sizeof(float),      qfo[k] = quatf_slerp(qfa[k], qfb[k], rft[k])) \
+    X(quatf_slerp_fast,         3*sizeof(Quaternionf) + sizeof(float),      qfo[k] = quatf_slerp_fast(qfa[k], qfb[k], rft[k])) \
+    \
+    X(mat44_from_quat,          sizeof(Quaternion) + sizeof(Matrix44),      mo[k] = mat44_from_quat(qa[k])) \
+    X(mat44_from_rotation_translation, sizeof(Quaternion) + sizeof(Vector3) + sizeof(Matrix44), \
+                                                                            mo[k] = mat44_from_rotation_translation(qa[k], va[k])) \
+    X(mat44_transform_point,    2*sizeof(Vector3),                          vo[k] = mat44_transform_point(mo[0], va[k])) \
+    X(mat44_transform_dir,      2*sizeof(Vector3),                          vo[k] = mat44_transform_dir(mo[0], va[k])) \
+    X(mat44_mul,                3*sizeof(Matrix44),                         mr[k] = mat44_mul(mo[k], mo[0])) \
+    X(dualquat_mul,             3*sizeof(DualQuaternion),                   dqo[k] = dualquat_mul(dqa[k], dqb[k])) \
+    X(dualquat_norm,            2*sizeof(DualQuaternion),                   dqo[k] = dualquat_norm(dqa[k])) \
+    X(dualquat_transform_point, 2*sizeof(Vector3),                          vo[k] = dualquat_transform_point(dqa[0], va[k]))
+
+#define BENCH_BATCH(X) \
+    X(quat_rotate_vec3_array,           2*sizeof(Vector3),      quat_rotate_vec3_array(qa[0], va, vo, count)) \
+    X(quat_rotate_vec3_soa,             6*sizeof(double),       quat_rotate_vec3_soa(qa[0], sx, sy, sz, sox, soy, soz, count)) \
+    X(quat_rotate_vec3_array_parallel,  2*sizeof(Vector3),      quat_rotate_vec3_array_parallel(qa[0], va, vo, count)) \
+    X(quat_rotate_vec3_soa_parallel,    6*sizeof(double),       quat_rotate_vec3_soa_parallel(qa[0], sx, sy, sz, sox, soy, soz, count)) \
+    X(quatf_rotate_vec3_array,          2*sizeof(Vector3f),     quatf_rotate_vec3_array(qfa[0], vfa, vfo, count)) \
+    X(quatf_rotate_vec3_soa,            6*sizeof(float),        quatf_rotate_vec3_soa(qfa[0], sfx, sfy, sfz, sfox, sfoy, sfoz, count)) \
+    X(quatf_rotate_vec3_array_parallel, 2*sizeof(Vector3f),     quatf_rotate_vec3_array_parallel(qfa[0], vfa, vfo, count)) \
+    X(quatf_rotate_vec3_soa_parallel,   6*sizeof(float),        quatf_rotate_vec3_soa_parallel(qfa[0], sfx, sfy, sfz, sfox, sfoy, sfoz, count)) \
+    X(quat_integrate_soa_euler,         11*sizeof(double),      quat_integrate_soa(QUAT_INTEGRATE_EULER, iw, ix, iy, iz, sx, sy, sz, 0.01, count)) \
+    X(quat_integrate_soa_exp,           11*sizeof(double),      quat_integrate_soa(QUAT_INTEGRATE_EXP, iw, ix, iy, iz, sx, sy, sz, 0.01, count)) \
+    X(quat_integrate_soa_rk4,           11*sizeof(double),      quat_integrate_soa(QUAT_INTEGRATE_RK4, iw, ix, iy, iz, sx, sy, sz, 0.01, count)) \
+    X(quat_integrate_soa_parallel,      11*sizeof(double),      quat_integrate_soa_parallel(QUAT_INTEGRATE_EXP, iw, ix, iy, iz, sx, sy, sz, 0.01, count)) \
+    X(quat_from_euler_angles_array,     sizeof(Vector3) + sizeof(Quaternion),   quat_from_euler_angles_array(QUAT_SINCOS_ACCURATE, va, qo, count)) \
+    X(quat_from_euler_angles_array_fast, sizeof(Vector3) + sizeof(Quaternion),  quat_from_euler_angles_array(QUAT_SINCOS_FAST, va, qo, count)) \
+    X(quat_from_angle_axis_array,       sizeof(double) + sizeof(Vector3) + sizeof(Quaternion), \
+        quat_from_angle_axis_array(QUAT_SINCOS_ACCURATE, ra, vb, qo, count)) \
+    X(quat_from_angle_axis_array_fast,  sizeof(double) + sizeof(Vector3) + sizeof(Quaternion), \
+        quat_from_angle_axis_array(QUAT_SINCOS_FAST, ra, vb, qo, count)) \
+    X(mat44_to_quat_array,              sizeof(Matrix44) + sizeof(Quaternion),  mat44_to_quat_array(mo, qo, count)) \
+    X(quat_to_euler_angles_array,       sizeof(Quaternion) + sizeof(Vector3),   quat_to_euler_angles_array(QUAT_EULER_ZXY, qa, vo, count)) \
+    X(quat_exp_array,                   sizeof(Vector3) + sizeof(Quaternion),   quat_exp_array(vsm, qo, count)) \
+    X(quat_exp_array_large,             sizeof(Vector3) + sizeof(Quaternion),   quat_exp_array(va, qo, count)) \
+    X(quat_log_array,                   sizeof(Quaternion) + sizeof(Vector3),   quat_log_array(qsm, vo, count)) \
+    X(quat_log_array_large,             sizeof(Quaternion) + sizeof(Vector3),   quat_log_array(qa, vo, count)) \
+    X(quat_pow_array,                   2*sizeof(Quaternion) + sizeof(double),  quat_pow_array(qsm, rt, qo, count)) \
+    X(quat_pow_array_large,             2*sizeof(Quaternion) + sizeof(double),  quat_pow_array(qa, rt, qo, count)) \
+    X(quat_nlerp_array,                 3*sizeof(Quaternion) + sizeof(double),  quat_interpolate_array(QUAT_NLERP, qa, qb, rt, qo, count)) \
+    X(quat_slerp_array,                 3*sizeof(Quaternion) + sizeof(double),  quat_interpolate_array(QUAT_SLERP, qa, qb, rt, qo, count)) \
+    X(quat_slerp_fast_array,            3*sizeof(Quaternion) + sizeof(double),  quat_interpolate_array(QUAT_SLERP_FAST, qa, qb, rt, qo, count)) \
+    X(quat_slerp_samples,               sizeof(Quaternion) + sizeof(double),    quat_interpolate_samples(QUAT_SLERP, qa[0], qb[0], rt, qo, count)) \
+    X(quat_slerp_fast_samples,          sizeof(Quaternion) + sizeof(double),    quat_interpolate_samples(QUAT_SLERP_FAST, qa[0], qb[0], rt, qo, count)) \
+    X(quatf_nlerp_array,                3*sizeof(Quaternionf) + sizeof(float),  quatf_interpolate_array(QUAT_NLERP, qfa, qfb, rft, qfo, count)) \
+    X(quatf_slerp_array,                3*sizeof(Quaternionf) + sizeof(float),  quatf_interpolate_array(QUAT_SLERP, qfa, qfb, rft, qfo, count)) \
+    X(quatf_slerp_fast_array,           3*sizeof(Quaternionf) + sizeof(float),  quatf_interpolate_array(QUAT_SLERP_FAST, qfa, qfb, rft, qfo, count)) \
+    X(quatf_slerp_samples,              sizeof(Quaternionf) + sizeof(float),    quatf_interpolate_samples(QUAT_SLERP, qfa[0], qfb[0], rft, qfo, count)) \
+    X(quatf_slerp_fast_samples,         sizeof(Quaternionf) + sizeof(float),    quatf_interpolate_samples(QUAT_SLERP_FAST, qfa[0], qfb[0], rft, qfo, count)) \
+    X(vec3_norm_array,                  2*sizeof(Vector3),      vec3_norm_array(va, vo, count)) \
+    X(vec3_renorm_array,                2*sizeof(Vector3),      vec3_renorm_array(vo, count, 1e-12)) \
+    X(vec3f_norm_array,                 2*sizeof(Vector3f),     vec3f_norm_array(vfa, vfo, count)) \
+    X(vec3f_renorm_array,               2*sizeof(Vector3f),     vec3f_renorm_array(vfo, count, 1e-6f)) \
+    X(vec3_dot_array,                   2*sizeof(Vector3) + sizeof(double),     vec3_dot_array(va, vb, ro, count)) \
+    X(vec3_cross_array,                 3*sizeof(Vector3),      vec3_cross_array(va, vb, vo, count)) \
+    X(vec3_cross_array_inplace,         5*sizeof(Vector3), \
+        memcpy(vo, va, sizeof(Vector3) * count); vec3_cross_array_inplace(vo, vb, count)) \
+    X(vec3_add_array,                   3*sizeof(Vector3),      vec3_add_array(va, vb, vo, count)) \
+    X(vec3_add_array_inplace,           3*sizeof(Vector3),      vec3_add_array_inplace(vo, vb, count)) \
+    X(vec3_project_plane_array,         3*sizeof(Vector3),      vec3_project_plane_array(va, vb, vo, count)) \
+    X(vec3_project_plane_array_inplace, 5*sizeof(Vector3), \
+        memcpy(vo, va, sizeof(Vector3) * count); vec3_project_plane_array_inplace(vo, vb, count)) \
+    X(vec3_dot_soa,                     7*sizeof(double),       vec3_dot_soa(sx, sy, sz, ix, iy, iz, ro, count)) \
+    X(vec3_cross_soa,                   9*sizeof(double),       vec3_cross_soa(sx, sy, sz, ix, iy, iz, sox, soy, soz, count)) \
+    X(vec3_cross_soa_inplace,           15*sizeof(double),      bench_soa_copy(count); \
+        vec3_cross_soa_inplace(sox, soy, soz, ix, iy, iz, count)) \
+    X(vec3_add_soa,                     9*sizeof(double),       vec3_add_soa(sx, sy, sz, ix, iy, iz, sox, soy, soz, count)) \
+    X(vec3_add_soa_inplace,             9*sizeof(double),       vec3_add_soa_inplace(sox, soy, soz, ix, iy, iz, count)) \
+    X(vec3_project_plane_soa,           9*sizeof(double),       vec3_project_plane_soa(sx, sy, sz, ix, iy, iz, sox, soy, soz, count)) \
+    X(vec3_project_plane_soa_inplace,   15*sizeof(double),      bench_soa_copy(count); \
+        vec3_project_plane_soa_inplace(sox, soy, soz, ix, iy, iz, count)) \
+    X(vec3_norm_soa,                    6*sizeof(double),       vec3_norm_soa(sx, sy, sz, sox, soy, soz, count)) \
+    X(vec3_norm_soa_inplace,            6*sizeof(double),       vec3_norm_soa_inplace(sox, soy, soz, count)) \
+    X(vec3_renorm_soa,                  6*sizeof(double),       vec3_renorm_soa(sox, soy, soz, count, 1e-12)) \
+    X(quat_norm_array,                  2*sizeof(Quaternion),   quat_norm_array(qa, qo, count)) \
+    X(quat_renorm_array,                2*sizeof(Quaternion),   quat_renorm_array(qo, count, 1e-12)) \
+    X(quat_norm_soa,                    8*sizeof(double),       quat_norm_soa(iw, ix, iy, iz, iw, ix, iy, iz, count)) \
+    X(quat_renorm_soa,                  8*sizeof(double),       quat_renorm_soa(iw, ix, iy, iz, count, 1e-12)) \
+    X(quatf_norm_array,                 2*sizeof(Quaternionf),  quatf_norm_array(qfa, qfo, count)) \
+    X(quatf_renorm_array,               2*sizeof(Quaternionf),  quatf_renorm_array(qfo, count, 1e-6f)) \
+    X(mat44_upload_float_3x4,           sizeof(Quaternion) + sizeof(Vector3) + 12*sizeof(float), \
+        mat44_from_rotation_translation_array(qa, va, count, mfo, 0, MAT44_FLOAT_3X4, MAT44_ROW_MAJOR)) \
+    X(mat44_upload_float_4x4,           sizeof(Quaternion) + sizeof(Vector3) + 16*sizeof(float), \
+        mat44_from_rotation_translation_array(qa, va, count, mfo, 0, MAT44_FLOAT_4X4, MAT44_COLUMN_MAJOR)) \
+    X(mat44_upload_quatf_float_3x4,     sizeof(Quaternionf) + sizeof(Vector3f) + 12*sizeof(float), \
+        mat44_from_quatf_translation_array(qfa, vfa, count, mfo, 0, MAT44_FLOAT_3X4, MAT44_ROW_MAJOR)) \
+    X(dualquat_mul_array,               3*sizeof(DualQuaternion),   dualquat_mul_array(dqa, dqb, dqo, count)) \
+    X(dualquat_transform_point_array,   2*sizeof(Vector3),      dualquat_transform_point_array(dqa[0], va, vo, count)) \
+    X(skin_dualquat,                    2*sizeof(Vector3) + SKIN_INFLUENCES*(sizeof(uint16_t) + sizeof(float)), \
+        skin_dualquat(dqa, bi, bw, va, NULL, vo, NULL, count)) \
+    X(skin_dualquat_normals,            4*sizeof(Vector3) + SKIN_INFLUENCES*(sizeof(uint16_t) + sizeof(float)), \
+        skin_dualquat(dqa, bi, bw, va, vb, vo, vno, count)) \
+    X(skin_dualquat_parallel,           4*sizeof(Vector3) + SKIN_INFLUENCES*(sizeof(uint16_t) + sizeof(float)), \
+        skin_dualquat_parallel(dqa, bi, bw, va, vb, vo, vno, count)) \
+    X(quat_pack32_array,                sizeof(Quaternion) + sizeof(QuatPack32),    quat_pack32_array(qa, qp32, count)) \
+    X(quat_pack48_array,                sizeof(Quaternion) + sizeof(QuatPack48),    quat_pack48_array(qa, qp48, count)) \
+    X(quat_pack64_array,                sizeof(Quaternion) + sizeof(QuatPack64),    quat_pack64_array(qa, qp64, count)) \
+    X(quat_unpack32_array,              sizeof(QuatPack32) + sizeof(Quaternion),    quat_unpack32_array(qp32, qo, count)) \
+    X(quat_unpack48_array,              sizeof(QuatPack48) + sizeof(Quaternion),    quat_unpack48_array(qp48, qo, count)) \
+    X(quat_unpack64_array,              sizeof(QuatPack64) + sizeof(Quaternion),    quat_unpack64_array(qp64, qo, count)) \
+    X(vec3h_from_vec3_array,            sizeof(Vector3) + sizeof(Vector3h),     vec3h_from_vec3_array(va, vho, count)) \
+    X(vec3_from_vec3h_array,            sizeof(Vector3h) + sizeof(Vector3),     vec3_from_vec3h_array(vha, vo, count)) \
+    X(vec3h_add_array,                  3*sizeof(Vector3h),                     vec3h_add_array(vha, vhb, vho, count)) \
+    X(vec3h_scale_array,                2*sizeof(Vector3h),                     vec3h_scale_array(vha, 0.5f, vho, count)) \
+    X(vec3h_dot_array,                  2*sizeof(Vector3h) + sizeof(float),     vec3h_dot_array(vha, vhb, rfo, count)) \
+    X(vec3q16_from_vec3_array,          sizeof(Vector3) + sizeof(Vector3q16),   vec3q16_from_vec3_array(va, bq16, vq16, count)) \
+    X(vec3_from_vec3q16_array,          sizeof(Vector3q16) + sizeof(Vector3),   vec3_from_vec3q16_array(vq16, bq16, vo, count)) \
+    X(vec3q16_dot_array,                sizeof(Vector3q16) + sizeof(double),    vec3q16_dot_array(vq16, bq16, vb[0], ro, count)) \
+    X(vec3q21_from_vec3_array,          sizeof(Vector3) + sizeof(Vector3q21),   vec3q21_from_vec3_array(va, bq21, vq21, count)) \
+    X(vec3_from_vec3q21_array,          sizeof(Vector3q21) + sizeof(Vector3),   vec3_from_vec3q21_array(vq21, bq21, vo, count)) \
+    X(vec3q21_dot_array,                sizeof(Vector3q21) + sizeof(double),    vec3q21_dot_array(vq21, bq21, vb[0], ro, count)) \
+    X(arrayfile_quaternions,            2*sizeof(Quaternion),                   bench_arrayfile(count, "raw")) \
+    X(arrayfile_read_quatpack32,        sizeof(QuatPack32) + 3*sizeof(Quaternion),  bench_arrayfile(count, "packed")) \
+    X(hierarchy_update_full,            2*(sizeof(Quaternion) + sizeof(Vector3)) + sizeof(uint32_t), \
+        bench_hierarchy_update(count, 0)) \
+    X(hierarchy_update_partial,         2*(sizeof(Quaternion) + sizeof(Vector3)) + sizeof(uint32_t), \
+        bench_hierarchy_update(count, count / 2)) \
+    X(frame_scratch_malloc,             2*sizeof(Vector3),      bench_frame_scratch(count, false)) \
+    X(frame_scratch_arena,              2*sizeof(Vector3),      bench_frame_scratch(count, true)) \
+    X(mat44_transform_point_array,      2*sizeof(Vector3),      mat44_transform_point_array(mo[0], va, vo, count)) \
+    X(mat44_transform_dir_array,        2*sizeof(Vector3),      mat44_transform_dir_array(mo[0], va, vo, count)) \
+    X(quat_index_build,                 2*sizeof(Quaternion) + sizeof(size_t) + sizeof(double), bench_build_quat_index(count)) \
+    X(quat_index_knn_array,             sizeof(Quaternion) + sizeof(QuatIndexMatch), \
+        quat_index_knn_array(bench_quat_index(), qb, count, 1, bqm)) \
+    X(quat_index_knn_array_parallel,    sizeof(Quaternion) + sizeof(QuatIndexMatch), \
+        quat_index_knn_array_parallel(bench_quat_index(), qb, count, 1, bqm)) \
+    X(vec3_index_build,                 2*sizeof(Vector3) + 2*sizeof(double) + sizeof(size_t) + 1, bench_build_vec3_index(count)) \
+    X(vec3_index_knn_array,             sizeof(Vector3) + sizeof(Vec3IndexMatch), \
+        vec3_index_knn_array(bench_vec3_index(), vb, count, 1, bvm)) \
+    X(vec3_index_knn_array_parallel,    sizeof(Vector3) + sizeof(Vec3IndexMatch), \
+        vec3_index_knn_array_parallel(bench_vec3_index(), vb, count, 1, bvm))
+
+
+#define BENCH_DEFINE_ITEMS(name, bytes, ...) \
+    static void bench_##name(size_t count) \
+    { \
+        size_t k; \
+        for (k = 0; k < count; k++) { \
+            __VA_ARGS__; \
+        } \
+    }
+
+#define BENCH_DEFINE_BATCH(name, bytes, ...) \
+    static void bench_##name(size_t count) \
+    { \
+        __VA_ARGS__; \
+    }
+
+#define BENCH_ENTRY(name, bytes, ...)   { #name, bench_##name, bytes },
+
+BENCH_ITEMS(BENCH_DEFINE_ITEMS)
+BENCH_BATCH(BENCH_DEFINE_BATCH)
+
+static const Bench benches[] = {
+    BENCH_ITEMS(BENCH_ENTRY)
+    BENCH_BATCH(BENCH_ENTRY)
+};
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+static double bench_seconds(void)
+{
+    struct timespec t;
+
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return (double) t.tv_sec + (double) t.tv_nsec * 1e-9;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret best time in seconds of one call of [kernel] over [count] items
+static double bench_run(BenchKernel kernel, size_t count)
+{
+    size_t inner = (count < BENCH_MIN_SAMPLE_ITEMS) ? BENCH_MIN_SAMPLE_ITEMS / count : 1;
+    double best = HUGE_VAL, total = 0, start, elapsed;
+    size_t k;
+    int reps = 0;
+
+    kernel( count );                    // warm up the caches, the branch predictors and the thread pool
+
+    while (reps < BENCH_MIN_REPS || total < BENCH_MIN_SECONDS) {
+        start = bench_seconds();
+        for (k = 0; k < inner; k++) {
+            kernel( count );
+        }
+        elapsed = (bench_seconds() - start) / (double) inner;
+
+        total += elapsed * (double) inner;
+        reps++;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    return best;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Fills every buffer with pseudo random, deterministic data: unit quaternions, vectors in [-1, 1], scalars in [0.5, 1.5]
+// and interpolation parameters in [0, 1].
+static bool bench_alloc(void)
+{
+    size_t n = BENCH_MAX_ITEMS, k;
+    unsigned seed = 12345;
+    double r[4];
+    int j;
+
+    ra = malloc(n * sizeof(*ra));       ro = malloc(n * sizeof(*ro));       rt = malloc(n * sizeof(*rt));
+    rfa = malloc(n * sizeof(*rfa));     rfo = malloc(n * sizeof(*rfo));     rft = malloc(n * sizeof(*rft));
+    bo = malloc(n * sizeof(*bo));
+    va = malloc(n * sizeof(*va));       vb = malloc(n * sizeof(*vb));       vo = malloc(n * sizeof(*vo));
+    vfa = malloc(n * sizeof(*vfa));     vfb = malloc(n * sizeof(*vfb));     vfo = malloc(n * sizeof(*vfo));
+    qa = malloc(n * sizeof(*qa));       qb = malloc(n * sizeof(*qb));       qo = malloc(n * sizeof(*qo));
+    qfa = malloc(n * sizeof(*qfa));     qfb = malloc(n * sizeof(*qfb));     qfo = malloc(n * sizeof(*qfo));
+    mo = aligned_alloc(32, n * sizeof(*mo));  mr = aligned_alloc(32, n * sizeof(*mr));
+    mfo = aligned_alloc(64, n * 16 * sizeof(*mfo));
+    dqa = malloc(n * sizeof(*dqa));     dqb = malloc(n * sizeof(*dqb));     dqo = malloc(n * sizeof(*dqo));
+    bi = malloc(n * SKIN_INFLUENCES * sizeof(*bi));                         bw = malloc(n * SKIN_INFLUENCES * sizeof(*bw));
+    vno = malloc(n * sizeof(*vno));
+    qp32 = malloc(n * sizeof(*qp32));   qp48 = malloc(n * sizeof(*qp48));   qp64 = malloc(n * sizeof(*qp64));
+    vha = malloc(n * sizeof(*vha));     vhb = malloc(n * sizeof(*vhb));     vho = malloc(n * sizeof(*vho));
+    vq16 = malloc(n * sizeof(*vq16));   vq21 = malloc(n * sizeof(*vq21));
+    sx = malloc(n * sizeof(*sx));       sy = malloc(n * sizeof(*sy));       sz = malloc(n * sizeof(*sz));
+    sox = malloc(n * sizeof(*sox));     soy = malloc(n * sizeof(*soy));     soz = malloc(n * sizeof(*soz));
+    sfx = malloc(n * sizeof(*sfx));     sfy = malloc(n * sizeof(*sfy));     sfz = malloc(n * sizeof(*sfz));
+    sfox = malloc(n * sizeof(*sfox));   sfoy = malloc(n * sizeof(*sfoy));   sfoz = malloc(n * sizeof(*sfoz));
+    vsm = malloc(n * sizeof(*vsm));     qsm = malloc(n * sizeof(*qsm));
+    iw = malloc(n * sizeof(*iw));       ix = malloc(n * sizeof(*ix));       iy = malloc(n * sizeof(*iy));       iz = malloc(n * sizeof(*iz));
+    bqm = malloc(n * sizeof(*bqm));     bvm = malloc(n * sizeof(*bvm));
+
+    if (!ra || !ro || !rt || !rfa || !rfo || !rft || !bo || !va || !vb || !vo || !vfa || !vfb || !vfo ||
+        !qa || !qb || !qo || !qfa || !qfb || !qfo || !mo || !mr || !mfo || !dqa || !dqb || !dqo || !bi || !bw || !vno ||
+        !qp32 || !qp48 || !qp64 || !vha || !vhb || !vho || !vq16 || !vq21 ||
+        !sx || !sy || !sz || !sox || !soy || !soz || !sfx || !sfy || !sfz || !sfox || !sfoy || !sfoz ||
+        !vsm || !qsm || !iw || !ix || !iy || !iz || !bqm || !bvm || !arena_init(&ba, 0)) {
+        return false;
+    }
+
+    bq16 = vec3_quantization_from_bounds( vec3_from_values(-1.0, -1.0, -1.0), vec3_from_values(1.0, 1.0, 1.0), VEC3_Q16_BITS );
+    bq21 = vec3_quantization_from_bounds( vec3_from_values(-1.0, -1.0, -1.0), vec3_from_values(1.0, 1.0, 1.0), VEC3_Q21_BITS );
+
+    for (k = 0; k < n; k++) {
+        for (j = 0; j < 4; j++) {
+            seed = seed * 1103515245u + 12345u;
+            r[j] = (double) (seed >> 8) / (double) (1u << 24) * 2 - 1;
+        }
+
+        ra[k] = fabs(r[0]) + 0.5;
+        rfa[k] = (float) ra[k];
+        rt[k] = ra[k] - 0.5;
+        rft[k] = (float) rt[k];
+        va[k] = vec3_from_values(r[0], r[1], r[2]);
+        vb[k] = vec3_norm( vec3_from_values(r[3], r[1], r[0]) );
+        vfa[k] = vec3f_from_vec3( va[k] );
+        vfb[k] = vec3f_from_vec3( vb[k] );
+        qa[k] = quat_norm( quat_from_values(r[0], r[1], r[2], r[3]) );
+        qb[k] = quat_norm( quat_from_values(r[3], r[2], r[1], r[0]) );
+        qfa[k] = quatf_from_quat( qa[k] );
+        qfb[k] = quatf_from_quat( qb[k] );
+        mo[k] = mat44_from_rotation_translation( qa[k], va[k] );
+        dqa[k] = dualquat_from_rotation_translation( qa[k], va[k] );
+        dqb[k] = dualquat_from_rotation_translation( qb[k], vb[k] );
+        for (j = 0; j < SKIN_INFLUENCES; j++) {
+            bi[SKIN_INFLUENCES*k + (size_t) j] = (uint16_t) ((seed >> (4 + 6*j)) % BENCH_BONES);
+            bw[SKIN_INFLUENCES*k + (size_t) j] = (float) (SKIN_INFLUENCES - j) / (SKIN_INFLUENCES * (SKIN_INFLUENCES + 1) / 2);
+        }
+        qp32[k] = quat_pack32( qa[k] );
+        qp48[k] = quat_pack48( qa[k] );
+        qp64[k] = quat_pack64( qa[k] );
+        vha[k] = vec3h_from_vec3( va[k] );
+        vhb[k] = vec3h_from_vec3( vb[k] );
+        vq16[k] = vec3q16_from_vec3( va[k], bq16 );
+        vq21[k] = vec3q21_from_vec3( va[k], bq21 );
+        sx[k] = va[k].x;    sy[k] = va[k].y;    sz[k] = va[k].z;
+        sfx[k] = vfa[k].x;  sfy[k] = vfa[k].y;  sfz[k] = vfa[k].z;
+        vsm[k] = vec3_scalar_mul( va[k], 0.015 );
+        qsm[k] = quat_exp( quat_from_values(0, vsm[k].x, vsm[k].y, vsm[k].z) );
+        iw[k] = qa[k].w;    ix[k] = qa[k].x;    iy[k] = qa[k].y;    iz[k] = qa[k].z;
+    }
+
+    return true;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    const char * filter = (argc > 1) ? argv[1] : NULL;
+    FILE * out;
+    size_t b, s, count;
+    double seconds, ns_per_op, items_per_s, gb_per_s;
+
+    if (!bench_alloc()) {
+        fprintf( stderr, "bench: out of memory\n" );
+        return EXIT_FAILURE;
+    }
+
+    out = fopen( BENCH_OUTPUT, "w" );
+    if (out == NULL) {
+        perror( BENCH_OUTPUT );
+        return EXIT_FAILURE;
+    }
+
+    printf( "%s kernels, %u threads for the _parallel variants\n\n", simd_tier_name(simd_tier()), parallel_init(0) );
+    printf( "%-34s %5s %9s %10s %14s %9s\n", "function", "level", "items", "ns/op", "items/s", "GB/s" );
+    fprintf( out, "# function\tlevel\titems\tbytes_per_item\tns_per_op\titems_per_s\tgb_per_s\n" );
+
+    for (b = 0; b < sizeof(benches) / sizeof(benches[0]); b++) {
+        if (filter != NULL && strstr(benches[b].name, filter) == NULL) {
+            continue;
+        }
+
+        for (s = 0; s < sizeof(bench_sizes) / sizeof(bench_sizes[0]); s++) {
+            count = bench_sizes[s].items;
+            seconds = bench_run( benches[b].kernel, count );
+
+            ns_per_op = seconds * 1e9 / (double) count;
+            items_per_s = (double) count / seconds;
+            gb_per_s = items_per_s * (double) benches[b].bytes * 1e-9;
+
+            printf( "%-34s %5s %9zu %10.3f %14.4g %9.3f\n",
+                    benches[b].name, bench_sizes[s].level, count, ns_per_op, items_per_s, gb_per_s );
+            fprintf( out, "%s\t%s\t%zu\t%zu\t%.4f\t%.6g\t%.4f\n",
+                     benches[b].name, bench_sizes[s].level, count, benches[b].bytes, ns_per_op, items_per_s, gb_per_s );
+        }
+    }
+
+    fclose( out );
+    hierarchy_free( &bh );
+    arena_free( &ba );
+    quat_index_free( &bqi );
+    vec3_index_free( &bvi );
+    remove( BENCH_ARRAYFILE );
+    parallel_shutdown();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+# Benchmark build of the library: optimised, no profiling instrumentation and no unit tests.
+# Run it from the source directory, it writes bench_output.txt next to itself.
+CONFIG -= debug
+CONFIG += release
+
+TARGET = bench
+
+SOURCES += \
+    bench.c \
+    quaternion.c \
+    vector3.c \
+    matrix44.c \
+    dualquat.c \
+    skinning.c \
+    hierarchy.c \
+    quatpack.c \
+    vec3pack.c \
+    arrayfile.c \
+    integrate.c \
+    arena.c \
+    container.c \
+    dispatch.c \
+    instrument.c \
+    quatindex.c \
+    vec3index.c \
+    parallel.c
+
+QMAKE_CFLAGS_RELEASE -= -O2
+QMAKE_CFLAGS_RELEASE += -O3
+
+# -march=native tunes the common code for the build machine; the batch kernels are chosen at run time, see simd.pri
+QMAKE_CFLAGS        += -std=c11 -pedantic -Wextra -Wall -W -Wdeclaration-after-statement \
+    -Wconversion -Wshadow -Wmissing-prototypes -Wstrict-prototypes \
+    -march=native \
+    -fno-common -fstrict-aliasing \
+    -Wno-aggregate-return \
+    -Wno-psabi
+
+
+LIBS += -pthread -lm -lc
+
+include(simd.pri)
+
+HEADERS += \
+    quaternion.h \
+    vector3.h \
+    matrix44.h \
+    dualquat.h \
+    skinning.h \
+    hierarchy.h \
+    quatpack.h \
+    vec3pack.h \
+    arrayfile.h \
+    integrate.h \
+    arena.h \
+    container.h \
+    dispatch.h \
+    instrument.h \
+    quatindex.h \
+    vec3index.h \
+    simd.h \
+    quaternion_impl.h \
+    vector3_impl.h \
+    index_impl.h \
+    parallel.h
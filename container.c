@@ -0,0 +1,467 @@
+//
+//
+//
+//
+//
+
+// The quat_ / vec3_ scalar functions are used per element, take the header-only versions so they inline
+#define AGK_INLINE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "container.h"
+#include "arena.h"
+#include "integrate.h"
+#include "quaternion.h"
+#include "vector3.h"
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret [count] elements of [size] bytes from [arena], NULL if out of memory or the size overflows
+static void * container_alloc(Arena * arena, size_t count, size_t size)
+{
+    if (count > SIZE_MAX / size) {
+        return NULL;
+    }
+    return arena_alloc( arena, count * size );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool quat_array_init(QuatArray * a, Arena * arena, ArrayLayout layout, size_t capacity)
+{
+    memset( a, 0, sizeof(*a) );
+    a->layout = layout;
+
+    if (layout == ARRAY_AOS) {
+        a->q = container_alloc( arena, capacity, sizeof(Quaternion) );
+        if (a->q == NULL) {
+            return false;
+        }
+    } else {
+        a->w = container_alloc( arena, capacity, sizeof(double) );
+        a->x = container_alloc( arena, capacity, sizeof(double) );
+        a->y = container_alloc( arena, capacity, sizeof(double) );
+        a->z = container_alloc( arena, capacity, sizeof(double) );
+        if (a->w == NULL || a->x == NULL || a->y == NULL || a->z == NULL) {
+            // What was allocated goes back with the next arena_reset
+            a->w = a->x = a->y = a->z = NULL;
+            return false;
+        }
+    }
+    a->capacity = capacity;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool vec3_array_init(Vec3Array * a, Arena * arena, ArrayLayout layout, size_t capacity)
+{
+    memset( a, 0, sizeof(*a) );
+    a->layout = layout;
+
+    if (layout == ARRAY_AOS) {
+        a->v = container_alloc( arena, capacity, sizeof(Vector3) );
+        if (a->v == NULL) {
+            return false;
+        }
+    } else {
+        a->x = container_alloc( arena, capacity, sizeof(double) );
+        a->y = container_alloc( arena, capacity, sizeof(double) );
+        a->z = container_alloc( arena, capacity, sizeof(double) );
+        if (a->x == NULL || a->y == NULL || a->z == NULL) {
+            a->x = a->y = a->z = NULL;
+            return false;
+        }
+    }
+    a->capacity = capacity;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Quaternion quat_array_get(const QuatArray * a, size_t k)
+{
+    if (a->layout == ARRAY_AOS) {
+        return a->q[k];
+    }
+    return quat_from_values( a->w[k], a->x[k], a->y[k], a->z[k] );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void quat_array_set(QuatArray * a, size_t k, Quaternion q)
+{
+    if (a->layout == ARRAY_AOS) {
+        a->q[k] = q;
+    } else {
+        a->w[k] = q.w;
+        a->x[k] = q.x;
+        a->y[k] = q.y;
+        a->z[k] = q.z;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Vector3 vec3_array_get(const Vec3Array * a, size_t k)
+{
+    if (a->layout == ARRAY_AOS) {
+        return a->v[k];
+    }
+    return vec3_from_values( a->x[k], a->y[k], a->z[k] );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void vec3_array_set(Vec3Array * a, size_t k, Vector3 v)
+{
+    if (a->layout == ARRAY_AOS) {
+        a->v[k] = v;
+    } else {
+        a->x[k] = v.x;
+        a->y[k] = v.y;
+        a->z[k] = v.z;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool quat_array_push(QuatArray * a, Quaternion q)
+{
+    if (a->count >= a->capacity) {
+        return false;
+    }
+    quat_array_set( a, a->count++, q );
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool vec3_array_push(Vec3Array * a, Vector3 v)
+{
+    if (a->count >= a->capacity) {
+        return false;
+    }
+    vec3_array_set( a, a->count++, v );
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool quat_array_copy(QuatArray * dst, const QuatArray * src)
+{
+    size_t k;
+
+    if (dst->capacity < src->count) {
+        return false;
+    }
+    if (dst == src) {
+        return true;
+    }
+
+    if (src->layout == ARRAY_AOS && dst->layout == ARRAY_AOS) {
+        memmove( dst->q, src->q, sizeof(Quaternion) * src->count );
+    } else if (src->layout == ARRAY_SOA && dst->layout == ARRAY_SOA) {
+        memmove( dst->w, src->w, sizeof(double) * src->count );
+        memmove( dst->x, src->x, sizeof(double) * src->count );
+        memmove( dst->y, src->y, sizeof(double) * src->count );
+        memmove( dst->z, src->z, sizeof(double) * src->count );
+    } else {
+        for (k = 0; k < src->count; k++) {
+            quat_array_set( dst, k, quat_array_get(src, k) );
+        }
+    }
+    dst->count = src->count;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool vec3_array_copy(Vec3Array * dst, const Vec3Array * src)
+{
+    size_t k;
+
+    if (dst->capacity < src->count) {
+        return false;
+    }
+    if (dst == src) {
+        return true;
+    }
+
+    if (src->layout == ARRAY_AOS && dst->layout == ARRAY_AOS) {
+        memmove( dst->v, src->v, sizeof(Vector3) * src->count );
+    } else if (src->layout == ARRAY_SOA && dst->layout == ARRAY_SOA) {
+        memmove( dst->x, src->x, sizeof(double) * src->count );
+        memmove( dst->y, src->y, sizeof(double) * src->count );
+        memmove( dst->z, src->z, sizeof(double) * src->count );
+    } else {
+        for (k = 0; k < src->count; k++) {
+            vec3_array_set( dst, k, vec3_array_get(src, k) );
+        }
+    }
+    dst->count = src->count;
+    return true;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool quat_array_rotate_vec3(Quaternion q, const Vec3Array * in, Vec3Array * out)
+{
+    if (out->capacity < in->count || out->layout != in->layout) {
+        return false;
+    }
+    if (in->layout == ARRAY_AOS) {
+        quat_rotate_vec3_array( q, in->v, out->v, in->count );
+    } else {
+        quat_rotate_vec3_soa( q, in->x, in->y, in->z, out->x, out->y, out->z, in->count );
+    }
+    out->count = in->count;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool quat_array_rotate_vec3_parallel(Quaternion q, const Vec3Array * in, Vec3Array * out)
+{
+    if (out->capacity < in->count || out->layout != in->layout) {
+        return false;
+    }
+    if (in->layout == ARRAY_AOS) {
+        quat_rotate_vec3_array_parallel( q, in->v, out->v, in->count );
+    } else {
+        quat_rotate_vec3_soa_parallel( q, in->x, in->y, in->z, out->x, out->y, out->z, in->count );
+    }
+    out->count = in->count;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool quat_array_norm(const QuatArray * in, QuatArray * out)
+{
+    if (out->capacity < in->count || out->layout != in->layout) {
+        return false;
+    }
+    if (in->layout == ARRAY_AOS) {
+        quat_norm_array( in->q, out->q, in->count );
+    } else {
+        quat_norm_soa( in->w, in->x, in->y, in->z, out->w, out->x, out->y, out->z, in->count );
+    }
+    out->count = in->count;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool vec3_array_norm(const Vec3Array * in, Vec3Array * out)
+{
+    if (out->capacity < in->count || out->layout != in->layout) {
+        return false;
+    }
+    if (in->layout == ARRAY_AOS) {
+        vec3_norm_array( in->v, out->v, in->count );
+    } else if (in->x == out->x) {
+        // The arrays of one Vec3Array never overlap those of another, so the streams are either the same or disjoint
+        vec3_norm_soa_inplace( out->x, out->y, out->z, in->count );
+    } else {
+        vec3_norm_soa( in->x, in->y, in->z, out->x, out->y, out->z, in->count );
+    }
+    out->count = in->count;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+size_t quat_array_renorm(QuatArray * a, double epsilon)
+{
+    if (a->layout == ARRAY_AOS) {
+        return quat_renorm_array( a->q, a->count, epsilon );
+    }
+    return quat_renorm_soa( a->w, a->x, a->y, a->z, a->count, epsilon );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+size_t vec3_array_renorm(Vec3Array * a, double epsilon)
+{
+    if (a->layout == ARRAY_AOS) {
+        return vec3_renorm_array( a->v, a->count, epsilon );
+    }
+    return vec3_renorm_soa( a->x, a->y, a->z, a->count, epsilon );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool quat_array_integrate(QuatIntegration method, QuatArray * q, const Vec3Array * omega, double dt)
+{
+    size_t k;
+
+    if (omega->count < q->count || omega->layout != q->layout) {
+        return false;
+    }
+    if (q->layout == ARRAY_AOS) {
+        for (k = 0; k < q->count; k++) {
+            q->q[k] = quat_integrate( method, q->q[k], omega->v[k], dt );
+        }
+    } else {
+        quat_integrate_soa( method, q->w, q->x, q->y, q->z, omega->x, omega->y, omega->z, dt, q->count );
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// AoS has no multi-threaded kernel, it is integrated on the calling thread.
+bool quat_array_integrate_parallel(QuatIntegration method, QuatArray * q, const Vec3Array * omega, double dt)
+{
+    if (q->layout == ARRAY_AOS || omega->count < q->count || omega->layout != q->layout) {
+        return quat_array_integrate( method, q, omega, dt );
+    }
+    quat_integrate_soa_parallel( method, q->w, q->x, q->y, q->z, omega->x, omega->y, omega->z, dt, q->count );
+    return true;
+}
+
+
+
+//==========================================================================================================================================
+//==========================================================================================================================================
+//==========================================================================================================================================
+#ifdef CONTAINER_UNITTEST
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Arrays of both layouts are aligned, hold what is pushed up to their capacity, and convert into each other.
+void test_container_layouts(void)
+{
+    enum { count = 37 };
+    QuatArray qa, qs, qb;
+    Vec3Array va, vs;
+    Arena arena;
+    size_t k;
+
+    g_assert_true(  arena_init(&arena, 0)  );
+    g_assert_true(  quat_array_init(&qa, &arena, ARRAY_AOS, count)  );
+    g_assert_true(  quat_array_init(&qs, &arena, ARRAY_SOA, count)  );
+    g_assert_true(  quat_array_init(&qb, &arena, ARRAY_AOS, count)  );
+    g_assert_true(  vec3_array_init(&va, &arena, ARRAY_AOS, count)  );
+    g_assert_true(  vec3_array_init(&vs, &arena, ARRAY_SOA, count)  );
+    g_assert_cmpuint(  (uintptr_t) qa.q % ARENA_ALIGN, ==, 0  );
+    g_assert_cmpuint(  (uintptr_t) qs.z % ARENA_ALIGN, ==, 0  );
+    g_assert_cmpuint(  (uintptr_t) vs.y % ARENA_ALIGN, ==, 0  );
+    g_assert_null(  qa.w  );
+    g_assert_null(  vs.v  );
+
+    for (k = 0; k < count; k++) {
+        g_assert_true(  quat_array_push(&qa, quat_from_euler_angles(0.1 * (double) k, 0.5, -0.02 * (double) k))  );
+        g_assert_true(  vec3_array_push(&va, vec3_from_values((double) k, 1, -2))  );
+    }
+    g_assert_false(  quat_array_push(&qa, quat_from_identity())  );
+    g_assert_false(  vec3_array_push(&va, vec3_from_zeroes())  );
+
+    g_assert_true(  quat_array_copy(&qs, &qa)  );
+    g_assert_true(  quat_array_copy(&qb, &qs)  );
+    g_assert_true(  vec3_array_copy(&vs, &va)  );
+    g_assert_cmpuint(  qb.count, ==, count  );
+    g_assert_true(  memcmp(qa.q, qb.q, sizeof(Quaternion) * count) == 0  );
+    for (k = 0; k < count; k++) {
+        g_assert_true(  vec3_equal(vec3_array_get(&vs, k), va.v[k])  );
+    }
+
+    qs.count = count - 1;
+    g_assert_true(  quat_array_copy(&qb, &qs)  );
+    g_assert_cmpuint(  qb.count, ==, count - 1  );
+    g_assert_true(  quat_array_init(&qb, &arena, ARRAY_SOA, count - 2)  );
+    g_assert_false(  quat_array_copy(&qb, &qa)  );
+    g_assert_false(  quat_array_init(&qb, &arena, ARRAY_SOA, SIZE_MAX)  );
+    g_assert_cmpuint(  qb.capacity, ==, 0  );
+
+    arena_free( &arena );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The batch functions give the same results in either layout, and refuse arrays they can not process.
+void test_container_batch(void)
+{
+    enum { count = 101 };
+    QuatArray qa, qs;
+    Vec3Array va, vs, ra, rs, oa, os;
+    Quaternion q;
+    Arena arena;
+    double s;
+    size_t k;
+
+    g_assert_true(  arena_init(&arena, 4096)  );
+    g_assert_true(  quat_array_init(&qa, &arena, ARRAY_AOS, count) && quat_array_init(&qs, &arena, ARRAY_SOA, count)  );
+    g_assert_true(  vec3_array_init(&va, &arena, ARRAY_AOS, count) && vec3_array_init(&vs, &arena, ARRAY_SOA, count)  );
+    g_assert_true(  vec3_array_init(&ra, &arena, ARRAY_AOS, count) && vec3_array_init(&rs, &arena, ARRAY_SOA, count)  );
+    g_assert_true(  vec3_array_init(&oa, &arena, ARRAY_AOS, count) && vec3_array_init(&os, &arena, ARRAY_SOA, count)  );
+
+    for (k = 0; k < count; k++) {
+        q = quat_from_euler_angles( 0.05 * (double) k, 0.2, -1.0 );
+        s = 1 + 0.01 * (double) k;
+        quat_array_push( &qa, quat_from_values(s * q.w, s * q.x, s * q.y, s * q.z) );
+        vec3_array_push( &va, vec3_from_values(0.5 * (double) k, 1, -2) );
+        vec3_array_push( &oa, vec3_from_values(1, -0.03 * (double) k, 2) );
+    }
+    quat_array_copy( &qs, &qa );
+    vec3_array_copy( &vs, &va );
+    vec3_array_copy( &os, &oa );
+    q = quat_from_euler_angles( 0.3, -1.1, 2.0 );
+
+    g_assert_true(  quat_array_rotate_vec3(q, &va, &ra) && quat_array_rotate_vec3(q, &vs, &rs)  );
+    for (k = 0; k < count; k++) {
+        g_assert_true(  vec3_equal(vec3_array_get(&rs, k), ra.v[k])  );
+        g_assert_true(  vec3_equal(ra.v[k], quat_rotate_vec3(q, va.v[k]))  );
+    }
+    g_assert_true(  quat_array_rotate_vec3_parallel(q, &vs, &rs)  );
+    g_assert_true(  vec3_equal(vec3_array_get(&rs, count - 1), ra.v[count - 1])  );
+    g_assert_false(  quat_array_rotate_vec3(q, &va, &rs)  );
+
+    g_assert_true(  vec3_array_norm(&va, &ra) && vec3_array_norm(&vs, &rs)  );
+    for (k = 0; k < count; k++) {
+        g_assert_true(  vec3_equal(vec3_array_get(&rs, k), ra.v[k])  );
+    }
+    g_assert_true(  vec3_array_norm(&vs, &vs)  );
+    for (k = 0; k < count; k++) {
+        g_assert_true(  vec3_equal(vec3_array_get(&vs, k), ra.v[k])  );
+    }
+    g_assert_cmpuint(  vec3_array_renorm(&vs, 1e-12), ==, 0  );
+    g_assert_cmpuint(  vec3_array_renorm(&os, 1e-12), ==, vec3_array_renorm(&oa, 1e-12)  );
+    g_assert_true(  vec3_equal(vec3_array_get(&os, count - 1), oa.v[count - 1])  );
+
+    g_assert_cmpuint(  quat_array_renorm(&qs, 1e-12), ==, count - 1  );
+    g_assert_true(  quat_array_norm(&qa, &qa)  );
+    for (k = 0; k < count; k++) {
+        g_assert_true(  quat_equal(quat_array_get(&qs, k), qa.q[k])  );
+    }
+
+    g_assert_true(  quat_array_integrate(QUAT_INTEGRATE_EXP, &qa, &oa, 0.01)  );
+    g_assert_true(  quat_array_integrate_parallel(QUAT_INTEGRATE_EXP, &qs, &os, 0.01)  );
+    for (k = 0; k < count; k++) {
+        g_assert_true(  quat_equal(quat_array_get(&qs, k), qa.q[k])  );
+    }
+    os.count = count - 1;
+    g_assert_false(  quat_array_integrate(QUAT_INTEGRATE_EXP, &qs, &os, 0.01)  );
+    g_assert_false(  quat_array_integrate(QUAT_INTEGRATE_EXP, &qs, &oa, 0.01)  );
+
+    arena_free( &arena );
+}
+
+
+
+void setuptests(void)
+{
+    g_test_add_func("/set_container/test_container_layouts", test_container_layouts);
+    g_test_add_func("/set_container/test_container_batch", test_container_batch);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // CONTAINER_UNITTEST
@@ -0,0 +1,110 @@
+//
+//
+//
+//
+//
+
+#if ! defined CONTAINER_H
+#define CONTAINER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "vector3.h"
+#include "quaternion.h"
+#include "integrate.h"
+#include "arena.h"
+
+
+// Fixed capacity arrays of quaternions and vectors allocated from an Arena, so that their storage is aligned on
+// ARENA_ALIGN and a frame's worth of them is released by arena_reset, without any per-array free.
+// The elements are stored either as an array of structures (AoS: q, v) or as one array per component (SoA: w x y z),
+// the pointers of the other layout being NULL. The batch functions of quaternion.h, vector3.h and integrate.h take the
+// pointers as they are; the functions below pick the one matching the layout.
+// Only rotation, normalisation and integration are wrapped, each by a vectorised kernel in either layout except the AoS
+// integration, which integrate.h only offers per element. The rest of the batch algebra is called on the pointers
+// directly: vec3_dot_soa, vec3_add_soa and the like in either layout, quat_interpolate_array, quat_exp_array and the
+// other quaternion batch functions for AoS only, having no SoA form.
+//
+// An array is valid until the arena it was allocated from is reset or freed. [count] may be set directly, up to
+// [capacity]; the other fields are read-only.
+typedef enum array_layout {
+    ARRAY_AOS,
+    ARRAY_SOA
+} ArrayLayout;
+
+
+typedef struct quat_array {
+    ArrayLayout layout;
+    size_t count;
+    size_t capacity;
+    Quaternion * q;                     // AoS
+    double * w, * x, * y, * z;          // SoA
+} QuatArray;
+
+typedef struct vec3_array {
+    ArrayLayout layout;
+    size_t count;
+    size_t capacity;
+    Vector3 * v;                        // AoS
+    double * x, * y, * z;               // SoA
+} Vec3Array;
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Allocates room for [capacity] elements from [arena]; the array starts empty.
+// @ret false if out of memory, leaving [a] empty with no capacity
+bool quat_array_init(QuatArray * a, Arena * arena, ArrayLayout layout, size_t capacity);
+bool vec3_array_init(Vec3Array * a, Arena * arena, ArrayLayout layout, size_t capacity);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Element [k] < capacity, whatever the layout.
+Quaternion quat_array_get(const QuatArray * a, size_t k);
+void quat_array_set(QuatArray * a, size_t k, Quaternion q);
+Vector3 vec3_array_get(const Vec3Array * a, size_t k);
+void vec3_array_set(Vec3Array * a, size_t k, Vector3 v);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Appends an element.
+// @ret false if the array is full
+bool quat_array_push(QuatArray * a, Quaternion q);
+bool vec3_array_push(Vec3Array * a, Vector3 v);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Copies the elements of [src] into [dst], converting between layouts as needed.
+// @ret false if [dst] is too small
+bool quat_array_copy(QuatArray * dst, const QuatArray * src);
+bool vec3_array_copy(Vec3Array * dst, const Vec3Array * src);
+
+
+
+//==========================================================================================================================================
+// Batch operations. Unless stated otherwise, [out] receives [in]->count elements and may be the same array as [in].
+// @ret false, without writing anything, if [out] is too small or the arrays are of different layouts
+//------------------------------------------------------------------------------------------------------------------------------------------
+// quat_rotate_vec3_array / quat_rotate_vec3_soa, and their multi-threaded versions
+bool quat_array_rotate_vec3(Quaternion q, const Vec3Array * in, Vec3Array * out);
+bool quat_array_rotate_vec3_parallel(Quaternion q, const Vec3Array * in, Vec3Array * out);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// quat_norm_array / vec3_norm_array for AoS, quat_norm_soa / vec3_norm_soa for SoA.
+bool quat_array_norm(const QuatArray * in, QuatArray * out);
+bool vec3_array_norm(const Vec3Array * in, Vec3Array * out);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// quat_renorm_array / vec3_renorm_array in place for AoS, quat_renorm_soa / vec3_renorm_soa for SoA.
+// @ret number of elements that were renormalised
+size_t quat_array_renorm(QuatArray * a, double epsilon);
+size_t vec3_array_renorm(Vec3Array * a, double epsilon);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Advances the orientations [q] in place by the angular velocities [omega], see integrate.h: quat_integrate_soa for SoA,
+// quat_integrate per element for AoS.
+// @ret false if [omega] holds fewer elements than [q] or is of the other layout
+bool quat_array_integrate(QuatIntegration method, QuatArray * q, const Vec3Array * omega, double dt);
+bool quat_array_integrate_parallel(QuatIntegration method, QuatArray * q, const Vec3Array * omega, double dt);
+
+
+#endif      // CONTAINER_H
@@ -0,0 +1,214 @@
+//
+//
+//
+//
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <assert.h>             // for static_assert of the tier numbering
+
+#include "dispatch.h"
+#include "simd.h"
+
+
+static_assert( SIMD_TIER_SCALAR == SIMD_LEVEL_SCALAR && SIMD_TIER_SSE2 == SIMD_LEVEL_SSE2 &&
+               SIMD_TIER_AVX2 == SIMD_LEVEL_AVX2 && SIMD_TIER_AVX512 == SIMD_LEVEL_AVX512,
+               "SimdTier and the SIMD_LEVEL_ macros of simd.h must agree" );
+
+#define DISPATCH_ENV            "AGK_SIMD"
+#define DISPATCH_TIER_COUNT     4
+#define DISPATCH_UNSET          (-1)
+
+
+static const char * const dispatch_names[DISPATCH_TIER_COUNT] = {"scalar", "sse2", "avx2", "avx512"};
+
+// Tier in use, DISPATCH_UNSET until the first call of simd_tier or simd_set_tier
+static atomic_int dispatch_current = DISPATCH_UNSET;
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Picks the tier of the AGK_SIMD variable, or the best supported one, unless simd_set_tier got there first.
+static SimdTier dispatch_init(void)
+{
+    SimdTier supported = simd_tier_supported(), tier = supported;
+    int expected = DISPATCH_UNSET;
+#if defined AGK_SIMD_DISPATCH
+    const char * env = getenv( DISPATCH_ENV );
+    int k;
+
+    for (k = 0; env != NULL && k < DISPATCH_TIER_COUNT; k++) {
+        if (strcmp(env, dispatch_names[k]) == 0 && k <= (int) supported) {
+            tier = (SimdTier) k;
+        }
+    }
+#endif
+
+    if (!atomic_compare_exchange_strong( &dispatch_current, &expected, (int) tier )) {
+        tier = (SimdTier) expected;
+    }
+    return tier;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+SimdTier simd_tier(void)
+{
+    int tier = atomic_load_explicit( &dispatch_current, memory_order_relaxed );
+
+    return (tier != DISPATCH_UNSET) ? (SimdTier) tier : dispatch_init();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+SimdTier simd_tier_supported(void)
+{
+#if defined AGK_SIMD_DISPATCH
+    // The AVX2 kernels are built with -mf16c for the half precision conversions
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma") || !__builtin_cpu_supports("f16c")) {
+        return __builtin_cpu_supports("sse2") ? SIMD_TIER_SSE2 : SIMD_TIER_SCALAR;
+    }
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq")) {
+        return SIMD_TIER_AVX512;
+    }
+    return SIMD_TIER_AVX2;
+#elif defined SIMD_HAVE_AVX2
+    return SIMD_TIER_AVX2;
+#elif defined SIMD_HAVE_SSE2
+    return SIMD_TIER_SSE2;
+#else
+    return SIMD_TIER_SCALAR;
+#endif
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool simd_set_tier(SimdTier tier)
+{
+#if defined AGK_SIMD_DISPATCH
+    if (tier > simd_tier_supported()) {
+        return false;
+    }
+    atomic_store( &dispatch_current, (int) tier );
+    return true;
+#else
+    return tier == simd_tier_supported();
+#endif
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+const char * simd_tier_name(SimdTier tier)
+{
+    if ((int) tier < 0 || (int) tier >= DISPATCH_TIER_COUNT) {
+        return "unknown";
+    }
+    return dispatch_names[tier];
+}
+
+
+
+//==========================================================================================================================================
+//==========================================================================================================================================
+//==========================================================================================================================================
+#ifdef DISPATCH_UNITTEST
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+
+#include <math.h>
+
+#include "quaternion.h"
+#include "vector3.h"
+
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Every tier up to the supported one can be selected, the ones above can not.
+void test_simd_set_tier(void)
+{
+    SimdTier supported = simd_tier_supported(), initial = simd_tier();
+    int k;
+
+    g_assert_cmpint(  initial, <=, supported  );
+    for (k = 0; k < DISPATCH_TIER_COUNT; k++) {
+#if defined AGK_SIMD_DISPATCH
+        g_assert_true(  simd_set_tier((SimdTier) k) == (k <= (int) supported)  );
+        g_assert_cmpint(  simd_tier(), ==, (k <= (int) supported) ? k : (int) supported  );
+#else
+        g_assert_true(  simd_set_tier((SimdTier) k) == (k == (int) supported)  );
+        g_assert_cmpint(  simd_tier(), ==, supported  );
+#endif
+        g_assert_cmpstr(  simd_tier_name((SimdTier) k), ==, dispatch_names[k]  );
+    }
+    g_assert_cmpstr(  simd_tier_name((SimdTier) DISPATCH_TIER_COUNT), ==, "unknown"  );
+    simd_set_tier( initial );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The kernels of every supported tier agree with the scalar ones. The module tests cover each kernel in depth when run
+// under each AGK_SIMD value.
+void test_simd_tiers_agree(void)
+{
+    enum { count = 203 };
+    Vector3 in[count], out[count], expected[count];
+    Quaternion q[count], qn[count], qexpected[count];
+    Quaternion r = quat_from_euler_angles(0.4, -1.3, 2.2);
+    SimdTier supported = simd_tier_supported(), initial = simd_tier();
+    size_t k;
+    int t, i;
+
+    for (k = 0; k < count; k++) {
+        in[k] = vec3_from_values( (double) k, 1.0 - 0.5 * (double) k, 3.0 );
+        q[k] = quat_from_values( 1.0 + 0.01 * (double) k, 0.5, -0.25 * (double) k, 2.0 );
+    }
+
+    simd_set_tier( SIMD_TIER_SCALAR );
+    quat_rotate_vec3_array( r, in, expected, count );
+    quat_norm_array( q, qexpected, count );
+
+    for (t = (int) SIMD_TIER_SCALAR; t <= (int) supported; t++) {
+        if (!simd_set_tier((SimdTier) t)) {
+            continue;                       // built without AGK_SIMD_DISPATCH: only the supported tier
+        }
+        quat_rotate_vec3_array( r, in, out, count );
+        quat_norm_array( q, qn, count );
+        for (k = 0; k < count; k++) {
+            for (i = 0; i < 3; i++) {
+                g_assert_cmpfloat(  fabs(out[k].v[i] - expected[k].v[i]), <=, 1e-12 * (1 + fabs(expected[k].v[i]))  );
+            }
+            for (i = 0; i < 4; i++) {
+                g_assert_cmpfloat(  fabs(qn[k].q[i] - qexpected[k].q[i]), <=, 1e-15  );
+            }
+        }
+    }
+    simd_set_tier( initial );
+}
+
+
+
+void setuptests(void)
+{
+    g_test_add_func("/set_dispatch/test_simd_set_tier", test_simd_set_tier);
+    g_test_add_func("/set_dispatch/test_simd_tiers_agree", test_simd_tiers_agree);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // DISPATCH_UNITTEST
@@ -0,0 +1,54 @@
+//
+//
+//
+//
+//
+
+#if ! defined DISPATCH_H
+#define DISPATCH_H
+
+#include <stdbool.h>
+
+
+// Runtime selection of the batch kernels. Built with AGK_SIMD_DISPATCH (as agk.pro and bench.pro do, see simd.pri),
+// every batch function is compiled once per tier below and calls the kernel of the tier in use, so that a single
+// binary runs the widest kernels each machine supports.
+//
+// The tier in use is the best one the CPU supports, detected with cpuid on the first batch call, unless the
+// environment variable AGK_SIMD names another one ("scalar", "sse2", "avx2" or "avx512"), for testing and
+// benchmarking; a tier the CPU lacks is lowered to the best it has.
+// Built without AGK_SIMD_DISPATCH the kernels are those of the compiler flags, reported as the only tier, and AGK_SIMD
+// is ignored.
+//
+// No kernel has an AVX-512 version of its own yet: the AVX-512 tier runs the AVX2 kernels compiled with AVX-512
+// enabled, which gives the compiler 32 vector registers and wider vectorisation of the scalar loops.
+typedef enum simd_tier {
+    SIMD_TIER_SCALAR,
+    SIMD_TIER_SSE2,
+    SIMD_TIER_AVX2,
+    SIMD_TIER_AVX512
+} SimdTier;
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret the tier whose kernels the batch functions run
+SimdTier simd_tier(void);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret the best tier this CPU and the build support
+SimdTier simd_tier_supported(void);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Switches the batch functions to the kernels of [tier], overriding AGK_SIMD. Takes effect for the next batch calls,
+// so it is best called before any.
+// @ret false, changing nothing, if [tier] is above simd_tier_supported
+bool simd_set_tier(SimdTier tier);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret the name of [tier] as AGK_SIMD takes it, "unknown" for a value out of range
+const char * simd_tier_name(SimdTier tier);
+
+
+#endif      // DISPATCH_H
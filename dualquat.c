@@ -0,0 +1,440 @@
+//
+//
+//
+//
+//
+
+// The quat_ / vec3_ scalar functions are used in the inner loops, take the header-only versions so they inline
+#define AGK_INLINE
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <tgmath.h>
+#include <float.h>              // for FLT_EPSILON in comparison precision
+#include <assert.h>             // for static_assert of padding inside the union
+#include <string.h>
+
+#include "dualquat.h"
+#include "quaternion.h"
+#include "vector3.h"
+#include "matrix44.h"
+#include "simd.h"
+#include "instrument.h"
+
+
+#if ! defined SIMD_KERNEL_BUILD
+
+static DualQuaternion test_dualquat_alignment;
+static_assert( sizeof(test_dualquat_alignment) == sizeof(test_dualquat_alignment.dq),
+               "Error: padding detected. DualQuaternion can not be represented correctly!\n");
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+DualQuaternion dualquat_from_identity(void)
+{
+    DualQuaternion r = {{1.0, 0.0, 0.0, 0.0,
+                         0.0, 0.0, 0.0, 0.0}};
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+DualQuaternion dualquat_from_rotation_translation(Quaternion q, Vector3 t)
+{
+    DualQuaternion r;
+    Quaternion tq = {{0.0, 0.5 * t.x, 0.5 * t.y, 0.5 * t.z}};
+
+    r.real = q;
+    r.dual = quat_mul( tq, q );
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Quaternion dualquat_get_rotation(DualQuaternion dq)
+{
+    return dq.real;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Vector part of 2 * dual * conjugate(real), expanded.
+Vector3 dualquat_get_translation(DualQuaternion dq)
+{
+    Quaternion r = dq.real, d = dq.dual;
+    Vector3 t = {{2.0 * (r.w*d.x - d.w*r.x + r.y*d.z - r.z*d.y),
+                  2.0 * (r.w*d.y - d.w*r.y + r.z*d.x - r.x*d.z),
+                  2.0 * (r.w*d.z - d.w*r.z + r.x*d.y - r.y*d.x)}};
+    return t;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+DualQuaternion dualquat_mul(DualQuaternion a, DualQuaternion b)
+{
+    DualQuaternion r;
+    Quaternion rd = quat_mul( a.real, b.dual );
+    Quaternion dr = quat_mul( a.dual, b.real );
+    int i;
+
+    r.real = quat_mul( a.real, b.real );
+    for (i = 0; i < 4; i++) {
+        r.dual.q[i] = rd.q[i] + dr.q[i];
+    }
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+DualQuaternion dualquat_inverse(DualQuaternion dq)
+{
+    DualQuaternion r;
+
+    r.real = quat_conjugate( dq.real );
+    r.dual = quat_conjugate( dq.dual );
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+DualQuaternion dualquat_norm(DualQuaternion dq)
+{
+    DualQuaternion r;
+    double inv_len = 1.0 / quat_len( dq.real );
+    double along;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        r.dq[i] = dq.dq[i] * inv_len;
+    }
+
+    // A unit dual quaternion has dot(real, dual) == 0
+    along = quat_dot( r.real, r.dual );
+    for (i = 0; i < 4; i++) {
+        r.dual.q[i] -= along * r.real.q[i];
+    }
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool dualquat_equal(DualQuaternion a, DualQuaternion b)
+{
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        if ( fabs(a.dq[i] - b.dq[i]) > FLT_EPSILON)
+            return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Vector3 dualquat_transform_point(DualQuaternion dq, Vector3 p)
+{
+    return vec3_add( quat_rotate_vec3(dq.real, p), dualquat_get_translation(dq) );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Vector3 dualquat_transform_dir(DualQuaternion dq, Vector3 d)
+{
+    return quat_rotate_vec3( dq.real, d );
+}
+
+
+
+#endif      // ! SIMD_KERNEL_BUILD
+
+
+
+//==========================================================================================================================================
+// Batch operations. dualquat_mul_array is compiled once per tier under runtime dispatch (simd.h).
+SIMD_DISPATCH_VOID(dualquat_mul_array, (const DualQuaternion * a, const DualQuaternion * b, DualQuaternion * out,
+                                        size_t count),
+                   (a, b, out, count))
+
+#if defined SIMD_KERNELS
+//------------------------------------------------------------------------------------------------------------------------------------------
+#if defined SIMD_HAVE_AVX2
+// Loads part [part] (0 real, 1 dual) of 4 consecutive dual quaternions as w, x, y and z lanes.
+static inline void dualquat_load4(const DualQuaternion * p, int part, __m256d * l)
+{
+    l[0] = _mm256_loadu_pd(p[0].dq + 4*part);
+    l[1] = _mm256_loadu_pd(p[1].dq + 4*part);
+    l[2] = _mm256_loadu_pd(p[2].dq + 4*part);
+    l[3] = _mm256_loadu_pd(p[3].dq + 4*part);
+    simd_transpose4( &l[0], &l[1], &l[2], &l[3] );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline void dualquat_store4(DualQuaternion * p, int part, __m256d * l)
+{
+    simd_transpose4( &l[0], &l[1], &l[2], &l[3] );
+    _mm256_storeu_pd(p[0].dq + 4*part, l[0]);
+    _mm256_storeu_pd(p[1].dq + 4*part, l[1]);
+    _mm256_storeu_pd(p[2].dq + 4*part, l[2]);
+    _mm256_storeu_pd(p[3].dq + 4*part, l[3]);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// quat_mul of the lanes of [a] and [b]
+static inline void dualquat_qmul4(const __m256d * a, const __m256d * b, __m256d * r)
+{
+    r[0] = _mm256_fnmadd_pd(a[3], b[3], _mm256_fnmadd_pd(a[2], b[2], _mm256_fnmadd_pd(a[1], b[1], _mm256_mul_pd(a[0], b[0]))));
+    r[1] = _mm256_fnmadd_pd(a[3], b[2], _mm256_fmadd_pd(a[2], b[3], _mm256_fmadd_pd(a[1], b[0], _mm256_mul_pd(a[0], b[1]))));
+    r[2] = _mm256_fmadd_pd(a[3], b[1], _mm256_fmadd_pd(a[2], b[0], _mm256_fnmadd_pd(a[1], b[3], _mm256_mul_pd(a[0], b[2]))));
+    r[3] = _mm256_fmadd_pd(a[3], b[0], _mm256_fnmadd_pd(a[2], b[1], _mm256_fmadd_pd(a[1], b[2], _mm256_mul_pd(a[0], b[3]))));
+}
+
+#elif defined SIMD_HAVE_SSE2
+//------------------------------------------------------------------------------------------------------------------------------------------
+// 2 lane versions of the above
+static inline void dualquat_load2(const DualQuaternion * p, int part, __m128d * l)
+{
+    __m128d wx0 = _mm_loadu_pd(p[0].dq + 4*part), yz0 = _mm_loadu_pd(p[0].dq + 4*part + 2);
+    __m128d wx1 = _mm_loadu_pd(p[1].dq + 4*part), yz1 = _mm_loadu_pd(p[1].dq + 4*part + 2);
+
+    l[0] = _mm_unpacklo_pd(wx0, wx1);
+    l[1] = _mm_unpackhi_pd(wx0, wx1);
+    l[2] = _mm_unpacklo_pd(yz0, yz1);
+    l[3] = _mm_unpackhi_pd(yz0, yz1);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline void dualquat_store2(DualQuaternion * p, int part, const __m128d * l)
+{
+    _mm_storeu_pd(p[0].dq + 4*part,     _mm_unpacklo_pd(l[0], l[1]));
+    _mm_storeu_pd(p[0].dq + 4*part + 2, _mm_unpacklo_pd(l[2], l[3]));
+    _mm_storeu_pd(p[1].dq + 4*part,     _mm_unpackhi_pd(l[0], l[1]));
+    _mm_storeu_pd(p[1].dq + 4*part + 2, _mm_unpackhi_pd(l[2], l[3]));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline void dualquat_qmul2(const __m128d * a, const __m128d * b, __m128d * r)
+{
+    r[0] = _mm_sub_pd(_mm_sub_pd(_mm_mul_pd(a[0], b[0]), _mm_mul_pd(a[1], b[1])),
+                      _mm_add_pd(_mm_mul_pd(a[2], b[2]), _mm_mul_pd(a[3], b[3])));
+    r[1] = _mm_add_pd(_mm_add_pd(_mm_mul_pd(a[0], b[1]), _mm_mul_pd(a[1], b[0])),
+                      _mm_sub_pd(_mm_mul_pd(a[2], b[3]), _mm_mul_pd(a[3], b[2])));
+    r[2] = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(a[0], b[2]), _mm_mul_pd(a[1], b[3])),
+                      _mm_add_pd(_mm_mul_pd(a[2], b[0]), _mm_mul_pd(a[3], b[1])));
+    r[3] = _mm_add_pd(_mm_add_pd(_mm_mul_pd(a[0], b[3]), _mm_mul_pd(a[1], b[2])),
+                      _mm_sub_pd(_mm_mul_pd(a[3], b[0]), _mm_mul_pd(a[2], b[1])));
+}
+#endif
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(dualquat_mul_array)(const DualQuaternion * a, const DualQuaternion * b, DualQuaternion * out, size_t count)
+{
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2
+    {
+        __m256d ar[4], ad[4], br[4], bd[4], rr[4], rd[4], dr[4];
+        int i;
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            dualquat_load4( a + k, 0, ar );
+            dualquat_load4( a + k, 1, ad );
+            dualquat_load4( b + k, 0, br );
+            dualquat_load4( b + k, 1, bd );
+
+            dualquat_qmul4( ar, br, rr );
+            dualquat_qmul4( ar, bd, rd );
+            dualquat_qmul4( ad, br, dr );
+            for (i = 0; i < 4; i++) {
+                rd[i] = _mm256_add_pd(rd[i], dr[i]);
+            }
+
+            dualquat_store4( out + k, 0, rr );
+            dualquat_store4( out + k, 1, rd );
+        }
+    }
+#elif defined SIMD_HAVE_SSE2
+    {
+        __m128d ar[4], ad[4], br[4], bd[4], rr[4], rd[4], dr[4];
+        int i;
+
+        for (k = 0; k + 2 <= count; k += 2) {
+            dualquat_load2( a + k, 0, ar );
+            dualquat_load2( a + k, 1, ad );
+            dualquat_load2( b + k, 0, br );
+            dualquat_load2( b + k, 1, bd );
+
+            dualquat_qmul2( ar, br, rr );
+            dualquat_qmul2( ar, bd, rd );
+            dualquat_qmul2( ad, br, dr );
+            for (i = 0; i < 4; i++) {
+                rd[i] = _mm_add_pd(rd[i], dr[i]);
+            }
+
+            dualquat_store2( out + k, 0, rr );
+            dualquat_store2( out + k, 1, rd );
+        }
+    }
+#endif
+
+    for (; k < count; k++) {
+        out[k] = dualquat_mul( a[k], b[k] );
+    }
+}
+
+#endif      // SIMD_KERNELS
+
+#if ! defined SIMD_KERNEL_BUILD
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void dualquat_norm_array(const DualQuaternion * in, DualQuaternion * out, size_t count)
+{
+    size_t k;
+    INSTRUMENT_BEGIN(dualquat_norm_array);
+
+    for (k = 0; k < count; k++) {
+        out[k] = dualquat_norm( in[k] );
+    }
+    INSTRUMENT_END(dualquat_norm_array, count);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void dualquat_transform_point_array(DualQuaternion dq, const Vector3 * in, Vector3 * out, size_t count)
+{
+    Matrix44 m = mat44_from_rotation_translation( dq.real, dualquat_get_translation(dq) );
+
+    mat44_transform_point_array( m, in, out, count );
+}
+
+#endif      // ! SIMD_KERNEL_BUILD
+
+
+
+
+
+
+
+
+
+//==========================================================================================================================================
+// Unit testing facilities
+#if defined DUALQUAT_UNITTEST && ! defined SIMD_KERNEL_BUILD
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+
+
+
+Quaternion testrot = {0.8660254037844387, 0.2886751345948129, 0.2886751345948129, 0.2886751345948129};
+Vector3 testtrans = {3.0, -4.0, 12.5};
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_dualquat_from_rotation_translation(void)
+{
+    DualQuaternion dq = dualquat_from_rotation_translation( testrot, testtrans );
+    Vector3 p = {-43.32332, 1.0, 32.0};
+
+    g_assert_true(  quat_equal(dualquat_get_rotation(dq), testrot)  );
+    g_assert_true(  vec3_equal(dualquat_get_translation(dq), testtrans)  );
+    g_assert_true(  vec3_equal(dualquat_transform_point(dq, p), vec3_add(quat_rotate_vec3(testrot, p), testtrans))  );
+    g_assert_true(  vec3_equal(dualquat_transform_dir(dq, p), quat_rotate_vec3(testrot, p))  );
+    g_assert_true(  vec3_equal(dualquat_transform_point(dualquat_from_identity(), p), p)  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Composition must agree with the matrix product, and a transform times its inverse is the identity.
+void test_dualquat_mul(void)
+{
+    Quaternion q2 = quat_from_euler_angles( 0.3, -1.2, 2.0 );
+    Vector3 t2 = {-1.0, 0.5, 7.25};
+    DualQuaternion a = dualquat_from_rotation_translation( testrot, testtrans );
+    DualQuaternion b = dualquat_from_rotation_translation( q2, t2 );
+    DualQuaternion ab = dualquat_mul( a, b );
+    Matrix44 m = mat44_mul( mat44_from_rotation_translation(testrot, testtrans), mat44_from_rotation_translation(q2, t2) );
+    Vector3 p = {2.0, -3.0, 0.125};
+
+    g_assert_true(  vec3_equal(dualquat_transform_point(ab, p), mat44_transform_point(m, p))  );
+    g_assert_true(  dualquat_equal(dualquat_mul(a, dualquat_inverse(a)), dualquat_from_identity())  );
+    g_assert_true(  dualquat_equal(dualquat_mul(dualquat_inverse(ab), ab), dualquat_from_identity())  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_dualquat_norm(void)
+{
+    DualQuaternion dq = dualquat_from_rotation_translation( testrot, testtrans );
+    DualQuaternion drift = dq;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        drift.dq[i] *= 1.01;
+    }
+    drift.dual.w += 0.003;
+
+    drift = dualquat_norm( drift );
+    g_assert_cmpfloat( fabs(quat_len(drift.real) - 1.0), <, 1e-12 );
+    g_assert_cmpfloat( fabs(quat_dot(drift.real, drift.dual)), <, 1e-12 );
+    g_assert_true(  dualquat_equal(dualquat_norm(dq), dq)  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Odd count so that both the vector kernel and the scalar tail are exercised.
+void test_dualquat_arrays(void)
+{
+    DualQuaternion a[7], b[7], out[7];
+    Vector3 in[7], pts[7];
+    DualQuaternion dq = dualquat_from_rotation_translation( testrot, testtrans );
+    int k;
+
+    for (k = 0; k < 7; k++) {
+        a[k] = dualquat_from_rotation_translation( quat_from_euler_angles(0.1*k, -0.3, 0.7*k),
+                                                   vec3_from_values(k, -2.0*k, 0.5) );
+        b[k] = dualquat_from_rotation_translation( quat_from_euler_angles(1.0, 0.2*k, -0.4*k),
+                                                   vec3_from_values(0.25*k, 3.0, -k) );
+        in[k] = vec3_from_values( -4.5 + k, 1.0 - 0.5*k, 0.25 * k );
+    }
+
+    dualquat_mul_array( a, b, out, 7 );
+    for (k = 0; k < 7; k++) {
+        g_assert_true(  dualquat_equal(out[k], dualquat_mul(a[k], b[k]))  );
+    }
+
+    dualquat_mul_array( a, b, a, 7 );                                           // in place
+    dualquat_norm_array( a, a, 7 );
+    for (k = 0; k < 7; k++) {
+        g_assert_true(  dualquat_equal(a[k], out[k])  );
+    }
+
+    dualquat_transform_point_array( dq, in, pts, 7 );
+    for (k = 0; k < 7; k++) {
+        g_assert_true(  vec3_equal(pts[k], dualquat_transform_point(dq, in[k]))  );
+    }
+}
+
+
+
+void setuptests(void)
+{
+    // Creation functions
+    g_test_add_func("/set_dualquat/test_dualquat_from_rotation_translation", test_dualquat_from_rotation_translation);
+
+    // Operations
+    g_test_add_func("/set_dualquat/test_dualquat_mul", test_dualquat_mul);
+    g_test_add_func("/set_dualquat/test_dualquat_norm", test_dualquat_norm);
+
+    // Batch operations
+    g_test_add_func("/set_dualquat/test_dualquat_arrays", test_dualquat_arrays);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // DUALQUAT_UNITTEST
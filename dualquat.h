@@ -0,0 +1,93 @@
+//
+//
+//
+//
+//
+
+#if ! defined DUALQUAT_H
+#define DUALQUAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "vector3.h"
+#include "quaternion.h"
+
+
+// Rigid transform (rotation followed by translation) as a unit dual quaternion real + e * dual, where [real] is the
+// rotation and dual = 0.5 * t * real for the translation t (t taken as the pure quaternion (0, t)).
+// Half the size of a Matrix44, and composing two transforms takes 3 quaternion products instead of a 4x4 product.
+typedef union dual_quaternion {
+    double dq[8];
+
+    struct
+    {
+        Quaternion real;
+        Quaternion dual;
+    };
+} DualQuaternion;
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+DualQuaternion dualquat_from_identity(void);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret transform that first rotates by [q] and then translates by [t]. [q] should be of UNIT length.
+DualQuaternion dualquat_from_rotation_translation(Quaternion q, Vector3 t);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret the rotation of [dq], i.e. its real part
+Quaternion dualquat_get_rotation(DualQuaternion dq);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret the translation of [dq], 2 * dual * conjugate(real)
+Vector3 dualquat_get_translation(DualQuaternion dq);
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret a*b, i.e. the transform that applies [b] first and then [a], like mat44_mul
+DualQuaternion dualquat_mul(DualQuaternion a, DualQuaternion b);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Inverse of a UNIT dual quaternion, the quaternion conjugate of both parts.
+DualQuaternion dualquat_inverse(DualQuaternion dq);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Scales [dq] to a unit real part and removes the component of the dual part along the real part, so that the result
+// is again a rigid transform. Use it on transforms that drifted after many products.
+DualQuaternion dualquat_norm(DualQuaternion dq);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool dualquat_equal(DualQuaternion a, DualQuaternion b);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Transforms point [p]: rotation and translation.
+Vector3 dualquat_transform_point(DualQuaternion dq, Vector3 p);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Transforms direction [d], translation is ignored.
+Vector3 dualquat_transform_dir(DualQuaternion dq, Vector3 d);
+
+
+
+//==========================================================================================================================================
+// Batch operations. [in] and [out] may point to the same array.
+//------------------------------------------------------------------------------------------------------------------------------------------
+// out[k] = a[k] * b[k]. [out] may be [a] or [b]. Vectorised over 4 transforms with AVX2, 2 with SSE2.
+void dualquat_mul_array(const DualQuaternion * a, const DualQuaternion * b, DualQuaternion * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// dualquat_norm applied to [count] dual quaternions.
+void dualquat_norm_array(const DualQuaternion * in, DualQuaternion * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// dualquat_transform_point applied to [count] points. [dq] is expanded once to its 3x4 matrix, which is the cheapest
+// form for transforming many points by the same transform.
+void dualquat_transform_point_array(DualQuaternion dq, const Vector3 * in, Vector3 * out, size_t count);
+
+
+#endif      // DUALQUAT_H
@@ -0,0 +1,395 @@
+//
+//
+//
+//
+//
+
+// The quat_ / vec3_ scalar functions are used per node, take the header-only versions so they inline
+#define AGK_INLINE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "hierarchy.h"
+#include "dualquat.h"
+#include "quaternion.h"
+#include "vector3.h"
+#include "instrument.h"
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Grows every array to [capacity] nodes. Arrays already grown stay valid when a later one fails.
+static bool hierarchy_reserve(Hierarchy * h, size_t capacity)
+{
+    void * p;
+
+    if (capacity <= h->capacity) {
+        return true;
+    }
+
+#define HIERARCHY_GROW(field) \
+    p = realloc( h->field, capacity * sizeof(*h->field) ); \
+    if (p == NULL) { \
+        return false; \
+    } \
+    h->field = p;
+
+    HIERARCHY_GROW(parent)
+    HIERARCHY_GROW(dirty)
+    HIERARCHY_GROW(local_rotation)
+    HIERARCHY_GROW(local_translation)
+    HIERARCHY_GROW(world_rotation)
+    HIERARCHY_GROW(world_translation)
+
+#undef HIERARCHY_GROW
+
+    h->capacity = capacity;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool hierarchy_init(Hierarchy * h, size_t capacity)
+{
+    memset( h, 0, sizeof(*h) );
+    if (!hierarchy_reserve( h, (capacity > 0) ? capacity : 1 )) {
+        hierarchy_free( h );
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void hierarchy_free(Hierarchy * h)
+{
+    free( h->parent );
+    free( h->dirty );
+    free( h->local_rotation );
+    free( h->local_translation );
+    free( h->world_rotation );
+    free( h->world_translation );
+    memset( h, 0, sizeof(*h) );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+uint32_t hierarchy_add(Hierarchy * h, uint32_t parent, Quaternion rotation, Vector3 translation)
+{
+    uint32_t node = (uint32_t) h->count;
+
+    if ((parent != HIERARCHY_NONE && parent >= h->count) || h->count >= HIERARCHY_NONE) {
+        return HIERARCHY_NONE;
+    }
+    if (h->count == h->capacity && !hierarchy_reserve( h, 2 * h->capacity )) {
+        return HIERARCHY_NONE;
+    }
+
+    h->count++;
+    h->parent[node] = parent;
+    hierarchy_set_local( h, node, rotation, translation );
+
+    return node;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Depth first numbering from the roots with an explicit [stack]. The children of every node are first gathered into
+// [children] (counting sort by parent, [first] holds the offsets), so the whole build is linear in [count].
+// Nodes on a cycle are never reached from a root, which is how cycles are detected.
+static bool hierarchy_sort(Hierarchy * h, const uint32_t * parents, size_t count, uint32_t * new_index,
+                           size_t * first, uint32_t * children, uint32_t * stack)
+{
+    size_t k, top = 0, placed = 0;
+    uint32_t node;
+
+    for (k = 0; k <= count; k++) {
+        first[k] = 0;
+    }
+    for (k = 0; k < count; k++) {
+        if (parents[k] != HIERARCHY_NONE) {
+            if (parents[k] >= count) {
+                return false;
+            }
+            first[parents[k] + 1]++;
+        }
+    }
+    for (k = 0; k < count; k++) {
+        first[k + 1] += first[k];
+    }
+    // first[p] is used as the fill cursor of the children of p, and shifted back afterwards
+    for (k = 0; k < count; k++) {
+        if (parents[k] != HIERARCHY_NONE) {
+            children[first[parents[k]]++] = (uint32_t) k;
+        }
+    }
+    for (k = count; k > 0; k--) {
+        first[k] = first[k - 1];
+    }
+    first[0] = 0;
+
+    for (k = count; k > 0; k--) {
+        if (parents[k - 1] == HIERARCHY_NONE) {
+            stack[top++] = (uint32_t) (k - 1);                  // reversed so that roots keep their relative order
+        }
+    }
+
+    while (top > 0) {
+        node = stack[--top];
+        new_index[node] = (uint32_t) placed;
+        h->parent[placed] = (parents[node] == HIERARCHY_NONE) ? HIERARCHY_NONE : new_index[parents[node]];
+        placed++;
+
+        for (k = first[node + 1]; k > first[node]; k--) {
+            stack[top++] = children[k - 1];
+        }
+    }
+
+    return placed == count;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool hierarchy_from_parents(Hierarchy * h, const uint32_t * parents, size_t count, uint32_t * new_index)
+{
+    size_t * first = malloc( (count + 1) * sizeof(size_t) );
+    uint32_t * children = malloc( (count + 1) * sizeof(uint32_t) );
+    uint32_t * stack = malloc( (count + 1) * sizeof(uint32_t) );
+    bool ok = false;
+    size_t k;
+
+    if (first != NULL && children != NULL && stack != NULL && count < HIERARCHY_NONE && hierarchy_init( h, count )) {
+        ok = hierarchy_sort( h, parents, count, new_index, first, children, stack );
+        if (ok) {
+            h->count = count;
+            for (k = 0; k < count; k++) {
+                hierarchy_set_local( h, (uint32_t) k, quat_from_identity(), vec3_from_zeroes() );
+            }
+        } else {
+            hierarchy_free( h );
+        }
+    }
+
+    free( first );
+    free( children );
+    free( stack );
+    return ok;
+}
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+void hierarchy_set_local(Hierarchy * h, uint32_t node, Quaternion rotation, Vector3 translation)
+{
+    h->local_rotation[node] = rotation;
+    h->local_translation[node] = translation;
+    h->dirty[node] = 1;
+    if (node < h->first_dirty) {
+        h->first_dirty = node;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void hierarchy_set_local_rotation(Hierarchy * h, uint32_t node, Quaternion rotation)
+{
+    hierarchy_set_local( h, node, rotation, h->local_translation[node] );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// A node is recomputed when it is dirty itself or its parent was recomputed in this sweep, which the parent
+// records in its own dirty flag since it comes first. The flags are cleared after the sweep.
+size_t hierarchy_update(Hierarchy * h)
+{
+    size_t k, updated = 0;
+    uint32_t p;
+    Quaternion pr;
+    INSTRUMENT_BEGIN(hierarchy_update);
+
+    for (k = h->first_dirty; k < h->count; k++) {
+        p = h->parent[k];
+
+        if (p == HIERARCHY_NONE) {
+            if (h->dirty[k]) {
+                h->world_rotation[k] = h->local_rotation[k];
+                h->world_translation[k] = h->local_translation[k];
+                updated++;
+            }
+            continue;
+        }
+
+        if (h->dirty[p]) {
+            h->dirty[k] = 1;
+        } else if (!h->dirty[k]) {
+            continue;
+        }
+
+        pr = h->world_rotation[p];
+        h->world_rotation[k] = quat_mul( pr, h->local_rotation[k] );
+        h->world_translation[k] = vec3_add( h->world_translation[p], quat_rotate_vec3(pr, h->local_translation[k]) );
+        updated++;
+    }
+
+    if (h->first_dirty < h->count) {
+        memset( h->dirty + h->first_dirty, 0, h->count - h->first_dirty );
+    }
+    h->first_dirty = h->count;
+
+    INSTRUMENT_END(hierarchy_update, updated);
+    return updated;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+DualQuaternion hierarchy_world_dualquat(const Hierarchy * h, uint32_t node)
+{
+    return dualquat_from_rotation_translation( h->world_rotation[node], h->world_translation[node] );
+}
+
+
+
+
+
+
+
+
+
+//==========================================================================================================================================
+// Unit testing facilities
+#ifdef HIERARCHY_UNITTEST
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+
+#include "matrix44.h"
+
+
+
+// Two roots, 0 -> 1 -> {2 -> 3, 4} and 5 -> 6
+uint32_t testparents[7] = {HIERARCHY_NONE, 0, 1, 2, 1, HIERARCHY_NONE, 5};
+
+
+// World matrix of [node], composed from the root down with mat44_mul
+static Matrix44 world_matrix(const Hierarchy * h, uint32_t node)
+{
+    Matrix44 local = mat44_from_rotation_translation( h->local_rotation[node], h->local_translation[node] );
+
+    if (h->parent[node] == HIERARCHY_NONE) {
+        return local;
+    }
+    return mat44_mul( world_matrix(h, h->parent[node]), local );
+}
+
+static void build(Hierarchy * h)
+{
+    uint32_t k;
+
+    g_assert_true(  hierarchy_init(h, 2)  );                        // forces the arrays to grow
+    for (k = 0; k < 7; k++) {
+        g_assert_cmpuint( hierarchy_add(h, testparents[k], quat_from_euler_angles(0.3*k, -0.2, 1.0 - 0.4*k),
+                                        vec3_from_values(k, 1.0, -0.5*k)), ==, k );
+    }
+}
+
+static void check_world(const Hierarchy * h)
+{
+    Vector3 p = {0.5, -2.0, 3.0};
+    uint32_t k;
+
+    for (k = 0; k < h->count; k++) {
+        g_assert_true(  vec3_equal(dualquat_transform_point(hierarchy_world_dualquat(h, k), p),
+                                   mat44_transform_point(world_matrix(h, k), p))  );
+    }
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_hierarchy_update(void)
+{
+    Hierarchy h;
+
+    build( &h );
+    g_assert_cmpuint( hierarchy_add(&h, 7, quat_from_identity(), vec3_from_zeroes()), ==, HIERARCHY_NONE );
+
+    g_assert_cmpuint( hierarchy_update(&h), ==, 7 );
+    check_world( &h );
+    g_assert_cmpuint( hierarchy_update(&h), ==, 0 );
+
+    // Only the subtree of the changed node is recomputed
+    hierarchy_set_local_rotation( &h, 2, quat_from_euler_angles(1.0, 0.5, -0.25) );
+    g_assert_cmpuint( hierarchy_update(&h), ==, 2 );
+    check_world( &h );
+
+    hierarchy_set_local( &h, 4, quat_from_identity(), vec3_from_values(9.0, 0.0, 0.0) );
+    hierarchy_set_local( &h, 6, quat_from_identity(), vec3_from_values(0.0, 9.0, 0.0) );
+    g_assert_cmpuint( hierarchy_update(&h), ==, 2 );
+    check_world( &h );
+
+    hierarchy_set_local_rotation( &h, 1, quat_from_euler_angles(-0.5, 0.0, 0.75) );
+    g_assert_cmpuint( hierarchy_update(&h), ==, 4 );
+    check_world( &h );
+
+    hierarchy_free( &h );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The parents of testparents, shuffled: every node must land after its parent with its subtree contiguous.
+void test_hierarchy_from_parents(void)
+{
+    uint32_t shuffle[7] = {4, 6, 0, 3, 1, 5, 2};            // input node i is test node shuffle[i]
+    uint32_t parents[7], new_index[7], back[7];
+    uint32_t cycle[3] = {1, 2, 0};
+    uint32_t k;
+    Hierarchy h;
+
+    for (k = 0; k < 7; k++) {
+        back[shuffle[k]] = k;
+    }
+    for (k = 0; k < 7; k++) {
+        parents[k] = (testparents[shuffle[k]] == HIERARCHY_NONE) ? HIERARCHY_NONE : back[testparents[shuffle[k]]];
+    }
+
+    g_assert_true(  hierarchy_from_parents(&h, parents, 7, new_index)  );
+    g_assert_cmpuint( h.count, ==, 7 );
+    for (k = 0; k < 7; k++) {
+        if (parents[k] == HIERARCHY_NONE) {
+            g_assert_cmpuint( h.parent[new_index[k]], ==, HIERARCHY_NONE );
+        } else {
+            g_assert_cmpuint( h.parent[new_index[k]], ==, new_index[parents[k]] );
+            g_assert_cmpuint( h.parent[new_index[k]], <, new_index[k] );
+        }
+    }
+    // Depth first: the subtree {1, 2, 3, 4} of test node 0 directly follows it
+    for (k = 1; k <= 4; k++) {
+        g_assert_cmpuint( new_index[back[k]], <=, new_index[back[0]] + 4 );
+    }
+
+    hierarchy_set_local( &h, new_index[back[3]], quat_from_euler_angles(0.1, 0.2, 0.3), vec3_from_values(1.0, 2.0, 3.0) );
+    g_assert_cmpuint( hierarchy_update(&h), ==, 7 );
+    check_world( &h );
+    hierarchy_free( &h );
+
+    g_assert_false(  hierarchy_from_parents(&h, cycle, 3, new_index)  );
+    parents[2] = 9;
+    g_assert_false(  hierarchy_from_parents(&h, parents, 7, new_index)  );
+}
+
+
+
+void setuptests(void)
+{
+    g_test_add_func("/set_hierarchy/test_hierarchy_update", test_hierarchy_update);
+    g_test_add_func("/set_hierarchy/test_hierarchy_from_parents", test_hierarchy_from_parents);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // HIERARCHY_UNITTEST
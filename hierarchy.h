@@ -0,0 +1,88 @@
+//
+//
+//
+//
+//
+
+#if ! defined HIERARCHY_H
+#define HIERARCHY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector3.h"
+#include "quaternion.h"
+#include "dualquat.h"
+
+
+#define HIERARCHY_NONE      UINT32_MAX      // parent of root nodes, and the result of a failed hierarchy_add
+
+
+// Transform hierarchy (skeleton or scene graph) in flat arrays, one entry per node, sorted so that every parent comes
+// before its children. World transforms are then computed in a single forward sweep over the arrays.
+// Local and world transforms are a rotation followed by a translation, world = world(parent) * local.
+//
+// Changing a local transform marks the node dirty. hierarchy_update recomputes the dirty nodes and their descendants
+// only, starting at the lowest dirty index, since nothing before it can depend on a dirty node.
+// The fields are read-only for users, go through the functions below to modify them.
+typedef struct hierarchy {
+    size_t count;
+    size_t capacity;
+    size_t first_dirty;                 // count when nothing is dirty
+
+    uint32_t * parent;                  // parent[k] < k, or HIERARCHY_NONE
+    uint8_t * dirty;
+    Quaternion * local_rotation;
+    Vector3 * local_translation;
+    Quaternion * world_rotation;
+    Vector3 * world_translation;
+} Hierarchy;
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @param [capacity] nodes to allocate room for, the arrays grow as needed
+// @ret false if out of memory
+bool hierarchy_init(Hierarchy * h, size_t capacity);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void hierarchy_free(Hierarchy * h);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Appends a node. Since [parent] must already exist, appending keeps the arrays sorted.
+// @param [parent] index of the parent node, HIERARCHY_NONE for a root
+// @ret index of the new node, HIERARCHY_NONE if [parent] is invalid or out of memory
+uint32_t hierarchy_add(Hierarchy * h, uint32_t parent, Quaternion rotation, Vector3 translation);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Builds [h] from a parent array in any order, such as one loaded from a file. Nodes are placed in depth first order,
+// which also keeps every subtree contiguous. Local transforms start as the identity.
+// @param [parents] parent of each of the [count] input nodes, HIERARCHY_NONE for roots
+// @param [new_index] receives the index in [h] of each input node
+// @ret false if a parent is out of range, the parents form a cycle, or out of memory
+bool hierarchy_from_parents(Hierarchy * h, const uint32_t * parents, size_t count, uint32_t * new_index);
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Sets the local transform of [node] and marks it dirty.
+void hierarchy_set_local(Hierarchy * h, uint32_t node, Quaternion rotation, Vector3 translation);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Sets the local rotation of [node] and marks it dirty.
+void hierarchy_set_local_rotation(Hierarchy * h, uint32_t node, Quaternion rotation);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Recomputes the world transforms of the dirty nodes and all of their descendants, and clears the dirty marks.
+// @ret number of nodes recomputed
+size_t hierarchy_update(Hierarchy * h);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// World transform of [node] as of the last hierarchy_update, as a dual quaternion (see dualquat.h).
+DualQuaternion hierarchy_world_dualquat(const Hierarchy * h, uint32_t node);
+
+
+#endif      // HIERARCHY_H
@@ -0,0 +1,273 @@
+//
+//
+//
+//
+//
+//
+// Template of what the two point indexes share, instantiated by quatindex.c and vec3index.c: the order of the
+// matches, the heap of the best matches of a query, the quickselect and the builds, and the parallel queries.
+// Both trees are implicit, every node a range of the reordered points, holding INDEX_NODE_POINTS points of its own
+// (a vantage point, or none) then its lower half up to INDEX_FN(split), then its upper half.
+//
+// The includer defines INDEX_FN(name), which must paste [name] onto the prefix of the index (quat_index_), INDEX_T
+// (the index type), INDEX_POINT_T (the type of its points and queries), INDEX_MATCH_T (its match type, whose distance
+// field is INDEX_MATCH_KEY), INDEX_BUILD_T (the state of a build, copied for every subtree task), INDEX_NODE_POINTS,
+// INDEX_TASKS_PER_THREAD (subtrees per thread of the parallel build) and INDEX_QUERY_GRAIN (queries per parallel_for
+// chunk), and defines after including it:
+//     static void INDEX_FN(swap)(INDEX_BUILD_T * build, size_t a, size_t b)
+//     static inline size_t INDEX_FN(split)(size_t begin, size_t n)
+//     static bool INDEX_FN(split_node)(INDEX_BUILD_T * build, size_t begin, size_t end, bool parallel)
+// the last one returning false for a leaf. The macros are #undef'd at the end of this file.
+//
+// No include guard on purpose. Under the tier builds of simd.h only the match order and the heap are compiled.
+
+
+
+//==========================================================================================================================================
+// Matches
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Strict order of the matches: by distance, then by id
+static inline bool INDEX_FN(before)(INDEX_MATCH_T a, INDEX_MATCH_T b)
+{
+    return a.INDEX_MATCH_KEY < b.INDEX_MATCH_KEY || (!(a.INDEX_MATCH_KEY > b.INDEX_MATCH_KEY) && a.id < b.id);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline int INDEX_FN(compare)(const void * a, const void * b)
+{
+    const INDEX_MATCH_T * ma = a, * mb = b;
+
+    return INDEX_FN(before)(*mb, *ma) - INDEX_FN(before)(*ma, *mb);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Offers [m] to the best [k] matches of a query so far, the [*size] first of [heap], a max-heap on INDEX_FN(before)
+// with the worst on top.
+// @ret true if [m] is kept
+static inline bool INDEX_FN(heap_offer)(INDEX_MATCH_T * heap, size_t * size, size_t k, INDEX_MATCH_T m)
+{
+    size_t i, c, n = *size;
+
+    if (n < k) {
+        // sift up
+        for (i = n; i > 0 && INDEX_FN(before)(heap[(i - 1) / 2], m); i = (i - 1) / 2) {
+            heap[i] = heap[(i - 1) / 2];
+        }
+        heap[i] = m;
+        *size = n + 1;
+        return true;
+    }
+    if (k == 0 || !INDEX_FN(before)(m, heap[0])) {
+        return false;
+    }
+
+    // replace the worst, sift down
+    for (i = 0; (c = 2*i + 1) < n; i = c) {
+        if (c + 1 < n && INDEX_FN(before)(heap[c], heap[c + 1])) {
+            c++;
+        }
+        if (!INDEX_FN(before)(m, heap[c])) {
+            break;
+        }
+        heap[i] = heap[c];
+    }
+    heap[i] = m;
+    return true;
+}
+
+
+
+#if ! defined SIMD_KERNEL_BUILD
+//==========================================================================================================================================
+// Construction
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void INDEX_FN(swap)(INDEX_BUILD_T * build, size_t a, size_t b);
+static inline size_t INDEX_FN(split)(size_t begin, size_t n);
+static bool INDEX_FN(split_node)(INDEX_BUILD_T * build, size_t begin, size_t end, bool parallel);
+
+// The subtrees of INDEX_FN(subtree_task), a begin and an end each
+struct INDEX_FN(subtree_job) {
+    INDEX_BUILD_T * build;
+    size_t * ranges;
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Reorders [begin, end) so that the point at [nth] has its final place in the order of [key], an array that
+// INDEX_FN(swap) reorders along, with no greater key before it and no smaller one after it. Quickselect on the median
+// of 3.
+static void INDEX_FN(select)(INDEX_BUILD_T * build, const double * key, size_t begin, size_t end, size_t nth)
+{
+    size_t lo = begin, hi = end - 1, mid, i, j;
+    double pivot;
+
+    while (hi > lo) {
+        mid = lo + (hi - lo) / 2;
+        if (key[mid] < key[lo]) {
+            INDEX_FN(swap)( build, mid, lo );
+        }
+        if (key[hi] < key[lo]) {
+            INDEX_FN(swap)( build, hi, lo );
+        }
+        if (key[hi] < key[mid]) {
+            INDEX_FN(swap)( build, hi, mid );
+        }
+        pivot = key[mid];
+
+        i = lo;
+        j = hi;
+        while (i <= j) {
+            while (key[i] < pivot) {
+                i++;
+            }
+            while (key[j] > pivot) {
+                j--;
+            }
+            if (i <= j) {
+                INDEX_FN(swap)( build, i, j );
+                i++;
+                if (j == 0) {
+                    break;
+                }
+                j--;
+            }
+        }
+
+        if (nth <= j) {
+            hi = j;
+        } else if (nth >= i) {
+            lo = i;
+        } else {
+            return;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void INDEX_FN(build_subtree)(INDEX_BUILD_T * build, size_t begin, size_t end)
+{
+    size_t split;
+
+    while (INDEX_FN(split_node)( build, begin, end, false )) {
+        split = INDEX_FN(split)( begin, end - begin );
+        INDEX_FN(build_subtree)( build, begin + INDEX_NODE_POINTS, split );
+        begin = split;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void INDEX_FN(subtree_task)(void * context, size_t begin, size_t end)
+{
+    const struct INDEX_FN(subtree_job) * job = context;
+    INDEX_BUILD_T build = *job->build;                  // own copy of the state of the build
+    size_t k;
+
+    for (k = begin; k < end; k++) {
+        INDEX_FN(build_subtree)( &build, job->ranges[2*k], job->ranges[2*k + 1] );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Builds the tree of the [count] points of [build] with the parallel_for pool: the upper nodes are split level by
+// level, each with all threads, until there are enough subtrees for the pool, then the subtrees are built one per
+// task. Gives the same tree as INDEX_FN(build_subtree).
+// @ret false if out of memory, with nothing split
+static bool INDEX_FN(build_levels)(INDEX_BUILD_T * build, size_t count)
+{
+    struct INDEX_FN(subtree_job) job;
+    size_t target = (size_t) parallel_init( 0 ) * INDEX_TASKS_PER_THREAD;
+    size_t * ranges = malloc( sizeof(size_t) * 4 * target );
+    size_t * next = malloc( sizeof(size_t) * 4 * target );
+    size_t * t;
+    size_t n = 1, m, j, split;
+
+    if (ranges == NULL || next == NULL) {
+        free( ranges );
+        free( next );
+        return false;
+    }
+
+    ranges[0] = 0;
+    ranges[1] = count;
+    while (n < target) {
+        m = 0;
+        for (j = 0; j < n; j++) {
+            if (INDEX_FN(split_node)( build, ranges[2*j], ranges[2*j + 1], true )) {
+                split = INDEX_FN(split)( ranges[2*j], ranges[2*j + 1] - ranges[2*j] );
+                next[2*m] = ranges[2*j] + INDEX_NODE_POINTS;    next[2*m + 1] = split;              m++;
+                next[2*m] = split;                              next[2*m + 1] = ranges[2*j + 1];    m++;
+            }
+        }
+        t = ranges;     ranges = next;      next = t;
+        n = m;
+        if (m == 0) {
+            break;
+        }
+    }
+
+    job.build = build;
+    job.ranges = ranges;
+    parallel_for( n, 1, INDEX_FN(subtree_task), &job );
+
+    free( ranges );
+    free( next );
+    return true;
+}
+
+
+
+//==========================================================================================================================================
+// Parallel queries, over the _array ones
+//------------------------------------------------------------------------------------------------------------------------------------------
+struct INDEX_FN(query_job) {
+    const INDEX_T * index;
+    const INDEX_POINT_T * queries;
+    size_t k;                           // matches per query, k or max
+    double limit;                       // of the radius queries
+    INDEX_MATCH_T * out;
+    size_t * found;
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void INDEX_FN(knn_task)(void * context, size_t begin, size_t end)
+{
+    const struct INDEX_FN(query_job) * job = context;
+    INDEX_FN(knn_array)( job->index, job->queries + begin, end - begin, job->k, job->out + begin * job->k );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void INDEX_FN(radius_task)(void * context, size_t begin, size_t end)
+{
+    const struct INDEX_FN(query_job) * job = context;
+    INDEX_FN(radius_array)( job->index, job->queries + begin, end - begin, job->limit, job->out + begin * job->k, job->k,
+                            job->found + begin );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void INDEX_FN(knn_array_parallel)(const INDEX_T * index, const INDEX_POINT_T * queries, size_t count, size_t k,
+                                  INDEX_MATCH_T * out)
+{
+    struct INDEX_FN(query_job) job = {index, queries, k, 0, out, NULL};
+    parallel_for( count, INDEX_QUERY_GRAIN, INDEX_FN(knn_task), &job );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void INDEX_FN(radius_array_parallel)(const INDEX_T * index, const INDEX_POINT_T * queries, size_t count, double limit,
+                                     INDEX_MATCH_T * out, size_t max, size_t * found)
+{
+    struct INDEX_FN(query_job) job = {index, queries, max, limit, out, found};
+    parallel_for( count, INDEX_QUERY_GRAIN, INDEX_FN(radius_task), &job );
+}
+
+#endif      // ! SIMD_KERNEL_BUILD
+
+
+
+#undef INDEX_FN
+#undef INDEX_T
+#undef INDEX_POINT_T
+#undef INDEX_MATCH_T
+#undef INDEX_MATCH_KEY
+#undef INDEX_BUILD_T
+#undef INDEX_NODE_POINTS
+#undef INDEX_TASKS_PER_THREAD
+#undef INDEX_QUERY_GRAIN
@@ -0,0 +1,532 @@
+//
+//
+//
+//
+//
+
+#define _POSIX_C_SOURCE 200809L         // clock_gettime, nanosleep
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#include <x86intrin.h>
+#define INSTRUMENT_RDTSC
+#endif
+
+#include "instrument.h"
+
+
+#define INSTRUMENT_ENV              "AGK_INSTRUMENT"
+#define INSTRUMENT_CALIBRATION_NS   20000000        // least time between the two readings that scale the tsc to ns
+
+
+// The counters of one function in one thread. Only the owning thread writes them, with plain relaxed load and store
+// rather than an atomic add, so that collecting them from another thread is defined without slowing the owner down.
+// The owner makes [seq] odd while it updates the others, so that a reader can take all of them from the same call.
+typedef struct instrument_counter {
+    atomic_uint_least64_t seq;
+    atomic_uint_least64_t calls;
+    atomic_uint_least64_t items;
+    atomic_uint_least64_t ticks;
+    atomic_uint_least64_t sizes[INSTRUMENT_SIZE_CLASSES];
+} InstrumentCounter;
+
+// A consistent reading of an InstrumentCounter
+typedef struct instrument_totals {
+    uint64_t calls;
+    uint64_t items;
+    uint64_t ticks;
+    uint64_t sizes[INSTRUMENT_SIZE_CLASSES];
+} InstrumentTotals;
+
+// The counters of a thread, allocated on its first instrumented call and kept in a list after the thread ends,
+// so that its calls still count. The counters only ever grow: instrument_reset records them in [baseline], which
+// instrument_collect subtracts, so that a reset never races with the owner updating them.
+typedef struct instrument_thread {
+    struct instrument_thread * next;
+    InstrumentCounter counters[INSTRUMENT_POINT_COUNT];
+    InstrumentTotals baseline[INSTRUMENT_POINT_COUNT];      // guarded by instrument_lock
+} InstrumentThread;
+
+
+#define INSTRUMENT_NAME(name)   #name,
+static const char * const instrument_names[INSTRUMENT_POINT_COUNT] = { INSTRUMENT_POINTS(INSTRUMENT_NAME) };
+
+static _Thread_local InstrumentThread * instrument_self = NULL;
+static _Atomic(InstrumentThread *) instrument_threads = NULL;
+
+static pthread_mutex_t instrument_lock = PTHREAD_MUTEX_INITIALIZER;     // instrument_collect and instrument_reset
+static pthread_once_t instrument_once = PTHREAD_ONCE_INIT;
+static uint64_t instrument_origin_ticks, instrument_origin_ns;     // first reading of both clocks, to scale the tsc
+static char * instrument_path = NULL;       // copy of AGK_INSTRUMENT at the first instrumented call, the program may unset it
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+static uint64_t instrument_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The clock of the timings: the time stamp counter, which runs at a constant rate on the processors of the last 15
+// years and costs about 20 cycles, or else the monotonic clock in ns.
+static inline uint64_t instrument_ticks(void)
+{
+#if defined INSTRUMENT_RDTSC
+    return __rdtsc();
+#else
+    return instrument_ns();
+#endif
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret the size class of [items]: 0 for none, else 1 + the index of its highest set bit, up to the last class
+static inline unsigned instrument_size_class(size_t items)
+{
+    unsigned c = 0;
+
+#if defined __GNUC__
+    if (items != 0) {
+        c = (unsigned) (sizeof(unsigned long) * CHAR_BIT) - (unsigned) __builtin_clzl( (unsigned long) items );
+    }
+#else
+    for (; items != 0; items >>= 1) {
+        c++;
+    }
+#endif
+    return (c < INSTRUMENT_SIZE_CLASSES) ? c : INSTRUMENT_SIZE_CLASSES - 1;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline void instrument_add(atomic_uint_least64_t * counter, uint64_t n)
+{
+    atomic_store_explicit( counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Reads the counters of [c] as they stood between two calls of their owner, retrying while it updates them.
+static void instrument_read(const InstrumentCounter * c, InstrumentTotals * totals)
+{
+    uint64_t seq;
+    unsigned s;
+
+    for (;;) {
+        seq = atomic_load_explicit( &c->seq, memory_order_acquire );
+        if (seq % 2 != 0) {
+            continue;
+        }
+        totals->calls = atomic_load_explicit( &c->calls, memory_order_relaxed );
+        totals->items = atomic_load_explicit( &c->items, memory_order_relaxed );
+        totals->ticks = atomic_load_explicit( &c->ticks, memory_order_relaxed );
+        for (s = 0; s < INSTRUMENT_SIZE_CLASSES; s++) {
+            totals->sizes[s] = atomic_load_explicit( &c->sizes[s], memory_order_relaxed );
+        }
+        atomic_thread_fence( memory_order_acquire );
+        if (atomic_load_explicit( &c->seq, memory_order_relaxed ) == seq) {
+            return;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void instrument_dump_at_exit(void)
+{
+    FILE * f;
+
+    if (strcmp(instrument_path, "-") == 0) {
+        instrument_dump( stderr );
+    } else if ((f = fopen( instrument_path, "w" )) == NULL) {
+        perror( instrument_path );
+    } else {
+        instrument_dump( f );
+        fclose( f );
+    }
+    free( instrument_path );
+    instrument_path = NULL;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void instrument_init(void)
+{
+    const char * path = getenv( INSTRUMENT_ENV );
+
+    instrument_origin_ns = instrument_ns();
+    instrument_origin_ticks = instrument_ticks();
+    if (path != NULL && path[0] != '\0') {
+        instrument_path = strdup( path );
+        if (instrument_path != NULL) {
+            atexit( instrument_dump_at_exit );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Allocates the counters of the calling thread and links them into the list.
+// @ret NULL without memory, the calls of the thread are then not counted
+static InstrumentThread * instrument_register(void)
+{
+    InstrumentThread * t;
+
+    pthread_once( &instrument_once, instrument_init );
+
+    t = calloc( 1, sizeof(InstrumentThread) );
+    if (t != NULL) {
+        t->next = atomic_load( &instrument_threads );
+        while (!atomic_compare_exchange_weak( &instrument_threads, &t->next, t )) {
+        }
+        instrument_self = t;
+    }
+    return t;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret ns per tick of instrument_ticks
+static double instrument_ns_per_tick(void)
+{
+#if defined INSTRUMENT_RDTSC
+    uint64_t ns, ticks;
+    struct timespec wait = {0, 0};
+
+    pthread_once( &instrument_once, instrument_init );
+
+    ns = instrument_ns();
+    if (ns - instrument_origin_ns < INSTRUMENT_CALIBRATION_NS) {
+        wait.tv_nsec = (long) (INSTRUMENT_CALIBRATION_NS - (ns - instrument_origin_ns));
+        nanosleep( &wait, NULL );
+        ns = instrument_ns();
+    }
+    ticks = instrument_ticks();
+    return (double) (ns - instrument_origin_ns) / (double) (ticks - instrument_origin_ticks);
+#else
+    return 1;
+#endif
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// qsort order of the dump: the longest total time first
+static int instrument_compare_ns(const void * a, const void * b)
+{
+    const InstrumentStats * sa = a, * sb = b;
+
+    return (sa->ns < sb->ns) - (sa->ns > sb->ns);
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool instrument_enabled(void)
+{
+#if defined AGK_INSTRUMENT
+    return true;
+#else
+    return false;
+#endif
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void instrument_collect(InstrumentStats * stats)
+{
+    const InstrumentThread * t;
+    const InstrumentTotals * base;
+    InstrumentTotals now;
+    double ns_per_tick = instrument_ns_per_tick();
+    uint64_t ticks[INSTRUMENT_POINT_COUNT] = {0};
+    unsigned p, s;
+
+    memset( stats, 0, sizeof(InstrumentStats) * INSTRUMENT_POINT_COUNT );
+    pthread_mutex_lock( &instrument_lock );
+    for (t = atomic_load( &instrument_threads ); t != NULL; t = t->next) {
+        for (p = 0; p < INSTRUMENT_POINT_COUNT; p++) {
+            instrument_read( &t->counters[p], &now );
+            base = &t->baseline[p];
+            stats[p].calls += now.calls - base->calls;
+            stats[p].items += now.items - base->items;
+            ticks[p] += now.ticks - base->ticks;
+            for (s = 0; s < INSTRUMENT_SIZE_CLASSES; s++) {
+                stats[p].sizes[s] += now.sizes[s] - base->sizes[s];
+            }
+        }
+    }
+    pthread_mutex_unlock( &instrument_lock );
+    for (p = 0; p < INSTRUMENT_POINT_COUNT; p++) {
+        stats[p].name = instrument_names[p];
+        stats[p].ns = (double) ticks[p] * ns_per_tick;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void instrument_dump(FILE * f)
+{
+    InstrumentStats stats[INSTRUMENT_POINT_COUNT];
+    const InstrumentStats * st;
+    char range[48];
+    unsigned p, s, mode;
+
+    if (!instrument_enabled()) {
+        fprintf( f, "instrumentation not compiled in, build with AGK_INSTRUMENT\n" );
+        return;
+    }
+
+    instrument_collect( stats );
+    qsort( stats, INSTRUMENT_POINT_COUNT, sizeof(stats[0]), instrument_compare_ns );
+
+    fprintf( f, "%-38s %12s %11s %11s %9s %11s  %s\n",
+             "function", "calls", "items/call", "ns/call", "ns/item", "total ms", "usual items" );
+    for (p = 0; p < INSTRUMENT_POINT_COUNT; p++) {
+        st = &stats[p];
+        if (st->calls == 0) {
+            continue;
+        }
+
+        mode = 0;
+        for (s = 1; s < INSTRUMENT_SIZE_CLASSES; s++) {
+            if (st->sizes[s] > st->sizes[mode]) {
+                mode = s;
+            }
+        }
+        if (mode <= 1) {
+            snprintf( range, sizeof(range), "%u", mode );
+        } else if (mode == INSTRUMENT_SIZE_CLASSES - 1) {
+            snprintf( range, sizeof(range), "%zu+", (size_t) 1 << (mode - 1) );
+        } else {
+            snprintf( range, sizeof(range), "%zu-%zu", (size_t) 1 << (mode - 1), ((size_t) 1 << mode) - 1 );
+        }
+
+        fprintf( f, "%-38s %12" PRIu64 " %11.1f %11.1f %9.2f %11.3f  %s\n", st->name, st->calls,
+                 (double) st->items / (double) st->calls, st->ns / (double) st->calls,
+                 (st->items != 0) ? st->ns / (double) st->items : 0.0, st->ns * 1e-6, range );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void instrument_reset(void)
+{
+    InstrumentThread * t;
+    unsigned p;
+
+    pthread_mutex_lock( &instrument_lock );
+    for (t = atomic_load( &instrument_threads ); t != NULL; t = t->next) {
+        for (p = 0; p < INSTRUMENT_POINT_COUNT; p++) {
+            instrument_read( &t->counters[p], &t->baseline[p] );
+        }
+    }
+    pthread_mutex_unlock( &instrument_lock );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+uint64_t instrument_begin(void)
+{
+    return instrument_ticks();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void instrument_end(InstrumentPoint point, uint64_t start, size_t items)
+{
+    uint64_t ticks = instrument_ticks() - start;
+    InstrumentThread * t = instrument_self;
+    InstrumentCounter * c;
+
+    if (t == NULL && (t = instrument_register()) == NULL) {
+        return;
+    }
+    c = &t->counters[point];
+    instrument_add( &c->seq, 1 );
+    atomic_thread_fence( memory_order_release );
+    instrument_add( &c->calls, 1 );
+    instrument_add( &c->items, items );
+    instrument_add( &c->ticks, ticks );
+    instrument_add( &c->sizes[instrument_size_class(items)], 1 );
+    atomic_store_explicit( &c->seq, atomic_load_explicit(&c->seq, memory_order_relaxed) + 1, memory_order_release );
+}
+
+
+
+
+
+
+
+//==========================================================================================================================================
+//==========================================================================================================================================
+//==========================================================================================================================================
+#ifdef INSTRUMENT_UNITTEST
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+
+#include "quaternion.h"
+
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void * test_instrument_thread(void * arg)
+{
+    Quaternion * q = arg;
+
+    quat_norm_array( q, q, 300 );
+    return NULL;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The calls of every thread are summed, each in the size class of its item count; the counters are zero in a build
+// without AGK_INSTRUMENT.
+void test_instrument_collect(void)
+{
+    enum { count = 300 };
+    static Quaternion q[count];
+    InstrumentStats stats[INSTRUMENT_POINT_COUNT];
+    const InstrumentStats * st = &stats[INSTRUMENT_quat_norm_array];
+    pthread_t thread;
+    uint64_t calls = instrument_enabled() ? 3 : 0;
+    size_t k;
+
+    for (k = 0; k < count; k++) {
+        q[k] = quat_from_values( 1, 2, 3, (double) k );
+    }
+
+    instrument_reset();
+    quat_norm_array( q, q, 0 );
+    quat_norm_array( q, q, 5 );
+    g_assert_cmpint(  pthread_create(&thread, NULL, test_instrument_thread, q), ==, 0  );
+    pthread_join( thread, NULL );
+
+    instrument_collect( stats );
+    g_assert_cmpstr(  st->name, ==, "quat_norm_array"  );
+    g_assert_cmpuint(  st->calls, ==, calls  );
+    g_assert_cmpuint(  st->items, ==, instrument_enabled() ? 305 : 0  );
+    g_assert_cmpuint(  st->sizes[0], ==, calls / 3  );          // 0
+    g_assert_cmpuint(  st->sizes[3], ==, calls / 3  );          // 4-7
+    g_assert_cmpuint(  st->sizes[9], ==, calls / 3  );          // 256-511
+    g_assert_true(  st->ns >= 0  );
+    g_assert_cmpuint(  stats[INSTRUMENT_quat_log_array].calls, ==, 0  );
+
+    instrument_reset();
+    instrument_collect( stats );
+    g_assert_cmpuint(  st->calls, ==, 0  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static atomic_bool test_instrument_stop;
+
+static void * test_instrument_busy_thread(void * arg)
+{
+    Quaternion * q = arg;
+
+    while (!atomic_load(&test_instrument_stop)) {
+        quat_norm_array( q, q, 5 );
+    }
+    return NULL;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Resets and collections while another thread keeps calling: every reading holds whole calls, and a reset is never
+// undone by the owner writing back older counts.
+void test_instrument_reset_concurrent(void)
+{
+    static Quaternion q[5];
+    InstrumentStats stats[INSTRUMENT_POINT_COUNT];
+    const InstrumentStats * st = &stats[INSTRUMENT_quat_norm_array];
+    pthread_t thread;
+    int k;
+
+    for (k = 0; k < 5; k++) {
+        q[k] = quat_from_values( 1, 2, 3, (double) k );
+    }
+
+    atomic_store( &test_instrument_stop, false );
+    g_assert_cmpint(  pthread_create(&thread, NULL, test_instrument_busy_thread, q), ==, 0  );
+    for (k = 0; k < 1000; k++) {
+        instrument_reset();
+        instrument_collect( stats );
+        g_assert_cmpuint(  st->items, ==, 5 * st->calls  );
+        g_assert_cmpuint(  st->sizes[3], ==, st->calls  );
+    }
+    atomic_store( &test_instrument_stop, true );
+    pthread_join( thread, NULL );
+
+    instrument_reset();
+    instrument_collect( stats );
+    g_assert_cmpuint(  st->calls, ==, 0  );
+    g_assert_cmpuint(  st->items, ==, 0  );
+    quat_norm_array( q, q, 5 );
+    instrument_collect( stats );
+    g_assert_cmpuint(  st->calls, ==, instrument_enabled() ? 1 : 0  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The dump at exit goes to the path of AGK_INSTRUMENT at the first instrumented call, even if the program unsets it
+// since. Registered first, so that the subprocess makes the first call.
+void test_instrument_dump_unset(void)
+{
+    const char * path = "test_instrument_dump.txt";
+    FILE * f;
+
+    if (g_test_subprocess()) {
+        setenv( INSTRUMENT_ENV, path, 1 );
+        instrument_end( INSTRUMENT_quat_norm_array, instrument_begin(), 1 );
+        unsetenv( INSTRUMENT_ENV );
+        exit( 0 );
+    }
+
+    remove( path );
+    g_test_trap_subprocess( NULL, 0, 0 );
+    g_test_trap_assert_passed();
+    f = fopen( path, "r" );
+    g_assert_nonnull(  f  );
+    if (f != NULL) {
+        g_assert_true(  fgetc(f) != EOF  );
+        fclose( f );
+    }
+    remove( path );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_instrument_size_class(void)
+{
+    g_assert_cmpuint(  instrument_size_class(0), ==, 0  );
+    g_assert_cmpuint(  instrument_size_class(1), ==, 1  );
+    g_assert_cmpuint(  instrument_size_class(3), ==, 2  );
+    g_assert_cmpuint(  instrument_size_class(4), ==, 3  );
+    g_assert_cmpuint(  instrument_size_class(1000), ==, 10  );
+    g_assert_cmpuint(  instrument_size_class((size_t) 1 << (INSTRUMENT_SIZE_CLASSES - 2)), ==, INSTRUMENT_SIZE_CLASSES - 1  );
+    g_assert_cmpuint(  instrument_size_class(SIZE_MAX), ==, INSTRUMENT_SIZE_CLASSES - 1  );
+}
+
+
+
+void setuptests(void)
+{
+    g_test_add_func("/set_instrument/test_instrument_dump_unset", test_instrument_dump_unset);
+    g_test_add_func("/set_instrument/test_instrument_collect", test_instrument_collect);
+    g_test_add_func("/set_instrument/test_instrument_size_class", test_instrument_size_class);
+    g_test_add_func("/set_instrument/test_instrument_reset_concurrent", test_instrument_reset_concurrent);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // INSTRUMENT_UNITTEST
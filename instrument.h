@@ -0,0 +1,165 @@
+//
+//
+//
+//
+//
+
+#if ! defined INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <assert.h>             // static_assert of the disabled INSTRUMENT_BEGIN
+
+
+// Hot path instrumentation of the batch functions, compiled in by defining AGK_INSTRUMENT for the whole build, in
+// place of a -pg build that has to run unoptimised. Each instrumented function counts its calls, the items it was
+// given, in power of two size classes, and the time spent in it, read from the time stamp counter where there is one.
+// The counters are kept per thread, written by their own thread only, without locks or atomic read-modify-write, and
+// summed by instrument_collect / instrument_dump whenever asked. instrument_reset leaves them be and records where they
+// stood instead, which the sums subtract.
+// Without AGK_INSTRUMENT the macros expand to nothing that runs and the functions below report no calls.
+//
+// The batch functions of simd.h (SIMD_DISPATCH) are instrumented at their entry, other functions with the macros:
+//      size_t k;
+//      INSTRUMENT_BEGIN(name);             // a declaration, last of the block
+//      ...
+//      INSTRUMENT_END(name, items);        // before every return
+// where [name] is listed in INSTRUMENT_POINTS. A call of an instrumented function from another one counts in both.
+//
+// Setting the environment variable AGK_INSTRUMENT to a file name, or to "-" for stderr, dumps the counters there at
+// exit.
+
+// Every instrumented function, in the order of the dump
+#define INSTRUMENT_POINTS(X) \
+    X(vec3_norm_array) \
+    X(vec3_renorm_array) \
+    X(vec3f_norm_array) \
+    X(vec3f_renorm_array) \
+    X(vec3_dot_array) \
+    X(vec3_cross_array) \
+    X(vec3_cross_array_inplace) \
+    X(vec3_add_array) \
+    X(vec3_add_array_inplace) \
+    X(vec3_project_plane_array) \
+    X(vec3_project_plane_array_inplace) \
+    X(vec3_dot_soa) \
+    X(vec3_cross_soa) \
+    X(vec3_cross_soa_inplace) \
+    X(vec3_add_soa) \
+    X(vec3_add_soa_inplace) \
+    X(vec3_project_plane_soa) \
+    X(vec3_project_plane_soa_inplace) \
+    X(vec3_norm_soa) \
+    X(vec3_norm_soa_inplace) \
+    X(vec3_renorm_soa) \
+    X(quat_rotate_vec3_array) \
+    X(quat_rotate_vec3_soa) \
+    X(quatf_rotate_vec3_array) \
+    X(quatf_rotate_vec3_soa) \
+    X(quat_interpolate_array) \
+    X(quat_interpolate_samples) \
+    X(quatf_interpolate_array) \
+    X(quatf_interpolate_samples) \
+    X(quat_norm_array) \
+    X(quat_renorm_array) \
+    X(quat_norm_soa) \
+    X(quat_renorm_soa) \
+    X(quatf_norm_array) \
+    X(quatf_renorm_array) \
+    X(quat_exp_array) \
+    X(quat_log_array) \
+    X(quat_pow_array) \
+    X(quat_from_euler_angles_array) \
+    X(quat_from_angle_axis_array) \
+    X(mat44_transform_point_array) \
+    X(mat44_transform_dir_array) \
+    X(mat44_to_quat_array) \
+    X(mat44_from_rotation_translation_array) \
+    X(mat44_from_quatf_translation_array) \
+    X(dualquat_mul_array) \
+    X(dualquat_norm_array) \
+    X(skin_dualquat) \
+    X(hierarchy_update) \
+    X(quat_integrate_soa) \
+    X(quat_pack32_array) \
+    X(quat_pack48_array) \
+    X(quat_pack64_array) \
+    X(quat_unpack32_array) \
+    X(quat_unpack48_array) \
+    X(quat_unpack64_array) \
+    X(vec3h_from_vec3_array) \
+    X(vec3_from_vec3h_array) \
+    X(vec3h_add_array) \
+    X(vec3h_scale_array) \
+    X(vec3h_dot_array) \
+    X(vec3q16_from_vec3_array) \
+    X(vec3_from_vec3q16_array) \
+    X(vec3q16_dot_array) \
+    X(vec3q21_from_vec3_array) \
+    X(vec3_from_vec3q21_array) \
+    X(vec3q21_dot_array) \
+    X(vec3_index_knn_array) \
+    X(vec3_index_radius_array)
+
+#define INSTRUMENT_ENUM(name)   INSTRUMENT_##name,
+
+typedef enum instrument_point {
+    INSTRUMENT_POINTS(INSTRUMENT_ENUM)
+    INSTRUMENT_POINT_COUNT
+} InstrumentPoint;
+
+// Size classes of the item counts: 0, 1, 2-3, 4-7, ... and the last one for 2^(INSTRUMENT_SIZE_CLASSES - 2) and more
+#define INSTRUMENT_SIZE_CLASSES 18
+
+
+#if defined AGK_INSTRUMENT
+#define INSTRUMENT_BEGIN(name)          const uint64_t instrument_start_##name = instrument_begin()
+#define INSTRUMENT_END(name, items)     instrument_end( INSTRUMENT_##name, instrument_start_##name, (size_t) (items) )
+#else
+#define INSTRUMENT_BEGIN(name)          static_assert( INSTRUMENT_##name < INSTRUMENT_POINT_COUNT, #name )
+#define INSTRUMENT_END(name, items)     ((void) 0)
+#endif
+
+
+// The counters of one function, summed over the threads
+typedef struct instrument_stats {
+    const char * name;
+    uint64_t calls;
+    uint64_t items;
+    double ns;                              // time inside the function
+    uint64_t sizes[INSTRUMENT_SIZE_CLASSES];    // calls per size class of their item count
+} InstrumentStats;
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret true if the build counts, i.e. AGK_INSTRUMENT was defined
+bool instrument_enabled(void);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Sums the counters of all threads, including the ones that have ended. A call ending meanwhile is counted wholly or
+// not at all: its calls, items, time and size class always agree.
+// @param [stats] receives INSTRUMENT_POINT_COUNT entries, in the order of INSTRUMENT_POINTS
+void instrument_collect(InstrumentStats * stats);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Prints a table of the functions called since the start or the last instrument_reset, the longest total time first:
+// calls, items per call, time per call and per item, total time and the largest size class.
+void instrument_dump(FILE * f);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Zeroes the counters of all threads, as seen by instrument_collect and instrument_dump. A call ending meanwhile falls
+// wholly before or wholly after the reset; none is lost or counted twice.
+void instrument_reset(void);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Used by INSTRUMENT_BEGIN and INSTRUMENT_END.
+uint64_t instrument_begin(void);
+void instrument_end(InstrumentPoint point, uint64_t start, size_t items);
+
+
+#endif      // INSTRUMENT_H
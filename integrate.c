@@ -0,0 +1,412 @@
+//
+//
+//
+//
+//
+
+// The quat_ scalar functions are used per body, take the header-only versions so they inline
+#define AGK_INLINE
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <tgmath.h>
+#include <float.h>              // for FLT_EPSILON in comparison precision
+#include <string.h>
+
+#include "integrate.h"
+#include "quaternion.h"
+#include "vector3.h"
+#include "parallel.h"
+#include "simd.h"
+
+
+#define INTEGRATE_PARALLEL_GRAIN    8192    // bodies per parallel_for chunk, 7 arrays or about 450 KB of streamed data
+#define INTEGRATE_POLY_MAX          0.25    // largest |a|^2 of the vector sin / cos polynomials, a half angle of 0.5
+#define INTEGRATE_POLY_TERMS        9
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Step quaternion times [q], [a] being dt/2 omega. Too large to inline at -O2 with quat_mul and quat_norm inlined in it,
+// its callers are the tail call of quat_integrate and the fallback and remainder bodies of the vector kernels.
+static Quaternion integrate_step(QuatIntegration method, Quaternion q, double ax, double ay, double az)
+{
+    double s = ax*ax + ay*ay + az*az;
+    double h, k = 1;
+    Quaternion m;
+
+    switch (method) {
+    case QUAT_INTEGRATE_EULER:
+        m.w = 1;
+        break;
+    case QUAT_INTEGRATE_EXP:
+        h = sqrt(s);
+        m.w = cos(h);
+        if (h > 0) {
+            k = sin(h) / h;
+        }
+        break;
+    case QUAT_INTEGRATE_RK4:
+        m.w = 1 - s/2 + s*s/24;
+        k = 1 - s/6;
+        break;
+    default:
+        m.w = 1;
+        break;
+    }
+
+    m.x = k * ax;
+    m.y = k * ay;
+    m.z = k * az;
+    q = quat_mul(m, q);
+
+    return (method == QUAT_INTEGRATE_EXP) ? q : quat_norm(q);
+}
+
+#if ! defined SIMD_KERNEL_BUILD
+//------------------------------------------------------------------------------------------------------------------------------------------
+Quaternion quat_integrate(QuatIntegration method, Quaternion q, Vector3 omega, double dt)
+{
+    double half_dt = dt / 2;
+
+    return integrate_step( method, q, half_dt * omega.x, half_dt * omega.y, half_dt * omega.z );
+}
+#endif
+
+
+
+//==========================================================================================================================================
+// SoA kernel, one per tier under runtime dispatch (simd.h)
+SIMD_DISPATCH_VOID(quat_integrate_soa, (QuatIntegration method, double * w, double * x, double * y, double * z,
+                                        const double * omega_x, const double * omega_y, const double * omega_z,
+                                        double dt, size_t count),
+                   (method, w, x, y, z, omega_x, omega_y, omega_z, dt, count))
+
+#if defined SIMD_KERNELS
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Body [k] of the SoA arrays.
+static inline void integrate_body(QuatIntegration method,
+                                  double * w, double * x, double * y, double * z,
+                                  const double * omega_x, const double * omega_y, const double * omega_z,
+                                  double half_dt, size_t k)
+{
+    Quaternion q = {{w[k], x[k], y[k], z[k]}};
+
+    q = integrate_step( method, q, half_dt * omega_x[k], half_dt * omega_y[k], half_dt * omega_z[k] );
+    w[k] = q.w;
+    x[k] = q.x;
+    y[k] = q.y;
+    z[k] = q.z;
+}
+
+
+
+//==========================================================================================================================================
+#if defined SIMD_HAVE_AVX2
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Taylor coefficients in s = h^2 of cos h and sin h / h. For s <= INTEGRATE_POLY_MAX the first omitted term is below
+// 1e-21, so both are within rounding of the library functions.
+static const double integrate_cos_poly[INTEGRATE_POLY_TERMS] = {
+    1.0, -1.0/2, 1.0/24, -1.0/720, 1.0/40320, -1.0/3628800, 1.0/479001600, -1.0/87178291200.0, 1.0/20922789888000.0
+};
+static const double integrate_sinc_poly[INTEGRATE_POLY_TERMS] = {
+    1.0, -1.0/6, 1.0/120, -1.0/5040, 1.0/362880, -1.0/39916800, 1.0/6227020800.0, -1.0/1307674368000.0,
+    1.0/355687428096000.0
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline __m256d integrate_poly4(const double * c, __m256d s)
+{
+    __m256d r = _mm256_set1_pd(c[INTEGRATE_POLY_TERMS - 1]);
+    int i;
+
+    for (i = INTEGRATE_POLY_TERMS - 2; i >= 0; i--) {
+        r = _mm256_fmadd_pd(r, s, _mm256_set1_pd(c[i]));
+    }
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Bodies [k] .. [k + 3], one per lane.
+// @ret false, leaving the bodies unchanged, if QUAT_INTEGRATE_EXP has a step beyond the polynomials
+static inline bool integrate_block4(QuatIntegration method,
+                                    double * w, double * x, double * y, double * z,
+                                    const double * omega_x, const double * omega_y, const double * omega_z,
+                                    __m256d half_dt, size_t k)
+{
+    __m256d one = _mm256_set1_pd(1);
+    __m256d ax = _mm256_mul_pd(half_dt, _mm256_loadu_pd(omega_x + k));
+    __m256d ay = _mm256_mul_pd(half_dt, _mm256_loadu_pd(omega_y + k));
+    __m256d az = _mm256_mul_pd(half_dt, _mm256_loadu_pd(omega_z + k));
+    __m256d qw = _mm256_loadu_pd(w + k), qx = _mm256_loadu_pd(x + k);
+    __m256d qy = _mm256_loadu_pd(y + k), qz = _mm256_loadu_pd(z + k);
+    __m256d s, mw, mk, rw, rx, ry, rz, inv_len;
+
+    s = _mm256_fmadd_pd(az, az, _mm256_fmadd_pd(ay, ay, _mm256_mul_pd(ax, ax)));
+
+    switch (method) {
+    case QUAT_INTEGRATE_EULER:
+        mw = one;
+        mk = one;
+        break;
+    case QUAT_INTEGRATE_EXP:
+        if (_mm256_movemask_pd(_mm256_cmp_pd(s, _mm256_set1_pd(INTEGRATE_POLY_MAX), _CMP_GT_OQ)) != 0) {
+            return false;
+        }
+        mw = integrate_poly4( integrate_cos_poly, s );
+        mk = integrate_poly4( integrate_sinc_poly, s );
+        break;
+    case QUAT_INTEGRATE_RK4:
+        mw = _mm256_fmadd_pd(s, _mm256_fmadd_pd(s, _mm256_set1_pd(1.0/24), _mm256_set1_pd(-0.5)), one);
+        mk = _mm256_fnmadd_pd(s, _mm256_set1_pd(1.0/6), one);
+        break;
+    default:
+        mw = one;
+        mk = one;
+        break;
+    }
+
+    ax = _mm256_mul_pd(mk, ax);
+    ay = _mm256_mul_pd(mk, ay);
+    az = _mm256_mul_pd(mk, az);
+
+    // (mw, a) * q, as in quat_mul
+    rw = _mm256_fnmadd_pd(az, qz, _mm256_fnmadd_pd(ay, qy, _mm256_fnmadd_pd(ax, qx, _mm256_mul_pd(mw, qw))));
+    rx = _mm256_fnmadd_pd(az, qy, _mm256_fmadd_pd(ay, qz, _mm256_fmadd_pd(ax, qw, _mm256_mul_pd(mw, qx))));
+    ry = _mm256_fmadd_pd(az, qx, _mm256_fmadd_pd(ay, qw, _mm256_fnmadd_pd(ax, qz, _mm256_mul_pd(mw, qy))));
+    rz = _mm256_fmadd_pd(az, qw, _mm256_fnmadd_pd(ay, qx, _mm256_fmadd_pd(ax, qy, _mm256_mul_pd(mw, qz))));
+
+    if (method != QUAT_INTEGRATE_EXP) {
+        s = _mm256_fmadd_pd(rz, rz, _mm256_fmadd_pd(ry, ry, _mm256_fmadd_pd(rx, rx, _mm256_mul_pd(rw, rw))));
+        inv_len = simd_rsqrt4_pd(s);
+        rw = _mm256_mul_pd(rw, inv_len);
+        rx = _mm256_mul_pd(rx, inv_len);
+        ry = _mm256_mul_pd(ry, inv_len);
+        rz = _mm256_mul_pd(rz, inv_len);
+    }
+
+    _mm256_storeu_pd(w + k, rw);
+    _mm256_storeu_pd(x + k, rx);
+    _mm256_storeu_pd(y + k, ry);
+    _mm256_storeu_pd(z + k, rz);
+    return true;
+}
+#endif
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quat_integrate_soa)(QuatIntegration method,
+                                 double * w, double * x, double * y, double * z,
+                                 const double * omega_x, const double * omega_y, const double * omega_z,
+                                 double dt, size_t count)
+{
+    double half_dt = dt / 2;
+    size_t k = 0, j;
+
+#if defined SIMD_HAVE_AVX2
+    for (k = 0; k + 4 <= count; k += 4) {
+        if (! integrate_block4( method, w, x, y, z, omega_x, omega_y, omega_z, _mm256_set1_pd(half_dt), k )) {
+            for (j = k; j < k + 4; j++) {
+                integrate_body( method, w, x, y, z, omega_x, omega_y, omega_z, half_dt, j );
+            }
+        }
+    }
+#endif
+
+    for (j = k; j < count; j++) {
+        integrate_body( method, w, x, y, z, omega_x, omega_y, omega_z, half_dt, j );
+    }
+}
+
+#endif      // SIMD_KERNELS
+
+
+
+#if ! defined SIMD_KERNEL_BUILD
+//==========================================================================================================================================
+// Multi-threaded integration. Each chunk is an independent call of quat_integrate_soa.
+//------------------------------------------------------------------------------------------------------------------------------------------
+typedef struct integrate_job {
+    QuatIntegration method;
+    double * w;
+    double * x;
+    double * y;
+    double * z;
+    const double * omega_x;
+    const double * omega_y;
+    const double * omega_z;
+    double dt;
+} IntegrateJob;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void integrate_task(void * context, size_t begin, size_t end)
+{
+    IntegrateJob * job = context;
+
+    quat_integrate_soa( job->method, job->w + begin, job->x + begin, job->y + begin, job->z + begin,
+                        job->omega_x + begin, job->omega_y + begin, job->omega_z + begin, job->dt, end - begin );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void quat_integrate_soa_parallel(QuatIntegration method,
+                                 double * w, double * x, double * y, double * z,
+                                 const double * omega_x, const double * omega_y, const double * omega_z,
+                                 double dt, size_t count)
+{
+    IntegrateJob job = {method, w, x, y, z, omega_x, omega_y, omega_z, dt};
+    parallel_for( count, INTEGRATE_PARALLEL_GRAIN, integrate_task, &job );
+}
+
+#endif      // ! SIMD_KERNEL_BUILD
+
+
+
+
+
+
+
+
+
+//==========================================================================================================================================
+// Unit testing facilities
+#if defined INTEGRATE_UNITTEST && ! defined SIMD_KERNEL_BUILD
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+
+#include <stdlib.h>
+
+
+
+static const QuatIntegration testmethods[3] = {QUAT_INTEGRATE_EULER, QUAT_INTEGRATE_EXP, QUAT_INTEGRATE_RK4};
+
+
+// Largest component difference of [a] and [b], as rotations (either sign)
+static double rotation_error(Quaternion a, Quaternion b)
+{
+    double e = 0, s = (quat_dot(a, b) < 0) ? -1 : 1;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        e = fmax( e, fabs(a.q[i] - s * b.q[i]) );
+    }
+    return e;
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// A constant angular velocity for one second in 1000 steps matches the rotation by |w| about its axis, within the
+// order of each method. A zero velocity leaves the orientation as it is.
+void test_quat_integrate(void)
+{
+    const double tolerance[3] = {1e-5, 1e-12, 1e-9};
+    Vector3 omega = {{0.6, -1.2, 1.5}};
+    Quaternion q0 = quat_from_euler_angles(0.3, -1.1, 2.0), q, expected;
+    int m, k;
+
+    expected = quat_mul( quat_from_angle_axis(vec3_len(omega), omega), q0 );
+    for (m = 0; m < 3; m++) {
+        q = q0;
+        for (k = 0; k < 1000; k++) {
+            q = quat_integrate( testmethods[m], q, omega, 1e-3 );
+        }
+        g_assert_cmpfloat(  rotation_error(q, expected), <, tolerance[m]  );
+        g_assert_true(  quat_equal(quat_integrate(testmethods[m], q0, vec3_from_zeroes(), 0.1), q0)  );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Odd count so that the scalar tail is exercised, and velocities from still to several turns per step so that groups
+// both inside and beyond the range of the vector polynomials are.
+void test_quat_integrate_soa(void)
+{
+    enum { count = 1003 };
+    double * a = malloc( sizeof(double) * 7 * count );
+    double * w = a, * x = a + count, * y = a + 2*count, * z = a + 3*count;
+    double * ox = a + 4*count, * oy = a + 5*count, * oz = a + 6*count;
+    Quaternion q, expected;
+    Vector3 omega;
+    size_t k;
+    int m;
+
+    for (m = 0; m < 3; m++) {
+        for (k = 0; k < count; k++) {
+            q = quat_from_euler_angles( 0.01 * (double) k, 1.0 - 0.003 * (double) k, -0.5 );
+            w[k] = q.w;
+            x[k] = q.x;
+            y[k] = q.y;
+            z[k] = q.z;
+            ox[k] = (k < 500) ? 0.1 * (double) k : 1000.0 - (double) k;
+            oy[k] = (k % 7 == 0) ? 0.0 : 2.0;
+            oz[k] = -0.3 * (double) (k % 13);
+        }
+
+        quat_integrate_soa( testmethods[m], w, x, y, z, ox, oy, oz, 1.0 / 60, count );
+        for (k = 0; k < count; k++) {
+            q = quat_from_euler_angles( 0.01 * (double) k, 1.0 - 0.003 * (double) k, -0.5 );
+            omega = vec3_from_values( ox[k], oy[k], oz[k] );
+            expected = quat_integrate( testmethods[m], q, omega, 1.0 / 60 );
+            g_assert_cmpfloat(  rotation_error(quat_from_values(w[k], x[k], y[k], z[k]), expected), <, 1e-14  );
+        }
+    }
+
+    free( a );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Large enough to be split across the pool; every body must match the single threaded result.
+void test_quat_integrate_soa_parallel(void)
+{
+    enum { count = 50001 };
+    double * serial = malloc( sizeof(double) * 4 * count );
+    double * parallel = malloc( sizeof(double) * 4 * count );
+    double * omega = malloc( sizeof(double) * 3 * count );
+    size_t k;
+    int m;
+
+    for (m = 0; m < 3; m++) {
+        for (k = 0; k < count; k++) {
+            serial[k] = parallel[k] = cos( 0.001 * (double) k );
+            serial[count + k] = parallel[count + k] = sin( 0.001 * (double) k );
+            serial[2*count + k] = parallel[2*count + k] = 0;
+            serial[3*count + k] = parallel[3*count + k] = 0;
+            omega[k] = 1.0;
+            omega[count + k] = 0.0001 * (double) k;
+            omega[2*count + k] = -3.0;
+        }
+
+        quat_integrate_soa( testmethods[m], serial, serial + count, serial + 2*count, serial + 3*count,
+                            omega, omega + count, omega + 2*count, 0.01, count );
+        quat_integrate_soa_parallel( testmethods[m], parallel, parallel + count, parallel + 2*count, parallel + 3*count,
+                                     omega, omega + count, omega + 2*count, 0.01, count );
+        g_assert_true(  memcmp(serial, parallel, sizeof(double) * 4 * count) == 0  );
+    }
+
+    free( serial );
+    free( parallel );
+    free( omega );
+}
+
+
+
+void setuptests(void)
+{
+    g_test_add_func("/set_integrate/test_quat_integrate", test_quat_integrate);
+    g_test_add_func("/set_integrate/test_quat_integrate_soa", test_quat_integrate_soa);
+    g_test_add_func("/set_integrate/test_quat_integrate_soa_parallel", test_quat_integrate_soa_parallel);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // INTEGRATE_UNITTEST
@@ -0,0 +1,57 @@
+//
+//
+//
+//
+//
+
+#if ! defined INTEGRATE_H
+#define INTEGRATE_H
+
+#include <stddef.h>
+
+#include "vector3.h"
+#include "quaternion.h"
+
+
+// Orientation integration for rigid bodies: advances q by a time step [dt] under a constant angular velocity w,
+// given in rad/s in the world frame, so that dq/dt = 1/2 (0, w) q and the step rotation is applied on the left.
+// For a body frame velocity, rotate it into the world frame first (quat_rotate_vec3 by q).
+//
+// With a = dt/2 w, every method multiplies q on the left by a step quaternion built from a:
+//  QUAT_INTEGRATE_EULER    (1, a), then renormalised; error per step O(|a|^3) in the angle
+//  QUAT_INTEGRATE_EXP      exp(a) = (cos |a|, sin |a| a / |a|), the exact rotation; keeps the length up to rounding
+//  QUAT_INTEGRATE_RK4      classical Runge-Kutta, which for a constant w is the 4th order Taylor expansion of exp(a):
+//                          (1 - |a|^2/2 + |a|^4/24, (1 - |a|^2/6) a), then renormalised
+typedef enum quat_integration {
+    QUAT_INTEGRATE_EULER,
+    QUAT_INTEGRATE_EXP,
+    QUAT_INTEGRATE_RK4
+} QuatIntegration;
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @param [q] unit orientation
+// @param [omega] angular velocity in the world frame, in rad/s
+// @ret the orientation [dt] later
+Quaternion quat_integrate(QuatIntegration method, Quaternion q, Vector3 omega, double dt);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Advances [count] bodies in place, orientations and angular velocities given as SoA arrays.
+// Vectorised over 4 bodies with AVX2, where the sin and cos of QUAT_INTEGRATE_EXP are polynomials valid for step
+// angles up to 1 radian; a group of 4 with a larger step is computed with the scalar functions instead.
+void quat_integrate_soa(QuatIntegration method,
+                        double * w, double * x, double * y, double * z,
+                        const double * omega_x, const double * omega_y, const double * omega_z,
+                        double dt, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// quat_integrate_soa split across the parallel_for pool, giving the same bits.
+void quat_integrate_soa_parallel(QuatIntegration method,
+                                 double * w, double * x, double * y, double * z,
+                                 const double * omega_x, const double * omega_y, const double * omega_z,
+                                 double dt, size_t count);
+
+
+#endif      // INTEGRATE_H
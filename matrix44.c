@@ -4,7 +4,1056 @@
 //
 //
 
-// This is just a do nothing to stop warnings
-extern int i;
+#include <stdio.h>
+#include <stdbool.h>
+#include <tgmath.h>
+#include <float.h>              // for FLT_EPSILON in comparison precision
+#include <assert.h>             // for static_assert of padding inside the union
+#include <string.h>
+#include <stdint.h>             // uintptr_t for the alignment test of upload buffers
 
+#include "matrix44.h"
+#include "quaternion.h"
+#include "vector3.h"
+#include "simd.h"
 
+
+#if ! defined SIMD_KERNEL_BUILD
+
+static Matrix44 test_mat44_alignment;
+static_assert( sizeof(test_mat44_alignment) == sizeof(test_mat44_alignment.m),
+               "Error: padding detected. Matrix44 can not be represented correctly!\n");
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+Matrix44 mat44_from_identity(void)
+{
+    Matrix44 r = {{1.0, 0.0, 0.0, 0.0,
+                   0.0, 1.0, 0.0, 0.0,
+                   0.0, 0.0, 1.0, 0.0,
+                   0.0, 0.0, 0.0, 1.0}};
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Matrix44 mat44_from_array(const double * buffer, Matrix44Layout layout)
+{
+    Matrix44 r;
+    memcpy( r.m, buffer, sizeof(double) * 16 );
+
+    if (layout == MAT44_ROW_MAJOR) {
+        return mat44_transpose( r );
+    }
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Matrix44 mat44_from_quat(Quaternion q)
+{
+    Matrix44 r;
+    quat_to_matrix44( q, r.m );
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Matrix44 mat44_from_translation(Vector3 t)
+{
+    Matrix44 r = mat44_from_identity();
+    memcpy( r.col[3], t.v, sizeof(double) * 3 );
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Matrix44 mat44_from_rotation_translation(Quaternion q, Vector3 t)
+{
+    Matrix44 r = mat44_from_quat( q );
+    memcpy( r.col[3], t.v, sizeof(double) * 3 );
+    return r;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+void mat44_to_array(Matrix44 m, double * buffer, Matrix44Layout layout)
+{
+    if (layout == MAT44_ROW_MAJOR) {
+        m = mat44_transpose( m );
+    }
+    memcpy( buffer, m.m, sizeof(double) * 16 );
+}
+
+#endif      // ! SIMD_KERNEL_BUILD
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Shepperd's method: q is recovered from one of its four squared components, taken from the diagonal as 4w^2 = 1 + trace,
+// 4x^2 = 1 + m00 - m11 - m22, ..., and from the off-diagonal differences 4xw = m21 - m12, ... and sums 4xy = m10 + m01, ...
+// Dividing by the largest of the four keeps the result accurate for every rotation. The case is picked from the
+// diagonal with comparisons only, as in M. Day, "Converting a Rotation Matrix to a Quaternion" (2015), so that
+// mat44_to_quat_array selects it with blends.
+static inline Quaternion mat44_to_quat_one(const double * m)
+{
+    double m00 = m[0], m10 = m[1], m20 = m[2];
+    double m01 = m[4], m11 = m[5], m21 = m[6];
+    double m02 = m[8], m12 = m[9], m22 = m[10];
+    double dx = m21 - m12, dy = m02 - m20, dz = m10 - m01;
+    double sxy = m10 + m01, sxz = m02 + m20, syz = m21 + m12;
+    Quaternion c[4] = {
+        {{((1 + m00) + m11) + m22, dx, dy, dz}},            // 4w times q
+        {{dx, ((1 + m00) - m11) - m22, sxy, sxz}},          // 4x times q
+        {{dy, sxy, ((1 - m00) + m11) - m22, syz}},          // 4y times q
+        {{dz, sxz, syz, ((1 - m00) - m11) + m22}}           // 4z times q
+    };
+    int k = (m22 < 0) ? ((m00 > m11) ? 1 : 2) : ((m00 < -m11) ? 3 : 0);
+    double scale = 0.5 / sqrt( c[k].q[k] );
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        c[k].q[i] *= scale;
+    }
+
+    return c[k];
+}
+
+#if ! defined SIMD_KERNEL_BUILD
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Quaternion mat44_to_quat(Matrix44 m)
+{
+    return mat44_to_quat_one( m.m );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Matrix44 mat44_transpose(Matrix44 m)
+{
+    Matrix44 r;
+
+#if defined SIMD_HAVE_AVX2
+    __m256d c0 = _mm256_loadu_pd(m.col[0]);
+    __m256d c1 = _mm256_loadu_pd(m.col[1]);
+    __m256d c2 = _mm256_loadu_pd(m.col[2]);
+    __m256d c3 = _mm256_loadu_pd(m.col[3]);
+
+    __m256d t0 = _mm256_unpacklo_pd(c0, c1);
+    __m256d t1 = _mm256_unpackhi_pd(c0, c1);
+    __m256d t2 = _mm256_unpacklo_pd(c2, c3);
+    __m256d t3 = _mm256_unpackhi_pd(c2, c3);
+
+    _mm256_storeu_pd(r.col[0], _mm256_permute2f128_pd(t0, t2, 0x20));
+    _mm256_storeu_pd(r.col[1], _mm256_permute2f128_pd(t1, t3, 0x20));
+    _mm256_storeu_pd(r.col[2], _mm256_permute2f128_pd(t0, t2, 0x31));
+    _mm256_storeu_pd(r.col[3], _mm256_permute2f128_pd(t1, t3, 0x31));
+#else
+    int c, k;
+
+    for (c = 0; c < 4; c++) {
+        for (k = 0; k < 4; k++) {
+            r.col[c][k] = m.col[k][c];
+        }
+    }
+#endif
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool mat44_is_affine(Matrix44 m)
+{
+    return fabs(m.m[3]) < FLT_EPSILON && fabs(m.m[7]) < FLT_EPSILON && fabs(m.m[11]) < FLT_EPSILON
+        && fabs(m.m[15] - 1.0) < FLT_EPSILON;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Matrix44 mat44_inverse(Matrix44 m)
+{
+    Matrix44 r;
+    const double * a = m.m;
+    double * inv = r.m;
+    double det;
+    int k;
+
+    if (mat44_is_affine( m )) {
+        return mat44_inverse_affine( m );
+    }
+
+    // Cofactor expansion. Since inverse(transpose(m)) == transpose(inverse(m)) this is valid for either storage order.
+    inv[0]  =  a[5]*a[10]*a[15] - a[5]*a[11]*a[14] - a[9]*a[6]*a[15] + a[9]*a[7]*a[14] + a[13]*a[6]*a[11] - a[13]*a[7]*a[10];
+    inv[4]  = -a[4]*a[10]*a[15] + a[4]*a[11]*a[14] + a[8]*a[6]*a[15] - a[8]*a[7]*a[14] - a[12]*a[6]*a[11] + a[12]*a[7]*a[10];
+    inv[8]  =  a[4]*a[9]*a[15]  - a[4]*a[11]*a[13] - a[8]*a[5]*a[15] + a[8]*a[7]*a[13] + a[12]*a[5]*a[11] - a[12]*a[7]*a[9];
+    inv[12] = -a[4]*a[9]*a[14]  + a[4]*a[10]*a[13] + a[8]*a[5]*a[14] - a[8]*a[6]*a[13] - a[12]*a[5]*a[10] + a[12]*a[6]*a[9];
+    inv[1]  = -a[1]*a[10]*a[15] + a[1]*a[11]*a[14] + a[9]*a[2]*a[15] - a[9]*a[3]*a[14] - a[13]*a[2]*a[11] + a[13]*a[3]*a[10];
+    inv[5]  =  a[0]*a[10]*a[15] - a[0]*a[11]*a[14] - a[8]*a[2]*a[15] + a[8]*a[3]*a[14] + a[12]*a[2]*a[11] - a[12]*a[3]*a[10];
+    inv[9]  = -a[0]*a[9]*a[15]  + a[0]*a[11]*a[13] + a[8]*a[1]*a[15] - a[8]*a[3]*a[13] - a[12]*a[1]*a[11] + a[12]*a[3]*a[9];
+    inv[13] =  a[0]*a[9]*a[14]  - a[0]*a[10]*a[13] - a[8]*a[1]*a[14] + a[8]*a[2]*a[13] + a[12]*a[1]*a[10] - a[12]*a[2]*a[9];
+    inv[2]  =  a[1]*a[6]*a[15]  - a[1]*a[7]*a[14]  - a[5]*a[2]*a[15] + a[5]*a[3]*a[14] + a[13]*a[2]*a[7]  - a[13]*a[3]*a[6];
+    inv[6]  = -a[0]*a[6]*a[15]  + a[0]*a[7]*a[14]  + a[4]*a[2]*a[15] - a[4]*a[3]*a[14] - a[12]*a[2]*a[7]  + a[12]*a[3]*a[6];
+    inv[10] =  a[0]*a[5]*a[15]  - a[0]*a[7]*a[13]  - a[4]*a[1]*a[15] + a[4]*a[3]*a[13] + a[12]*a[1]*a[7]  - a[12]*a[3]*a[5];
+    inv[14] = -a[0]*a[5]*a[14]  + a[0]*a[6]*a[13]  + a[4]*a[1]*a[14] - a[4]*a[2]*a[13] - a[12]*a[1]*a[6]  + a[12]*a[2]*a[5];
+    inv[3]  = -a[1]*a[6]*a[11]  + a[1]*a[7]*a[10]  + a[5]*a[2]*a[11] - a[5]*a[3]*a[10] - a[9]*a[2]*a[7]   + a[9]*a[3]*a[6];
+    inv[7]  =  a[0]*a[6]*a[11]  - a[0]*a[7]*a[10]  - a[4]*a[2]*a[11] + a[4]*a[3]*a[10] + a[8]*a[2]*a[7]   - a[8]*a[3]*a[6];
+    inv[11] = -a[0]*a[5]*a[11]  + a[0]*a[7]*a[9]   + a[4]*a[1]*a[11] - a[4]*a[3]*a[9]  - a[8]*a[1]*a[7]   + a[8]*a[3]*a[5];
+    inv[15] =  a[0]*a[5]*a[10]  - a[0]*a[6]*a[9]   - a[4]*a[1]*a[10] + a[4]*a[2]*a[9]  + a[8]*a[1]*a[6]   - a[8]*a[2]*a[5];
+
+    det = 1.0 / (a[0]*inv[0] + a[1]*inv[4] + a[2]*inv[8] + a[3]*inv[12]);
+    for (k = 0; k < 16; k++) {
+        inv[k] *= det;
+    }
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Matrix44 mat44_inverse_affine(Matrix44 m)
+{
+    Matrix44 r;
+    const double * a = m.m;
+    double * inv = r.m;
+    double det;
+    int k;
+
+    inv[3] = inv[7] = inv[11] = 0.0;
+    inv[15] = 1.0;
+
+    // Inverse of the upper 3x3 block from its cofactors
+    inv[0]  = a[5]*a[10] - a[6]*a[9];
+    inv[1]  = a[2]*a[9]  - a[1]*a[10];
+    inv[2]  = a[1]*a[6]  - a[2]*a[5];
+    inv[4]  = a[6]*a[8]  - a[4]*a[10];
+    inv[5]  = a[0]*a[10] - a[2]*a[8];
+    inv[6]  = a[2]*a[4]  - a[0]*a[6];
+    inv[8]  = a[4]*a[9]  - a[5]*a[8];
+    inv[9]  = a[1]*a[8]  - a[0]*a[9];
+    inv[10] = a[0]*a[5]  - a[1]*a[4];
+
+    det = 1.0 / (a[0]*inv[0] + a[4]*inv[1] + a[8]*inv[2]);
+    for (k = 0; k < 11; k++) {
+        inv[k] *= det;
+    }
+
+    // The translation becomes -inverse(A) * t
+    inv[12] = -(inv[0]*a[12] + inv[4]*a[13] + inv[8]*a[14]);
+    inv[13] = -(inv[1]*a[12] + inv[5]*a[13] + inv[9]*a[14]);
+    inv[14] = -(inv[2]*a[12] + inv[6]*a[13] + inv[10]*a[14]);
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool mat44_equal(Matrix44 a, Matrix44 b)
+{
+    int k;
+
+    for (k = 0; k < 16; k++) {
+        if ( fabs(a.m[k] - b.m[k]) > FLT_EPSILON)
+            return false;
+    }
+
+    return true;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Column c of the product is a * b.col[c], i.e. the columns of [a] weighted by the elements of b.col[c].
+Matrix44 mat44_mul(Matrix44 a, Matrix44 b)
+{
+    Matrix44 r;
+    int c;
+
+#if defined SIMD_HAVE_AVX2
+    __m256d a0 = _mm256_loadu_pd(a.col[0]);
+    __m256d a1 = _mm256_loadu_pd(a.col[1]);
+    __m256d a2 = _mm256_loadu_pd(a.col[2]);
+    __m256d a3 = _mm256_loadu_pd(a.col[3]);
+    __m256d rc;
+
+    for (c = 0; c < 4; c++) {
+        rc = _mm256_mul_pd(a0, _mm256_set1_pd(b.col[c][0]));
+        rc = _mm256_fmadd_pd(a1, _mm256_set1_pd(b.col[c][1]), rc);
+        rc = _mm256_fmadd_pd(a2, _mm256_set1_pd(b.col[c][2]), rc);
+        rc = _mm256_fmadd_pd(a3, _mm256_set1_pd(b.col[c][3]), rc);
+        _mm256_storeu_pd(r.col[c], rc);
+    }
+#elif defined SIMD_HAVE_SSE2
+    int h;
+    __m128d rc, bk;
+
+    // each column is handled as two halves of 2 rows
+    for (c = 0; c < 4; c++) {
+        for (h = 0; h < 4; h += 2) {
+            bk = _mm_set1_pd(b.col[c][0]);
+            rc = _mm_mul_pd(_mm_loadu_pd(&a.col[0][h]), bk);
+            bk = _mm_set1_pd(b.col[c][1]);
+            rc = _mm_add_pd(rc, _mm_mul_pd(_mm_loadu_pd(&a.col[1][h]), bk));
+            bk = _mm_set1_pd(b.col[c][2]);
+            rc = _mm_add_pd(rc, _mm_mul_pd(_mm_loadu_pd(&a.col[2][h]), bk));
+            bk = _mm_set1_pd(b.col[c][3]);
+            rc = _mm_add_pd(rc, _mm_mul_pd(_mm_loadu_pd(&a.col[3][h]), bk));
+            _mm_storeu_pd(&r.col[c][h], rc);
+        }
+    }
+#else
+    int k;
+
+    for (c = 0; c < 4; c++) {
+        for (k = 0; k < 4; k++) {
+            r.col[c][k] = a.col[0][k]*b.col[c][0] + a.col[1][k]*b.col[c][1]
+                        + a.col[2][k]*b.col[c][2] + a.col[3][k]*b.col[c][3];
+        }
+    }
+#endif
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Vector3 mat44_transform_point(Matrix44 m, Vector3 p)
+{
+    mat44_transform_point_array( m, &p, &p, 1 );
+    return p;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Vector3 mat44_transform_dir(Matrix44 m, Vector3 d)
+{
+    mat44_transform_dir_array( m, &d, &d, 1 );
+    return d;
+}
+
+
+
+#endif      // ! SIMD_KERNEL_BUILD
+
+
+
+//==========================================================================================================================================
+// Batch kernels, one set per tier under runtime dispatch (simd.h)
+SIMD_DISPATCH_VOID(mat44_transform_point_array, (Matrix44 m, const Vector3 * in, Vector3 * out, size_t count),
+                   (m, in, out, count))
+SIMD_DISPATCH_VOID(mat44_transform_dir_array, (Matrix44 m, const Vector3 * in, Vector3 * out, size_t count),
+                   (m, in, out, count))
+SIMD_DISPATCH_VOID(mat44_to_quat_array, (const Matrix44 * m, Quaternion * out, size_t count), (m, out, count))
+SIMD_DISPATCH_VOID(mat44_from_rotation_translation_array, (const Quaternion * q, const Vector3 * t, size_t count,
+                                                           void * buffer, size_t stride, Matrix44Format format,
+                                                           Matrix44Layout layout),
+                   (q, t, count, buffer, stride, format, layout))
+SIMD_DISPATCH_VOID(mat44_from_quatf_translation_array, (const Quaternionf * q, const Vector3f * t, size_t count,
+                                                        void * buffer, size_t stride, Matrix44Format format,
+                                                        Matrix44Layout layout),
+                   (q, t, count, buffer, stride, format, layout))
+
+#if defined SIMD_KERNELS
+
+//==========================================================================================================================================
+// Batch operations
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Shared kernel of the point and direction transforms.
+// @param [w] 1.0 for points, 0.0 for directions (drops the translation column)
+// @param [project] divide by the transformed w (only meaningful for points of a non-affine matrix)
+static void mat44_transform_kernel(const double * m, double w, bool project,
+                                   const double * src, double * dst, size_t count)
+{
+    size_t k = 0;
+    double vx, vy, vz, rw;
+    double t[4] = {m[12]*w, m[13]*w, m[14]*w, m[15]*w};
+
+#if defined SIMD_HAVE_AVX2
+    {
+        __m256d mv[12], tv[4];
+        __m256d x, y, z, rx, ry, rz, pw;
+        int j;
+
+        for (j = 0; j < 12; j++) {
+            mv[j] = _mm256_set1_pd(m[j]);
+        }
+        for (j = 0; j < 4; j++) {
+            tv[j] = _mm256_set1_pd(t[j]);
+        }
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            simd_load_xyz4(src + 3*k, &x, &y, &z);
+
+            rx = _mm256_fmadd_pd(mv[8], z, _mm256_fmadd_pd(mv[4], y, _mm256_fmadd_pd(mv[0], x, tv[0])));
+            ry = _mm256_fmadd_pd(mv[9], z, _mm256_fmadd_pd(mv[5], y, _mm256_fmadd_pd(mv[1], x, tv[1])));
+            rz = _mm256_fmadd_pd(mv[10], z, _mm256_fmadd_pd(mv[6], y, _mm256_fmadd_pd(mv[2], x, tv[2])));
+
+            if (project) {
+                pw = _mm256_fmadd_pd(mv[11], z, _mm256_fmadd_pd(mv[7], y, _mm256_fmadd_pd(mv[3], x, tv[3])));
+                rx = _mm256_div_pd(rx, pw);
+                ry = _mm256_div_pd(ry, pw);
+                rz = _mm256_div_pd(rz, pw);
+            }
+
+            simd_store_xyz4(dst + 3*k, rx, ry, rz);
+        }
+    }
+#elif defined SIMD_HAVE_SSE2
+    {
+        __m128d mv[12], tv[4];
+        __m128d x, y, z, rx, ry, rz, pw;
+        int j;
+
+        for (j = 0; j < 12; j++) {
+            mv[j] = _mm_set1_pd(m[j]);
+        }
+        for (j = 0; j < 4; j++) {
+            tv[j] = _mm_set1_pd(t[j]);
+        }
+
+        for (k = 0; k + 2 <= count; k += 2) {
+            simd_load_xyz2(src + 3*k, &x, &y, &z);
+
+            rx = _mm_add_pd(_mm_add_pd(_mm_mul_pd(mv[0], x), _mm_mul_pd(mv[4], y)), _mm_add_pd(_mm_mul_pd(mv[8], z), tv[0]));
+            ry = _mm_add_pd(_mm_add_pd(_mm_mul_pd(mv[1], x), _mm_mul_pd(mv[5], y)), _mm_add_pd(_mm_mul_pd(mv[9], z), tv[1]));
+            rz = _mm_add_pd(_mm_add_pd(_mm_mul_pd(mv[2], x), _mm_mul_pd(mv[6], y)), _mm_add_pd(_mm_mul_pd(mv[10], z), tv[2]));
+
+            if (project) {
+                pw = _mm_add_pd(_mm_add_pd(_mm_mul_pd(mv[3], x), _mm_mul_pd(mv[7], y)), _mm_add_pd(_mm_mul_pd(mv[11], z), tv[3]));
+                rx = _mm_div_pd(rx, pw);
+                ry = _mm_div_pd(ry, pw);
+                rz = _mm_div_pd(rz, pw);
+            }
+
+            simd_store_xyz2(dst + 3*k, rx, ry, rz);
+        }
+    }
+#endif
+
+    for (; k < count; k++) {
+        vx = src[3*k];
+        vy = src[3*k + 1];
+        vz = src[3*k + 2];
+
+        dst[3*k]     = m[0]*vx + m[4]*vy + m[8]*vz  + t[0];
+        dst[3*k + 1] = m[1]*vx + m[5]*vy + m[9]*vz  + t[1];
+        dst[3*k + 2] = m[2]*vx + m[6]*vy + m[10]*vz + t[2];
+
+        if (project) {
+            rw = m[3]*vx + m[7]*vy + m[11]*vz + t[3];
+            dst[3*k]     /= rw;
+            dst[3*k + 1] /= rw;
+            dst[3*k + 2] /= rw;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(mat44_transform_point_array)(Matrix44 m, const Vector3 * in, Vector3 * out, size_t count)
+{
+    mat44_transform_kernel( m.m, 1.0, !mat44_is_affine(m), in->v, out->v, count );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(mat44_transform_dir_array)(Matrix44 m, const Vector3 * in, Vector3 * out, size_t count)
+{
+    mat44_transform_kernel( m.m, 0.0, false, in->v, out->v, count );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The same operations as mat44_to_quat_one on 4 lanes: the 4 candidates are all computed and the case selected per lane.
+void SIMD_FN(mat44_to_quat_array)(const Matrix44 * m, Quaternion * out, size_t count)
+{
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2
+    {
+        __m256d one = _mm256_set1_pd(1), sign = _mm256_set1_pd(-0.0);
+        __m256d c0[4], c1[4], c2[4];            // columns 0 .. 2, transposed: c1[2] holds m21 of the 4 matrices
+        __m256d cw[4], cx[4], cy[4], cz[4], r[4];
+        __m256d neg, x_not_y, z_not_w, scale;
+        int i;
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            for (i = 0; i < 4; i++) {
+                c0[i] = _mm256_loadu_pd(m[k + (size_t) i].col[0]);
+                c1[i] = _mm256_loadu_pd(m[k + (size_t) i].col[1]);
+                c2[i] = _mm256_loadu_pd(m[k + (size_t) i].col[2]);
+            }
+            simd_transpose4( &c0[0], &c0[1], &c0[2], &c0[3] );
+            simd_transpose4( &c1[0], &c1[1], &c1[2], &c1[3] );
+            simd_transpose4( &c2[0], &c2[1], &c2[2], &c2[3] );
+
+            cw[1] = cx[0] = _mm256_sub_pd(c1[2], c2[1]);            // m21 - m12
+            cw[2] = cy[0] = _mm256_sub_pd(c2[0], c0[2]);            // m02 - m20
+            cw[3] = cz[0] = _mm256_sub_pd(c0[1], c1[0]);            // m10 - m01
+            cx[2] = cy[1] = _mm256_add_pd(c0[1], c1[0]);
+            cx[3] = cz[1] = _mm256_add_pd(c2[0], c0[2]);
+            cy[3] = cz[2] = _mm256_add_pd(c1[2], c2[1]);
+            cw[0] = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(one, c0[0]), c1[1]), c2[2]);
+            cx[1] = _mm256_sub_pd(_mm256_sub_pd(_mm256_add_pd(one, c0[0]), c1[1]), c2[2]);
+            cy[2] = _mm256_sub_pd(_mm256_add_pd(_mm256_sub_pd(one, c0[0]), c1[1]), c2[2]);
+            cz[3] = _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(one, c0[0]), c1[1]), c2[2]);
+
+            neg = _mm256_cmp_pd(c2[2], _mm256_setzero_pd(), _CMP_LT_OQ);
+            x_not_y = _mm256_cmp_pd(c0[0], c1[1], _CMP_GT_OQ);
+            z_not_w = _mm256_cmp_pd(c0[0], _mm256_xor_pd(c1[1], sign), _CMP_LT_OQ);
+
+            for (i = 0; i < 4; i++) {
+                r[i] = _mm256_blendv_pd(_mm256_blendv_pd(cw[i], cz[i], z_not_w),
+                                        _mm256_blendv_pd(cy[i], cx[i], x_not_y), neg);
+            }
+            scale = _mm256_blendv_pd(_mm256_blendv_pd(cw[0], cz[3], z_not_w),
+                                     _mm256_blendv_pd(cy[2], cx[1], x_not_y), neg);
+            scale = _mm256_div_pd(_mm256_set1_pd(0.5), _mm256_sqrt_pd(scale));
+            for (i = 0; i < 4; i++) {
+                r[i] = _mm256_mul_pd(r[i], scale);
+            }
+
+            simd_transpose4( &r[0], &r[1], &r[2], &r[3] );
+            for (i = 0; i < 4; i++) {
+                _mm256_storeu_pd(out[k + (size_t) i].q, r[i]);
+            }
+        }
+    }
+#endif
+
+    for (; k < count; k++) {
+        out[k] = mat44_to_quat_one( m[k].m );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// One matrix of the upload functions, in the element type and order of the destination. 16 byte aligned so that it
+// can be copied out with 16 byte streaming stores; every format is a multiple of 16 bytes long.
+typedef union matrix44_staging {
+#if defined SIMD_HAVE_AVX2 || defined SIMD_HAVE_SSE2
+    __m128i v[8];
+#endif
+    _Alignas(16) double d[16];
+    float f[16];
+} Matrix44Staging;
+
+
+// Destination of the upload functions. The destination is a sequence of [lines] rows or columns of [width] elements;
+// line[l] lists the indices of their elements in the column-major 4x4 source matrix. Column-major 3x4 is the only
+// format with lines of 3, there the 4th index is that of the dropped bottom row element and gets overwritten.
+typedef struct matrix44_upload {
+    unsigned char * dst;
+    size_t stride;
+    size_t bytes;
+    int lines;
+    int width;
+    int line[4][4];
+    bool single;
+    bool stream;
+} Matrix44Upload;
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static Matrix44Upload mat44_upload_init(void * buffer, size_t stride, Matrix44Format format, Matrix44Layout layout)
+{
+    Matrix44Upload u;
+    int rows = (format == MAT44_DOUBLE_4X4 || format == MAT44_FLOAT_4X4) ? 4 : 3;
+    int l, j;
+
+    u.dst = buffer;
+    u.single = (format == MAT44_FLOAT_4X4 || format == MAT44_FLOAT_3X4);
+    u.bytes = (size_t) rows * 4 * (u.single ? sizeof(float) : sizeof(double));
+    u.stride = (stride == 0) ? u.bytes : stride;
+
+    if (layout == MAT44_ROW_MAJOR) {
+        u.lines = rows;
+        u.width = 4;
+    } else {
+        u.lines = 4;
+        u.width = rows;
+    }
+    for (l = 0; l < 4; l++) {
+        for (j = 0; j < 4; j++) {
+            u.line[l][j] = (layout == MAT44_ROW_MAJOR) ? j*4 + l : l*4 + j;
+        }
+    }
+
+#if defined SIMD_HAVE_AVX2 || defined SIMD_HAVE_SSE2
+    u.stream = ((uintptr_t) buffer % 16 == 0) && (u.stride % 16 == 0);
+#else
+    u.stream = false;
+#endif
+
+    return u;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Copies the staged matrix [s] to matrix [k] of the destination.
+static inline void mat44_upload_write(const Matrix44Upload * u, const Matrix44Staging * s, size_t k)
+{
+    unsigned char * dst = u->dst + k * u->stride;
+
+#if defined SIMD_HAVE_AVX2 || defined SIMD_HAVE_SSE2
+    size_t j;
+
+    if (u->stream) {
+        for (j = 0; j < u->bytes / 16; j++) {
+            _mm_stream_si128( (__m128i *) dst + j, s->v[j] );
+        }
+        return;
+    }
+#endif
+    memcpy( dst, s, u->bytes );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Writes the column-major 4x4 matrix [m] as matrix [k] of the destination.
+static inline void mat44_upload_one(const Matrix44Upload * u, const double * m, size_t k)
+{
+    Matrix44Staging s;
+    int l, j;
+
+    for (l = 0; l < u->lines; l++) {
+        for (j = 0; j < u->width; j++) {
+            if (u->single) {
+                s.f[l*u->width + j] = (float) m[u->line[l][j]];
+            } else {
+                s.d[l*u->width + j] = m[u->line[l][j]];
+            }
+        }
+    }
+
+    mat44_upload_write( u, &s, k );
+}
+
+#if defined SIMD_HAVE_AVX2
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Writes matrices [k] .. [k + 3] from the quaternion lanes [w] .. [z] and the translation lanes [tx] .. [tz].
+// The 16 elements are computed lane-wise like quat_to_matrix44, then every line of the 4 matrices is one transpose.
+// Too large to inline at -O2, the call is amortised over the 4 matrices.
+static void mat44_upload_block4(const Matrix44Upload * u, __m256d w, __m256d x, __m256d y, __m256d z,
+                                __m256d tx, __m256d ty, __m256d tz, size_t k)
+{
+    Matrix44Staging s[4];
+    __m256d e[16], r[4];
+    __m256d one = _mm256_set1_pd(1), two = _mm256_set1_pd(2), zero = _mm256_setzero_pd();
+    __m256d x2 = _mm256_mul_pd(x, two), y2 = _mm256_mul_pd(y, two), z2 = _mm256_mul_pd(z, two);
+    __m256d xx = _mm256_mul_pd(x, x2), yy = _mm256_mul_pd(y, y2), zz = _mm256_mul_pd(z, z2);
+    __m256d xy = _mm256_mul_pd(x, y2), xz = _mm256_mul_pd(x, z2), yz = _mm256_mul_pd(y, z2);
+    __m256d xw = _mm256_mul_pd(w, x2), yw = _mm256_mul_pd(w, y2), zw = _mm256_mul_pd(w, z2);
+    int l, i;
+
+    e[0]  = _mm256_sub_pd(_mm256_sub_pd(one, yy), zz);
+    e[1]  = _mm256_add_pd(xy, zw);
+    e[2]  = _mm256_sub_pd(xz, yw);
+    e[4]  = _mm256_sub_pd(xy, zw);
+    e[5]  = _mm256_sub_pd(_mm256_sub_pd(one, xx), zz);
+    e[6]  = _mm256_add_pd(yz, xw);
+    e[8]  = _mm256_add_pd(xz, yw);
+    e[9]  = _mm256_sub_pd(yz, xw);
+    e[10] = _mm256_sub_pd(_mm256_sub_pd(one, xx), yy);
+    e[3] = e[7] = e[11] = zero;
+    e[12] = tx;
+    e[13] = ty;
+    e[14] = tz;
+    e[15] = one;
+
+    // Lines are stored in order, so the 4th element of a line of 3 is overwritten by the next line or lies past the end
+    for (l = 0; l < u->lines; l++) {
+        r[0] = e[u->line[l][0]];
+        r[1] = e[u->line[l][1]];
+        r[2] = e[u->line[l][2]];
+        r[3] = e[u->line[l][3]];
+        simd_transpose4( &r[0], &r[1], &r[2], &r[3] );
+
+        for (i = 0; i < 4; i++) {
+            if (u->single) {
+                _mm_storeu_ps( s[i].f + l*u->width, _mm256_cvtpd_ps(r[i]) );
+            } else {
+                _mm256_storeu_pd( s[i].d + l*u->width, r[i] );
+            }
+        }
+    }
+
+    for (i = 0; i < 4; i++) {
+        mat44_upload_write( u, &s[i], k + (size_t) i );
+    }
+}
+#endif
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void mat44_upload_finish(const Matrix44Upload * u)
+{
+#if defined SIMD_HAVE_AVX2 || defined SIMD_HAVE_SSE2
+    // Streaming stores are weakly ordered, make them visible before the buffer is handed over
+    if (u->stream) {
+        _mm_sfence();
+    }
+#else
+    (void) u;
+#endif
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(mat44_from_rotation_translation_array)(const Quaternion * q, const Vector3 * t, size_t count,
+                                                    void * buffer, size_t stride, Matrix44Format format, Matrix44Layout layout)
+{
+    Matrix44Upload u = mat44_upload_init( buffer, stride, format, layout );
+    double m[16];
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2
+    {
+        __m256d w, x, y, z, tx, ty, tz;
+
+        tx = ty = tz = _mm256_setzero_pd();
+        for (k = 0; k + 4 <= count; k += 4) {
+            w = _mm256_loadu_pd(q[k].q);
+            x = _mm256_loadu_pd(q[k + 1].q);
+            y = _mm256_loadu_pd(q[k + 2].q);
+            z = _mm256_loadu_pd(q[k + 3].q);
+            simd_transpose4( &w, &x, &y, &z );
+            if (t != NULL) {
+                simd_load_xyz4( t[k].v, &tx, &ty, &tz );
+            }
+            mat44_upload_block4( &u, w, x, y, z, tx, ty, tz, k );
+        }
+    }
+#endif
+
+    for (; k < count; k++) {
+        quat_to_matrix44( q[k], m );
+        if (t != NULL) {
+            memcpy( &m[12], t[k].v, sizeof(double) * 3 );
+        }
+        mat44_upload_one( &u, m, k );
+    }
+
+    mat44_upload_finish( &u );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(mat44_from_quatf_translation_array)(const Quaternionf * q, const Vector3f * t, size_t count,
+                                                 void * buffer, size_t stride, Matrix44Format format, Matrix44Layout layout)
+{
+    Matrix44Upload u = mat44_upload_init( buffer, stride, format, layout );
+    double m[16];
+    size_t k = 0;
+    int j;
+
+#if defined SIMD_HAVE_AVX2
+    {
+        __m256d w, x, y, z, tx, ty, tz;
+        __m128 fx, fy, fz;
+
+        tx = ty = tz = _mm256_setzero_pd();
+        for (k = 0; k + 4 <= count; k += 4) {
+            w = _mm256_cvtps_pd(_mm_loadu_ps(q[k].q));
+            x = _mm256_cvtps_pd(_mm_loadu_ps(q[k + 1].q));
+            y = _mm256_cvtps_pd(_mm_loadu_ps(q[k + 2].q));
+            z = _mm256_cvtps_pd(_mm_loadu_ps(q[k + 3].q));
+            simd_transpose4( &w, &x, &y, &z );
+            if (t != NULL) {
+                simd_load_xyz4f( t[k].v, &fx, &fy, &fz );
+                tx = _mm256_cvtps_pd(fx);
+                ty = _mm256_cvtps_pd(fy);
+                tz = _mm256_cvtps_pd(fz);
+            }
+            mat44_upload_block4( &u, w, x, y, z, tx, ty, tz, k );
+        }
+    }
+#endif
+
+    for (; k < count; k++) {
+        quat_to_matrix44( quat_from_quatf(q[k]), m );
+        if (t != NULL) {
+            for (j = 0; j < 3; j++) {
+                m[12 + j] = t[k].v[j];
+            }
+        }
+        mat44_upload_one( &u, m, k );
+    }
+
+    mat44_upload_finish( &u );
+}
+
+#endif      // SIMD_KERNELS
+
+
+
+
+
+
+
+
+
+//==========================================================================================================================================
+// Unit testing facilities
+#if defined MATRIX44_UNITTEST && ! defined SIMD_KERNEL_BUILD
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+
+
+
+// Column-major, non-affine, every element distinct
+Matrix44 testmat = {{  2.0, -1.5,  0.25,  0.1,
+                       0.5,  3.0, -2.0,   0.0,
+                      -1.0,  0.75, 4.0,   0.2,
+                      10.0, -20.0, 5.5,   1.0}};
+
+Quaternion testrot = {0.8660254037844387, 0.2886751345948129, 0.2886751345948129, 0.2886751345948129};
+
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_mat44_from_array(void)
+{
+    double rows[16];
+    Matrix44 func;
+
+    mat44_to_array( testmat, rows, MAT44_ROW_MAJOR );
+    g_assert_cmpfloat( rows[3], ==, testmat.m[12] );        // row 0, column 3 is the x translation
+
+    func = mat44_from_array( rows, MAT44_ROW_MAJOR );
+    g_assert_true(  mat44_equal(testmat, func)  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_mat44_from_quat(void)
+{
+    double math[16];
+    Matrix44 func = mat44_from_quat( testrot );
+    int k;
+
+    quat_to_matrix44( testrot, math );
+    for (k = 0; k < 16; k++) {
+        g_assert_cmpfloat( math[k], ==, func.m[k] );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Round trip through mat44_from_quat for rotations that select each of Shepperd's cases, half turns included, and the
+// batch version bit for bit, with an odd count for the scalar tail, also on matrices only 16 byte aligned.
+void test_mat44_to_quat(void)
+{
+    enum { count = 11 };
+    Vector3 axes[4] = {{{0, 0, 1}}, {{1, 0, 0}}, {{0, 1, 0}}, {{1, 1, 1}}};
+    _Alignas(32) unsigned char buffer[count * sizeof(Matrix44) + 16];
+    Matrix44 m[count];
+    Quaternion q[count], batch[count], r;
+    int i, j;
+
+    for (i = 0; i < count; i++) {
+        q[i] = (i < 8) ? quat_from_angle_axis( (i < 4) ? 0.3 : 3.14159265358979, axes[i % 4] )
+                       : quat_from_euler_angles( 1.1*i, -0.4*i, 2.5 - 0.3*i );
+        m[i] = mat44_from_rotation_translation( q[i], vec3_from_values(1, 2, 3) );
+        r = mat44_to_quat( m[i] );
+        if (quat_dot(r, q[i]) < 0) {
+            r = quat_negate( r );
+        }
+        for (j = 0; j < 4; j++) {
+            g_assert_cmpfloat_with_epsilon( r.q[j], q[i].q[j], 1e-15 );
+        }
+    }
+
+    mat44_to_quat_array( m, batch, count );
+    for (i = 0; i < count; i++) {
+        r = mat44_to_quat( m[i] );
+        g_assert_true(  memcmp(&r, &batch[i], sizeof(Quaternion)) == 0  );
+    }
+
+    memcpy( buffer + 16, m, sizeof(m) );
+    memset( batch, 0, sizeof(batch) );
+    mat44_to_quat_array( (const Matrix44 *) (void *) (buffer + 16), batch, count );
+    for (i = 0; i < count; i++) {
+        r = mat44_to_quat( m[i] );
+        g_assert_true(  memcmp(&r, &batch[i], sizeof(Quaternion)) == 0  );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_mat44_transpose(void)
+{
+    Matrix44 func = mat44_transpose( testmat );
+    int r, c;
+
+    for (c = 0; c < 4; c++) {
+        for (r = 0; r < 4; r++) {
+            g_assert_cmpfloat( testmat.col[c][r], ==, func.col[r][c] );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_mat44_mul(void)
+{
+    Matrix44 math = {{ 1.0, -0.75,  0.125, 0.05,
+                      -2.0,  1.5,   8.0,   0.4,
+                       5.0, -6.625, 2.75,  0.6,
+                      -4.0,  9.75, -8.75, -0.5}};
+
+    Matrix44 b = {{0.5, 0.0, 0.0, 0.0,
+                   0.0, 0.0, 2.0, 0.0,
+                   0.0, 1.0, 0.5, 0.5,
+                   -3.0, 2.0, -1.0, 0.0}};
+
+    Matrix44 func = mat44_mul( testmat, b );
+    g_assert_true(  mat44_equal(math, func)  );
+    g_assert_true(  mat44_equal(testmat, mat44_mul(testmat, mat44_from_identity()))  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_mat44_inverse(void)
+{
+    Matrix44 func = mat44_inverse( testmat );
+    g_assert_false( mat44_is_affine(testmat) );
+    g_assert_true(  mat44_equal(mat44_from_identity(), mat44_mul(testmat, func))  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_mat44_inverse_affine(void)
+{
+    Vector3 t = {3.0, -4.0, 12.5};
+    Matrix44 m = mat44_from_rotation_translation( testrot, t );
+    Matrix44 func = mat44_inverse( m );
+
+    g_assert_true(  mat44_is_affine(m)  );
+    g_assert_true(  mat44_equal(mat44_from_identity(), mat44_mul(m, func))  );
+    g_assert_true(  mat44_equal(mat44_transpose(mat44_from_quat(testrot)),
+                                mat44_mul(func, mat44_from_translation(t)))  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_mat44_transform_point(void)
+{
+    Vector3 t = {3.0, -4.0, 12.5};
+    Vector3 p = {-43.32332, 1.0, 32.0};
+    Vector3 math = vec3_add( quat_rotate_vec3(testrot, p), t );
+    Vector3 func = mat44_transform_point( mat44_from_rotation_translation(testrot, t), p );
+
+    g_assert_true(  vec3_equal(math, func)  );
+    g_assert_true(  vec3_equal(quat_rotate_vec3(testrot, p),
+                               mat44_transform_dir(mat44_from_rotation_translation(testrot, t), p))  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Odd count so that both the vector kernel and the scalar tail are exercised, with a projective matrix.
+void test_mat44_transform_point_array(void)
+{
+    Vector3 in[7], out[7];
+    Vector3 math;
+    double w;
+    int k;
+
+    for (k = 0; k < 7; k++) {
+        in[k] = vec3_from_values( -4.5 + k, 1.0 - 0.5*k, 0.25 * k );
+    }
+
+    mat44_transform_point_array( testmat, in, out, 7 );
+    for (k = 0; k < 7; k++) {
+        w = testmat.m[3]*in[k].x + testmat.m[7]*in[k].y + testmat.m[11]*in[k].z + testmat.m[15];
+        math.x = (testmat.m[0]*in[k].x + testmat.m[4]*in[k].y + testmat.m[8]*in[k].z + testmat.m[12]) / w;
+        math.y = (testmat.m[1]*in[k].x + testmat.m[5]*in[k].y + testmat.m[9]*in[k].z + testmat.m[13]) / w;
+        math.z = (testmat.m[2]*in[k].x + testmat.m[6]*in[k].y + testmat.m[10]*in[k].z + testmat.m[14]) / w;
+        g_assert_true(  vec3_equal(math, out[k])  );
+    }
+
+    mat44_transform_dir_array( mat44_from_quat(testrot), in, in, 7 );
+    for (k = 0; k < 7; k++) {
+        math = quat_rotate_vec3( testrot, vec3_from_values(-4.5 + k, 1.0 - 0.5*k, 0.25 * k) );
+        g_assert_true(  vec3_equal(math, in[k])  );
+    }
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Every format and layout, once with an aligned padded stride (streaming stores) and once misaligned (plain stores).
+// The padding between the matrices must be left alone.
+void test_mat44_from_rotation_translation_array(void)
+{
+    Matrix44Format formats[4] = {MAT44_DOUBLE_4X4, MAT44_DOUBLE_3X4, MAT44_FLOAT_4X4, MAT44_FLOAT_3X4};
+    Matrix44Layout layouts[2] = {MAT44_COLUMN_MAJOR, MAT44_ROW_MAJOR};
+    _Alignas(16) unsigned char buffer[5 * 160 + 16];
+    Quaternion q[5];
+    Quaternionf qf[5];
+    Vector3 t[5];
+    Vector3f tf[5];
+    double math[16], value;
+    float f_value;
+    unsigned char * base;
+    size_t bytes, stride;
+    int f, l, a, k, j, rows, single;
+
+    for (k = 0; k < 5; k++) {
+        q[k] = quat_from_euler_angles( 0.3*k, -0.7 + 0.2*k, 1.1 );
+        t[k] = vec3_from_values( 10.0*k, -2.5, 0.125*k );
+        qf[k] = quatf_from_quat( q[k] );
+        tf[k] = vec3f_from_vec3( t[k] );
+    }
+
+    for (f = 0; f < 4; f++) {
+        single = (formats[f] == MAT44_FLOAT_4X4 || formats[f] == MAT44_FLOAT_3X4);
+        rows = (formats[f] == MAT44_DOUBLE_4X4 || formats[f] == MAT44_FLOAT_4X4) ? 4 : 3;
+        bytes = (size_t) rows * 4 * (single ? sizeof(float) : sizeof(double));
+
+        for (l = 0; l < 2; l++) {
+            for (a = 0; a < 2; a++) {
+                base = buffer + (a == 0 ? 0 : 4);
+                stride = bytes + (a == 0 ? 16 : 4);
+                memset( buffer, 0xAB, sizeof(buffer) );
+
+                if (single) {
+                    mat44_from_quatf_translation_array( qf, tf, 5, base, stride, formats[f], layouts[l] );
+                } else {
+                    mat44_from_rotation_translation_array( q, t, 5, base, stride, formats[f], layouts[l] );
+                }
+
+                for (k = 0; k < 5; k++) {
+                    mat44_to_array( mat44_from_rotation_translation(q[k], t[k]), math, layouts[l] );
+                    if (rows == 3 && layouts[l] == MAT44_COLUMN_MAJOR) {
+                        for (j = 0; j < 12; j++) {
+                            math[j] = math[(j / 3) * 4 + j % 3];
+                        }
+                    }
+
+                    for (j = 0; j < rows * 4; j++) {
+                        if (single) {
+                            memcpy( &f_value, base + k*stride + j*sizeof(float), sizeof(float) );
+                            value = f_value;
+                        } else {
+                            memcpy( &value, base + k*stride + j*sizeof(double), sizeof(double) );
+                        }
+                        g_assert_cmpfloat( fabs(value - math[j]), <, 1e-5 );
+                    }
+                    g_assert_cmpuint( base[k*stride + bytes], ==, 0xAB );
+                }
+            }
+        }
+    }
+}
+
+
+
+void setuptests(void)
+{
+    // Creation functions
+    g_test_add_func("/set_mat44/test_mat44_from_array", test_mat44_from_array);
+    g_test_add_func("/set_mat44/test_mat44_from_quat", test_mat44_from_quat);
+    g_test_add_func("/set_mat44/test_mat44_to_quat", test_mat44_to_quat);
+
+    // Unary matrix operations
+    g_test_add_func("/set_mat44/test_mat44_transpose", test_mat44_transpose);
+    g_test_add_func("/set_mat44/test_mat44_inverse", test_mat44_inverse);
+    g_test_add_func("/set_mat44/test_mat44_inverse_affine", test_mat44_inverse_affine);
+
+    // Functions taking various inputs
+    g_test_add_func("/set_mat44/test_mat44_mul", test_mat44_mul);
+    g_test_add_func("/set_mat44/test_mat44_transform_point", test_mat44_transform_point);
+    g_test_add_func("/set_mat44/test_mat44_transform_point_array", test_mat44_transform_point_array);
+    g_test_add_func("/set_mat44/test_mat44_from_rotation_translation_array", test_mat44_from_rotation_translation_array);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // MATRIX44_UNITTEST
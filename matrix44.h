@@ -7,6 +7,139 @@
 #if ! defined MATRIX44_H
 #define MATRIX44_H
 
+#include <stdbool.h>
+#include <stddef.h>
 
+#include "vector3.h"
+#include "quaternion.h"
 
-#endif
+
+// Matrices are stored column-major (the layout quat_to_matrix44 writes and OpenGL expects):
+// element (row, col) is m[col*4 + row], and col[c] is the c-th column.
+// Aligned to 32 bytes so that a column fits one AVX register.
+typedef union matrix44 {
+    _Alignas(32) double m[16];
+
+    double col[4][4];
+} Matrix44;
+
+
+// Memory layout of plain double buffers handed to mat44_from_array / mat44_to_array
+typedef enum matrix44_layout {
+    MAT44_COLUMN_MAJOR,
+    MAT44_ROW_MAJOR
+} Matrix44Layout;
+
+
+// Element type and shape of the buffers written by mat44_from_rotation_translation_array. The 3x4 shapes drop the
+// constant bottom row (0, 0, 0, 1): in row-major order they hold 3 rows of 4, in column-major order 4 columns of 3.
+typedef enum matrix44_format {
+    MAT44_DOUBLE_4X4,
+    MAT44_DOUBLE_3X4,
+    MAT44_FLOAT_4X4,
+    MAT44_FLOAT_3X4
+} Matrix44Format;
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+Matrix44 mat44_from_identity(void);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @param [buffer] array of 16 doubles stored in [layout] order
+Matrix44 mat44_from_array(const double * buffer, Matrix44Layout layout);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret rotation matrix of [q]. Same matrix as quat_to_matrix44.
+Matrix44 mat44_from_quat(Quaternion q);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Matrix44 mat44_from_translation(Vector3 t);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret matrix that first rotates by [q] and then translates by [t]
+Matrix44 mat44_from_rotation_translation(Quaternion q, Vector3 t);
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @param [buffer] array in which at least 16 doubles will be stored in [layout] order
+void mat44_to_array(Matrix44 m, double * buffer, Matrix44Layout layout);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Inverse of mat44_from_quat (Shepperd's method). Only the upper 3x3 block is read, which must be a rotation; no scale
+// is removed. The result is a unit quaternion of either sign.
+Quaternion mat44_to_quat(Matrix44 m);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Matrix44 mat44_transpose(Matrix44 m);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret true if the bottom row is (0, 0, 0, 1), compared with the same FLT_EPSILON precision as mat44_equal
+bool mat44_is_affine(Matrix44 m);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// General inverse. Takes the mat44_inverse_affine fast path when [m] is affine.
+// The result is not meaningful (inf or nan elements) if [m] is singular.
+Matrix44 mat44_inverse(Matrix44 m);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Inverse of an affine matrix: inverts the upper 3x3 block and transforms the translation by it.
+// @param [m] must be affine, the bottom row is not read.
+Matrix44 mat44_inverse_affine(Matrix44 m);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool mat44_equal(Matrix44 a, Matrix44 b);
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret a*b, i.e. the transform that applies [b] first and then [a]
+Matrix44 mat44_mul(Matrix44 a, Matrix44 b);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Transforms point [p] (w = 1). The result is divided by w unless [m] is affine.
+Vector3 mat44_transform_point(Matrix44 m, Vector3 p);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Transforms direction [d] (w = 0), translation is ignored.
+Vector3 mat44_transform_dir(Matrix44 m, Vector3 d);
+
+
+
+//==========================================================================================================================================
+// Batch operations. [in] and [out] may point to the same array.
+//------------------------------------------------------------------------------------------------------------------------------------------
+// mat44_transform_point applied to [count] points. The affine test is done once per call.
+void mat44_transform_point_array(Matrix44 m, const Vector3 * in, Vector3 * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// mat44_transform_dir applied to [count] directions.
+void mat44_transform_dir_array(Matrix44 m, const Vector3 * in, Vector3 * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// mat44_to_quat applied to [count] matrices, bit for bit. Vectorised over 4 matrices with AVX2, the choice of
+// Shepperd's case being made with blends rather than branches. [m] may be only 16 byte aligned, as malloc gives.
+void mat44_to_quat_array(const Matrix44 * m, Quaternion * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Writes the mat44_from_rotation_translation matrices of [count] orientations and translations straight into [buffer],
+// typically a mapped GPU upload buffer, in [format] and [layout].
+// @param [t] translations, or NULL for pure rotations
+// @param [stride] bytes from the start of one matrix to the next, 0 for tightly packed matrices
+//
+// When [buffer] and [stride] are multiples of 16 bytes the matrices are written with non-temporal stores that bypass
+// the cache, since the data is written once and not read back by the CPU. The stores are fenced before returning.
+void mat44_from_rotation_translation_array(const Quaternion * q, const Vector3 * t, size_t count,
+                                           void * buffer, size_t stride, Matrix44Format format, Matrix44Layout layout);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Same for single precision orientations and translations.
+void mat44_from_quatf_translation_array(const Quaternionf * q, const Vector3f * t, size_t count,
+                                        void * buffer, size_t stride, Matrix44Format format, Matrix44Layout layout);
+
+
+#endif      // MATRIX44_H
@@ -0,0 +1,454 @@
+//
+//
+//
+//
+//
+
+#define _POSIX_C_SOURCE 200809L         // sysconf, and clock_gettime / nanosleep of the tests
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "parallel.h"
+
+
+#define PARALLEL_MAX_THREADS        256
+#define PARALLEL_CHUNKS_PER_THREAD  8       // with grain 0, enough chunks per thread for stealing to even out the load
+
+
+// A contiguous run of chunk numbers owned by one participant. The owner and thieves both take chunks from the
+// front with an atomic increment. Each slot sits on its own cache line so that claiming chunks does not bounce
+// the lines of the other participants.
+typedef struct parallel_slot {
+    _Alignas(64) atomic_size_t next;
+    size_t end;
+} ParallelSlot;
+
+
+typedef struct parallel_job {
+    ParallelTask task;
+    void * context;
+    size_t count;
+    size_t grain;
+} ParallelJob;
+
+
+static struct {
+    pthread_mutex_t init;               // guards running and workers outside of a parallel_for
+    pthread_mutex_t submit;             // held by the thread running a parallel_for, and during start up and shut down
+    pthread_mutex_t lock;               // guards the fields below
+    pthread_cond_t wake;
+    pthread_cond_t done;
+
+    pthread_t * threads;
+    ParallelSlot * slots;               // one per worker, the calling thread uses the last one
+    unsigned workers;                   // not counting the calling thread
+    unsigned pending;                   // workers still busy with the current job
+    unsigned long generation;           // incremented for every job
+    unsigned long start_generation;
+    bool running;
+    bool stop;
+    ParallelJob job;
+} pool = {
+    .init = PTHREAD_MUTEX_INITIALIZER,
+    .submit = PTHREAD_MUTEX_INITIALIZER,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER
+};
+
+static _Thread_local bool inside_task = false;
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Drains the own slot of participant [self], then steals from the others in round robin order.
+static void parallel_run(unsigned self)
+{
+    unsigned participants = pool.workers + 1;
+    unsigned k;
+    ParallelSlot * slot;
+    size_t chunk, begin, end;
+
+    inside_task = true;
+
+    for (k = 0; k < participants; k++) {
+        slot = &pool.slots[(self + k) % participants];
+
+        while ((chunk = atomic_fetch_add_explicit(&slot->next, 1, memory_order_relaxed)) < slot->end) {
+            begin = chunk * pool.job.grain;
+            end = (pool.job.count - begin < pool.job.grain) ? pool.job.count : begin + pool.job.grain;
+            pool.job.task( pool.job.context, begin, end );
+        }
+    }
+
+    inside_task = false;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void * parallel_worker(void * arg)
+{
+    unsigned self = (unsigned) (uintptr_t) arg;
+    unsigned long seen = pool.start_generation;
+
+    pthread_mutex_lock( &pool.lock );
+    for (;;) {
+        while (pool.generation == seen && !pool.stop) {
+            pthread_cond_wait( &pool.wake, &pool.lock );
+        }
+        if (pool.stop) {
+            break;
+        }
+        seen = pool.generation;
+        pthread_mutex_unlock( &pool.lock );
+
+        parallel_run( self );
+
+        pthread_mutex_lock( &pool.lock );
+        if (--pool.pending == 0) {
+            pthread_cond_signal( &pool.done );
+        }
+    }
+    pthread_mutex_unlock( &pool.lock );
+
+    return NULL;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+unsigned parallel_init(unsigned thread_count)
+{
+    long cores;
+    unsigned k, in_use;
+
+    // A running pool is only looked at, under pool.init, so that a parallel_for running on another thread does not
+    // hold this call up; starting one also takes pool.submit, which no job holds while the pool is stopped
+    pthread_mutex_lock( &pool.init );
+    if (pool.running) {
+        in_use = pool.workers + 1;
+        pthread_mutex_unlock( &pool.init );
+        return in_use;
+    }
+    pthread_mutex_unlock( &pool.init );
+
+    pthread_mutex_lock( &pool.submit );
+    pthread_mutex_lock( &pool.init );
+
+    if (!pool.running) {
+        if (thread_count == 0) {
+            cores = sysconf( _SC_NPROCESSORS_ONLN );
+            thread_count = (cores > 0) ? (unsigned) cores : 1;
+        }
+        if (thread_count > PARALLEL_MAX_THREADS) {
+            thread_count = PARALLEL_MAX_THREADS;
+        }
+
+        pool.threads = malloc( sizeof(pthread_t) * thread_count );
+        pool.slots = aligned_alloc( 64, sizeof(ParallelSlot) * thread_count );
+        pool.workers = 0;
+        pool.stop = false;
+        pool.start_generation = pool.generation;
+
+        // Without memory the pool runs with the calling thread only
+        if (pool.threads != NULL && pool.slots != NULL) {
+            for (k = 0; k + 1 < thread_count; k++) {
+                if (pthread_create( &pool.threads[k], NULL, parallel_worker, (void *) (uintptr_t) k ) != 0) {
+                    break;
+                }
+                pool.workers++;
+            }
+        }
+        pool.running = true;
+    }
+
+    in_use = pool.workers + 1;
+    pthread_mutex_unlock( &pool.init );
+    pthread_mutex_unlock( &pool.submit );
+
+    return in_use;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void parallel_shutdown(void)
+{
+    unsigned k;
+
+    pthread_mutex_lock( &pool.submit );
+    pthread_mutex_lock( &pool.init );
+
+    if (pool.running) {
+        pthread_mutex_lock( &pool.lock );
+        pool.stop = true;
+        pthread_cond_broadcast( &pool.wake );
+        pthread_mutex_unlock( &pool.lock );
+
+        for (k = 0; k < pool.workers; k++) {
+            pthread_join( pool.threads[k], NULL );
+        }
+
+        free( pool.threads );
+        free( pool.slots );
+        pool.threads = NULL;
+        pool.slots = NULL;
+        pool.workers = 0;
+        pool.running = false;
+    }
+
+    pthread_mutex_unlock( &pool.init );
+    pthread_mutex_unlock( &pool.submit );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+unsigned parallel_thread_count(void)
+{
+    unsigned count;
+
+    pthread_mutex_lock( &pool.init );
+    count = pool.running ? pool.workers + 1 : 1;
+    pthread_mutex_unlock( &pool.init );
+
+    return count;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void parallel_for(size_t count, size_t grain, ParallelTask task, void * context)
+{
+    unsigned participants, k;
+    size_t chunks;
+
+    if (count == 0) {
+        return;
+    }
+
+    participants = inside_task ? 1 : parallel_init( 0 );
+    if (grain == 0) {
+        grain = count / ((size_t) participants * PARALLEL_CHUNKS_PER_THREAD) + 1;
+    }
+
+    if (participants == 1 || count <= grain || pthread_mutex_trylock( &pool.submit ) != 0) {
+        task( context, 0, count );
+        return;
+    }
+
+    // The pool may have been shut down since parallel_init returned
+    if (!pool.running || pool.workers == 0) {
+        pthread_mutex_unlock( &pool.submit );
+        task( context, 0, count );
+        return;
+    }
+    participants = pool.workers + 1;
+
+    chunks = (count - 1) / grain + 1;
+    for (k = 0; k < participants; k++) {
+        atomic_store_explicit( &pool.slots[k].next, chunks * k / participants, memory_order_relaxed );
+        pool.slots[k].end = chunks * (k + 1) / participants;
+    }
+
+    pthread_mutex_lock( &pool.lock );
+    pool.job.task = task;
+    pool.job.context = context;
+    pool.job.count = count;
+    pool.job.grain = grain;
+    pool.pending = pool.workers;
+    pool.generation++;
+    pthread_cond_broadcast( &pool.wake );
+    pthread_mutex_unlock( &pool.lock );
+
+    parallel_run( pool.workers );
+
+    pthread_mutex_lock( &pool.lock );
+    while (pool.pending > 0) {
+        pthread_cond_wait( &pool.done, &pool.lock );
+    }
+    pthread_mutex_unlock( &pool.lock );
+
+    pthread_mutex_unlock( &pool.submit );
+}
+
+
+
+
+
+
+
+
+
+//==========================================================================================================================================
+// Unit testing facilities
+#ifdef PARALLEL_UNITTEST
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+#include <time.h>
+
+
+
+#define TEST_COUNT 100003       // prime, so the last chunk is always partial
+
+static atomic_int visits[TEST_COUNT];
+
+
+// Counts how often every index is handed out
+void count_visits(void * context, size_t begin, size_t end);
+void count_visits(void * context, size_t begin, size_t end)
+{
+    size_t k;
+    (void) context;
+
+    for (k = begin; k < end; k++) {
+        atomic_fetch_add( &visits[k], 1 );
+    }
+}
+
+// Starts a nested parallel_for over the same range for every slice, which must run serially
+void nested_visits(void * context, size_t begin, size_t end);
+void nested_visits(void * context, size_t begin, size_t end)
+{
+    size_t k;
+    (void) context;
+
+    for (k = begin; k < end; k++) {
+        parallel_for( 2, 1, count_visits, NULL );
+    }
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_parallel_for(void)
+{
+    size_t grains[3] = {0, 1, 977};
+    int g, k;
+
+    for (g = 0; g < 3; g++) {
+        for (k = 0; k < TEST_COUNT; k++) {
+            atomic_store( &visits[k], 0 );
+        }
+
+        parallel_for( TEST_COUNT, grains[g], count_visits, NULL );
+
+        for (k = 0; k < TEST_COUNT; k++) {
+            g_assert_cmpint( atomic_load(&visits[k]), ==, 1 );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_parallel_nested(void)
+{
+    atomic_store( &visits[0], 0 );
+    parallel_for( 1000, 10, nested_visits, NULL );
+    g_assert_cmpint( atomic_load(&visits[0]), ==, 1000 );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// A job that holds the pool until a second thread has run its own parallel_for, or until a deadline if that one waits
+static atomic_bool slow_started, second_done;
+
+void slow_task(void * context, size_t begin, size_t end);
+void slow_task(void * context, size_t begin, size_t end)
+{
+    struct timespec now, deadline, pause = {0, 1000000};
+    (void) context;
+    (void) begin;
+    (void) end;
+
+    clock_gettime( CLOCK_MONOTONIC, &deadline );
+    deadline.tv_sec += 2;
+    atomic_store( &slow_started, true );
+    do {
+        nanosleep( &pause, NULL );
+        clock_gettime( CLOCK_MONOTONIC, &now );
+    } while (!atomic_load(&second_done) && (now.tv_sec < deadline.tv_sec ||
+             (now.tv_sec == deadline.tv_sec && now.tv_nsec < deadline.tv_nsec)));
+}
+
+void * second_caller(void * arg);
+void * second_caller(void * arg)
+{
+    struct timespec pause = {0, 1000000};
+    (void) arg;
+
+    while (!atomic_load(&slow_started)) {
+        nanosleep( &pause, NULL );
+    }
+    atomic_store( &visits[0], 0 );
+    atomic_store( &visits[1], 0 );
+    parallel_for( 2, 1, count_visits, NULL );
+    atomic_store( &second_done, true );
+    return NULL;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// A parallel_for on a second thread runs serially while the pool is busy, instead of waiting for the job to end.
+void test_parallel_concurrent(void)
+{
+    pthread_t second;
+
+    parallel_shutdown();
+    g_assert_cmpuint( parallel_init(4), ==, 4 );
+    atomic_store( &slow_started, false );
+    atomic_store( &second_done, false );
+
+    g_assert_cmpint( pthread_create(&second, NULL, second_caller, NULL), ==, 0 );
+    parallel_for( 4, 1, slow_task, NULL );
+    g_assert_true( atomic_load(&second_done) );         // before the deadline of slow_task, or the second one waited
+    pthread_join( second, NULL );
+
+    g_assert_cmpint( atomic_load(&visits[0]), ==, 1 );
+    g_assert_cmpint( atomic_load(&visits[1]), ==, 1 );
+    parallel_shutdown();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_parallel_resize(void)
+{
+    int k;
+
+    parallel_shutdown();
+    g_assert_cmpuint( parallel_thread_count(), ==, 1 );
+    g_assert_cmpuint( parallel_init(3), ==, 3 );
+    g_assert_cmpuint( parallel_init(5), ==, 3 );         // already running
+
+    for (k = 0; k < TEST_COUNT; k++) {
+        atomic_store( &visits[k], 0 );
+    }
+    parallel_for( TEST_COUNT, 100, count_visits, NULL );
+    for (k = 0; k < TEST_COUNT; k++) {
+        g_assert_cmpint( atomic_load(&visits[k]), ==, 1 );
+    }
+
+    parallel_shutdown();
+}
+
+
+
+void setuptests(void)
+{
+    g_test_add_func("/set_parallel/test_parallel_for", test_parallel_for);
+    g_test_add_func("/set_parallel/test_parallel_nested", test_parallel_nested);
+    g_test_add_func("/set_parallel/test_parallel_resize", test_parallel_resize);
+    g_test_add_func("/set_parallel/test_parallel_concurrent", test_parallel_concurrent);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // PARALLEL_UNITTEST
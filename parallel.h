@@ -0,0 +1,46 @@
+//
+//
+//
+//
+//
+
+#if ! defined PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+
+// Body of a parallel loop. Called with consecutive, non-overlapping [begin, end) slices of the index range.
+// @param [context] the pointer handed to parallel_for, shared by all threads
+typedef void (*ParallelTask)(void * context, size_t begin, size_t end);
+
+
+
+//==========================================================================================================================================
+// A pool of pthread workers for the batch functions. The calling thread always takes part in the work, so
+// parallel_for never waits idle. Each participant owns a contiguous run of chunks and steals chunks from the
+// others once its own run is exhausted, so uneven chunk costs are balanced without a central queue.
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Starts the pool. Called implicitly by the first parallel_for, call it yourself to choose the size.
+// Does nothing if the pool is already running (call parallel_shutdown first to resize it).
+// @param [thread_count] total threads including the caller, 0 means one per online core
+// @ret number of threads actually in use, including the caller
+unsigned parallel_init(unsigned thread_count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Joins all workers. Must not be called while a parallel_for is running.
+void parallel_shutdown(void);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret threads used by parallel_for including the caller, 1 if the pool is not running
+unsigned parallel_thread_count(void);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Calls [task] over [0, count) split into chunks of [grain] indices and returns once every chunk is done.
+// Runs serially on the calling thread when [count] fits one chunk, when called from inside a task, or when another
+// thread is already running a parallel_for, so it is always safe to call.
+// @param [grain] indices per chunk, 0 picks a size that gives every thread several chunks
+void parallel_for(size_t count, size_t grain, ParallelTask task, void * context);
+
+
+#endif      // PARALLEL_H
@@ -1,3 +1,11 @@
+// This file provides the out-of-line symbols, it is never built in header-only mode (see vector3.h).
+// Its kernel builds (simd.h) provide none of them, and take the inline versions for the scalar loops.
+#if defined SIMD_KERNEL_BUILD
+#define AGK_INLINE
+#else
+#undef AGK_INLINE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -8,267 +16,1505 @@
 
 #include "quaternion.h"
 #include "vector3.h"
+#include "parallel.h"
+#include "simd.h"               // SSE2 / AVX2 kernels of the batch functions
 
 
 #ifndef M_PI
 #define M_PI           3.14159265358979323846264338327
 #endif
 
+#define QUAT_PARALLEL_GRAIN     16384   // points per parallel_for chunk, a few hundred KB of streamed data
+
+
+#if ! defined SIMD_KERNEL_BUILD
 
 static Quaternion test_quat_alignment;
 static_assert( sizeof(test_quat_alignment) == sizeof(test_quat_alignment.q),
                "Error: padding detected. Quaternion can not be represented correctly! Going nowhere without my Quaternion!\n");
 
+static Quaternionf test_quatf_alignment;
+static_assert( sizeof(test_quatf_alignment) == sizeof(test_quatf_alignment.q),
+               "Error: padding detected. Quaternionf can not be represented correctly! Going nowhere without my Quaternionf!\n");
 
 
+//==========================================================================================================================================
+// Both precisions are generated from the same source
+#define QUAT_T              Quaternion
+#define QUAT_REAL           double
+#define QUAT_VEC3_T         Vector3
+#define QUAT_FN(name)       quat_##name
+#define QUAT_VEC3_FN(name)  vec3_##name
+#define QUAT_MATH(name)     name
+#include "quaternion_impl.h"
+
+#define QUAT_T              Quaternionf
+#define QUAT_REAL           float
+#define QUAT_VEC3_T         Vector3f
+#define QUAT_FN(name)       quatf_##name
+#define QUAT_VEC3_FN(name)  vec3f_##name
+#define QUAT_MATH(name)     name##f
+#include "quaternion_impl.h"
+
 
-static int i = 0;       // will be used in all loops
 
 //==========================================================================================================================================
 //------------------------------------------------------------------------------------------------------------------------------------------
-Quaternion quat_from_identity(void)
+Quaternionf quatf_from_quat(Quaternion q)
 {
-    Quaternion q = {1.0, 0.0, 0.0, 0.0};
-    return q;
+    Quaternionf r = {{(float) q.w, (float) q.x, (float) q.y, (float) q.z}};
+    return r;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-Quaternion quat_from_values(double w, double x, double y, double z)
+Quaternion quat_from_quatf(Quaternionf q)
 {
-    Quaternion q;
-    q.w = w;
-    q.x = x;
-    q.y = y;
-    q.z = z;
-    return q;
+    Quaternion r = {{q.w, q.x, q.y, q.z}};
+    return r;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-Quaternion quat_from_angle_axis(double angle, Vector3 axis)
+void quat_print(Quaternion q)
 {
-    Quaternion q;
-    double s = sin(angle /= 2.0) / vec3_len( axis );
+    printf( "(%f, %f, %f, %f)\n", q.w, q.x, q.y, q.z );
+}
 
-    q.w = cos(angle);
-    for (i = 0; i < 3; i++) {
-        q.q[ i+1 ] = s * axis.v[i];
+//------------------------------------------------------------------------------------------------------------------------------------------
+void quatf_print(Quaternionf q)
+{
+    printf( "(%f, %f, %f, %f)\n", (double) q.w, (double) q.x, (double) q.y, (double) q.z );
+}
+
+
+
+//==========================================================================================================================================
+// Euler angles, quat_to_euler_angles being in quaternion_impl.h
+//------------------------------------------------------------------------------------------------------------------------------------------
+void quat_to_euler_angles_array(QuatEulerOrder order, const Quaternion * in, Vector3 * out, size_t count)
+{
+    size_t k;
+
+    for (k = 0; k < count; k++) {
+        out[k] = quat_to_euler_angles(in[k], order);
     }
+}
 
-    return q;
+
+
+#endif      // ! SIMD_KERNEL_BUILD
+
+
+
+//==========================================================================================================================================
+// Scalar versions of one element, used by the batch kernels for their remainders and by the tests
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline Quaternion quat_interpolate_one(QuatInterpolation method, Quaternion a, Quaternion b, double t)
+{
+    switch (method) {
+    case QUAT_NLERP:
+        return quat_nlerp(a, b, t);
+    case QUAT_SLERP:
+        return quat_slerp(a, b, t);
+    case QUAT_SLERP_FAST:
+    default:
+        return quat_slerp_fast(a, b, t);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline Quaternionf quatf_interpolate_one(QuatInterpolation method, Quaternionf a, Quaternionf b, float t)
+{
+    switch (method) {
+    case QUAT_NLERP:
+        return quatf_nlerp(a, b, t);
+    case QUAT_SLERP:
+        return quatf_slerp(a, b, t);
+    case QUAT_SLERP_FAST:
+    default:
+        return quatf_slerp_fast(a, b, t);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline Quaternion quat_exp_vec3(Vector3 v)
+{
+    Quaternion q = {{0, v.x, v.y, v.z}};
+    return quat_exp(q);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline Vector3 quat_log_vec3(Quaternion q)
+{
+    Quaternion l = quat_log(q);
+    return vec3_from_values(l.x, l.y, l.z);
+}
+
+
+
+//==========================================================================================================================================
+// Batch kernels, one set per tier under runtime dispatch (simd.h)
+SIMD_DISPATCH_VOID(quat_rotate_vec3_array, (Quaternion q, const Vector3 * in, Vector3 * out, size_t count),
+                   (q, in, out, count))
+SIMD_DISPATCH_VOID(quat_rotate_vec3_soa, (Quaternion q, const double * x, const double * y, const double * z,
+                                          double * out_x, double * out_y, double * out_z, size_t count),
+                   (q, x, y, z, out_x, out_y, out_z, count))
+SIMD_DISPATCH_VOID(quatf_rotate_vec3_array, (Quaternionf q, const Vector3f * in, Vector3f * out, size_t count),
+                   (q, in, out, count))
+SIMD_DISPATCH_VOID(quatf_rotate_vec3_soa, (Quaternionf q, const float * x, const float * y, const float * z,
+                                           float * out_x, float * out_y, float * out_z, size_t count),
+                   (q, x, y, z, out_x, out_y, out_z, count))
+SIMD_DISPATCH_VOID(quat_interpolate_array, (QuatInterpolation method, const Quaternion * a, const Quaternion * b,
+                                            const double * t, Quaternion * out, size_t count),
+                   (method, a, b, t, out, count))
+SIMD_DISPATCH_VOID(quat_interpolate_samples, (QuatInterpolation method, Quaternion a, Quaternion b, const double * t,
+                                              Quaternion * out, size_t count),
+                   (method, a, b, t, out, count))
+SIMD_DISPATCH_VOID(quatf_interpolate_array, (QuatInterpolation method, const Quaternionf * a, const Quaternionf * b,
+                                             const float * t, Quaternionf * out, size_t count),
+                   (method, a, b, t, out, count))
+SIMD_DISPATCH_VOID(quatf_interpolate_samples, (QuatInterpolation method, Quaternionf a, Quaternionf b, const float * t,
+                                               Quaternionf * out, size_t count),
+                   (method, a, b, t, out, count))
+SIMD_DISPATCH_VOID(quat_norm_array, (const Quaternion * in, Quaternion * out, size_t count), (in, out, count))
+SIMD_DISPATCH(size_t, quat_renorm_array, (Quaternion * q, size_t count, double epsilon), (q, count, epsilon))
+SIMD_DISPATCH_VOID(quat_norm_soa, (const double * w, const double * x, const double * y, const double * z,
+                                   double * out_w, double * out_x, double * out_y, double * out_z, size_t count),
+                   (w, x, y, z, out_w, out_x, out_y, out_z, count))
+SIMD_DISPATCH(size_t, quat_renorm_soa, (double * w, double * x, double * y, double * z, size_t count, double epsilon),
+              (w, x, y, z, count, epsilon))
+SIMD_DISPATCH_VOID(quatf_norm_array, (const Quaternionf * in, Quaternionf * out, size_t count), (in, out, count))
+SIMD_DISPATCH(size_t, quatf_renorm_array, (Quaternionf * q, size_t count, float epsilon), (q, count, epsilon))
+SIMD_DISPATCH_VOID(quat_exp_array, (const Vector3 * in, Quaternion * out, size_t count), (in, out, count))
+SIMD_DISPATCH_VOID(quat_log_array, (const Quaternion * in, Vector3 * out, size_t count), (in, out, count))
+SIMD_DISPATCH_VOID(quat_pow_array, (const Quaternion * in, const double * t, Quaternion * out, size_t count),
+                   (in, t, out, count))
+SIMD_DISPATCH_VOID(quat_from_euler_angles_array, (QuatSincosAccuracy accuracy, const Vector3 * angles,
+                                                  Quaternion * out, size_t count),
+                   (accuracy, angles, out, count))
+SIMD_DISPATCH_VOID(quat_from_angle_axis_array, (QuatSincosAccuracy accuracy, const double * angles,
+                                                const Vector3 * axes, Quaternion * out, size_t count),
+                   (accuracy, angles, axes, out, count))
+
+#if defined SIMD_KERNELS
+
+//==========================================================================================================================================
+// Batch operations
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Fills [m] with the row-major 3x3 matrix that quat_rotate_vec3 applies to a point.
+// Same terms as quat_rotate_vec3, so a non-unit [q] also scales the point by its squared length.
+static void quat_rotation_terms(Quaternion q, double * m)
+{
+    double w = q.w, x = q.x, y = q.y, z = q.z;
+
+    double ww = w*w;
+    double xx = x*x;
+    double yy = y*y;
+    double zz = z*z;
+    double wx = w*x;
+    double wy = w*y;
+    double wz = w*z;
+    double xy = x*y;
+    double xz = x*z;
+    double yz = y*z;
+
+    m[0] = ww + xx - yy - zz;   m[1] = 2*(xy - wz);         m[2] = 2*(xz + wy);
+    m[3] = 2*(xy + wz);         m[4] = ww - xx + yy - zz;   m[5] = 2*(yz - wx);
+    m[6] = 2*(xz - wy);         m[7] = 2*(yz + wx);         m[8] = ww - xx - yy + zz;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Scalar tail shared by all kernels. Reads the whole point before writing, so in place rotation is fine.
+static void quat_rotate_terms_scalar(const double * m,
+                                     const double * x, const double * y, const double * z,
+                                     double * out_x, double * out_y, double * out_z,
+                                     size_t stride, size_t count)
+{
+    size_t k;
+    double vx, vy, vz;
+
+    for (k = 0; k < count; k++) {
+        vx = x[k*stride];
+        vy = y[k*stride];
+        vz = z[k*stride];
+
+        out_x[k*stride] = m[0]*vx + m[1]*vy + m[2]*vz;
+        out_y[k*stride] = m[3]*vx + m[4]*vy + m[5]*vz;
+        out_z[k*stride] = m[6]*vx + m[7]*vy + m[8]*vz;
+    }
 }
 
 
+#if defined SIMD_HAVE_AVX2
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline void quat_rotate_terms_avx2(const __m256d * m, __m256d * x, __m256d * y, __m256d * z)
+{
+    __m256d rx = _mm256_fmadd_pd(m[2], *z, _mm256_fmadd_pd(m[1], *y, _mm256_mul_pd(m[0], *x)));
+    __m256d ry = _mm256_fmadd_pd(m[5], *z, _mm256_fmadd_pd(m[4], *y, _mm256_mul_pd(m[3], *x)));
+    __m256d rz = _mm256_fmadd_pd(m[8], *z, _mm256_fmadd_pd(m[7], *y, _mm256_mul_pd(m[6], *x)));
+
+    *x = rx;
+    *y = ry;
+    *z = rz;
+}
+
+#elif defined SIMD_HAVE_SSE2
 //------------------------------------------------------------------------------------------------------------------------------------------
-Quaternion quat_from_vec3(Vector3 a, Vector3 b)
+static inline void quat_rotate_terms_sse2(const __m128d * m, __m128d * x, __m128d * y, __m128d * z)
 {
-    Quaternion r = {0};
-    Vector3 axis = vec3_cross(a, b);
-    double dp = 0.0;
+    __m128d rx = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m[0], *x), _mm_mul_pd(m[1], *y)), _mm_mul_pd(m[2], *z));
+    __m128d ry = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m[3], *x), _mm_mul_pd(m[4], *y)), _mm_mul_pd(m[5], *z));
+    __m128d rz = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m[6], *x), _mm_mul_pd(m[7], *y)), _mm_mul_pd(m[8], *z));
 
-    if (vec3_equal( axis, vec3_from_zeroes() )) {
-        return quat_from_identity();
+    *x = rx;
+    *y = ry;
+    *z = rz;
+}
+#endif
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quat_rotate_vec3_array)(Quaternion q, const Vector3 * in, Vector3 * out, size_t count)
+{
+    double m[9];
+    size_t k = 0;
+    const double * src = in->v;         // Vector3 has no padding, so the array is one stream of x y z triples
+    double * dst = out->v;
+
+    quat_rotation_terms(q, m);
+
+#if defined SIMD_HAVE_AVX2
+    {
+        __m256d mv[9];
+        __m256d vx, vy, vz;
+
+        for (k = 0; k < 9; k++) {
+            mv[k] = _mm256_set1_pd(m[k]);
+        }
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            simd_load_xyz4(src + 3*k, &vx, &vy, &vz);
+            quat_rotate_terms_avx2(mv, &vx, &vy, &vz);
+            simd_store_xyz4(dst + 3*k, vx, vy, vz);
+        }
+    }
+#elif defined SIMD_HAVE_SSE2
+    {
+        __m128d mv[9];
+        __m128d vx, vy, vz;
+
+        for (k = 0; k < 9; k++) {
+            mv[k] = _mm_set1_pd(m[k]);
+        }
+
+        for (k = 0; k + 2 <= count; k += 2) {
+            simd_load_xyz2(src + 3*k, &vx, &vy, &vz);
+            quat_rotate_terms_sse2(mv, &vx, &vy, &vz);
+            simd_store_xyz2(dst + 3*k, vx, vy, vz);
+        }
     }
+#endif
 
-    dp = vec3_dot(a, b);
-    r.w = sqrt(vec3_len_squared(a) * vec3_len_squared(b)) + dp;
+    quat_rotate_terms_scalar(m, src + 3*k, src + 3*k + 1, src + 3*k + 2,
+                             dst + 3*k, dst + 3*k + 1, dst + 3*k + 2,
+                             3, count - k);
+}
 
-    for (i = 0; i < 3; i++) {
-        r.q[i + 1] = axis.v[i];
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quat_rotate_vec3_soa)(Quaternion q,
+                                   const double * x, const double * y, const double * z,
+                                   double * out_x, double * out_y, double * out_z,
+                                   size_t count)
+{
+    double m[9];
+    size_t k = 0;
+
+    quat_rotation_terms(q, m);
+
+#if defined SIMD_HAVE_AVX2
+    {
+        __m256d mv[9];
+        __m256d vx, vy, vz;
+
+        for (k = 0; k < 9; k++) {
+            mv[k] = _mm256_set1_pd(m[k]);
+        }
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            vx = _mm256_loadu_pd(x + k);
+            vy = _mm256_loadu_pd(y + k);
+            vz = _mm256_loadu_pd(z + k);
+
+            quat_rotate_terms_avx2(mv, &vx, &vy, &vz);
+
+            _mm256_storeu_pd(out_x + k, vx);
+            _mm256_storeu_pd(out_y + k, vy);
+            _mm256_storeu_pd(out_z + k, vz);
+        }
+    }
+#elif defined SIMD_HAVE_SSE2
+    {
+        __m128d mv[9];
+        __m128d vx, vy, vz;
+
+        for (k = 0; k < 9; k++) {
+            mv[k] = _mm_set1_pd(m[k]);
+        }
+
+        for (k = 0; k + 2 <= count; k += 2) {
+            vx = _mm_loadu_pd(x + k);
+            vy = _mm_loadu_pd(y + k);
+            vz = _mm_loadu_pd(z + k);
+
+            quat_rotate_terms_sse2(mv, &vx, &vy, &vz);
+
+            _mm_storeu_pd(out_x + k, vx);
+            _mm_storeu_pd(out_y + k, vy);
+            _mm_storeu_pd(out_z + k, vz);
+        }
     }
+#endif
 
-    return quat_norm(r);
+    quat_rotate_terms_scalar(m, x + k, y + k, z + k, out_x + k, out_y + k, out_z + k, 1, count - k);
 }
 
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-Quaternion quat_from_euler_angles(double anglex, double angley, double anglez)
+// The single precision terms are computed in double from the promoted quaternion and rounded once.
+static void quatf_rotation_terms(Quaternionf q, float * m)
+{
+    double md[9];
+    int k;
+
+    quat_rotation_terms(quat_from_quatf(q), md);
+    for (k = 0; k < 9; k++) {
+        m[k] = (float) md[k];
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void quatf_rotate_terms_scalar(const float * m,
+                                      const float * x, const float * y, const float * z,
+                                      float * out_x, float * out_y, float * out_z,
+                                      size_t stride, size_t count)
 {
-    Quaternion r;
+    size_t k;
+    float vx, vy, vz;
 
-    double cx = cos(anglex /= 2.0), sx = sin( anglex );
-    double cy = cos(angley /= 2.0), sy = sin( angley );
-    double cz = cos(anglez /= 2.0), sz = sin( anglez );
+    for (k = 0; k < count; k++) {
+        vx = x[k*stride];
+        vy = y[k*stride];
+        vz = z[k*stride];
 
-    r.w = cy*cz*cx - sy*sz*sx;
-    r.x = sy*sz*cx + cy*cz*sx;
-    r.y = sy*cz*cx + cy*sz*sx;
-    r.z = cy*sz*cx - sy*cz*sx;
+        out_x[k*stride] = m[0]*vx + m[1]*vy + m[2]*vz;
+        out_y[k*stride] = m[3]*vx + m[4]*vy + m[5]*vz;
+        out_z[k*stride] = m[6]*vx + m[7]*vy + m[8]*vz;
+    }
+}
 
-    return r;
+
+#if defined SIMD_HAVE_AVX2
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline void quatf_rotate_terms_avx2(const __m256 * m, __m256 * x, __m256 * y, __m256 * z)
+{
+    __m256 rx = _mm256_fmadd_ps(m[2], *z, _mm256_fmadd_ps(m[1], *y, _mm256_mul_ps(m[0], *x)));
+    __m256 ry = _mm256_fmadd_ps(m[5], *z, _mm256_fmadd_ps(m[4], *y, _mm256_mul_ps(m[3], *x)));
+    __m256 rz = _mm256_fmadd_ps(m[8], *z, _mm256_fmadd_ps(m[7], *y, _mm256_mul_ps(m[6], *x)));
+
+    *x = rx;
+    *y = ry;
+    *z = rz;
+}
+#endif
+
+#if defined SIMD_HAVE_AVX2 || defined SIMD_HAVE_SSE2
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline void quatf_rotate_terms_sse(const __m128 * m, __m128 * x, __m128 * y, __m128 * z)
+{
+    __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], *x), _mm_mul_ps(m[1], *y)), _mm_mul_ps(m[2], *z));
+    __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[3], *x), _mm_mul_ps(m[4], *y)), _mm_mul_ps(m[5], *z));
+    __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[6], *x), _mm_mul_ps(m[7], *y)), _mm_mul_ps(m[8], *z));
+
+    *x = rx;
+    *y = ry;
+    *z = rz;
+}
+#endif
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quatf_rotate_vec3_array)(Quaternionf q, const Vector3f * in, Vector3f * out, size_t count)
+{
+    float m[9];
+    size_t k = 0;
+    const float * src = in->v;
+    float * dst = out->v;
+
+    quatf_rotation_terms(q, m);
+
+#if defined SIMD_HAVE_AVX2 || defined SIMD_HAVE_SSE2
+    {
+        __m128 mv[9];
+        __m128 vx, vy, vz;
+
+        for (k = 0; k < 9; k++) {
+            mv[k] = _mm_set1_ps(m[k]);
+        }
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            simd_load_xyz4f(src + 3*k, &vx, &vy, &vz);
+            quatf_rotate_terms_sse(mv, &vx, &vy, &vz);
+            simd_store_xyz4f(dst + 3*k, vx, vy, vz);
+        }
+    }
+#endif
+
+    quatf_rotate_terms_scalar(m, src + 3*k, src + 3*k + 1, src + 3*k + 2,
+                              dst + 3*k, dst + 3*k + 1, dst + 3*k + 2,
+                              3, count - k);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quatf_rotate_vec3_soa)(Quaternionf q,
+                                    const float * x, const float * y, const float * z,
+                                    float * out_x, float * out_y, float * out_z,
+                                    size_t count)
+{
+    float m[9];
+    size_t k = 0;
+
+    quatf_rotation_terms(q, m);
+
+#if defined SIMD_HAVE_AVX2
+    {
+        __m256 mv[9];
+        __m256 vx, vy, vz;
+
+        for (k = 0; k < 9; k++) {
+            mv[k] = _mm256_set1_ps(m[k]);
+        }
+
+        for (k = 0; k + 8 <= count; k += 8) {
+            vx = _mm256_loadu_ps(x + k);
+            vy = _mm256_loadu_ps(y + k);
+            vz = _mm256_loadu_ps(z + k);
+
+            quatf_rotate_terms_avx2(mv, &vx, &vy, &vz);
+
+            _mm256_storeu_ps(out_x + k, vx);
+            _mm256_storeu_ps(out_y + k, vy);
+            _mm256_storeu_ps(out_z + k, vz);
+        }
+    }
+#elif defined SIMD_HAVE_SSE2
+    {
+        __m128 mv[9];
+        __m128 vx, vy, vz;
+
+        for (k = 0; k < 9; k++) {
+            mv[k] = _mm_set1_ps(m[k]);
+        }
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            vx = _mm_loadu_ps(x + k);
+            vy = _mm_loadu_ps(y + k);
+            vz = _mm_loadu_ps(z + k);
+
+            quatf_rotate_terms_sse(mv, &vx, &vy, &vz);
+
+            _mm_storeu_ps(out_x + k, vx);
+            _mm_storeu_ps(out_y + k, vy);
+            _mm_storeu_ps(out_z + k, vz);
+        }
+    }
+#endif
+
+    quatf_rotate_terms_scalar(m, x + k, y + k, z + k, out_x + k, out_y + k, out_z + k, 1, count - k);
 }
 
 
 
 //==========================================================================================================================================
+// Batch interpolation. The kernels walk [a] and [b] with a step of 1 for the _array functions, and with a step of 0,
+// repeating the same pair, for the _samples functions.
+//------------------------------------------------------------------------------------------------------------------------------------------
+#if defined SIMD_HAVE_AVX2 || defined SIMD_HAVE_SSE2
+static const double quat_slerp_fast_u[QUAT_SLERP_FAST_TERMS] = QUAT_SLERP_FAST_U;
+static const double quat_slerp_fast_v[QUAT_SLERP_FAST_TERMS] = QUAT_SLERP_FAST_V;
+#endif
+
+
+#if defined SIMD_HAVE_AVX2
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Interpolates the 4 quaternions held as w x y z lanes in [a] and [b] at [t], with the same steps as quat_nlerp and
+// quat_slerp_fast. The result replaces [a].
+static inline void quat_interpolate_avx2(QuatInterpolation method, __m256d t, __m256d * a, __m256d * b)
+{
+    __m256d one = _mm256_set1_pd(1);
+    __m256d dot, flip, len, x, d, tt, dd, u, v, ut, ud, ct, cd;
+    int i;
+
+    dot = _mm256_fmadd_pd(a[3], b[3], _mm256_fmadd_pd(a[2], b[2], _mm256_fmadd_pd(a[1], b[1], _mm256_mul_pd(a[0], b[0]))));
+    flip = _mm256_and_pd(dot, _mm256_set1_pd(-0.0));       // sign bit of the lanes that take the other arc
+    for (i = 0; i < 4; i++) {
+        b[i] = _mm256_xor_pd(b[i], flip);
+    }
+
+    if (method == QUAT_NLERP) {
+        for (i = 0; i < 4; i++) {
+            a[i] = _mm256_fmadd_pd(t, _mm256_sub_pd(b[i], a[i]), a[i]);
+        }
+        len = _mm256_fmadd_pd(a[3], a[3], _mm256_fmadd_pd(a[2], a[2], _mm256_fmadd_pd(a[1], a[1], _mm256_mul_pd(a[0], a[0]))));
+        len = _mm256_sqrt_pd(len);
+        for (i = 0; i < 4; i++) {
+            a[i] = _mm256_div_pd(a[i], len);
+        }
+        return;
+    }
+
+    x = _mm256_sub_pd(_mm256_xor_pd(dot, flip), one);
+    d = _mm256_sub_pd(one, t);
+    tt = _mm256_mul_pd(t, t);
+    dd = _mm256_mul_pd(d, d);
+    ct = _mm256_setzero_pd();
+    cd = _mm256_setzero_pd();
+
+    for (i = QUAT_SLERP_FAST_TERMS - 1; i >= 0; i--) {
+        u = _mm256_set1_pd(quat_slerp_fast_u[i]);
+        v = _mm256_set1_pd(quat_slerp_fast_v[i]);
+        ut = _mm256_mul_pd(_mm256_fmsub_pd(u, tt, v), x);
+        ud = _mm256_mul_pd(_mm256_fmsub_pd(u, dd, v), x);
+        ct = _mm256_fmadd_pd(ut, ct, ut);
+        cd = _mm256_fmadd_pd(ud, cd, ud);
+    }
+    ct = _mm256_fmadd_pd(t, ct, t);
+    cd = _mm256_fmadd_pd(d, cd, d);
+
+    for (i = 0; i < 4; i++) {
+        a[i] = _mm256_fmadd_pd(cd, a[i], _mm256_mul_pd(ct, b[i]));
+    }
+}
+
+#elif defined SIMD_HAVE_SSE2
 //------------------------------------------------------------------------------------------------------------------------------------------
-Quaternion quat_copy(Quaternion q)
+// 2 lane version of quat_interpolate_avx2.
+static inline void quat_interpolate_sse2(QuatInterpolation method, __m128d t, __m128d * a, __m128d * b)
 {
-    Quaternion r;
+    __m128d one = _mm_set1_pd(1);
+    __m128d dot, flip, len, x, d, tt, dd, u, v, ut, ud, ct, cd;
+    int i;
 
-    // This is more explicit than memcpy, and the compiler will optimise this to memcpy(r.q, q.q, sizeof(double)*4) anyway.
-    for(i = 0; i < 4; i++) {
-        r.q[i] = q.q[i];
+    dot = _mm_add_pd(_mm_add_pd(_mm_mul_pd(a[0], b[0]), _mm_mul_pd(a[1], b[1])),
+                     _mm_add_pd(_mm_mul_pd(a[2], b[2]), _mm_mul_pd(a[3], b[3])));
+    flip = _mm_and_pd(dot, _mm_set1_pd(-0.0));
+    for (i = 0; i < 4; i++) {
+        b[i] = _mm_xor_pd(b[i], flip);
     }
 
-    return r;
+    if (method == QUAT_NLERP) {
+        for (i = 0; i < 4; i++) {
+            a[i] = _mm_add_pd(a[i], _mm_mul_pd(t, _mm_sub_pd(b[i], a[i])));
+        }
+        len = _mm_add_pd(_mm_add_pd(_mm_mul_pd(a[0], a[0]), _mm_mul_pd(a[1], a[1])),
+                         _mm_add_pd(_mm_mul_pd(a[2], a[2]), _mm_mul_pd(a[3], a[3])));
+        len = _mm_sqrt_pd(len);
+        for (i = 0; i < 4; i++) {
+            a[i] = _mm_div_pd(a[i], len);
+        }
+        return;
+    }
+
+    x = _mm_sub_pd(_mm_xor_pd(dot, flip), one);
+    d = _mm_sub_pd(one, t);
+    tt = _mm_mul_pd(t, t);
+    dd = _mm_mul_pd(d, d);
+    ct = _mm_setzero_pd();
+    cd = _mm_setzero_pd();
+
+    for (i = QUAT_SLERP_FAST_TERMS - 1; i >= 0; i--) {
+        u = _mm_set1_pd(quat_slerp_fast_u[i]);
+        v = _mm_set1_pd(quat_slerp_fast_v[i]);
+        ut = _mm_mul_pd(_mm_sub_pd(_mm_mul_pd(u, tt), v), x);
+        ud = _mm_mul_pd(_mm_sub_pd(_mm_mul_pd(u, dd), v), x);
+        ct = _mm_mul_pd(ut, _mm_add_pd(one, ct));
+        cd = _mm_mul_pd(ud, _mm_add_pd(one, cd));
+    }
+    ct = _mm_mul_pd(t, _mm_add_pd(one, ct));
+    cd = _mm_mul_pd(d, _mm_add_pd(one, cd));
+
+    for (i = 0; i < 4; i++) {
+        a[i] = _mm_add_pd(_mm_mul_pd(cd, a[i]), _mm_mul_pd(ct, b[i]));
+    }
 }
+#endif
+
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-double quat_len_squared(Quaternion q)
+static void quat_interpolate_kernel(QuatInterpolation method,
+                                    const Quaternion * a, size_t a_step, const Quaternion * b, size_t b_step,
+                                    const double * t, Quaternion * out, size_t count)
 {
-    double len_2 = 0.0;
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2
+    if (method != QUAT_SLERP) {
+        __m256d va[4], vb[4];
+        int i;
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            for (i = 0; i < 4; i++) {
+                va[i] = _mm256_loadu_pd(a[(k + (size_t) i)*a_step].q);
+                vb[i] = _mm256_loadu_pd(b[(k + (size_t) i)*b_step].q);
+            }
+            simd_transpose4(&va[0], &va[1], &va[2], &va[3]);
+            simd_transpose4(&vb[0], &vb[1], &vb[2], &vb[3]);
+
+            quat_interpolate_avx2(method, _mm256_loadu_pd(t + k), va, vb);
+
+            simd_transpose4(&va[0], &va[1], &va[2], &va[3]);
+            for (i = 0; i < 4; i++) {
+                _mm256_storeu_pd(out[k + (size_t) i].q, va[i]);
+            }
+        }
+    }
+#elif defined SIMD_HAVE_SSE2
+    if (method != QUAT_SLERP) {
+        __m128d va[4], vb[4];
+        __m128d a0, a1, a2, a3, b0, b1, b2, b3;
+
+        for (k = 0; k + 2 <= count; k += 2) {
+            a0 = _mm_loadu_pd(a[k*a_step].q);                  // w0 x0
+            a1 = _mm_loadu_pd(a[k*a_step].q + 2);              // y0 z0
+            a2 = _mm_loadu_pd(a[(k + 1)*a_step].q);
+            a3 = _mm_loadu_pd(a[(k + 1)*a_step].q + 2);
+            b0 = _mm_loadu_pd(b[k*b_step].q);
+            b1 = _mm_loadu_pd(b[k*b_step].q + 2);
+            b2 = _mm_loadu_pd(b[(k + 1)*b_step].q);
+            b3 = _mm_loadu_pd(b[(k + 1)*b_step].q + 2);
+
+            va[0] = _mm_unpacklo_pd(a0, a2);    va[1] = _mm_unpackhi_pd(a0, a2);
+            va[2] = _mm_unpacklo_pd(a1, a3);    va[3] = _mm_unpackhi_pd(a1, a3);
+            vb[0] = _mm_unpacklo_pd(b0, b2);    vb[1] = _mm_unpackhi_pd(b0, b2);
+            vb[2] = _mm_unpacklo_pd(b1, b3);    vb[3] = _mm_unpackhi_pd(b1, b3);
+
+            quat_interpolate_sse2(method, _mm_loadu_pd(t + k), va, vb);
+
+            _mm_storeu_pd(out[k].q,         _mm_unpacklo_pd(va[0], va[1]));
+            _mm_storeu_pd(out[k].q + 2,     _mm_unpacklo_pd(va[2], va[3]));
+            _mm_storeu_pd(out[k + 1].q,     _mm_unpackhi_pd(va[0], va[1]));
+            _mm_storeu_pd(out[k + 1].q + 2, _mm_unpackhi_pd(va[2], va[3]));
+        }
+    }
+#endif
 
-    for(i = 0; i < 4; i++) {
-        len_2 += (q.q[i] * q.q[i]);
+    for (; k < count; k++) {
+        out[k] = quat_interpolate_one(method, a[k*a_step], b[k*b_step], t[k]);
     }
+}
 
-    return len_2;
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quat_interpolate_array)(QuatInterpolation method,
+                                     const Quaternion * a, const Quaternion * b, const double * t,
+                                     Quaternion * out, size_t count)
+{
+    quat_interpolate_kernel(method, a, 1, b, 1, t, out, count);
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-double quat_len(Quaternion q)
+void SIMD_FN(quat_interpolate_samples)(QuatInterpolation method,
+                                       Quaternion a, Quaternion b, const double * t,
+                                       Quaternion * out, size_t count)
 {
-    return sqrt( quat_len_squared(q) );
+    double cosom = quat_dot(a, b), theta, inv_sinom, sa, sb;
+    size_t k;
+    int i;
+
+    if (method != QUAT_SLERP || fabs(cosom) > 1 - QUAT_SLERP_NLERP_THRESHOLD) {
+        quat_interpolate_kernel(method == QUAT_SLERP ? QUAT_NLERP : method, &a, 0, &b, 0, t, out, count);
+        return;
+    }
+
+    if (cosom < 0) {
+        cosom = -cosom;
+        b = quat_negate(b);
+    }
+    theta = acos(cosom);
+    inv_sinom = 1 / sin(theta);
+
+    for (k = 0; k < count; k++) {
+        sa = sin((1 - t[k]) * theta) * inv_sinom;
+        sb = sin(t[k] * theta) * inv_sinom;
+        for (i = 0; i < 4; i++) {
+            out[k].q[i] = sa*a.q[i] + sb*b.q[i];
+        }
+    }
 }
 
+
+#if defined SIMD_HAVE_AVX2 || defined SIMD_HAVE_SSE2
 //------------------------------------------------------------------------------------------------------------------------------------------
-Quaternion quat_norm(Quaternion q)
+// Single precision version of quat_interpolate_avx2, 4 lanes.
+static inline void quatf_interpolate_sse(QuatInterpolation method, __m128 t, __m128 * a, __m128 * b)
 {
-    Quaternion r;
-    double qlen = quat_len( q );
+    __m128 one = _mm_set1_ps(1);
+    __m128 dot, flip, len, x, d, tt, dd, u, v, ut, ud, ct, cd;
+    int i;
 
+    dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])),
+                     _mm_add_ps(_mm_mul_ps(a[2], b[2]), _mm_mul_ps(a[3], b[3])));
+    flip = _mm_and_ps(dot, _mm_set1_ps(-0.0f));
     for (i = 0; i < 4; i++) {
-        r.q[i] = q.q[i] / qlen;
+        b[i] = _mm_xor_ps(b[i], flip);
     }
 
-    return r;
+    if (method == QUAT_NLERP) {
+        for (i = 0; i < 4; i++) {
+            a[i] = _mm_add_ps(a[i], _mm_mul_ps(t, _mm_sub_ps(b[i], a[i])));
+        }
+        len = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], a[0]), _mm_mul_ps(a[1], a[1])),
+                         _mm_add_ps(_mm_mul_ps(a[2], a[2]), _mm_mul_ps(a[3], a[3])));
+        len = _mm_sqrt_ps(len);
+        for (i = 0; i < 4; i++) {
+            a[i] = _mm_div_ps(a[i], len);
+        }
+        return;
+    }
+
+    x = _mm_sub_ps(_mm_xor_ps(dot, flip), one);
+    d = _mm_sub_ps(one, t);
+    tt = _mm_mul_ps(t, t);
+    dd = _mm_mul_ps(d, d);
+    ct = _mm_setzero_ps();
+    cd = _mm_setzero_ps();
+
+    for (i = QUAT_SLERP_FAST_TERMS - 1; i >= 0; i--) {
+        u = _mm_set1_ps((float) quat_slerp_fast_u[i]);
+        v = _mm_set1_ps((float) quat_slerp_fast_v[i]);
+        ut = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, tt), v), x);
+        ud = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, dd), v), x);
+        ct = _mm_mul_ps(ut, _mm_add_ps(one, ct));
+        cd = _mm_mul_ps(ud, _mm_add_ps(one, cd));
+    }
+    ct = _mm_mul_ps(t, _mm_add_ps(one, ct));
+    cd = _mm_mul_ps(d, _mm_add_ps(one, cd));
+
+    for (i = 0; i < 4; i++) {
+        a[i] = _mm_add_ps(_mm_mul_ps(cd, a[i]), _mm_mul_ps(ct, b[i]));
+    }
 }
+#endif
+
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-Quaternion quat_negate(Quaternion q)
+static void quatf_interpolate_kernel(QuatInterpolation method,
+                                     const Quaternionf * a, size_t a_step, const Quaternionf * b, size_t b_step,
+                                     const float * t, Quaternionf * out, size_t count)
 {
-    Quaternion r;
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2 || defined SIMD_HAVE_SSE2
+    if (method != QUAT_SLERP) {
+        __m128 va[4], vb[4];
+        int i;
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            for (i = 0; i < 4; i++) {
+                va[i] = _mm_loadu_ps(a[(k + (size_t) i)*a_step].q);
+                vb[i] = _mm_loadu_ps(b[(k + (size_t) i)*b_step].q);
+            }
+            _MM_TRANSPOSE4_PS(va[0], va[1], va[2], va[3]);
+            _MM_TRANSPOSE4_PS(vb[0], vb[1], vb[2], vb[3]);
+
+            quatf_interpolate_sse(method, _mm_loadu_ps(t + k), va, vb);
+
+            _MM_TRANSPOSE4_PS(va[0], va[1], va[2], va[3]);
+            for (i = 0; i < 4; i++) {
+                _mm_storeu_ps(out[k + (size_t) i].q, va[i]);
+            }
+        }
+    }
+#endif
 
-    for(i = 0; i < 4; i++) {
-        r.q[i] = -q.q[i];
+    for (; k < count; k++) {
+        out[k] = quatf_interpolate_one(method, a[k*a_step], b[k*b_step], t[k]);
     }
-    return r;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-Quaternion quat_conjugate(Quaternion q)
+void SIMD_FN(quatf_interpolate_array)(QuatInterpolation method,
+                                      const Quaternionf * a, const Quaternionf * b, const float * t,
+                                      Quaternionf * out, size_t count)
+{
+    quatf_interpolate_kernel(method, a, 1, b, 1, t, out, count);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quatf_interpolate_samples)(QuatInterpolation method,
+                                        Quaternionf a, Quaternionf b, const float * t,
+                                        Quaternionf * out, size_t count)
 {
-    Quaternion r = {0};
+    float cosom = quatf_dot(a, b), theta, inv_sinom, sa, sb;
+    size_t k;
+    int i;
 
-    r.w = q.w;
-    for(i = 1; i < 4; i++) {
-        r.q[i] = -q.q[i];
+    if (method != QUAT_SLERP || fabs(cosom) > 1 - (float) QUATF_SLERP_NLERP_THRESHOLD) {
+        quatf_interpolate_kernel(method == QUAT_SLERP ? QUAT_NLERP : method, &a, 0, &b, 0, t, out, count);
+        return;
     }
-    return r;
+
+    if (cosom < 0) {
+        cosom = -cosom;
+        b = quatf_negate(b);
+    }
+    theta = acos(cosom);
+    inv_sinom = 1 / sin(theta);
+
+    for (k = 0; k < count; k++) {
+        sa = sin((1 - t[k]) * theta) * inv_sinom;
+        sb = sin(t[k] * theta) * inv_sinom;
+        for (i = 0; i < 4; i++) {
+            out[k].q[i] = sa*a.q[i] + sb*b.q[i];
+        }
+    }
+}
+
+
+
+//==========================================================================================================================================
+// Batch normalisation. norm_array is the renorm kernel with a negative epsilon, which selects every quaternion.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static size_t quat_renorm_kernel(const Quaternion * in, Quaternion * out, size_t count, double epsilon)
+{
+    size_t k = 0, changed = 0;
+
+#if defined SIMD_HAVE_AVX2
+    {
+        __m256d one = _mm256_set1_pd(1), eps = _mm256_set1_pd(epsilon), sign = _mm256_set1_pd(-0.0);
+        __m256d r0, r1, r2, r3, h01, h23, len2, mask, scale;
+        int bits;
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            r0 = _mm256_loadu_pd(in[k].q);
+            r1 = _mm256_loadu_pd(in[k + 1].q);
+            r2 = _mm256_loadu_pd(in[k + 2].q);
+            r3 = _mm256_loadu_pd(in[k + 3].q);
+
+            h01 = _mm256_hadd_pd(_mm256_mul_pd(r0, r0), _mm256_mul_pd(r1, r1));     // w0+x0 w1+x1 y0+z0 y1+z1 (squared)
+            h23 = _mm256_hadd_pd(_mm256_mul_pd(r2, r2), _mm256_mul_pd(r3, r3));
+            len2 = _mm256_add_pd(_mm256_permute2f128_pd(h01, h23, 0x20), _mm256_permute2f128_pd(h01, h23, 0x31));
+
+            mask = _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(len2, one)), eps, _CMP_NLE_UQ);    // nan counts as drifted
+            bits = _mm256_movemask_pd(mask);
+            if (bits == 0) {
+                continue;
+            }
+
+            scale = _mm256_blendv_pd(one, simd_rsqrt4_pd(len2), mask);
+            _mm256_storeu_pd(out[k].q,     _mm256_mul_pd(r0, _mm256_permute4x64_pd(scale, 0x00)));
+            _mm256_storeu_pd(out[k + 1].q, _mm256_mul_pd(r1, _mm256_permute4x64_pd(scale, 0x55)));
+            _mm256_storeu_pd(out[k + 2].q, _mm256_mul_pd(r2, _mm256_permute4x64_pd(scale, 0xAA)));
+            _mm256_storeu_pd(out[k + 3].q, _mm256_mul_pd(r3, _mm256_permute4x64_pd(scale, 0xFF)));
+            changed += (size_t) simd_mask_count(bits);
+        }
+    }
+#elif defined SIMD_HAVE_SSE2
+    {
+        __m128d one = _mm_set1_pd(1), eps = _mm_set1_pd(epsilon), sign = _mm_set1_pd(-0.0);
+        __m128d a0, a1, b0, b1, sa, sb, len2, mask, scale;
+        int bits;
+
+        for (k = 0; k + 2 <= count; k += 2) {
+            a0 = _mm_loadu_pd(in[k].q);                    // w0 x0
+            a1 = _mm_loadu_pd(in[k].q + 2);                // y0 z0
+            b0 = _mm_loadu_pd(in[k + 1].q);
+            b1 = _mm_loadu_pd(in[k + 1].q + 2);
+
+            sa = _mm_add_pd(_mm_mul_pd(a0, a0), _mm_mul_pd(a1, a1));
+            sb = _mm_add_pd(_mm_mul_pd(b0, b0), _mm_mul_pd(b1, b1));
+            len2 = _mm_add_pd(_mm_unpacklo_pd(sa, sb), _mm_unpackhi_pd(sa, sb));
+
+            mask = _mm_cmpnle_pd(_mm_andnot_pd(sign, _mm_sub_pd(len2, one)), eps);
+            bits = _mm_movemask_pd(mask);
+            if (bits == 0) {
+                continue;
+            }
+
+            scale = _mm_or_pd(_mm_and_pd(mask, simd_rsqrt2_pd(len2)), _mm_andnot_pd(mask, one));
+            sa = _mm_unpacklo_pd(scale, scale);
+            sb = _mm_unpackhi_pd(scale, scale);
+            _mm_storeu_pd(out[k].q,         _mm_mul_pd(a0, sa));
+            _mm_storeu_pd(out[k].q + 2,     _mm_mul_pd(a1, sa));
+            _mm_storeu_pd(out[k + 1].q,     _mm_mul_pd(b0, sb));
+            _mm_storeu_pd(out[k + 1].q + 2, _mm_mul_pd(b1, sb));
+            changed += (size_t) simd_mask_count(bits);
+        }
+    }
+#endif
+
+    for (; k < count; k++) {
+        if (fabs( quat_len_squared(in[k]) - 1 ) <= epsilon) {
+            out[k] = in[k];
+            continue;
+        }
+        out[k] = quat_norm_fast(in[k]);
+        changed++;
+    }
+
+    return changed;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-Quaternion quat_inverse(Quaternion q)
+void SIMD_FN(quat_norm_array)(const Quaternion * in, Quaternion * out, size_t count)
 {
+    quat_renorm_kernel(in, out, count, -1);
+}
 
-    double len_2 = quat_len_squared( q );
-    Quaternion r = { q.w/len_2,
-                     -q.x/len_2, -q.y/len_2, -q.z/len_2};
-    return r;
+//------------------------------------------------------------------------------------------------------------------------------------------
+size_t SIMD_FN(quat_renorm_array)(Quaternion * q, size_t count, double epsilon)
+{
+    return quat_renorm_kernel(q, q, count, epsilon);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// quat_renorm_kernel over four streams, [in] and [out] holding w x y z. Every lane reads its element before writing it.
+static size_t quat_renorm_streams_kernel(const double * const * in, double * const * out, size_t count, double epsilon)
+{
+    Quaternion q;
+    size_t k = 0, changed = 0;
+    int i;
+
+#if defined SIMD_HAVE_AVX2
+    {
+        __m256d one = _mm256_set1_pd(1), eps = _mm256_set1_pd(epsilon), sign = _mm256_set1_pd(-0.0);
+        __m256d r[4], len2, mask, scale;
+        int bits;
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            for (i = 0; i < 4; i++) {
+                r[i] = _mm256_loadu_pd(in[i] + k);
+            }
+            len2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(r[0], r[0]), _mm256_mul_pd(r[1], r[1])),
+                                 _mm256_add_pd(_mm256_mul_pd(r[2], r[2]), _mm256_mul_pd(r[3], r[3])));
+
+            mask = _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(len2, one)), eps, _CMP_NLE_UQ);    // nan counts as drifted
+            bits = _mm256_movemask_pd(mask);
+            if (bits == 0) {
+                continue;
+            }
+
+            scale = _mm256_blendv_pd(one, simd_rsqrt4_pd(len2), mask);
+            for (i = 0; i < 4; i++) {
+                _mm256_storeu_pd(out[i] + k, _mm256_mul_pd(r[i], scale));
+            }
+            changed += (size_t) simd_mask_count(bits);
+        }
+    }
+#elif defined SIMD_HAVE_SSE2
+    {
+        __m128d one = _mm_set1_pd(1), eps = _mm_set1_pd(epsilon), sign = _mm_set1_pd(-0.0);
+        __m128d r[4], len2, mask, scale;
+        int bits;
+
+        for (k = 0; k + 2 <= count; k += 2) {
+            for (i = 0; i < 4; i++) {
+                r[i] = _mm_loadu_pd(in[i] + k);
+            }
+            len2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(r[0], r[0]), _mm_mul_pd(r[1], r[1])),
+                              _mm_add_pd(_mm_mul_pd(r[2], r[2]), _mm_mul_pd(r[3], r[3])));
+
+            mask = _mm_cmpnle_pd(_mm_andnot_pd(sign, _mm_sub_pd(len2, one)), eps);
+            bits = _mm_movemask_pd(mask);
+            if (bits == 0) {
+                continue;
+            }
+
+            scale = _mm_or_pd(_mm_and_pd(mask, simd_rsqrt2_pd(len2)), _mm_andnot_pd(mask, one));
+            for (i = 0; i < 4; i++) {
+                _mm_storeu_pd(out[i] + k, _mm_mul_pd(r[i], scale));
+            }
+            changed += (size_t) simd_mask_count(bits);
+        }
+    }
+#endif
+
+    for (; k < count; k++) {
+        q = quat_from_values( in[0][k], in[1][k], in[2][k], in[3][k] );
+        if (fabs( quat_len_squared(q) - 1 ) > epsilon) {
+            q = quat_norm_fast(q);
+            changed++;
+        }
+        for (i = 0; i < 4; i++) {
+            out[i][k] = q.q[i];
+        }
+    }
+
+    return changed;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quat_norm_soa)(const double * w, const double * x, const double * y, const double * z,
+                            double * out_w, double * out_x, double * out_y, double * out_z, size_t count)
+{
+    const double * in[4] = {w, x, y, z};
+    double * out[4] = {out_w, out_x, out_y, out_z};
+
+    quat_renorm_streams_kernel(in, out, count, -1);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+size_t SIMD_FN(quat_renorm_soa)(double * w, double * x, double * y, double * z, size_t count, double epsilon)
+{
+    const double * in[4] = {w, x, y, z};
+    double * out[4] = {w, x, y, z};
+
+    return quat_renorm_streams_kernel(in, out, count, epsilon);
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static size_t quatf_renorm_kernel(const Quaternionf * in, Quaternionf * out, size_t count, float epsilon)
+{
+    size_t k = 0, changed = 0;
+
+#if defined SIMD_HAVE_AVX2 || defined SIMD_HAVE_SSE2
+    {
+        __m128 one = _mm_set1_ps(1), eps = _mm_set1_ps(epsilon), sign = _mm_set1_ps(-0.0f);
+        __m128 r[4], sq[4], len2, mask, scale;
+        int bits, i;
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            for (i = 0; i < 4; i++) {
+                r[i] = _mm_loadu_ps(in[k + (size_t) i].q);
+                sq[i] = _mm_mul_ps(r[i], r[i]);
+            }
+            _MM_TRANSPOSE4_PS(sq[0], sq[1], sq[2], sq[3]);
+            len2 = _mm_add_ps(_mm_add_ps(sq[0], sq[1]), _mm_add_ps(sq[2], sq[3]));
+
+            mask = _mm_cmpnle_ps(_mm_andnot_ps(sign, _mm_sub_ps(len2, one)), eps);
+            bits = _mm_movemask_ps(mask);
+            if (bits == 0) {
+                continue;
+            }
+
+            scale = _mm_or_ps(_mm_and_ps(mask, simd_rsqrt4_ps(len2)), _mm_andnot_ps(mask, one));
+            _mm_storeu_ps(out[k].q,     _mm_mul_ps(r[0], _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(0, 0, 0, 0))));
+            _mm_storeu_ps(out[k + 1].q, _mm_mul_ps(r[1], _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(1, 1, 1, 1))));
+            _mm_storeu_ps(out[k + 2].q, _mm_mul_ps(r[2], _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(2, 2, 2, 2))));
+            _mm_storeu_ps(out[k + 3].q, _mm_mul_ps(r[3], _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(3, 3, 3, 3))));
+            changed += (size_t) simd_mask_count(bits);
+        }
+    }
+#endif
+
+    for (; k < count; k++) {
+        if (fabs( quatf_len_squared(in[k]) - 1 ) <= epsilon) {
+            out[k] = in[k];
+            continue;
+        }
+        out[k] = quatf_norm_fast(in[k]);
+        changed++;
+    }
+
+    return changed;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quatf_norm_array)(const Quaternionf * in, Quaternionf * out, size_t count)
+{
+    quatf_renorm_kernel(in, out, count, -1);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+size_t SIMD_FN(quatf_renorm_array)(Quaternionf * q, size_t count, float epsilon)
+{
+    return quatf_renorm_kernel(q, q, count, epsilon);
 }
 
 
 
 //==========================================================================================================================================
+// Batch exponential map. The vector kernels evaluate the Taylor branches of quat_exp and quat_log on 4 lanes. Outside
+// them quat_exp_array takes the vectorised sine and cosine, the other two hand the group back to the scalar functions.
+#if defined SIMD_HAVE_AVX2
+//------------------------------------------------------------------------------------------------------------------------------------------
+// cos n and sin n / n of the lanes of s = n^2, as in quat_exp
+static inline void quat_exp_taylor_avx2(__m256d s, __m256d * c, __m256d * k)
+{
+    __m256d one = _mm256_set1_pd(1);
+    __m256d p;
+
+    p = _mm256_fnmadd_pd(s, _mm256_set1_pd(1.0/56), one);
+    p = _mm256_fnmadd_pd(_mm256_mul_pd(s, _mm256_set1_pd(1.0/30)), p, one);
+    p = _mm256_fnmadd_pd(_mm256_mul_pd(s, _mm256_set1_pd(1.0/12)), p, one);
+    *c = _mm256_fnmadd_pd(_mm256_mul_pd(s, _mm256_set1_pd(0.5)), p, one);
+
+    p = _mm256_fnmadd_pd(s, _mm256_set1_pd(1.0/72), one);
+    p = _mm256_fnmadd_pd(_mm256_mul_pd(s, _mm256_set1_pd(1.0/42)), p, one);
+    p = _mm256_fnmadd_pd(_mm256_mul_pd(s, _mm256_set1_pd(1.0/20)), p, one);
+    *k = _mm256_fnmadd_pd(_mm256_mul_pd(s, _mm256_set1_pd(1.0/6)), p, one);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// atan2(n, w) / n of the lanes of unit quaternions (w, x, y, z), as in quat_log.
+// @ret movemask of the lanes inside the Taylor branch
+static inline int quat_log_taylor_avx2(__m256d w, __m256d x, __m256d y, __m256d z, __m256d * k)
+{
+    __m256d inv_w = _mm256_div_pd(_mm256_set1_pd(1), w);
+    __m256d s = _mm256_fmadd_pd(z, z, _mm256_fmadd_pd(y, y, _mm256_mul_pd(x, x)));
+    __m256d t = _mm256_mul_pd(s, _mm256_mul_pd(inv_w, inv_w));
+    __m256d p, inside;
+
+    inside = _mm256_and_pd(_mm256_cmp_pd(w, _mm256_setzero_pd(), _CMP_GT_OQ),
+                           _mm256_cmp_pd(t, _mm256_set1_pd(QUAT_EXP_TAYLOR_THRESHOLD), _CMP_LT_OQ));
+
+    p = _mm256_fnmadd_pd(t, _mm256_set1_pd(1.0/9), _mm256_set1_pd(1.0/7));
+    p = _mm256_fnmadd_pd(t, p, _mm256_set1_pd(1.0/5));
+    p = _mm256_fnmadd_pd(t, p, _mm256_set1_pd(1.0/3));
+    p = _mm256_fnmadd_pd(t, p, _mm256_set1_pd(1));
+    *k = _mm256_mul_pd(p, inv_w);
+
+    return _mm256_movemask_pd(inside);
+}
+
 //------------------------------------------------------------------------------------------------------------------------------------------
-bool quat_equal(Quaternion a, Quaternion b)
+// Loads quaternions [q] .. [q + 3], one per lane
+static inline void quat_load4_avx2(const Quaternion * q, __m256d * r)
 {
-    for(i = 0; i < 4; i++) {
-        if ( fabs(a.q[i] - b.q[i]) > FLT_EPSILON)
-            return false;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        r[i] = _mm256_loadu_pd(q[i].q);
     }
+    simd_transpose4( &r[0], &r[1], &r[2], &r[3] );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Inverse of quat_load4_avx2, [r] is overwritten
+static inline void quat_store4_avx2(Quaternion * q, __m256d * r)
+{
+    int i;
 
-    return true;
+    simd_transpose4( &r[0], &r[1], &r[2], &r[3] );
+    for (i = 0; i < 4; i++) {
+        _mm256_storeu_pd(q[i].q, r[i]);
+    }
 }
+#endif
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-double quat_dot(Quaternion a, Quaternion b)
+void SIMD_FN(quat_exp_array)(const Vector3 * in, Quaternion * out, size_t count)
 {
-    double dp = 0.0;
-    for(i = 0; i < 4; i++) {
-        dp += a.q[i] * b.q[i];
+    size_t k = 0, j;
+
+#if defined SIMD_HAVE_AVX2
+    {
+        __m256d x, y, z, s, n, sn, c, f, tc, tf, small, r[4];
+        int inside;
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            simd_load_xyz4( in[k].v, &x, &y, &z );
+            s = _mm256_fmadd_pd(z, z, _mm256_fmadd_pd(y, y, _mm256_mul_pd(x, x)));
+            small = _mm256_cmp_pd(s, _mm256_set1_pd(QUAT_EXP_TAYLOR_THRESHOLD), _CMP_LT_OQ);
+            inside = _mm256_movemask_pd(small);
+
+            if (inside == 0xF) {
+                quat_exp_taylor_avx2( s, &c, &f );
+            } else {
+                n = _mm256_sqrt_pd(s);
+                if (_mm256_movemask_pd(_mm256_cmp_pd(n, _mm256_set1_pd(SIMD_SINCOS_MAX), _CMP_LE_OQ)) != 0xF) {
+                    for (j = k; j < k + 4; j++) {
+                        out[j] = quat_exp_vec3(in[j]);
+                    }
+                    continue;
+                }
+                simd_sincos4_pd( n, 0, &sn, &c );
+                f = _mm256_div_pd(sn, n);
+                if (inside != 0) {                                  // small lanes, which may have n = 0
+                    quat_exp_taylor_avx2( s, &tc, &tf );
+                    c = _mm256_blendv_pd(c, tc, small);
+                    f = _mm256_blendv_pd(f, tf, small);
+                }
+            }
+
+            r[0] = c;
+            r[1] = _mm256_mul_pd(f, x);
+            r[2] = _mm256_mul_pd(f, y);
+            r[3] = _mm256_mul_pd(f, z);
+            quat_store4_avx2( out + k, r );
+        }
     }
+#endif
 
-    return dp;
+    for (j = k; j < count; j++) {
+        out[j] = quat_exp_vec3(in[j]);
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-// Alternative quat comparison function. quat_equal is probably faster in most cases.
-bool quat_matching(Quaternion a, Quaternion b)
+void SIMD_FN(quat_log_array)(const Quaternion * in, Vector3 * out, size_t count)
 {
-    return fabs( quat_dot(a, b) ) < FLT_EPSILON;
+    size_t k = 0, j;
+
+#if defined SIMD_HAVE_AVX2
+    {
+        __m256d r[4], f;
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            quat_load4_avx2( in + k, r );
+            if (quat_log_taylor_avx2(r[0], r[1], r[2], r[3], &f) != 0xF) {
+                for (j = k; j < k + 4; j++) {
+                    out[j] = quat_log_vec3(in[j]);
+                }
+                continue;
+            }
+
+            simd_store_xyz4( out[k].v, _mm256_mul_pd(f, r[1]), _mm256_mul_pd(f, r[2]), _mm256_mul_pd(f, r[3]) );
+        }
+    }
+#endif
+
+    for (j = k; j < count; j++) {
+        out[j] = quat_log_vec3(in[j]);
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-Quaternion quat_mul(Quaternion a, Quaternion b)
+void SIMD_FN(quat_pow_array)(const Quaternion * in, const double * t, Quaternion * out, size_t count)
 {
-    Quaternion r;
+    size_t k = 0, j;
+
+#if defined SIMD_HAVE_AVX2
+    {
+        __m256d r[4], f, s, c;
+        int inside;
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            quat_load4_avx2( in + k, r );
+            inside = quat_log_taylor_avx2( r[0], r[1], r[2], r[3], &f );
+
+            // t log(q), then its exponential
+            f = _mm256_mul_pd(f, _mm256_loadu_pd(t + k));
+            r[1] = _mm256_mul_pd(f, r[1]);
+            r[2] = _mm256_mul_pd(f, r[2]);
+            r[3] = _mm256_mul_pd(f, r[3]);
+            s = _mm256_fmadd_pd(r[3], r[3], _mm256_fmadd_pd(r[2], r[2], _mm256_mul_pd(r[1], r[1])));
+            inside &= _mm256_movemask_pd(_mm256_cmp_pd(s, _mm256_set1_pd(QUAT_EXP_TAYLOR_THRESHOLD), _CMP_LT_OQ));
+            if (inside != 0xF) {
+                for (j = k; j < k + 4; j++) {
+                    out[j] = quat_pow(in[j], t[j]);
+                }
+                continue;
+            }
+
+            quat_exp_taylor_avx2( s, &c, &f );
+            r[0] = c;
+            r[1] = _mm256_mul_pd(f, r[1]);
+            r[2] = _mm256_mul_pd(f, r[2]);
+            r[3] = _mm256_mul_pd(f, r[3]);
+            quat_store4_avx2( out + k, r );
+        }
+    }
+#endif
 
-    r.w = a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z;
-    r.x = a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y;
-    r.y = a.w*b.y - a.x*b.z + a.y*b.w + a.z*b.x;
-    r.z = a.w*b.z + a.x*b.y - a.y*b.x + a.z*b.w;
+    for (j = k; j < count; j++) {
+        out[j] = quat_pow(in[j], t[j]);
+    }
+}
 
-    return r;
+
+
+//==========================================================================================================================================
+// Batch constructors on the vectorised sine and cosine of simd.h. A group with an angle beyond SIMD_SINCOS_MAX is
+// handed to the scalar constructor.
+//------------------------------------------------------------------------------------------------------------------------------------------
+#if defined SIMD_HAVE_AVX2
+// @ret true if every lane of [x] is within the range of simd_sincos4_pd
+static inline bool quat_sincos_range_avx2(__m256d x)
+{
+    __m256d a = _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);
+    return _mm256_movemask_pd(_mm256_cmp_pd(a, _mm256_set1_pd(SIMD_SINCOS_MAX), _CMP_LE_OQ)) == 0xF;
+}
+#endif
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quat_from_euler_angles_array)(QuatSincosAccuracy accuracy, const Vector3 * angles,
+                                            Quaternion * out, size_t count)
+{
+    size_t k = 0, j;
+
+#if defined SIMD_HAVE_AVX2
+    {
+        int fast = (accuracy == QUAT_SINCOS_FAST);
+        __m256d half = _mm256_set1_pd(0.5);
+        __m256d ax, ay, az, sx, cx, sy, cy, sz, cz, cc, ss, sc, cs, r[4];
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            simd_load_xyz4( angles[k].v, &ax, &ay, &az );
+            ax = _mm256_mul_pd(ax, half);
+            ay = _mm256_mul_pd(ay, half);
+            az = _mm256_mul_pd(az, half);
+            if (!quat_sincos_range_avx2(ax) || !quat_sincos_range_avx2(ay) || !quat_sincos_range_avx2(az)) {
+                for (j = k; j < k + 4; j++) {
+                    out[j] = quat_from_euler_angles(angles[j].x, angles[j].y, angles[j].z);
+                }
+                continue;
+            }
+
+            simd_sincos4_pd( ax, fast, &sx, &cx );
+            simd_sincos4_pd( ay, fast, &sy, &cy );
+            simd_sincos4_pd( az, fast, &sz, &cz );
+
+            // as in quat_from_euler_angles
+            cc = _mm256_mul_pd(cy, cz);
+            ss = _mm256_mul_pd(sy, sz);
+            sc = _mm256_mul_pd(sy, cz);
+            cs = _mm256_mul_pd(cy, sz);
+            r[0] = _mm256_fmsub_pd(cc, cx, _mm256_mul_pd(ss, sx));
+            r[1] = _mm256_fmadd_pd(ss, cx, _mm256_mul_pd(cc, sx));
+            r[2] = _mm256_fmadd_pd(sc, cx, _mm256_mul_pd(cs, sx));
+            r[3] = _mm256_fmsub_pd(cs, cx, _mm256_mul_pd(sc, sx));
+            quat_store4_avx2( out + k, r );
+        }
+    }
+#else
+    (void) accuracy;
+#endif
+
+    for (j = k; j < count; j++) {
+        out[j] = quat_from_euler_angles(angles[j].x, angles[j].y, angles[j].z);
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-Vector3 quat_rotate_vec3(Quaternion q, Vector3 v)
+void SIMD_FN(quat_from_angle_axis_array)(QuatSincosAccuracy accuracy, const double * angles, const Vector3 * axes,
+                                         Quaternion * out, size_t count)
 {
-    Vector3 r;
+    size_t k = 0, j;
+
+#if defined SIMD_HAVE_AVX2
+    {
+        int fast = (accuracy == QUAT_SINCOS_FAST);
+        __m256d a, x, y, z, s, f, r[4];
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            a = _mm256_mul_pd(_mm256_loadu_pd(angles + k), _mm256_set1_pd(0.5));
+            if (!quat_sincos_range_avx2(a)) {
+                for (j = k; j < k + 4; j++) {
+                    out[j] = quat_from_angle_axis(angles[j], axes[j]);
+                }
+                continue;
+            }
+
+            simd_load_xyz4( axes[k].v, &x, &y, &z );
+            simd_sincos4_pd( a, fast, &s, &r[0] );
+            f = _mm256_div_pd(s, _mm256_sqrt_pd(_mm256_fmadd_pd(z, z, _mm256_fmadd_pd(y, y, _mm256_mul_pd(x, x)))));
+            r[1] = _mm256_mul_pd(f, x);
+            r[2] = _mm256_mul_pd(f, y);
+            r[3] = _mm256_mul_pd(f, z);
+            quat_store4_avx2( out + k, r );
+        }
+    }
+#else
+    (void) accuracy;
+#endif
 
-    double vx = v.x, vy = v.y, vz = v.z;
-    double w = q.w, x = q.x, y = q.y, z = q.z;
+    for (j = k; j < count; j++) {
+        out[j] = quat_from_angle_axis(angles[j], axes[j]);
+    }
+}
 
-    double ww = w*w;
-    double xx = x*x;
-    double yy = y*y;
-    double zz = z*z;
-    double wx = w*x;
-    double wy = w*y;
-    double wz = w*z;
-    double xy = x*y;
-    double xz = x*z;
-    double yz = y*z;
+#endif      // SIMD_KERNELS
 
-    r.x = ww*vx + xx*vx - yy*vx - zz*vx + 2*((xy-wz)*vy + (xz+wy)*vz);
-    r.y = ww*vy - xx*vy + yy*vy - zz*vy + 2*((xy+wz)*vx + (yz-wx)*vz);
-    r.z = ww*vz - xx*vz - yy*vz + zz*vz + 2*((xz-wy)*vx + (yz+wx)*vy);
 
-    return r;
+
+#if ! defined SIMD_KERNEL_BUILD
+//==========================================================================================================================================
+// Multi-threaded batch operations. Each chunk is an independent call of the single threaded kernel.
+//------------------------------------------------------------------------------------------------------------------------------------------
+typedef struct quat_rotate_job {
+    Quaternion q;
+    Quaternionf qf;
+    const void * x;
+    const void * y;
+    const void * z;
+    void * out_x;
+    void * out_y;
+    void * out_z;
+} QuatRotateJob;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void quat_rotate_array_task(void * context, size_t begin, size_t end)
+{
+    QuatRotateJob * job = context;
+    quat_rotate_vec3_array( job->q, (const Vector3 *) job->x + begin, (Vector3 *) job->out_x + begin, end - begin );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void quat_rotate_soa_task(void * context, size_t begin, size_t end)
+{
+    QuatRotateJob * job = context;
+    quat_rotate_vec3_soa( job->q,
+                          (const double *) job->x + begin, (const double *) job->y + begin, (const double *) job->z + begin,
+                          (double *) job->out_x + begin, (double *) job->out_y + begin, (double *) job->out_z + begin,
+                          end - begin );
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void quatf_rotate_array_task(void * context, size_t begin, size_t end)
+{
+    QuatRotateJob * job = context;
+    quatf_rotate_vec3_array( job->qf, (const Vector3f *) job->x + begin, (Vector3f *) job->out_x + begin, end - begin );
+}
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-// @param [buffer] pointer to array of at least 16 doubles in which the matrix will be stored
-void quat_to_matrix44(Quaternion q, double * buffer)
+static void quatf_rotate_soa_task(void * context, size_t begin, size_t end)
+{
+    QuatRotateJob * job = context;
+    quatf_rotate_vec3_soa( job->qf,
+                           (const float *) job->x + begin, (const float *) job->y + begin, (const float *) job->z + begin,
+                           (float *) job->out_x + begin, (float *) job->out_y + begin, (float *) job->out_z + begin,
+                           end - begin );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void quat_rotate_vec3_array_parallel(Quaternion q, const Vector3 * in, Vector3 * out, size_t count)
+{
+    QuatRotateJob job = {0};
+
+    job.q = q;
+    job.x = in;
+    job.out_x = out;
+    parallel_for( count, QUAT_PARALLEL_GRAIN, quat_rotate_array_task, &job );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void quat_rotate_vec3_soa_parallel(Quaternion q,
+                                   const double * x, const double * y, const double * z,
+                                   double * out_x, double * out_y, double * out_z,
+                                   size_t count)
+{
+    QuatRotateJob job = {q, {{0}}, x, y, z, out_x, out_y, out_z};
+    parallel_for( count, QUAT_PARALLEL_GRAIN, quat_rotate_soa_task, &job );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void quatf_rotate_vec3_array_parallel(Quaternionf q, const Vector3f * in, Vector3f * out, size_t count)
 {
-    double xx = 2.0*q.x*q.x;
-    double yy = 2.0*q.y*q.y;
-    double zz = 2.0*q.z*q.z;
-    double xy = 2.0*q.x*q.y;
-    double zw = 2.0*q.z*q.w;
-    double xz = 2.0*q.x*q.z;
-    double yw = 2.0*q.y*q.w;
-    double yz = 2.0*q.y*q.z;
-    double xw = 2.0*q.x*q.w;
+    QuatRotateJob job = {0};
 
-    double mat44[16] = {1.0-yy-zz, xy+zw, xz-yw, 0.0,
-                        xy-zw, 1.0-xx-zz, yz+xw, 0.0,
-                        xz+yw, yz-xw, 1.0-xx-yy, 0.0,
-                        0.0,   0.0,   0.0,       1.0};
+    job.qf = q;
+    job.x = in;
+    job.out_x = out;
+    parallel_for( count, QUAT_PARALLEL_GRAIN, quatf_rotate_array_task, &job );
+}
 
-    memcpy( buffer, mat44, sizeof(double) * 16);
+//------------------------------------------------------------------------------------------------------------------------------------------
+void quatf_rotate_vec3_soa_parallel(Quaternionf q,
+                                    const float * x, const float * y, const float * z,
+                                    float * out_x, float * out_y, float * out_z,
+                                    size_t count)
+{
+    QuatRotateJob job = {{{0}}, q, x, y, z, out_x, out_y, out_z};
+    parallel_for( count, QUAT_PARALLEL_GRAIN, quatf_rotate_soa_task, &job );
 }
 
 
@@ -279,10 +1525,13 @@ void quat_to_matrix44(Quaternion q, double * buffer)
 
 
 
+#endif      // ! SIMD_KERNEL_BUILD
+
+
 
 //==========================================================================================================================================
 // Unit testing facilities
-#ifdef QUATERNION_UNITTEST
+#if defined QUATERNION_UNITTEST && ! defined SIMD_KERNEL_BUILD
 
 // You only need to include <glib-2.0/glib.h> for this to function.
 // BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
@@ -520,8 +1769,9 @@ void test_quat_rotate_vec3(void)
     Quaternion tq = quat_norm( testquat );
     Vector3 v = {-43.32332, 1.0, 32.0};
     Vector3 func = quat_rotate_vec3( tq, v );
+    int i;
 
-    for (i = 0; i < 16; i++) {
+    for (i = 0; i < 3; i++) {
         g_assert_cmpfloat( math.v[i], ==, func.v[i] );
     }
 }
@@ -538,6 +1788,8 @@ void test_quat_to_matrix44(void)
     };
 
     double func[16] = {0};
+    int i;
+
     quat_to_matrix44( testquat, func );
 
 
@@ -547,6 +1799,467 @@ void test_quat_to_matrix44(void)
 }
 
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_quat_slerp(void)
+{
+    Vector3 axis = vec3_from_values(0, 0, 1);
+    Quaternion a = quat_from_identity();
+    Quaternion b = quat_from_angle_axis( radian(90), axis );
+    Quaternion half = quat_from_angle_axis( radian(45), axis );
+    Quaternion quarter = quat_from_angle_axis( radian(22.5), axis );
+
+    g_assert_true(  quat_equal(quat_slerp(a, b, 0), a)  );
+    g_assert_true(  quat_equal(quat_slerp(a, b, 1), b)  );
+    g_assert_true(  quat_equal(quat_slerp(a, b, 0.5), half)  );
+    g_assert_true(  quat_equal(quat_slerp(a, b, 0.25), quarter)  );
+    g_assert_true(  quat_equal(quat_slerp(a, quat_negate(b), 0.25), quarter)  );      // shorter arc
+    g_assert_true(  quat_equal(quat_slerp(a, a, 0.3), a)  );
+
+    g_assert_true(  quat_equal(quat_nlerp(a, b, 0.5), half)  );
+    g_assert_false( quat_equal(quat_nlerp(a, b, 0.25), quarter)  );
+    g_assert_true(  quat_equal(quat_nlerp(a, quat_negate(b), 0.5), half)  );
+
+    g_assert_true(  quat_equal(quat_slerp_fast(a, b, 0.25), quarter)  );
+    g_assert_true(  quat_equal(quat_slerp_fast(a, quat_negate(b), 0.25), quarter)  );
+    g_assert_cmpfloat_with_epsilon( quat_slerp_fast(a, quat_from_angle_axis(radian(170), axis), 0.5).z,
+                                    sin(radian(42.5)), 3e-5 );
+
+    // Close enough inputs go to nlerp only where it agrees with slerp to the rounding error
+    b = quat_from_angle_axis( 2e-4, axis );
+    g_assert_cmpfloat_with_epsilon( quat_slerp(a, b, 0.25).z, sin(2.5e-5), 1e-16 );
+    b = quat_from_angle_axis( 2e-5, axis );
+    g_assert_cmpfloat_with_epsilon( quat_slerp(a, b, 0.25).z, sin(2.5e-6), 1e-16 );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// log and exp are inverse, pow scales the angle, and the Taylor branches agree with the libm ones across the threshold.
+void test_quat_exp_log(void)
+{
+    Vector3 axis = vec3_norm( vec3_from_values(1, -2, 0.5) );
+    Quaternion q = quat_from_angle_axis( radian(100), axis );
+    Quaternion l = quat_log( q ), g = quat_from_values( 0.3, -1.2, 0.4, 2.0 );
+    double a;
+    int i;
+
+    g_assert_cmpfloat_with_epsilon( l.w, 0, 1e-15 );
+    for (i = 0; i < 3; i++) {
+        g_assert_cmpfloat_with_epsilon( l.q[i + 1], radian(50) * axis.v[i], 1e-15 );
+    }
+    g_assert_true(  quat_equal(quat_exp(l), q)  );
+    g_assert_true(  quat_equal(quat_exp(quat_log(g)), g)  );
+    g_assert_cmpfloat_with_epsilon( quat_log(g).w, log(quat_len(g)), 1e-15 );
+
+    g_assert_true(  quat_equal(quat_pow(q, 0.3), quat_from_angle_axis(radian(30), axis))  );
+    g_assert_true(  quat_equal(quat_pow(q, -1), quat_conjugate(q))  );
+    g_assert_true(  quat_equal(quat_pow(q, 0), quat_from_identity())  );
+    g_assert_true(  quat_equal(quat_log(quat_from_values(-1, 0, 0, 0)), quat_from_values(0, 0, 0, 0))  );
+
+    for (a = 1e-6; a < 1; a *= 1.5) {
+        q = quat_from_angle_axis( a, axis );
+        l = quat_log( q );
+        for (i = 0; i < 3; i++) {
+            g_assert_cmpfloat_with_epsilon( l.q[i + 1], a / 2 * axis.v[i], 1e-16 );
+        }
+        g_assert_cmpfloat_with_epsilon( quat_exp(l).w, cos(a / 2), 2e-16 );
+        g_assert_cmpfloat_with_epsilon( quat_exp(l).x, sin(a / 2) * axis.x, 2e-16 );
+    }
+
+    g_assert_true(  quatf_equal(quatf_pow(quatf_from_quat(g), 0.5f), quatf_from_quat(quat_pow(g, 0.5)))  );
+}
+
+// Axes of each QuatEulerOrder, in the order the rotations are applied
+static const int quat_euler_axes[6][3] = QUAT_EULER_AXES;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Rotation of the Euler angles [angles] (by axis) in [order], composed from single axis rotations
+static Quaternion compose_euler(Vector3 angles, QuatEulerOrder order)
+{
+    Vector3 axes[3] = {{{1, 0, 0}}, {{0, 1, 0}}, {{0, 0, 1}}};
+    Quaternion q = quat_from_identity();
+    int n, a;
+
+    for (n = 0; n < 3; n++) {
+        a = quat_euler_axes[order][n];
+        q = quat_mul( quat_from_angle_axis(angles.v[a], axes[a]), q );
+    }
+    return q;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Every order recovers its angles. At the gimbal lock the last angle is 0, and at and next to it the angles rebuild
+// the same rotation; the angles alone are ill-conditioned there. The single precision twin agrees within float precision.
+void test_quat_to_euler_angles(void)
+{
+    // first, middle and last angle of each order
+    Vector3 angles[5] = {{{0.3, -0.7, 1.1}}, {{-2.9, 1.2, 3.0}}, {{0, 0, 0}}, {{0.4, 1.5707963267948966, -0.9}},
+                         {{-1.3, -1.5707963, 2.2}}};
+    Quaternion q[5];
+    Vector3 in, out, batch[5];
+    Vector3f outf;
+    int o, n, i;
+
+    for (o = QUAT_EULER_XYZ; o <= QUAT_EULER_ZYX; o++) {
+        for (n = 0; n < 5; n++) {
+            for (i = 0; i < 3; i++) {
+                in.v[quat_euler_axes[o][i]] = angles[n].v[i];
+            }
+            q[n] = compose_euler( in, (QuatEulerOrder) o );
+            out = quat_to_euler_angles( q[n], (QuatEulerOrder) o );
+            if (n < 3) {
+                for (i = 0; i < 3; i++) {
+                    g_assert_cmpfloat_with_epsilon( out.v[i], in.v[i], 1e-12 );
+                }
+            } else if (n == 3) {
+                g_assert_cmpfloat( out.v[quat_euler_axes[o][2]], ==, 0 );
+            }
+            g_assert_cmpfloat( 1 - fabs(quat_dot(compose_euler(out, (QuatEulerOrder) o), q[n])), <, 1e-15 );
+
+            outf = quatf_to_euler_angles( quatf_from_quat(q[n]), (QuatEulerOrder) o );
+            if (n < 3) {
+                for (i = 0; i < 3; i++) {
+                    g_assert_cmpfloat_with_epsilon( outf.v[i], in.v[i], 1e-5 );
+                }
+            } else if (n == 3) {
+                g_assert_cmpfloat( outf.v[quat_euler_axes[o][2]], ==, 0 );
+            }
+            out = vec3_from_vec3f( outf );
+            g_assert_cmpfloat( 1 - fabs(quat_dot(compose_euler(out, (QuatEulerOrder) o), q[n])), <, 1e-6 );
+        }
+
+        quat_to_euler_angles_array( (QuatEulerOrder) o, q, batch, 5 );
+        for (n = 0; n < 5; n++) {
+            g_assert_true(  vec3_equal(batch[n], quat_to_euler_angles(q[n], (QuatEulerOrder) o))  );
+        }
+    }
+
+    out = quat_to_euler_angles( quat_from_euler_angles(0.3, -0.7, 1.1), QUAT_EULER_XZY );
+    g_assert_true(  vec3_equal(out, vec3_from_values(0.3, -0.7, 1.1))  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_quat_interpolate_array(void)
+{
+    QuatInterpolation methods[3] = {QUAT_NLERP, QUAT_SLERP, QUAT_SLERP_FAST};
+    Quaternion a[11], b[11], out[11], c[11];
+    double t[11];
+    int i, m;
+
+    for (i = 0; i < 11; i++) {
+        a[i] = quat_from_euler_angles( 0.1*i, -0.2*i, 0.05*i );
+        b[i] = quat_from_euler_angles( 1.5 - 0.3*i, 0.25*i, -0.4*i );
+        if (i % 3 == 0) {
+            b[i] = quat_negate(b[i]);
+        }
+        t[i] = i / 10.0;
+    }
+
+    for (m = 0; m < 3; m++) {
+        quat_interpolate_array( methods[m], a, b, t, out, 11 );
+        for (i = 0; i < 11; i++) {
+            c[i] = a[i];
+            g_assert_true(  quat_equal(out[i], quat_interpolate_one(methods[m], a[i], b[i], t[i]))  );
+        }
+
+        quat_interpolate_array( methods[m], c, b, t, c, 11 );                          // in place
+        for (i = 0; i < 11; i++) {
+            g_assert_true(  quat_equal(c[i], out[i])  );
+        }
+
+        quat_interpolate_samples( methods[m], a[2], b[7], t, out, 11 );
+        for (i = 0; i < 11; i++) {
+            g_assert_true(  quat_equal(out[i], quat_interpolate_one(methods[m], a[2], b[7], t[i]))  );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Largest component difference of [a] and [b]
+static double quat_max_diff(Quaternion a, Quaternion b)
+{
+    double d = 0;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        d = fmax( d, fabs(a.q[i] - b.q[i]) );
+    }
+    return d;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Groups of small angles take the vector Taylor kernels, the groups holding a large angle or a w <= 0 the scalar functions,
+// and the odd count the scalar tail.
+void test_quat_exp_array(void)
+{
+    enum { count = 23 };
+    Vector3 v[count], l[count];
+    Quaternion q[count], out[count];
+    double t[count];
+    int i;
+
+    for (i = 0; i < count; i++) {
+        v[i] = vec3_scalar_mul( vec3_from_values(1.0 - 0.1*i, 0.5, -0.03*i), (i < 12) ? 1e-3 * i : 0.15 * i );
+        t[i] = 1.5 - 0.2*i;
+    }
+    v[13] = vec3_scalar_mul( v[13], -30.0 );
+    v[9] = vec3_from_values( 2, 0, 1 );
+
+    quat_exp_array( v, q, count );
+    quat_log_array( q, l, count );
+    for (i = 0; i < count; i++) {
+        g_assert_cmpfloat( quat_max_diff(q[i], quat_exp(quat_from_values(0, v[i].x, v[i].y, v[i].z))), <, 1e-15 );
+        g_assert_cmpfloat( vec3_len(vec3_from_points(l[i], quat_log_vec3(q[i]))), <, 1e-15 );
+    }
+
+    quat_pow_array( q, t, out, count );
+    for (i = 0; i < count; i++) {
+        g_assert_cmpfloat( quat_max_diff(out[i], quat_pow(q[i], t[i])), <, 1e-15 );
+    }
+    quat_pow_array( q, t, q, count );                                               // in place
+    g_assert_true(  memcmp(q, out, sizeof(q)) == 0  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Both accuracies against the scalar constructors. The third group holds an angle beyond the range of the vector
+// sine and cosine, and the odd count leaves a scalar tail.
+void test_quat_from_array(void)
+{
+    const QuatSincosAccuracy accuracy[2] = {QUAT_SINCOS_ACCURATE, QUAT_SINCOS_FAST};
+    const double tolerance[2] = {1e-15, 3e-8};
+    enum { count = 15 };
+    Vector3 euler[count], axes[count];
+    Quaternion out[count];
+    double angles[count];
+    int i, m;
+
+    for (i = 0; i < count; i++) {
+        euler[i] = vec3_from_values( 0.7*i - 3.0, 1.3 - 11.0*i, 100.0 * i );
+        axes[i] = vec3_from_values( 1.0 - 0.2*i, 0.5, 2.0 + i );
+        angles[i] = -20.0 + 3.7*i;
+    }
+    euler[9].y = 3e6;
+    angles[10] = -5e6;
+
+    for (m = 0; m < 2; m++) {
+        quat_from_euler_angles_array( accuracy[m], euler, out, count );
+        for (i = 0; i < count; i++) {
+            g_assert_cmpfloat( quat_max_diff(out[i], quat_from_euler_angles(euler[i].x, euler[i].y, euler[i].z)), <,
+                               tolerance[m] );
+        }
+
+        quat_from_angle_axis_array( accuracy[m], angles, axes, out, count );
+        for (i = 0; i < count; i++) {
+            g_assert_cmpfloat( quat_max_diff(out[i], quat_from_angle_axis(angles[i], axes[i])), <, tolerance[m] );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Odd count so that both the vector kernel and the scalar tail are exercised. Every third quaternion is already unit
+// length and must come back bit for bit from renorm_array.
+void test_quat_norm_array(void)
+{
+    Quaternion in[11], out[11];
+    Quaternionf inf[11], outf[11], unit[11];
+    size_t changed;
+    int i, j;
+
+    for (i = 0; i < 11; i++) {
+        in[i] = quat_from_values( 0.5 + 0.1*i, -3.0 + i, 1e-3 * i, 12.0 - 2*i );
+        if (i % 3 == 0) {
+            in[i] = quat_norm( in[i] );
+        }
+        inf[i] = quatf_from_quat( in[i] );
+        unit[i] = inf[i];
+    }
+
+    quat_norm_array( in, out, 11 );
+    quatf_norm_array( inf, outf, 11 );
+    for (i = 0; i < 11; i++) {
+        g_assert_true(  quat_equal(out[i], quat_norm(in[i]))  );
+        g_assert_cmpfloat( fabs(quat_len(out[i]) - 1), <, 1e-15 );
+        for (j = 0; j < 4; j++) {
+            g_assert_cmpfloat( fabsf(outf[i].q[j] - quatf_norm(inf[i]).q[j]), <, 4e-7f );      // one Newton step in float
+        }
+    }
+
+    g_assert_true(  quat_equal(quat_norm_fast(testquat), quat_norm(testquat))  );
+    g_assert_true(  quat_equal(quat_renorm(out[1], 1e-12), out[1])  );
+    g_assert_true(  quat_equal(quat_renorm(in[1], 1e-12), out[1])  );
+
+    changed = quat_renorm_array( in, 11, 1e-12 );
+    g_assert_cmpuint( changed, ==, 7 );
+    changed = quatf_renorm_array( inf, 11, 1e-6f );
+    g_assert_cmpuint( changed, ==, 7 );
+    for (i = 0; i < 11; i++) {
+        g_assert_true(  quat_equal(in[i], out[i])  );
+        g_assert_true(  memcmp(&inf[i], (i % 3 == 0) ? &unit[i] : &outf[i], sizeof(Quaternionf)) == 0  );
+    }
+    g_assert_cmpuint( quat_renorm_array(in, 11, 1e-12), ==, 0 );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Odd count so that both the vector kernel and the scalar tail are exercised.
+void test_quat_rotate_vec3_array(void)
+{
+    Quaternion tq = quat_norm( testquat );
+    Vector3 in[7], out[7];
+    int i;
+
+    for (i = 0; i < 7; i++) {
+        in[i] = vec3_from_values( -43.32332 + i, 1.0 - 3.5*i, 32.0 * i );
+    }
+
+    quat_rotate_vec3_array( tq, in, out, 7 );
+    for (i = 0; i < 7; i++) {
+        g_assert_true(  vec3_equal(quat_rotate_vec3(tq, in[i]), out[i])  );
+    }
+
+    // in place
+    quat_rotate_vec3_array( tq, in, in, 7 );
+    for (i = 0; i < 7; i++) {
+        g_assert_true(  vec3_equal(out[i], in[i])  );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_quat_rotate_vec3_soa(void)
+{
+    Quaternion tq = quat_norm( testquat );
+    double x[7], y[7], z[7];
+    double ox[7], oy[7], oz[7];
+    Vector3 math;
+    int i;
+
+    for (i = 0; i < 7; i++) {
+        x[i] = -43.32332 + i;
+        y[i] = 1.0 - 3.5*i;
+        z[i] = 32.0 * i;
+    }
+
+    quat_rotate_vec3_soa( tq, x, y, z, ox, oy, oz, 7 );
+    for (i = 0; i < 7; i++) {
+        math = quat_rotate_vec3( tq, vec3_from_values(x[i], y[i], z[i]) );
+        g_assert_true(  vec3_equal(math, vec3_from_values(ox[i], oy[i], oz[i]))  );
+    }
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The single precision twins come from the same source, so they only have to agree within float precision.
+void test_quatf_functions(void)
+{
+    Quaternion tq = quat_norm( testquat );
+    Quaternionf tqf = quatf_from_quat( tq );
+    Vector3 v = {-0.4332332, 0.01, 0.32};
+    Vector3f vf = vec3f_from_vec3( v );
+    Quaternion e = quat_from_euler_angles( radian(23.0), radian(-235.0), radian(390.0) );
+    Quaternionf ef = quatf_from_euler_angles( (float) radian(23.0), (float) radian(-235.0), (float) radian(390.0) );
+
+    g_assert_true(  quat_equal(e, quat_from_quatf(ef))  );
+    g_assert_true(  quatf_equal(quatf_from_quat(quat_mul(tq, e)), quatf_mul(tqf, ef))  );
+    g_assert_true(  vec3_equal(quat_rotate_vec3(e, v), vec3_from_vec3f(quatf_rotate_vec3(ef, vf)))  );
+    g_assert_true(  quatf_equal(quatf_from_quat(quat_inverse(e)), quatf_inverse(ef))  );
+    g_assert_cmpfloat( fabs(quatf_len(ef) - 1.0f), <, FLT_EPSILON );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Both precisions print the same, checked on the stdout of a subprocess.
+void test_quat_print(void)
+{
+    if (g_test_subprocess()) {
+        quat_print( quat_from_values(1.0, -2.5, 0.125, 0.0) );
+        quatf_print( quatf_from_values(1.0f, -2.5f, 0.125f, 0.0f) );
+        return;
+    }
+    g_test_trap_subprocess( NULL, 0, 0 );
+    g_test_trap_assert_passed();
+    g_test_trap_assert_stdout( "(1.000000, -2.500000, 0.125000, 0.000000)\n(1.000000, -2.500000, 0.125000, 0.000000)\n" );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// 11 points: one 8 wide AVX2 block, one 4 wide SSE block, and a scalar tail.
+void test_quatf_rotate_vec3_array(void)
+{
+    Quaternionf tq = quatf_from_quat( quat_norm(testquat) );
+    Vector3f in[11], out[11];
+    float x[11], y[11], z[11];
+    int i;
+
+    for (i = 0; i < 11; i++) {
+        in[i] = vec3f_from_values( -0.4f + 0.1f*(float) i, 1.0f - 0.35f*(float) i, 0.03f*(float) i );
+        x[i] = in[i].x;
+        y[i] = in[i].y;
+        z[i] = in[i].z;
+    }
+
+    quatf_rotate_vec3_array( tq, in, out, 11 );
+    quatf_rotate_vec3_soa( tq, x, y, z, x, y, z, 11 );
+    for (i = 0; i < 11; i++) {
+        g_assert_true(  vec3f_equal(quatf_rotate_vec3(tq, in[i]), out[i])  );
+        g_assert_true(  vec3f_equal(out[i], vec3f_from_values(x[i], y[i], z[i]))  );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_quatf_interpolate_array(void)
+{
+    QuatInterpolation methods[3] = {QUAT_NLERP, QUAT_SLERP, QUAT_SLERP_FAST};
+    Quaternionf a[7], b[7], out[7];
+    float t[7];
+    int i, m;
+
+    for (i = 0; i < 7; i++) {
+        a[i] = quatf_from_euler_angles( 0.1f*(float) i, -0.2f*(float) i, 0.05f );
+        b[i] = quatf_from_euler_angles( 1.5f - 0.3f*(float) i, 0.25f*(float) i, -0.4f );
+        t[i] = (float) i / 6;
+    }
+
+    for (m = 0; m < 3; m++) {
+        quatf_interpolate_array( methods[m], a, b, t, out, 7 );
+        for (i = 0; i < 7; i++) {
+            g_assert_true(  quatf_equal(out[i], quatf_interpolate_one(methods[m], a[i], b[i], t[i]))  );
+        }
+
+        quatf_interpolate_samples( methods[m], a[1], b[5], t, out, 7 );
+        for (i = 0; i < 7; i++) {
+            g_assert_true(  quatf_equal(out[i], quatf_interpolate_one(methods[m], a[1], b[5], t[i]))  );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Large enough to be split across the pool; every point must match the single threaded result.
+void test_quat_rotate_vec3_array_parallel(void)
+{
+    enum { count = 100003 };
+    Quaternion tq = quat_norm( testquat );
+    Vector3 * in = malloc( sizeof(Vector3) * count );
+    Vector3 * out = malloc( sizeof(Vector3) * count );
+    double * x = malloc( sizeof(double) * count );
+    int i;
+
+    for (i = 0; i < count; i++) {
+        in[i] = vec3_from_values( 0.001 * i, 1.0 - 0.5 * i, 32.0 );
+        x[i] = in[i].x;
+    }
+
+    quat_rotate_vec3_array_parallel( tq, in, out, count );
+    quat_rotate_vec3_array( tq, in, in, count );
+    for (i = 0; i < count; i++) {
+        g_assert_true(  vec3_equal(in[i], out[i])  );
+    }
+
+    // x stream used for all three coordinates, in place
+    quat_rotate_vec3_soa_parallel( tq, x, x, x, x, x, x, count );
+    for (i = 0; i < count; i++) {
+        g_assert_true(  fabs(x[i] - quat_rotate_vec3(tq, vec3_from_values(0.001*i, 0.001*i, 0.001*i)).z) < FLT_EPSILON  );
+    }
+
+    free( in );
+    free( out );
+    free( x );
+}
+
 
 void setuptests(void)
 {
@@ -573,6 +2286,24 @@ void setuptests(void)
     g_test_add_func("/set_quat/test_quat_equal", test_quat_equal);
     g_test_add_func("/set_quat/test_quat_dot", test_quat_dot);
     g_test_add_func("/set_quat/test_quat_matching", test_quat_matching);
+
+    // Batch operations
+    g_test_add_func("/set_quat/test_quat_slerp", test_quat_slerp);
+    g_test_add_func("/set_quat/test_quat_exp_log", test_quat_exp_log);
+    g_test_add_func("/set_quat/test_quat_to_euler_angles", test_quat_to_euler_angles);
+    g_test_add_func("/set_quat/test_quat_interpolate_array", test_quat_interpolate_array);
+    g_test_add_func("/set_quat/test_quat_exp_array", test_quat_exp_array);
+    g_test_add_func("/set_quat/test_quat_from_array", test_quat_from_array);
+    g_test_add_func("/set_quat/test_quat_norm_array", test_quat_norm_array);
+    g_test_add_func("/set_quat/test_quat_rotate_vec3_array", test_quat_rotate_vec3_array);
+    g_test_add_func("/set_quat/test_quat_rotate_vec3_soa", test_quat_rotate_vec3_soa);
+    g_test_add_func("/set_quat/test_quat_rotate_vec3_array_parallel", test_quat_rotate_vec3_array_parallel);
+
+    // Single precision twins
+    g_test_add_func("/set_quat/test_quatf_functions", test_quatf_functions);
+    g_test_add_func("/set_quat/test_quat_print", test_quat_print);
+    g_test_add_func("/set_quat/test_quatf_rotate_vec3_array", test_quatf_rotate_vec3_array);
+    g_test_add_func("/set_quat/test_quatf_interpolate_array", test_quatf_interpolate_array);
 }
 
 
@@ -8,6 +8,7 @@
 #define QUATERNION_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "vector3.h"
 
@@ -25,6 +26,62 @@ typedef union quaternion {
 } Quaternion;
 
 
+// Single precision counterpart of Quaternion, for buffers that do not need double precision.
+// Every quat_ function has a quatf_ twin generated from the same source (quaternion_impl.h).
+typedef union quaternionf {
+    float q[4];
+
+    struct
+    {
+        float w;
+        float x;
+        float y;
+        float z;
+    };
+} Quaternionf;
+
+
+// Orders of the Euler angles, naming the fixed (world) axes in the order the rotations are applied: QUAT_EULER_XYZ
+// rotates about x first, then y, then z, q = qz * qy * qx, which is also z, y', x'' about the rotating axes.
+// quat_from_euler_angles(x, y, z) is the QUAT_EULER_XZY rotation.
+typedef enum quat_euler_order {
+    QUAT_EULER_XYZ,
+    QUAT_EULER_XZY,
+    QUAT_EULER_YXZ,
+    QUAT_EULER_YZX,
+    QUAT_EULER_ZXY,
+    QUAT_EULER_ZYX
+} QuatEulerOrder;
+
+
+
+#if defined AGK_INLINE
+//==========================================================================================================================================
+// Header-only mode, see vector3.h. The single value quat_ / quatf_ functions become static inline definitions;
+// the batch functions below stay in quaternion.c.
+#include <math.h>
+#include <string.h>
+#include <float.h>
+
+#define QUAT_T              Quaternion
+#define QUAT_REAL           double
+#define QUAT_VEC3_T         Vector3
+#define QUAT_FN(name)       quat_##name
+#define QUAT_VEC3_FN(name)  vec3_##name
+#define QUAT_MATH(name)     name
+#define QUAT_API            static inline
+#include "quaternion_impl.h"
+
+#define QUAT_T              Quaternionf
+#define QUAT_REAL           float
+#define QUAT_VEC3_T         Vector3f
+#define QUAT_FN(name)       quatf_##name
+#define QUAT_VEC3_FN(name)  vec3f_##name
+#define QUAT_MATH(name)     name##f
+#define QUAT_API            static inline
+#include "quaternion_impl.h"
+
+#else
 //==========================================================================================================================================
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Returns (1.0, 0.0, 0.0, 0.0) quaternion
@@ -46,6 +103,13 @@ Quaternion quat_from_vec3(Vector3 a, Vector3 b);
 // @param all angles should be given in radians
 Quaternion quat_from_euler_angles(double anglex, double angley, double anglez);
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Angles in radians that rebuild the rotation of unit quaternion [q] in [order]. They are stored by axis, the angle
+// about x in .x whatever the order: the middle rotation in [-pi/2, pi/2], the other two in [-pi, pi].
+// At the gimbal lock (the middle angle at +-pi/2) only a sum or difference of the other two is defined; the last is 0.
+// Computed from the quaternion directly with atan2 only (Bernardes and Viollet, 2022), accurate near the lock as well.
+Vector3 quat_to_euler_angles(Quaternion q, QuatEulerOrder order);
+
 
 
 //==========================================================================================================================================
@@ -61,6 +125,15 @@ double quat_len(Quaternion q);
 //------------------------------------------------------------------------------------------------------------------------------------------
 Quaternion quat_norm(Quaternion q);
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Same result as quat_norm to within an ulp or two, with one division instead of four.
+Quaternion quat_norm_fast(Quaternion q);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Renormalises [q] only when it has drifted: returns [q] unchanged if |len_squared - 1| <= [epsilon], quat_norm_fast(q) otherwise.
+// Meant for orientations kept up to date by repeated multiplication or integration.
+Quaternion quat_renorm(Quaternion q, double epsilon);
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 Quaternion quat_negate(Quaternion q);
 
@@ -70,9 +143,6 @@ Quaternion quat_conjugate(Quaternion q);
 //------------------------------------------------------------------------------------------------------------------------------------------
 Quaternion quat_inverse(Quaternion q);
 
-//------------------------------------------------------------------------------------------------------------------------------------------
-void quat_print(Quaternion q);
-
 
 
 //==========================================================================================================================================
@@ -97,4 +167,239 @@ Vector3 quat_rotate_vec3(Quaternion q, Vector3 v);
 void quat_to_matrix44(Quaternion q, double * buffer);
 
 
+
+//==========================================================================================================================================
+// Interpolation between unit quaternions, [t] in [0, 1]. All three take the shorter arc between [a] and [b].
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Normalised linear interpolation. Cheapest, exact at t = 0, 0.5 and 1, but the angular speed is not constant:
+// for rotations 90 degrees apart the interpolated rotation lags or leads slerp by up to 0.9 degrees.
+Quaternion quat_nlerp(Quaternion a, Quaternion b, double t);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Spherical linear interpolation, constant angular speed. One acos and three sin per call.
+Quaternion quat_slerp(Quaternion a, Quaternion b, double t);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Polynomial approximation of quat_slerp without transcendental calls (D. Eberly, "A Fast and Accurate Algorithm for
+// Computing SLERP"), 8 terms. Each component differs from quat_slerp by less than 3e-5 (about 0.004 degrees), the worst
+// case being inputs 170 degrees apart at t = 0.5, and the error vanishes quickly for closer inputs (below 1e-11 under 50 degrees).
+// The result is not renormalised.
+Quaternion quat_slerp_fast(Quaternion a, Quaternion b, double t);
+
+
+
+//==========================================================================================================================================
+// Exponential map. A unit quaternion (cos a, sin a n), the rotation by 2a about n, has the logarithm (0, a n).
+// Small angles take Taylor polynomials instead of sin, cos and atan2, and lengths close to 1 instead of log.
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret e^w (cos |v|, sin |v| v / |v|) for [q] = (w, v)
+Quaternion quat_exp(Quaternion q);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Inverse of quat_exp, with the angle in [0, pi]: (ln |q|, atan2(|v|, w) v / |v|).
+// The vector part for a negative real [q] has no direction and is returned as zero.
+Quaternion quat_log(Quaternion q);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// exp(t log(q)): for a unit [q] the rotation about the same axis by [t] times its angle, taking the angle in [0, 2 pi].
+// quat_slerp(a, b, t) is a quat_pow(quat_mul(b, quat_conjugate(a)), t) times a, on the shorter arc.
+Quaternion quat_pow(Quaternion q, double t);
+
+
+
+//==========================================================================================================================================
+// Single precision twins of the functions above, same semantics.
+//------------------------------------------------------------------------------------------------------------------------------------------
+Quaternionf quatf_from_identity(void);
+Quaternionf quatf_from_values(float w, float x, float y, float z);
+Quaternionf quatf_from_angle_axis(float angle, Vector3f axis);
+Quaternionf quatf_from_vec3(Vector3f a, Vector3f b);
+Quaternionf quatf_from_euler_angles(float anglex, float angley, float anglez);
+Vector3f quatf_to_euler_angles(Quaternionf q, QuatEulerOrder order);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Quaternionf quatf_copy(Quaternionf q);
+float quatf_len_squared(Quaternionf q);
+float quatf_len(Quaternionf q);
+Quaternionf quatf_norm(Quaternionf q);
+Quaternionf quatf_norm_fast(Quaternionf q);
+Quaternionf quatf_renorm(Quaternionf q, float epsilon);
+Quaternionf quatf_negate(Quaternionf q);
+Quaternionf quatf_conjugate(Quaternionf q);
+Quaternionf quatf_inverse(Quaternionf q);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool quatf_equal(Quaternionf a, Quaternionf b);
+bool quatf_matching(Quaternionf a, Quaternionf b);
+float quatf_dot(Quaternionf a, Quaternionf b);
+Quaternionf quatf_mul(Quaternionf a, Quaternionf b);
+Vector3f quatf_rotate_vec3(Quaternionf q, Vector3f v);
+void quatf_to_matrix44(Quaternionf q, float * buffer);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Quaternionf quatf_nlerp(Quaternionf a, Quaternionf b, float t);
+Quaternionf quatf_slerp(Quaternionf a, Quaternionf b, float t);
+Quaternionf quatf_slerp_fast(Quaternionf a, Quaternionf b, float t);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Quaternionf quatf_exp(Quaternionf q);
+Quaternionf quatf_log(Quaternionf q);
+Quaternionf quatf_pow(Quaternionf q, float t);
+
+#endif      // AGK_INLINE
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Prints [q] on stdout as (w, x, y, z) and a newline.
+void quat_print(Quaternion q);
+void quatf_print(Quaternionf q);
+
+
+
+//==========================================================================================================================================
+// Euler angles, see quat_to_euler_angles
+//------------------------------------------------------------------------------------------------------------------------------------------
+// quat_to_euler_angles applied to [count] quaternions.
+void quat_to_euler_angles_array(QuatEulerOrder order, const Quaternion * in, Vector3 * out, size_t count);
+
+
+
+//==========================================================================================================================================
+// Batch operations. The rotation terms of [q] are computed once per call, not once per point.
+// Built with -mavx2 -mfma the kernels process 4 points per iteration, otherwise 2 (SSE2) or 1 (scalar).
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Rotates [count] points of [in] and stores them in [out]. [in] and [out] may point to the same array.
+void quat_rotate_vec3_array(Quaternion q, const Vector3 * in, Vector3 * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Structure-of-arrays variant of quat_rotate_vec3_array. Coordinates are passed as three separate streams of [count] doubles.
+// Each output stream may be the same array as its input stream (in place rotation).
+void quat_rotate_vec3_soa(Quaternion q,
+                          const double * x, const double * y, const double * z,
+                          double * out_x, double * out_y, double * out_z,
+                          size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Multi-threaded versions of the two functions above, splitting the points across the parallel_for pool (parallel.h).
+// Worth it from roughly a hundred thousand points, smaller arrays are rotated on the calling thread.
+void quat_rotate_vec3_array_parallel(Quaternion q, const Vector3 * in, Vector3 * out, size_t count);
+void quat_rotate_vec3_soa_parallel(Quaternion q,
+                                   const double * x, const double * y, const double * z,
+                                   double * out_x, double * out_y, double * out_z,
+                                   size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Normalises [count] quaternions of [in] into [out], which may be the same array. Uses the hardware reciprocal square root
+// estimate refined by Newton-Raphson steps: 3 steps in double precision, where the result is within a few ulp of quat_norm,
+// and 1 step for quatf_norm_array, where the relative error of the length stays below 4e-7.
+// Squared lengths must lie within float range (1e-38 .. 1e38); zero length gives inf / nan like quat_norm.
+void quat_norm_array(const Quaternion * in, Quaternion * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Batch quat_renorm, in place. Quaternions within [epsilon] of unit squared length are neither modified nor written back,
+// so a mostly clean array costs little more than reading it.
+// @ret number of quaternions that were renormalised
+size_t quat_renorm_array(Quaternion * q, size_t count, double epsilon);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Structure-of-arrays variants of the two functions above, the components being four separate streams of [count]
+// doubles. Each output stream may be the same array as its input stream.
+void quat_norm_soa(const double * w, const double * x, const double * y, const double * z,
+                   double * out_w, double * out_x, double * out_y, double * out_z, size_t count);
+size_t quat_renorm_soa(double * w, double * x, double * y, double * z, size_t count, double epsilon);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Interpolation method of the batch functions below, see quat_nlerp, quat_slerp and quat_slerp_fast.
+// QUAT_NLERP and QUAT_SLERP_FAST are vectorised (4 quaternions per iteration with AVX2, 2 with SSE2), QUAT_SLERP is not.
+typedef enum quat_interpolation {
+    QUAT_NLERP,
+    QUAT_SLERP,
+    QUAT_SLERP_FAST
+} QuatInterpolation;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Interpolates [count] pairs: out[k] = interpolation of a[k] and b[k] at t[k].
+// [out] may point to the same array as [a] or [b].
+void quat_interpolate_array(QuatInterpolation method,
+                            const Quaternion * a, const Quaternion * b, const double * t,
+                            Quaternion * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Samples one pair at [count] parameters: out[k] = interpolation of [a] and [b] at t[k].
+// QUAT_SLERP computes the angle between [a] and [b] once, leaving two sin per sample.
+void quat_interpolate_samples(QuatInterpolation method,
+                              Quaternion a, Quaternion b, const double * t,
+                              Quaternion * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Accuracy of the vectorised sine and cosine behind the batch constructors below. Groups with an angle beyond 1e6
+// radians, and builds without AVX2, use the libm functions whatever the choice.
+typedef enum quat_sincos_accuracy {
+    QUAT_SINCOS_ACCURATE,       // within 2 ulp of sin / cos
+    QUAT_SINCOS_FAST            // absolute error below 3e-8, better than single precision
+} QuatSincosAccuracy;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// out[k] = quat_from_euler_angles(angles[k].x, angles[k].y, angles[k].z), 4 per iteration with AVX2.
+void quat_from_euler_angles_array(QuatSincosAccuracy accuracy, const Vector3 * angles, Quaternion * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// out[k] = quat_from_angle_axis(angles[k], axes[k]), 4 per iteration with AVX2.
+void quat_from_angle_axis_array(QuatSincosAccuracy accuracy, const double * angles, const Vector3 * axes,
+                                Quaternion * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Exponential map between rotation vectors and unit quaternions: out[k] = quat_exp((0, in[k])).
+// With AVX2 groups of 4 whose angles are all in the Taylor range of quat_exp take its polynomials, the others the
+// accurate vectorised sine and cosine.
+void quat_exp_array(const Vector3 * in, Quaternion * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// out[k] = vector part of quat_log(in[k]), for unit quaternions whose real part, ln |q|, is 0.
+// With AVX2 groups of 4 in the Taylor range of quat_log are vectorised, the others call it.
+void quat_log_array(const Quaternion * in, Vector3 * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// out[k] = quat_pow(in[k], t[k]) for unit quaternions, [out] may be [in]. Vectorised like quat_log_array, on groups
+// where both the logarithm and the scaled exponential are in the Taylor range.
+void quat_pow_array(const Quaternion * in, const double * t, Quaternion * out, size_t count);
+
+
+
+//==========================================================================================================================================
+// Single precision batch operations, same semantics as the double ones.
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The rotation terms are computed in double precision and rounded once. The SoA kernel processes 8 points per
+// iteration with AVX2, the AoS kernel 4 points with SSE.
+void quatf_rotate_vec3_array(Quaternionf q, const Vector3f * in, Vector3f * out, size_t count);
+void quatf_rotate_vec3_soa(Quaternionf q,
+                           const float * x, const float * y, const float * z,
+                           float * out_x, float * out_y, float * out_z,
+                           size_t count);
+void quatf_rotate_vec3_array_parallel(Quaternionf q, const Vector3f * in, Vector3f * out, size_t count);
+void quatf_rotate_vec3_soa_parallel(Quaternionf q,
+                                    const float * x, const float * y, const float * z,
+                                    float * out_x, float * out_y, float * out_z,
+                                    size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void quatf_norm_array(const Quaternionf * in, Quaternionf * out, size_t count);
+size_t quatf_renorm_array(Quaternionf * q, size_t count, float epsilon);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The vectorised interpolation kernels process 4 quaternions per iteration with SSE.
+void quatf_interpolate_array(QuatInterpolation method,
+                             const Quaternionf * a, const Quaternionf * b, const float * t,
+                             Quaternionf * out, size_t count);
+void quatf_interpolate_samples(QuatInterpolation method,
+                               Quaternionf a, Quaternionf b, const float * t,
+                               Quaternionf * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Conversion between the two precisions. Narrowing rounds to nearest.
+Quaternionf quatf_from_quat(Quaternion q);
+Quaternion quat_from_quatf(Quaternionf q);
+
 #endif      // QUATERNION_H
@@ -0,0 +1,537 @@
+//
+//
+//
+//
+//
+//
+// Template of the single value quaternion functions, instantiated once per precision by quaternion.c, and by
+// quaternion.h in AGK_INLINE mode.
+// The includer defines QUAT_T (the union type), QUAT_REAL (its element type), QUAT_VEC3_T (the Vector3 type of
+// the same precision), QUAT_FN(name) / QUAT_VEC3_FN(name), which must paste [name] onto the function prefix
+// (quat_ / quatf_ and vec3_ / vec3f_), and QUAT_MATH(name), which names the <math.h> function of that precision
+// (sin or sinf). QUAT_API is the optional storage class of the definitions.
+// They are #undef'd at the end of this file.
+//
+// No include guard on purpose. Literals are integers so that no instantiation mixes precisions.
+// Every function is defined before its first use, in AGK_INLINE mode there are no prototypes to rely on.
+
+#if ! defined QUAT_API
+#define QUAT_API
+#endif
+
+#if ! defined QUAT_SLERP_FAST_TERMS
+// Coefficients of the polynomial slerp of D. Eberly, "A Fast and Accurate Algorithm for Computing SLERP":
+// u_i = 1/(i(2i+1)) and v_i = i/(2i+1), with the last pair scaled by 1 + mu to absorb most of the truncation error.
+// Shared by every instantiation and by the vectorised kernels of quaternion.c, so they are not #undef'd.
+#define QUAT_SLERP_FAST_TERMS       8
+#define QUAT_SLERP_FAST_ONE_PLUS_MU 1.90110745351730037
+#define QUAT_SLERP_FAST_U           { 1.0/3, 1.0/10, 1.0/21, 1.0/36, 1.0/55, 1.0/78, 1.0/105, QUAT_SLERP_FAST_ONE_PLUS_MU/136 }
+#define QUAT_SLERP_FAST_V           { 1.0/3, 2.0/5, 3.0/7, 4.0/9, 5.0/11, 6.0/13, 7.0/15, QUAT_SLERP_FAST_ONE_PLUS_MU*8/17 }
+
+// Slerp falls back to nlerp where 1 - cos(theta) is below these, theta being the angle between the inputs, so as never
+// to divide by a sin(theta) of zero. nlerp strays from the slerp angle by at most theta^3 / 62, which stays below half
+// an epsilon E of the precision for 1 - cos(theta) < (32 E)^(2/3) / 2: about 1.8e-10 for double, 1.2e-4 for float.
+// Above that slerp itself is accurate to a few E: the error of acos near 1 only reaches its weights at second order.
+#define QUAT_SLERP_NLERP_THRESHOLD  1.8e-10
+#define QUATF_SLERP_NLERP_THRESHOLD 1.2e-4
+
+// Below this squared angle (or, for the length in log, distance of the squared length to 1) exp, log and pow replace
+// their transcendental factors by Taylor polynomials of 4 or 5 terms, whose relative truncation error is below 2e-16.
+#define QUAT_EXP_TAYLOR_THRESHOLD   1e-3
+
+// Axes (0 x, 1 y, 2 z) of each QuatEulerOrder, in the order the rotations are applied
+#define QUAT_EULER_AXES             {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}}
+
+// Below this distance of the middle angle to the gimbal lock the first angle takes the whole rotation about the
+// locked axis. Further away the two are well defined, however close. The same multiple, about 4500, of the epsilon of
+// each precision.
+#define QUAT_EULER_LOCK_EPSILON     1e-12
+#define QUATF_EULER_LOCK_EPSILON    5e-4
+#define QUAT_EULER_PI               3.14159265358979323846
+#endif
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(copy)(QUAT_T q)
+{
+    QUAT_T r;
+    int i;
+
+    // This is more explicit than memcpy, and the compiler will optimise this to memcpy(r.q, q.q, sizeof(q.q)) anyway.
+    for(i = 0; i < 4; i++) {
+        r.q[i] = q.q[i];
+    }
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_REAL QUAT_FN(len_squared)(QUAT_T q)
+{
+    QUAT_REAL len_2 = 0;
+    int i;
+
+    for(i = 0; i < 4; i++) {
+        len_2 += (q.q[i] * q.q[i]);
+    }
+
+    return len_2;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_REAL QUAT_FN(len)(QUAT_T q)
+{
+    return QUAT_MATH(sqrt)( QUAT_FN(len_squared)(q) );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(norm)(QUAT_T q)
+{
+    QUAT_T r;
+    QUAT_REAL qlen = QUAT_FN(len)( q );
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        r.q[i] = q.q[i] / qlen;
+    }
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(norm_fast)(QUAT_T q)
+{
+    QUAT_T r;
+    QUAT_REAL inv_len = 1 / QUAT_MATH(sqrt)( QUAT_FN(len_squared)(q) );
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        r.q[i] = q.q[i] * inv_len;
+    }
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(renorm)(QUAT_T q, QUAT_REAL epsilon)
+{
+    if (QUAT_MATH(fabs)( QUAT_FN(len_squared)(q) - 1 ) <= epsilon) {
+        return q;
+    }
+    return QUAT_FN(norm_fast)(q);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(negate)(QUAT_T q)
+{
+    QUAT_T r;
+    int i;
+
+    for(i = 0; i < 4; i++) {
+        r.q[i] = -q.q[i];
+    }
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(conjugate)(QUAT_T q)
+{
+    QUAT_T r = {0};
+    int i;
+
+    r.w = q.w;
+    for(i = 1; i < 4; i++) {
+        r.q[i] = -q.q[i];
+    }
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(inverse)(QUAT_T q)
+{
+
+    QUAT_REAL len_2 = QUAT_FN(len_squared)( q );
+    QUAT_T r = {{ q.w/len_2,
+                  -q.x/len_2, -q.y/len_2, -q.z/len_2}};
+    return r;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(from_identity)(void)
+{
+    QUAT_T q = {{1, 0, 0, 0}};
+    return q;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(from_values)(QUAT_REAL w, QUAT_REAL x, QUAT_REAL y, QUAT_REAL z)
+{
+    QUAT_T q;
+    q.w = w;
+    q.x = x;
+    q.y = y;
+    q.z = z;
+    return q;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(from_angle_axis)(QUAT_REAL angle, QUAT_VEC3_T axis)
+{
+    QUAT_T q;
+    QUAT_REAL s = QUAT_MATH(sin)(angle /= 2) / QUAT_VEC3_FN(len)( axis );
+    int i;
+
+    q.w = QUAT_MATH(cos)(angle);
+    for (i = 0; i < 3; i++) {
+        q.q[ i+1 ] = s * axis.v[i];
+    }
+
+    return q;
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(from_vec3)(QUAT_VEC3_T a, QUAT_VEC3_T b)
+{
+    QUAT_T r = {0};
+    QUAT_VEC3_T axis = QUAT_VEC3_FN(cross)(a, b);
+    QUAT_REAL dp = 0;
+    int i;
+
+    if (QUAT_VEC3_FN(equal)( axis, QUAT_VEC3_FN(from_zeroes)() )) {
+        return QUAT_FN(from_identity)();
+    }
+
+    dp = QUAT_VEC3_FN(dot)(a, b);
+    r.w = QUAT_MATH(sqrt)(QUAT_VEC3_FN(len_squared)(a) * QUAT_VEC3_FN(len_squared)(b)) + dp;
+
+    for (i = 0; i < 3; i++) {
+        r.q[i + 1] = axis.v[i];
+    }
+
+    return QUAT_FN(norm)(r);
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(from_euler_angles)(QUAT_REAL anglex, QUAT_REAL angley, QUAT_REAL anglez)
+{
+    QUAT_T r;
+
+    QUAT_REAL cx = QUAT_MATH(cos)(anglex /= 2), sx = QUAT_MATH(sin)( anglex );
+    QUAT_REAL cy = QUAT_MATH(cos)(angley /= 2), sy = QUAT_MATH(sin)( angley );
+    QUAT_REAL cz = QUAT_MATH(cos)(anglez /= 2), sz = QUAT_MATH(sin)( anglez );
+
+    r.w = cy*cz*cx - sy*sz*sx;
+    r.x = sy*sz*cx + cy*cz*sx;
+    r.y = sy*cz*cx + cy*sz*sx;
+    r.z = cy*sz*cx - sy*cz*sx;
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// For the axes i, j, k and the parity e = +-1 of the permutation, (a, b, c, d) is q permuted and rotated so that the
+// sequence behaves like the proper Euler sequence i j i: the middle angle is 2 atan2(|(c, d)|, |(a, b)|) - pi/2, and
+// the outer ones are atan2(b, a) -+ atan2(d, c).
+QUAT_API QUAT_VEC3_T QUAT_FN(to_euler_angles)(QUAT_T q, QuatEulerOrder order)
+{
+    static const int axes[6][3] = QUAT_EULER_AXES;
+    const QUAT_REAL pi = (QUAT_REAL) QUAT_EULER_PI;
+    const QUAT_REAL lock = (QUAT_REAL) (sizeof(QUAT_REAL) == sizeof(float) ? QUATF_EULER_LOCK_EPSILON
+                                                                             : QUAT_EULER_LOCK_EPSILON);
+    const int * axis = axes[order];
+    int i = axis[0], j = axis[1], k = axis[2];
+    QUAT_REAL e = (QUAT_REAL) ((i - j) * (j - k) * (k - i) / 2);
+    QUAT_REAL a = q.w - q.q[j + 1], b = q.q[i + 1] + e * q.q[k + 1];
+    QUAT_REAL c = q.q[j + 1] + q.w, d = e * q.q[k + 1] - q.q[i + 1];
+    QUAT_REAL middle = 2 * QUAT_MATH(atan2)( QUAT_MATH(sqrt)(c*c + d*d), QUAT_MATH(sqrt)(a*a + b*b) );
+    QUAT_REAL half_sum = QUAT_MATH(atan2)( b, a ), half_diff = QUAT_MATH(atan2)( d, c );
+    QUAT_REAL first, last = 0;
+    QUAT_VEC3_T r;
+
+    if (middle < lock) {
+        first = 2 * half_sum;
+    } else if (middle > pi - lock) {
+        first = -2 * half_diff;
+    } else {
+        first = half_sum - half_diff;
+        last = e * (half_sum + half_diff);
+    }
+
+    r.v[i] = (first > pi) ? first - 2*pi : (first < -pi) ? first + 2*pi : first;
+    r.v[j] = middle - pi/2;
+    r.v[k] = (last > pi) ? last - 2*pi : (last < -pi) ? last + 2*pi : last;
+
+    return r;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API bool QUAT_FN(equal)(QUAT_T a, QUAT_T b)
+{
+    int i;
+
+    for(i = 0; i < 4; i++) {
+        if ( QUAT_MATH(fabs)(a.q[i] - b.q[i]) > FLT_EPSILON)
+            return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_REAL QUAT_FN(dot)(QUAT_T a, QUAT_T b)
+{
+    QUAT_REAL dp = 0;
+    int i;
+
+    for(i = 0; i < 4; i++) {
+        dp += a.q[i] * b.q[i];
+    }
+
+    return dp;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Alternative quat comparison function. quat_equal is probably faster in most cases.
+QUAT_API bool QUAT_FN(matching)(QUAT_T a, QUAT_T b)
+{
+    return QUAT_MATH(fabs)( QUAT_FN(dot)(a, b) ) < FLT_EPSILON;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(mul)(QUAT_T a, QUAT_T b)
+{
+    QUAT_T r;
+
+    r.w = a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z;
+    r.x = a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y;
+    r.y = a.w*b.y - a.x*b.z + a.y*b.w + a.z*b.x;
+    r.z = a.w*b.z + a.x*b.y - a.y*b.x + a.z*b.w;
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_VEC3_T QUAT_FN(rotate_vec3)(QUAT_T q, QUAT_VEC3_T v)
+{
+    QUAT_VEC3_T r;
+
+    QUAT_REAL vx = v.x, vy = v.y, vz = v.z;
+    QUAT_REAL w = q.w, x = q.x, y = q.y, z = q.z;
+
+    QUAT_REAL ww = w*w;
+    QUAT_REAL xx = x*x;
+    QUAT_REAL yy = y*y;
+    QUAT_REAL zz = z*z;
+    QUAT_REAL wx = w*x;
+    QUAT_REAL wy = w*y;
+    QUAT_REAL wz = w*z;
+    QUAT_REAL xy = x*y;
+    QUAT_REAL xz = x*z;
+    QUAT_REAL yz = y*z;
+
+    r.x = ww*vx + xx*vx - yy*vx - zz*vx + 2*((xy-wz)*vy + (xz+wy)*vz);
+    r.y = ww*vy - xx*vy + yy*vy - zz*vy + 2*((xy+wz)*vx + (yz-wx)*vz);
+    r.z = ww*vz - xx*vz - yy*vz + zz*vz + 2*((xz-wy)*vx + (yz+wx)*vy);
+
+    return r;
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @param [buffer] pointer to array of at least 16 elements in which the matrix will be stored
+QUAT_API void QUAT_FN(to_matrix44)(QUAT_T q, QUAT_REAL * buffer)
+{
+    QUAT_REAL xx = 2*q.x*q.x;
+    QUAT_REAL yy = 2*q.y*q.y;
+    QUAT_REAL zz = 2*q.z*q.z;
+    QUAT_REAL xy = 2*q.x*q.y;
+    QUAT_REAL zw = 2*q.z*q.w;
+    QUAT_REAL xz = 2*q.x*q.z;
+    QUAT_REAL yw = 2*q.y*q.w;
+    QUAT_REAL yz = 2*q.y*q.z;
+    QUAT_REAL xw = 2*q.x*q.w;
+
+    QUAT_REAL mat44[16] = {1-yy-zz, xy+zw, xz-yw, 0,
+                           xy-zw, 1-xx-zz, yz+xw, 0,
+                           xz+yw, yz-xw, 1-xx-yy, 0,
+                           0,     0,     0,       1};
+
+    memcpy( buffer, mat44, sizeof(mat44) );
+}
+
+
+
+
+//==========================================================================================================================================
+// Interpolation. All three take the shorter of the two arcs: [b] is negated when its dot product with [a] is negative.
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(nlerp)(QUAT_T a, QUAT_T b, QUAT_REAL t)
+{
+    QUAT_T r;
+    QUAT_REAL sign = (QUAT_FN(dot)(a, b) < 0) ? -1 : 1;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        r.q[i] = a.q[i] + t*(sign*b.q[i] - a.q[i]);
+    }
+
+    return QUAT_FN(norm)(r);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(slerp)(QUAT_T a, QUAT_T b, QUAT_REAL t)
+{
+    QUAT_T r;
+    QUAT_REAL cosom = QUAT_FN(dot)(a, b), sign = 1;
+    QUAT_REAL theta, sinom, sa, sb;
+    int i;
+
+    if (cosom < 0) {
+        cosom = -cosom;
+        sign = -1;
+    }
+    if (cosom > 1 - (QUAT_REAL) (sizeof(QUAT_REAL) == sizeof(float) ? QUATF_SLERP_NLERP_THRESHOLD
+                                                                        : QUAT_SLERP_NLERP_THRESHOLD)) {
+        return QUAT_FN(nlerp)(a, b, t);
+    }
+
+    theta = QUAT_MATH(acos)(cosom);
+    sinom = QUAT_MATH(sin)(theta);
+    sa = QUAT_MATH(sin)((1 - t) * theta) / sinom;
+    sb = sign * QUAT_MATH(sin)(t * theta) / sinom;
+
+    for (i = 0; i < 4; i++) {
+        r.q[i] = sa*a.q[i] + sb*b.q[i];
+    }
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Evaluates the slerp weights sin((1-t)theta)/sin(theta) and sin(t theta)/sin(theta) as polynomials in t and cos(theta).
+QUAT_API QUAT_T QUAT_FN(slerp_fast)(QUAT_T a, QUAT_T b, QUAT_REAL t)
+{
+    static const double u[QUAT_SLERP_FAST_TERMS] = QUAT_SLERP_FAST_U;
+    static const double v[QUAT_SLERP_FAST_TERMS] = QUAT_SLERP_FAST_V;
+
+    QUAT_T r;
+    QUAT_REAL x = QUAT_FN(dot)(a, b), sign = 1;
+    QUAT_REAL d = 1 - t, tt = t*t, dd = d*d;
+    QUAT_REAL ct = 0, cd = 0;
+    int i;
+
+    if (x < 0) {
+        x = -x;
+        sign = -1;
+    }
+    x -= 1;
+
+    for (i = QUAT_SLERP_FAST_TERMS - 1; i >= 0; i--) {
+        ct = ((QUAT_REAL) u[i]*tt - (QUAT_REAL) v[i]) * x * (1 + ct);
+        cd = ((QUAT_REAL) u[i]*dd - (QUAT_REAL) v[i]) * x * (1 + cd);
+    }
+    ct = sign * t * (1 + ct);
+    cd = d * (1 + cd);
+
+    for (i = 0; i < 4; i++) {
+        r.q[i] = cd*a.q[i] + ct*b.q[i];
+    }
+
+    return r;
+}
+
+
+
+
+//==========================================================================================================================================
+// Exponential and logarithm of general quaternions. For a unit quaternion (cos a, sin a n) the logarithm is (0, a n),
+// and exp maps it back, so that pow(q, t) = exp(t log(q)) turns the rotation by t times its angle about the same axis.
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(exp)(QUAT_T q)
+{
+    QUAT_T r;
+    QUAT_REAL s = q.x*q.x + q.y*q.y + q.z*q.z;
+    QUAT_REAL e = QUAT_MATH(exp)(q.w);
+    QUAT_REAL n, k;
+    int i;
+
+    if (s < (QUAT_REAL) QUAT_EXP_TAYLOR_THRESHOLD) {
+        r.w = e * (1 - s/2 * (1 - s/12 * (1 - s/30 * (1 - s/56))));        // cos n
+        k = e * (1 - s/6 * (1 - s/20 * (1 - s/42 * (1 - s/72))));          // sin n / n
+    } else {
+        n = QUAT_MATH(sqrt)(s);
+        r.w = e * QUAT_MATH(cos)(n);
+        k = e * QUAT_MATH(sin)(n) / n;
+    }
+
+    for (i = 1; i < 4; i++) {
+        r.q[i] = k * q.q[i];
+    }
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The vector part of the logarithm of a negative real quaternion has no defined direction, it is returned as zero.
+QUAT_API QUAT_T QUAT_FN(log)(QUAT_T q)
+{
+    QUAT_T r;
+    QUAT_REAL s = q.x*q.x + q.y*q.y + q.z*q.z;
+    QUAT_REAL u = s + q.w*q.w - 1;
+    QUAT_REAL n, t, k = 0;
+    int i;
+
+    // ln |q| = ln(1 + u) / 2
+    if (QUAT_MATH(fabs)(u) < (QUAT_REAL) QUAT_EXP_TAYLOR_THRESHOLD) {
+        r.w = u/2 * (1 - u * ((QUAT_REAL) 1/2 - u * ((QUAT_REAL) 1/3 - u * ((QUAT_REAL) 1/4 - u/5))));
+    } else {
+        r.w = QUAT_MATH(log)(u + 1) / 2;
+    }
+
+    // atan2(n, w) / n, with atan(t) / t for t = n / w small
+    if (q.w > 0 && s < (QUAT_REAL) QUAT_EXP_TAYLOR_THRESHOLD * q.w*q.w) {
+        t = s / (q.w*q.w);
+        k = (1 - t * ((QUAT_REAL) 1/3 - t * ((QUAT_REAL) 1/5 - t * ((QUAT_REAL) 1/7 - t/9)))) / q.w;
+    } else if (s > 0) {
+        n = QUAT_MATH(sqrt)(s);
+        k = QUAT_MATH(atan2)(n, q.w) / n;
+    }
+
+    for (i = 1; i < 4; i++) {
+        r.q[i] = k * q.q[i];
+    }
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QUAT_API QUAT_T QUAT_FN(pow)(QUAT_T q, QUAT_REAL t)
+{
+    QUAT_T r = QUAT_FN(log)(q);
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        r.q[i] *= t;
+    }
+
+    return QUAT_FN(exp)(r);
+}
+
+
+
+#undef QUAT_T
+#undef QUAT_REAL
+#undef QUAT_VEC3_T
+#undef QUAT_FN
+#undef QUAT_VEC3_FN
+#undef QUAT_MATH
+#undef QUAT_API
@@ -0,0 +1,477 @@
+//
+//
+//
+//
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "quatindex.h"
+#include "quaternion.h"
+#include "parallel.h"
+
+
+#define QUAT_INDEX_TASKS_PER_THREAD     8           // subtrees per thread of quat_index_build_parallel
+#define QUAT_INDEX_PARALLEL_SPLIT       65536       // least points of a node whose distances are computed in parallel
+#define QUAT_INDEX_QUERY_GRAIN          64          // queries per parallel_for chunk
+
+
+// The working arrays of a build: the index being filled and, for every point, a key of its distance to the vantage
+// point of the node it is split in: -|dot|, which sorts the same as the angle without its acos
+typedef struct quat_index_build_job {
+    QuatIndex * index;
+    double * d;
+    size_t begin;                       // node whose distances quat_index_distance_task computes, after its vantage point
+} QuatIndexBuildJob;
+
+// A query in progress. The matches so far are a max-heap on quat_index_before, the worst on top, holding half angles
+// until the end.
+typedef struct quat_index_search {
+    const QuatIndex * index;
+    Quaternion q;
+    QuatIndexMatch * heap;
+    size_t k;
+    size_t size;
+    size_t found;                       // matches within [limit], counted even when the heap is full
+    double limit;                       // half angle beyond which nothing matches
+    bool shrink;                        // narrows tau to the worst match once the heap is full, for the k-NN queries
+    double tau;                         // half angle beyond which nothing is searched
+    double cos_tau;                     // |dot| below which nothing is searched
+} QuatIndexSearch;
+
+
+// The match order, heap, quickselect, builds and parallel queries shared with vec3index.c
+#define INDEX_FN(name)              quat_index_##name
+#define INDEX_T                     QuatIndex
+#define INDEX_POINT_T               Quaternion
+#define INDEX_MATCH_T               QuatIndexMatch
+#define INDEX_MATCH_KEY             angle
+#define INDEX_BUILD_T               QuatIndexBuildJob
+#define INDEX_NODE_POINTS           1                   // the vantage point
+#define INDEX_TASKS_PER_THREAD      QUAT_INDEX_TASKS_PER_THREAD
+#define INDEX_QUERY_GRAIN           QUAT_INDEX_QUERY_GRAIN
+#include "index_impl.h"
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Half the rotation angle between the unit quaternions [a] and [b], the metric of the tree.
+static inline double quat_index_distance(Quaternion a, Quaternion b)
+{
+    double dot = fabs( quat_dot(a, b) );
+
+    return acos( (dot < 1) ? dot : 1 );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret position of the first point of the outer half of the node of [n] points; the inner half follows the vantage point
+static inline size_t quat_index_split(size_t begin, size_t n)
+{
+    return begin + 1 + (n - 1) / 2;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline void quat_index_swap(QuatIndexBuildJob * job, size_t a, size_t b)
+{
+    QuatIndex * index = job->index;
+    double * d = job->d;
+    Quaternion q = index->q[a];
+    size_t id = index->id[a];
+    double t = d[a];
+
+    index->q[a] = index->q[b];      index->q[b] = q;
+    index->id[a] = index->id[b];    index->id[b] = id;
+    d[a] = d[b];                    d[b] = t;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void quat_index_distance_task(void * context, size_t begin, size_t end)
+{
+    QuatIndexBuildJob * job = context;
+    const QuatIndex * index = job->index;
+    Quaternion v = index->q[job->begin];
+    size_t k;
+
+    for (k = job->begin + 1 + begin; k < job->begin + 1 + end; k++) {
+        job->d[k] = -fabs( quat_dot(v, index->q[k]) );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Splits the node [begin, end) in its vantage point and two halves, unless it is a leaf.
+// @param [parallel] computes the distances of large nodes with parallel_for
+// @ret false for a leaf
+static bool quat_index_split_node(QuatIndexBuildJob * job, size_t begin, size_t end, bool parallel)
+{
+    QuatIndex * index = job->index;
+    size_t n = end - begin, split;
+    uint64_t h;
+
+    if (n <= QUAT_INDEX_LEAF) {
+        return false;
+    }
+
+    // A vantage point drawn from the position of the node, so that every build of the same points is the same tree
+    h = (uint64_t) begin * 0x9E3779B97F4A7C15u;
+    quat_index_swap( job, begin, begin + (size_t) ((h >> 32) % n) );
+
+    job->begin = begin;
+    if (parallel && n >= QUAT_INDEX_PARALLEL_SPLIT) {
+        parallel_for( n - 1, 0, quat_index_distance_task, job );
+    } else {
+        quat_index_distance_task( job, 0, n - 1 );
+    }
+
+    split = quat_index_split( begin, n );
+    quat_index_select( job, job->d, begin + 1, end, split );
+    index->radius[begin] = acos( (job->d[split] > -1) ? -job->d[split] : 1 );
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Allocates [index] and fills it with the normalised [q] in their given order.
+static bool quat_index_init(QuatIndex * index, const Quaternion * q, size_t count, double ** d)
+{
+    size_t k;
+
+    index->q = malloc( sizeof(Quaternion) * (count + 1) );
+    index->id = malloc( sizeof(size_t) * (count + 1) );
+    index->radius = malloc( sizeof(double) * (count + 1) );
+    index->count = count;
+    *d = malloc( sizeof(double) * (count + 1) );
+
+    if (index->q == NULL || index->id == NULL || index->radius == NULL || *d == NULL) {
+        free( *d );
+        quat_index_free( index );
+        return false;
+    }
+
+    for (k = 0; k < count; k++) {
+        index->q[k] = quat_norm( q[k] );
+        index->id[k] = k;
+        index->radius[k] = 0;
+    }
+    return true;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Offers the point [k] of the index at the half angle [d] to the search.
+static void quat_index_consider(QuatIndexSearch * s, size_t k, double d)
+{
+    QuatIndexMatch m = {s->index->id[k], d};
+
+    if (d > s->limit) {
+        return;
+    }
+    s->found++;
+
+    if (quat_index_heap_offer( s->heap, &s->size, s->k, m ) && s->shrink && s->size == s->k) {
+        s->tau = (s->heap[0].angle < s->limit) ? s->heap[0].angle : s->limit;
+        s->cos_tau = cos( s->tau );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Searches the node [begin, end).
+static void quat_index_search_node(QuatIndexSearch * s, size_t begin, size_t end)
+{
+    const QuatIndex * index = s->index;
+    size_t n, split, k;
+    double d, mu, dot;
+
+    for (;;) {
+        n = end - begin;
+        if (n <= QUAT_INDEX_LEAF) {
+            for (k = begin; k < end; k++) {
+                dot = fabs( quat_dot(s->q, index->q[k]) );
+                if (dot >= s->cos_tau) {
+                    quat_index_consider( s, k, acos((dot < 1) ? dot : 1) );
+                }
+            }
+            return;
+        }
+
+        d = quat_index_distance( s->q, index->q[begin] );
+        quat_index_consider( s, begin, d );
+        mu = index->radius[begin];
+        split = quat_index_split( begin, n );
+
+        // The nearer half first, the other one unless the ball of radius tau around the query stays on this side
+        if (d < mu) {
+            quat_index_search_node( s, begin + 1, split );
+            if (d + s->tau < mu) {
+                return;
+            }
+            begin = split;
+        } else {
+            quat_index_search_node( s, split, end );
+            if (d - s->tau > mu) {
+                return;
+            }
+            begin = begin + 1;
+            end = split;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Runs a query keeping the best [k] matches within the half angle [limit] in [out], sorted.
+// @param [shrink] stops searching beyond the k-th match, so that the count of the matches within [limit] is no more
+//                 than [k]
+// @ret the number of matches within [limit]
+static size_t quat_index_query(const QuatIndex * index, Quaternion q, size_t k, double limit, bool shrink,
+                               QuatIndexMatch * out)
+{
+    QuatIndexSearch s;
+    size_t i;
+
+    s.index = index;
+    s.q = quat_norm( q );
+    s.heap = out;
+    s.k = k;
+    s.size = 0;
+    s.found = 0;
+    s.limit = limit;
+    s.shrink = shrink;
+    s.tau = limit;
+    s.cos_tau = (limit < 3) ? cos( limit ) : -1;       // no more than pi/2 apart anyway
+
+    if (index->count > 0) {
+        quat_index_search_node( &s, 0, index->count );
+    }
+
+    qsort( out, s.size, sizeof(QuatIndexMatch), quat_index_compare );
+    for (i = 0; i < s.size; i++) {
+        out[i].angle *= 2;
+    }
+    return s.found;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool quat_index_build(QuatIndex * index, const Quaternion * q, size_t count)
+{
+    QuatIndexBuildJob job = {0};
+
+    if (!quat_index_init(index, q, count, &job.d)) {
+        return false;
+    }
+    job.index = index;
+    quat_index_build_subtree( &job, 0, count );
+    free( job.d );
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool quat_index_build_parallel(QuatIndex * index, const Quaternion * q, size_t count)
+{
+    QuatIndexBuildJob job = {0};
+
+    if (!quat_index_init(index, q, count, &job.d)) {
+        return false;
+    }
+    job.index = index;
+    if (!quat_index_build_levels(&job, count)) {
+        free( job.d );
+        quat_index_free( index );
+        return false;
+    }
+    free( job.d );
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void quat_index_free(QuatIndex * index)
+{
+    free( index->q );
+    free( index->id );
+    free( index->radius );
+    index->q = NULL;
+    index->id = NULL;
+    index->radius = NULL;
+    index->count = 0;
+}
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+size_t quat_index_knn(const QuatIndex * index, Quaternion q, size_t k, QuatIndexMatch * out)
+{
+    if (k == 0) {
+        return 0;
+    }
+    quat_index_query( index, q, k, HUGE_VAL, true, out );
+    return (k < index->count) ? k : index->count;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+size_t quat_index_radius(const QuatIndex * index, Quaternion q, double angle, QuatIndexMatch * out, size_t max)
+{
+    return quat_index_query( index, q, max, angle / 2, false, out );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void quat_index_knn_array(const QuatIndex * index, const Quaternion * queries, size_t count, size_t k,
+                          QuatIndexMatch * out)
+{
+    size_t j, i, n;
+
+    for (j = 0; j < count; j++) {
+        n = quat_index_knn( index, queries[j], k, out + j*k );
+        for (i = n; i < k; i++) {
+            out[j*k + i].id = QUAT_INDEX_NONE;
+            out[j*k + i].angle = HUGE_VAL;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void quat_index_radius_array(const QuatIndex * index, const Quaternion * queries, size_t count, double angle,
+                             QuatIndexMatch * out, size_t max, size_t * found)
+{
+    size_t j;
+
+    for (j = 0; j < count; j++) {
+        found[j] = quat_index_radius( index, queries[j], angle, out + j*max, max );
+    }
+}
+
+
+
+
+
+
+
+
+
+
+
+//==========================================================================================================================================
+//==========================================================================================================================================
+//==========================================================================================================================================
+#ifdef QUATINDEX_UNITTEST
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Pseudo random orientations, clustered around a few centres so that the tree has close and far neighbours
+static void test_quat_index_points(Quaternion * q, size_t count, unsigned seed)
+{
+    double r[4];
+    size_t k;
+    int j;
+
+    for (k = 0; k < count; k++) {
+        for (j = 0; j < 4; j++) {
+            seed = seed * 1103515245u + 12345u;
+            r[j] = (double) (seed >> 8) / (double) (1u << 24) * 2 - 1;
+        }
+        if (k % 3 == 0) {
+            q[k] = quat_norm( quat_from_values(r[0], r[1], r[2], r[3]) );
+        } else {
+            q[k] = quat_norm( quat_from_values(1 + 0.05 * r[0], 0.05 * r[1], 0.05 * r[2], (double) (k % 3) + 0.05 * r[3]) );
+        }
+        if (k % 2 == 0) {
+            q[k] = quat_negate( q[k] );         // the other sign of the same orientation
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The matches of the index are those of a scan over all the points, sorted the same way.
+void test_quat_index_queries(void)
+{
+    enum { count = 3001, queries = 40, k = 7, max = 50 };
+    static Quaternion q[count], query[queries];
+    static QuatIndexMatch all[count], knn[queries * k], radius[queries * max], one[max];
+    static size_t found[queries];
+    QuatIndex index, parallel;
+    double angle = 0.15;
+    size_t j, i, n, within;
+
+    test_quat_index_points( q, count, 7 );
+    test_quat_index_points( query, queries, 99 );
+    query[0] = quat_negate( q[5] );                     // exact match, up to sign
+    query[1] = q[6];
+
+    g_assert_true(  quat_index_build(&index, q, count)  );
+    g_assert_true(  quat_index_build_parallel(&parallel, q, count)  );
+    g_assert_cmpint(  memcmp(index.id, parallel.id, sizeof(size_t) * count), ==, 0  );
+    g_assert_cmpint(  memcmp(index.radius, parallel.radius, sizeof(double) * count), ==, 0  );
+
+    quat_index_knn_array_parallel( &index, query, queries, k, knn );
+    quat_index_radius_array_parallel( &index, query, queries, angle, radius, max, found );
+
+    for (j = 0; j < queries; j++) {
+        for (i = 0; i < count; i++) {
+            all[i].id = i;
+            all[i].angle = 2 * acos( fmin(1, fabs(quat_dot(quat_norm(query[j]), quat_norm(q[i])))) );
+        }
+        qsort( all, count, sizeof(all[0]), quat_index_compare );
+
+        for (i = 0; i < k; i++) {
+            g_assert_cmpuint(  knn[j*k + i].id, ==, all[i].id  );
+            g_assert_cmpfloat_with_epsilon(  knn[j*k + i].angle, all[i].angle, 1e-12  );
+        }
+
+        for (within = 0; within < count && all[within].angle <= angle; within++) {
+        }
+        g_assert_cmpuint(  found[j], ==, within  );
+        for (i = 0; i < within && i < max; i++) {
+            g_assert_cmpuint(  radius[j*max + i].id, ==, all[i].id  );
+        }
+    }
+    g_assert_cmpuint(  knn[0].id, ==, 5  );
+    g_assert_cmpfloat(  knn[0].angle, <, 1e-7  );
+
+    // Fewer points than asked for
+    n = quat_index_knn( &index, query[2], 0, one );
+    g_assert_cmpuint(  n, ==, 0  );
+    quat_index_free( &parallel );
+    g_assert_true(  quat_index_build(&parallel, q, 3)  );
+    quat_index_knn_array( &parallel, query, 1, 5, one );
+    g_assert_cmpuint(  one[2].id, !=, QUAT_INDEX_NONE  );
+    g_assert_cmpuint(  one[3].id, ==, QUAT_INDEX_NONE  );
+    g_assert_true(  isinf(one[4].angle)  );
+
+    quat_index_free( &parallel );
+    quat_index_free( &index );
+    g_assert_cmpuint(  index.count, ==, 0  );
+}
+
+
+
+void setuptests(void)
+{
+    g_test_add_func("/set_quatindex/test_quat_index_queries", test_quat_index_queries);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // QUATINDEX_UNITTEST
@@ -0,0 +1,101 @@
+//
+//
+//
+//
+//
+
+#if ! defined QUATINDEX_H
+#define QUATINDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "quaternion.h"
+
+
+// Nearest neighbour index over orientations, for matching observed orientations against a large library of reference
+// ones without scanning all of them.
+//
+// The distance between two orientations is the angle of the rotation from one to the other, 2 acos |a . b|, in
+// [0, pi]. It does not depend on the sign of either quaternion, so q and -q are the same orientation.
+// The index is a vantage point tree over the half of that angle, which is a metric on the unit quaternions taken up
+// to sign. Every node splits its points in two halves: the ones closer to its vantage point than a radius, and the
+// others. A query visits the half it falls in first and the other only if the ball of its current k-th match crosses
+// the radius.
+//
+// The tree is implicit: the quaternions are reordered so that every node is a range, its vantage point first, then the
+// inner half, then the outer half, each range of QUAT_INDEX_LEAF or fewer points being a leaf scanned linearly. Only a
+// radius per vantage point is stored, with no pointers, and a query reads the points of a subtree from one range.
+#define QUAT_INDEX_LEAF         16                  // most points of a leaf
+#define QUAT_INDEX_NONE         ((size_t) -1)       // id of the missing matches of quat_index_knn_array
+
+
+typedef struct quat_index_match {
+    size_t id;                          // position of the orientation in the array given to quat_index_build
+    double angle;                       // of the rotation between the query and that orientation, in [0, pi]
+} QuatIndexMatch;
+
+// The fields are read-only.
+typedef struct quat_index {
+    Quaternion * q;                     // unit, in tree order
+    size_t * id;                        // position of q[k] in the array given to quat_index_build
+    double * radius;                    // at the vantage point of every node: the half angle between its two halves
+    size_t count;
+} QuatIndex;
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Builds the index of [count] orientations, normalised on the way. [q] is copied and may be released afterwards.
+// @ret false if out of memory, leaving [index] empty
+bool quat_index_build(QuatIndex * index, const Quaternion * q, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// quat_index_build with the parallel_for pool: the upper nodes split their points with all threads, the subtrees below
+// are built one per task. Gives the same index.
+bool quat_index_build_parallel(QuatIndex * index, const Quaternion * q, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Releases the memory of [index], which is left empty.
+void quat_index_free(QuatIndex * index);
+
+
+
+//==========================================================================================================================================
+// Queries, the query normalised first. Matches at the same angle come in the order of their id.
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The [k] orientations closest to [q], closest first.
+// @param [out] receives min(k, count) matches
+// @ret number of matches, min(k, count)
+size_t quat_index_knn(const QuatIndex * index, Quaternion q, size_t k, QuatIndexMatch * out);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The orientations within [angle] of [q], closest first.
+// @param [out] receives the first min(max, found) matches
+// @ret number of orientations within [angle], which may exceed [max]
+size_t quat_index_radius(const QuatIndex * index, Quaternion q, double angle, QuatIndexMatch * out, size_t max);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// quat_index_knn of [count] queries.
+// @param [out] receives k matches per query, query j at out + j*k; the missing ones when the index holds fewer than [k]
+//              orientations have the id QUAT_INDEX_NONE and an infinite angle
+void quat_index_knn_array(const QuatIndex * index, const Quaternion * queries, size_t count, size_t k,
+                          QuatIndexMatch * out);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// quat_index_radius of [count] queries.
+// @param [out] receives up to [max] matches per query, query j at out + j*max
+// @param [found] receives the return value of quat_index_radius for every query
+void quat_index_radius_array(const QuatIndex * index, const Quaternion * queries, size_t count, double angle,
+                             QuatIndexMatch * out, size_t max, size_t * found);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The _array queries split across the parallel_for pool.
+void quat_index_knn_array_parallel(const QuatIndex * index, const Quaternion * queries, size_t count, size_t k,
+                                   QuatIndexMatch * out);
+void quat_index_radius_array_parallel(const QuatIndex * index, const Quaternion * queries, size_t count, double angle,
+                                      QuatIndexMatch * out, size_t max, size_t * found);
+
+
+#endif      // QUATINDEX_H
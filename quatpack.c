@@ -0,0 +1,570 @@
+//
+//
+//
+//
+//
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+#include <string.h>
+
+#include "quatpack.h"
+#include "quaternion.h"
+#include "simd.h"
+
+
+#define QUATPACK_RANGE      0.70710678118654752440      // 1/sqrt(2), bound of the 3 smallest components of a unit quaternion
+
+
+
+//==========================================================================================================================================
+// Quantisation shared by the scalar and the vectorised paths, which use the same operations in the same order so that
+// both give the same bits.
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Largest code on [bits] bits. The top code is left unused so that the count of levels is odd and 0 is one of them,
+// which makes the identity and the half turns about the axes exact.
+static inline double quatpack_max(int bits)
+{
+    return (double) ((1u << bits) - 2u);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Splits [q] into the index of its largest component, returned, and the codes of the 3 others in [code].
+static inline uint32_t quatpack_encode(Quaternion q, int bits, uint32_t code[3])
+{
+    double max = quatpack_max( bits ), scale = max / (2 * QUATPACK_RANGE), offset = QUATPACK_RANGE * scale;
+    double sign, t;
+    uint32_t largest = 0, k, j = 0;
+
+    for (k = 1; k < 4; k++) {
+        if (fabs(q.q[k]) > fabs(q.q[largest])) {
+            largest = k;
+        }
+    }
+    sign = copysign( 1.0, q.q[largest] );
+
+    for (k = 0; k < 4; k++) {
+        if (k == largest) {
+            continue;
+        }
+        t = sign * q.q[k] * scale + offset;
+        if (t < 0) {
+            t = 0;
+        } else if (t > max) {
+            t = max;
+        }
+        code[j++] = (uint32_t) (t + 0.5);
+    }
+
+    return largest;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline Quaternion quatpack_decode(uint32_t largest, const uint32_t code[3], int bits)
+{
+    double step = (2 * QUATPACK_RANGE) / quatpack_max( bits );
+    double v[3];
+    Quaternion r;
+    uint32_t k, j = 0;
+
+    for (k = 0; k < 3; k++) {
+        v[k] = (double) code[k] * step - QUATPACK_RANGE;
+    }
+
+    for (k = 0; k < 4; k++) {
+        if (k == largest) {
+            r.q[k] = sqrt( fmax(1.0 - (v[0]*v[0] + v[1]*v[1] + v[2]*v[2]), 0.0) );
+        } else {
+            r.q[k] = v[j++];
+        }
+    }
+
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline QuatPack48 quatpack_put48(uint32_t largest, const uint32_t code[3])
+{
+    uint64_t v = (uint64_t) largest << 45 | (uint64_t) code[0] << 30 | (uint64_t) code[1] << 15 | code[2];
+    QuatPack48 p = {{ (uint16_t) v, (uint16_t) (v >> 16), (uint16_t) (v >> 32) }};
+    return p;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline uint32_t quatpack_get48(QuatPack48 p, uint32_t code[3])
+{
+    uint64_t v = (uint64_t) p.v[0] | (uint64_t) p.v[1] << 16 | (uint64_t) p.v[2] << 32;
+
+    code[0] = (uint32_t) (v >> 30) & 0x7fff;
+    code[1] = (uint32_t) (v >> 15) & 0x7fff;
+    code[2] = (uint32_t) v & 0x7fff;
+    return (uint32_t) (v >> 45) & 3;
+}
+
+
+
+#if ! defined SIMD_KERNEL_BUILD
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+QuatPack32 quat_pack32(Quaternion q)
+{
+    uint32_t code[3];
+    uint32_t largest = quatpack_encode( q, 10, code );
+
+    return largest << 30 | code[0] << 20 | code[1] << 10 | code[2];
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QuatPack48 quat_pack48(Quaternion q)
+{
+    uint32_t code[3];
+    uint32_t largest = quatpack_encode( q, 15, code );
+
+    return quatpack_put48( largest, code );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+QuatPack64 quat_pack64(Quaternion q)
+{
+    uint32_t code[3];
+    uint32_t largest = quatpack_encode( q, 20, code );
+
+    return (uint64_t) largest << 60 | (uint64_t) code[0] << 40 | (uint64_t) code[1] << 20 | code[2];
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Quaternion quat_unpack32(QuatPack32 p)
+{
+    uint32_t code[3] = { (p >> 20) & 0x3ff, (p >> 10) & 0x3ff, p & 0x3ff };
+
+    return quatpack_decode( p >> 30, code, 10 );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Quaternion quat_unpack48(QuatPack48 p)
+{
+    uint32_t code[3];
+    uint32_t largest = quatpack_get48( p, code );
+
+    return quatpack_decode( largest, code, 15 );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Quaternion quat_unpack64(QuatPack64 p)
+{
+    uint32_t code[3] = { (uint32_t) (p >> 40) & 0xfffff, (uint32_t) (p >> 20) & 0xfffff, (uint32_t) p & 0xfffff };
+
+    return quatpack_decode( (uint32_t) (p >> 60), code, 20 );
+}
+#endif      // ! SIMD_KERNEL_BUILD
+
+
+
+//==========================================================================================================================================
+// Batch kernels, one set per tier under runtime dispatch (simd.h)
+SIMD_DISPATCH_VOID(quat_pack32_array, (const Quaternion * in, QuatPack32 * out, size_t count), (in, out, count))
+SIMD_DISPATCH_VOID(quat_pack48_array, (const Quaternion * in, QuatPack48 * out, size_t count), (in, out, count))
+SIMD_DISPATCH_VOID(quat_pack64_array, (const Quaternion * in, QuatPack64 * out, size_t count), (in, out, count))
+SIMD_DISPATCH_VOID(quat_unpack32_array, (const QuatPack32 * in, Quaternion * out, size_t count), (in, out, count))
+SIMD_DISPATCH_VOID(quat_unpack48_array, (const QuatPack48 * in, Quaternion * out, size_t count), (in, out, count))
+SIMD_DISPATCH_VOID(quat_unpack64_array, (const QuatPack64 * in, Quaternion * out, size_t count), (in, out, count))
+
+#if defined SIMD_KERNELS
+
+#if defined SIMD_HAVE_AVX2
+//==========================================================================================================================================
+// 4 quaternions at a time: the index of the largest component selects a permutation of the 4 doubles of each
+// quaternion (as pairs of 32 bit lanes) that moves the largest component to the last place, or back.
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Output component k of quatpack_decode4 comes from slot k of the (a b c largest) order, and the reverse
+static const int32_t quatpack_decode_perm[4][8] = {
+    { 6, 7, 0, 1, 2, 3, 4, 5 },
+    { 0, 1, 6, 7, 2, 3, 4, 5 },
+    { 0, 1, 2, 3, 6, 7, 4, 5 },
+    { 0, 1, 2, 3, 4, 5, 6, 7 }
+};
+
+static const int32_t quatpack_encode_perm[4][8] = {
+    { 2, 3, 4, 5, 6, 7, 0, 1 },
+    { 0, 1, 4, 5, 6, 7, 2, 3 },
+    { 0, 1, 2, 3, 6, 7, 4, 5 },
+    { 0, 1, 2, 3, 4, 5, 6, 7 }
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline __m256d quatpack_permute(__m256d q, const int32_t perm[8])
+{
+    return _mm256_castps_pd( _mm256_permutevar8x32_ps(_mm256_castpd_ps(q), _mm256_loadu_si256((const __m256i *) perm)) );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// quatpack_encode of in[0] .. in[3]: the indices go to [largest], the codes of the 3 other components to [a], [b], [c]
+static void quatpack_encode4(const Quaternion * in, int bits, int32_t largest[4], __m128i * a, __m128i * b, __m128i * c)
+{
+    const __m256d absmask = _mm256_castsi256_pd( _mm256_set1_epi64x(0x7fffffffffffffff) );
+    const __m256d signmask = _mm256_set1_pd( -0.0 );
+    const __m256d zero = _mm256_setzero_pd();
+    double max = quatpack_max( bits ), scale = max / (2 * QUATPACK_RANGE), offset = QUATPACK_RANGE * scale;
+    __m256d r[4], w, x, y, z, m, t, idx, gt, sign;
+    int k;
+
+    for (k = 0; k < 4; k++) {
+        r[k] = _mm256_loadu_pd( in[k].q );
+    }
+    w = r[0];   x = r[1];   y = r[2];   z = r[3];
+    simd_transpose4( &w, &x, &y, &z );
+
+    // Strictly greater, like the scalar search, so that ties keep the first index
+    m = _mm256_and_pd( w, absmask );
+    idx = zero;
+    t = _mm256_and_pd( x, absmask );
+    gt = _mm256_cmp_pd( t, m, _CMP_GT_OQ );
+    idx = _mm256_blendv_pd( idx, _mm256_set1_pd(1.0), gt );
+    m = _mm256_blendv_pd( m, t, gt );
+    t = _mm256_and_pd( y, absmask );
+    gt = _mm256_cmp_pd( t, m, _CMP_GT_OQ );
+    idx = _mm256_blendv_pd( idx, _mm256_set1_pd(2.0), gt );
+    m = _mm256_blendv_pd( m, t, gt );
+    t = _mm256_and_pd( z, absmask );
+    gt = _mm256_cmp_pd( t, m, _CMP_GT_OQ );
+    idx = _mm256_blendv_pd( idx, _mm256_set1_pd(3.0), gt );
+    _mm_storeu_si128( (__m128i *) largest, _mm256_cvttpd_epi32(idx) );
+
+    for (k = 0; k < 4; k++) {
+        r[k] = quatpack_permute( r[k], quatpack_encode_perm[largest[k]] );
+    }
+    simd_transpose4( &r[0], &r[1], &r[2], &r[3] );
+
+    sign = _mm256_and_pd( r[3], signmask );
+    for (k = 0; k < 3; k++) {
+        t = _mm256_add_pd( _mm256_mul_pd(_mm256_xor_pd(r[k], sign), _mm256_set1_pd(scale)), _mm256_set1_pd(offset) );
+        t = _mm256_min_pd( _mm256_max_pd(t, zero), _mm256_set1_pd(max) );
+        r[k] = _mm256_add_pd( t, _mm256_set1_pd(0.5) );
+    }
+    *a = _mm256_cvttpd_epi32( r[0] );
+    *b = _mm256_cvttpd_epi32( r[1] );
+    *c = _mm256_cvttpd_epi32( r[2] );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// quatpack_decode of 4 quaternions into out[0] .. out[3]
+static void quatpack_decode4(const int32_t largest[4], __m128i a, __m128i b, __m128i c, int bits, Quaternion * out)
+{
+    const __m256d step = _mm256_set1_pd( (2 * QUATPACK_RANGE) / quatpack_max(bits) );
+    const __m256d range = _mm256_set1_pd( QUATPACK_RANGE );
+    __m256d r[4], s;
+    int k;
+
+    r[0] = _mm256_sub_pd( _mm256_mul_pd(_mm256_cvtepi32_pd(a), step), range );
+    r[1] = _mm256_sub_pd( _mm256_mul_pd(_mm256_cvtepi32_pd(b), step), range );
+    r[2] = _mm256_sub_pd( _mm256_mul_pd(_mm256_cvtepi32_pd(c), step), range );
+
+    s = _mm256_add_pd( _mm256_add_pd(_mm256_mul_pd(r[0], r[0]), _mm256_mul_pd(r[1], r[1])), _mm256_mul_pd(r[2], r[2]) );
+    r[3] = _mm256_sqrt_pd( _mm256_max_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), s), _mm256_setzero_pd()) );
+
+    simd_transpose4( &r[0], &r[1], &r[2], &r[3] );
+    for (k = 0; k < 4; k++) {
+        _mm256_storeu_pd( out[k].q, quatpack_permute(r[k], quatpack_decode_perm[largest[k]]) );
+    }
+}
+#endif
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quat_pack32_array)(const Quaternion * in, QuatPack32 * out, size_t count)
+{
+    size_t k = 0;
+#if defined SIMD_HAVE_AVX2
+    int32_t largest[4];
+    __m128i a, b, c, p;
+
+    for (; k + 4 <= count; k += 4) {
+        quatpack_encode4( in + k, 10, largest, &a, &b, &c );
+        p = _mm_or_si128( _mm_slli_epi32(_mm_loadu_si128((const __m128i *) largest), 30), _mm_slli_epi32(a, 20) );
+        p = _mm_or_si128( p, _mm_or_si128(_mm_slli_epi32(b, 10), c) );
+        _mm_storeu_si128( (__m128i *) (out + k), p );
+    }
+#endif
+
+    for (; k < count; k++) {
+        out[k] = quat_pack32( in[k] );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quat_pack48_array)(const Quaternion * in, QuatPack48 * out, size_t count)
+{
+    size_t k = 0;
+#if defined SIMD_HAVE_AVX2
+    int32_t largest[4], a[4], b[4], c[4];
+    uint32_t code[3];
+    __m128i va, vb, vc;
+    int j;
+
+    for (; k + 4 <= count; k += 4) {
+        quatpack_encode4( in + k, 15, largest, &va, &vb, &vc );
+        _mm_storeu_si128( (__m128i *) a, va );
+        _mm_storeu_si128( (__m128i *) b, vb );
+        _mm_storeu_si128( (__m128i *) c, vc );
+        for (j = 0; j < 4; j++) {
+            code[0] = (uint32_t) a[j];  code[1] = (uint32_t) b[j];  code[2] = (uint32_t) c[j];
+            out[k + (size_t) j] = quatpack_put48( (uint32_t) largest[j], code );
+        }
+    }
+#endif
+
+    for (; k < count; k++) {
+        out[k] = quat_pack48( in[k] );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quat_pack64_array)(const Quaternion * in, QuatPack64 * out, size_t count)
+{
+    size_t k = 0;
+#if defined SIMD_HAVE_AVX2
+    int32_t largest[4];
+    __m128i a, b, c;
+    __m256i p;
+
+    for (; k + 4 <= count; k += 4) {
+        quatpack_encode4( in + k, 20, largest, &a, &b, &c );
+        p = _mm256_or_si256( _mm256_slli_epi64(_mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *) largest)), 60),
+                             _mm256_slli_epi64(_mm256_cvtepu32_epi64(a), 40) );
+        p = _mm256_or_si256( p, _mm256_or_si256(_mm256_slli_epi64(_mm256_cvtepu32_epi64(b), 20), _mm256_cvtepu32_epi64(c)) );
+        _mm256_storeu_si256( (__m256i *) (out + k), p );
+    }
+#endif
+
+    for (; k < count; k++) {
+        out[k] = quat_pack64( in[k] );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quat_unpack32_array)(const QuatPack32 * in, Quaternion * out, size_t count)
+{
+    size_t k = 0;
+#if defined SIMD_HAVE_AVX2
+    const __m128i mask = _mm_set1_epi32( 0x3ff );
+    int32_t largest[4];
+    __m128i p;
+
+    for (; k + 4 <= count; k += 4) {
+        p = _mm_loadu_si128( (const __m128i *) (in + k) );
+        _mm_storeu_si128( (__m128i *) largest, _mm_srli_epi32(p, 30) );
+        quatpack_decode4( largest, _mm_and_si128(_mm_srli_epi32(p, 20), mask), _mm_and_si128(_mm_srli_epi32(p, 10), mask),
+                          _mm_and_si128(p, mask), 10, out + k );
+    }
+#endif
+
+    for (; k < count; k++) {
+        out[k] = quat_unpack32( in[k] );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quat_unpack48_array)(const QuatPack48 * in, Quaternion * out, size_t count)
+{
+    size_t k = 0;
+#if defined SIMD_HAVE_AVX2
+    int32_t largest[4], a[4], b[4], c[4];
+    uint32_t code[3];
+    int j;
+
+    // The fields straddle the 16 bit words, they are taken apart in scalar code and only the arithmetic is vectorised
+    for (; k + 4 <= count; k += 4) {
+        for (j = 0; j < 4; j++) {
+            largest[j] = (int32_t) quatpack_get48( in[k + (size_t) j], code );
+            a[j] = (int32_t) code[0];   b[j] = (int32_t) code[1];   c[j] = (int32_t) code[2];
+        }
+        quatpack_decode4( largest, _mm_loadu_si128((const __m128i *) a), _mm_loadu_si128((const __m128i *) b),
+                          _mm_loadu_si128((const __m128i *) c), 15, out + k );
+    }
+#endif
+
+    for (; k < count; k++) {
+        out[k] = quat_unpack48( in[k] );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(quat_unpack64_array)(const QuatPack64 * in, Quaternion * out, size_t count)
+{
+    size_t k = 0;
+#if defined SIMD_HAVE_AVX2
+    const __m256i mask = _mm256_set1_epi64x( 0xfffff );
+    int32_t largest[4];
+    __m256i p;
+
+    for (; k + 4 <= count; k += 4) {
+        p = _mm256_loadu_si256( (const __m256i *) (in + k) );
+        _mm_storeu_si128( (__m128i *) largest, simd_low32_epi64(_mm256_srli_epi64(p, 60)) );
+        quatpack_decode4( largest, simd_low32_epi64(_mm256_and_si256(_mm256_srli_epi64(p, 40), mask)),
+                          simd_low32_epi64(_mm256_and_si256(_mm256_srli_epi64(p, 20), mask)),
+                          simd_low32_epi64(_mm256_and_si256(p, mask)), 20, out + k );
+    }
+#endif
+
+    for (; k < count; k++) {
+        out[k] = quat_unpack64( in[k] );
+    }
+}
+
+#endif      // SIMD_KERNELS
+
+
+
+
+
+
+
+
+
+//==========================================================================================================================================
+// Unit testing facilities
+#if defined QUATPACK_UNITTEST && ! defined SIMD_KERNEL_BUILD
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+
+
+
+#define TESTCOUNT   1003
+
+// Unit quaternions: hand picked edge cases (ties between components, negative largest component, half turns)
+// followed by pseudo random ones
+static void test_quaternions(Quaternion * q)
+{
+    const Quaternion special[] = {
+        {{ 1.0, 0.0, 0.0, 0.0 }}, {{ -1.0, 0.0, 0.0, 0.0 }}, {{ 0.0, 0.0, 0.0, 1.0 }}, {{ 0.0, -1.0, 0.0, 0.0 }},
+        {{ 0.5, 0.5, 0.5, 0.5 }}, {{ -0.5, 0.5, -0.5, 0.5 }}, {{ 0.0, 0.70710678118654752, -0.70710678118654752, 0.0 }}
+    };
+    unsigned seed = 777;
+    double r[4];
+    size_t k;
+    int j;
+
+    for (k = 0; k < TESTCOUNT; k++) {
+        if (k < sizeof(special) / sizeof(special[0])) {
+            q[k] = special[k];
+            continue;
+        }
+        for (j = 0; j < 4; j++) {
+            seed = seed * 1103515245u + 12345u;
+            r[j] = (double) (seed >> 8) / (double) (1u << 24) * 2 - 1;
+        }
+        q[k] = quat_norm( quat_from_values(r[0], r[1], r[2], r[3]) );
+    }
+}
+
+// Angle of the rotation from [a] to [b], from the chord between the quaternions, precise for small angles
+static double rotation_error(Quaternion a, Quaternion b)
+{
+    double d = 0, s = (quat_dot(a, b) < 0) ? -1.0 : 1.0;
+    int k;
+
+    for (k = 0; k < 4; k++) {
+        d += (a.q[k] - s * b.q[k]) * (a.q[k] - s * b.q[k]);
+    }
+    return 4 * asin( sqrt(d) / 2 );
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_quat_pack_error(void)
+{
+    Quaternion q[TESTCOUNT], r;
+    double e32 = 0, e48 = 0, e64 = 0;
+    size_t k;
+
+    test_quaternions( q );
+    for (k = 0; k < TESTCOUNT; k++) {
+        r = quat_unpack32( quat_pack32(q[k]) );
+        e32 = fmax( e32, rotation_error(q[k], r) );
+        g_assert_cmpfloat( fabs(quat_len(r) - 1.0), <, 1e-3 );
+
+        r = quat_unpack48( quat_pack48(q[k]) );
+        e48 = fmax( e48, rotation_error(q[k], r) );
+
+        r = quat_unpack64( quat_pack64(q[k]) );
+        e64 = fmax( e64, rotation_error(q[k], r) );
+        g_assert_cmpfloat( fabs(quat_len(r) - 1.0), <, 1e-6 );
+    }
+
+    g_assert_cmpfloat( e32, <, QUAT_PACK32_MAX_ANGLE );
+    g_assert_cmpfloat( e48, <, QUAT_PACK48_MAX_ANGLE );
+    g_assert_cmpfloat( e64, <, QUAT_PACK64_MAX_ANGLE );
+
+    // Exactly representable: the dropped component is rebuilt positive
+    r = quat_unpack64( quat_pack64(q[1]) );
+    g_assert_true(  quat_equal(r, q[0])  );
+    r = quat_unpack32( quat_pack32(q[2]) );
+    g_assert_true(  quat_equal(r, q[2])  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The batch functions give the same bits as the single value ones, including the scalar tail
+void test_quat_pack_array(void)
+{
+    Quaternion q[TESTCOUNT], r[TESTCOUNT];
+    QuatPack32 p32[TESTCOUNT];
+    QuatPack48 p48[TESTCOUNT];
+    QuatPack64 p64[TESTCOUNT];
+    QuatPack48 s48;
+    Quaternion s;
+    size_t k;
+
+    test_quaternions( q );
+
+    quat_pack32_array( q, p32, TESTCOUNT );
+    quat_unpack32_array( p32, r, TESTCOUNT );
+    for (k = 0; k < TESTCOUNT; k++) {
+        g_assert_cmpuint( p32[k], ==, quat_pack32(q[k]) );
+        s = quat_unpack32( p32[k] );
+        g_assert_true(  memcmp(&s, &r[k], sizeof(s)) == 0  );
+    }
+
+    quat_pack48_array( q, p48, TESTCOUNT );
+    quat_unpack48_array( p48, r, TESTCOUNT );
+    for (k = 0; k < TESTCOUNT; k++) {
+        s48 = quat_pack48( q[k] );
+        g_assert_true(  memcmp(&s48, &p48[k], sizeof(s48)) == 0  );
+        s = quat_unpack48( p48[k] );
+        g_assert_true(  memcmp(&s, &r[k], sizeof(s)) == 0  );
+    }
+
+    quat_pack64_array( q, p64, TESTCOUNT );
+    quat_unpack64_array( p64, r, TESTCOUNT );
+    for (k = 0; k < TESTCOUNT; k++) {
+        g_assert_cmpuint( p64[k], ==, quat_pack64(q[k]) );
+        s = quat_unpack64( p64[k] );
+        g_assert_true(  memcmp(&s, &r[k], sizeof(s)) == 0  );
+    }
+}
+
+
+
+void setuptests(void)
+{
+    g_test_add_func("/set_quatpack/test_quat_pack_error", test_quat_pack_error);
+    g_test_add_func("/set_quatpack/test_quat_pack_array", test_quat_pack_array);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // QUATPACK_UNITTEST
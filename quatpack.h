@@ -0,0 +1,75 @@
+//
+//
+//
+//
+//
+
+#if ! defined QUATPACK_H
+#define QUATPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "quaternion.h"
+
+
+// Compact storage of UNIT quaternions (rotations) by "smallest three": the largest component is dropped and rebuilt
+// from the unit length when decoding, its index takes 2 bits and the 3 other components are quantised uniformly over
+// [-1/sqrt(2), 1/sqrt(2)], the range they are confined to once the largest one is removed. The quaternion is negated
+// first if needed so that the dropped component is positive, which represents the same rotation.
+//
+//  format       bytes  bits per component  max angle error (radians)
+//  QuatPack32     4          10                4.8e-3   (0.28 degrees)
+//  QuatPack48     6          15                1.5e-4
+//  QuatPack64     8          20                4.7e-6
+//
+// The error is the angle of the rotation between the input and its decoded value. The bound is 2 * 2 sqrt(3) * h for
+// the half quantisation step h: the 3 kept components are each off by at most h and the rebuilt one by at most 3 h.
+// Decoded quaternions are of unit length to double precision, except when rounding pushed the 3 kept components
+// beyond unit length together, in which case the rebuilt one is 0 and the length is within 2 h of 1.
+typedef uint32_t QuatPack32;                // index << 30 | a << 20 | b << 10 | c
+
+typedef struct quat_pack48 {                // index << 45 | a << 30 | b << 15 | c, low 16 bits first
+    uint16_t v[3];
+} QuatPack48;
+
+typedef uint64_t QuatPack64;                // index << 60 | a << 40 | b << 20 | c
+
+#define QUAT_PACK32_MAX_ANGLE       4.8e-3
+#define QUAT_PACK48_MAX_ANGLE       1.5e-4
+#define QUAT_PACK64_MAX_ANGLE       4.7e-6
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @param [q] should be of UNIT length
+QuatPack32 quat_pack32(Quaternion q);
+QuatPack48 quat_pack48(Quaternion q);
+QuatPack64 quat_pack64(Quaternion q);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret the unit quaternion encoded in [p], with a positive dropped component, so possibly the negation of the
+// quaternion that was packed
+Quaternion quat_unpack32(QuatPack32 p);
+Quaternion quat_unpack48(QuatPack48 p);
+Quaternion quat_unpack64(QuatPack64 p);
+
+
+
+//==========================================================================================================================================
+// Batch encoding and decoding of [count] quaternions. Vectorised over 4 quaternions with AVX2, giving the same bits
+// as the single value functions.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void quat_pack32_array(const Quaternion * in, QuatPack32 * out, size_t count);
+void quat_pack48_array(const Quaternion * in, QuatPack48 * out, size_t count);
+void quat_pack64_array(const Quaternion * in, QuatPack64 * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The output can be given straight to the batch quat_ functions, such as quat_interpolate_array.
+void quat_unpack32_array(const QuatPack32 * in, Quaternion * out, size_t count);
+void quat_unpack48_array(const QuatPack48 * in, Quaternion * out, size_t count);
+void quat_unpack64_array(const QuatPack64 * in, Quaternion * out, size_t count);
+
+
+#endif      // QUATPACK_H
@@ -0,0 +1,384 @@
+//
+//
+//
+//
+//
+//
+// Internal helpers shared by the vectorised batch kernels. Not part of the public API.
+//
+// SIMD_HAVE_AVX2 is defined when the translation unit is built with -mavx2 -mfma,
+// otherwise SIMD_HAVE_SSE2 is defined on every x86-64 target. Without either the kernels fall back to scalar loops.
+// SIMD_HAVE_F16C is defined on its own when the half precision conversions are available (-mf16c, which implies AVX).
+//
+// Runtime dispatch (dispatch.h), enabled by defining AGK_SIMD_DISPATCH for the whole build: each module holding
+// kernels is compiled once more per tier with SIMD_KERNEL_BUILD set to the SIMD_LEVEL_ of the tier, and the
+// instruction set flags of that tier (see simd.pri). Such a kernel build only compiles the kernel region of the
+// module, with the public names of the kernels suffixed by the tier through SIMD_FN; the regular build of the
+// module compiles everything else, and under these public names functions that call the kernels of the tier in use.
+// Without AGK_SIMD_DISPATCH the regular build compiles the kernels for the flags it is given, as a single tier.
+// With AGK_INSTRUMENT (instrument.h) the public names are entries that count and time the calls of the kernels.
+
+#if ! defined SIMD_H
+#define SIMD_H
+
+// Tiers, in the order of SimdTier. SIMD_KERNEL_BUILD is one of them.
+#define SIMD_LEVEL_SCALAR       0
+#define SIMD_LEVEL_SSE2         1
+#define SIMD_LEVEL_AVX2         2
+#define SIMD_LEVEL_AVX512       3
+
+#if defined SIMD_KERNEL_BUILD && SIMD_KERNEL_BUILD == SIMD_LEVEL_SCALAR
+// no vector kernels, whatever the target
+#elif defined __AVX2__ && defined __FMA__
+#define SIMD_HAVE_AVX2
+#elif defined __SSE2__
+#define SIMD_HAVE_SSE2
+#endif
+
+#if defined __F16C__ && ! (defined SIMD_KERNEL_BUILD && SIMD_KERNEL_BUILD == SIMD_LEVEL_SCALAR)
+#define SIMD_HAVE_F16C
+#endif
+
+#if defined SIMD_KERNEL_BUILD
+#if (SIMD_KERNEL_BUILD == SIMD_LEVEL_SSE2 && ! defined SIMD_HAVE_SSE2) || \
+    (SIMD_KERNEL_BUILD >= SIMD_LEVEL_AVX2 && ! (defined SIMD_HAVE_AVX2 && defined SIMD_HAVE_F16C)) || \
+    (SIMD_KERNEL_BUILD == SIMD_LEVEL_AVX512 && ! (defined __AVX512F__ && defined __AVX512VL__ && defined __AVX512DQ__))
+#error "the instruction set flags do not match SIMD_KERNEL_BUILD, see simd.pri"
+#endif
+#endif
+
+
+// SIMD_KERNELS is defined when this translation unit compiles the kernel region of its module.
+// SIMD_FN names a kernel with a public name: the tier suffix in a kernel build, the name itself in a single tier
+// build, unless instrumented.
+#if defined SIMD_KERNEL_BUILD || ! defined AGK_SIMD_DISPATCH
+#define SIMD_KERNELS
+#endif
+
+#if ! defined SIMD_KERNEL_BUILD && ! defined AGK_INSTRUMENT
+#define SIMD_FN(name)           name
+#elif ! defined SIMD_KERNEL_BUILD
+#define SIMD_FN(name)           name##_kernel
+#elif SIMD_KERNEL_BUILD == SIMD_LEVEL_SCALAR
+#define SIMD_FN(name)           name##_scalar
+#elif SIMD_KERNEL_BUILD == SIMD_LEVEL_SSE2
+#define SIMD_FN(name)           name##_sse2
+#elif SIMD_KERNEL_BUILD == SIMD_LEVEL_AVX2
+#define SIMD_FN(name)           name##_avx2
+#else
+#define SIMD_FN(name)           name##_avx512
+#endif
+
+
+// SIMD_DISPATCH / SIMD_DISPATCH_VOID(return type, name, (parameters), (arguments)), at file scope before the kernel
+// region, once per kernel with a public name, whose parameters include the item count [count]. With AGK_SIMD_DISPATCH
+// they declare the kernel of every tier, and in the regular build also define [name] as the call of the kernel of the
+// tier in use. Without, they expand to nothing, unless AGK_INSTRUMENT defines [name] as the call of [name]_kernel.
+#include "instrument.h"
+
+#define SIMD_ENTRY(ret, name, params, call) \
+    ret name params { ret simd_result; INSTRUMENT_BEGIN(name); call INSTRUMENT_END(name, count); return simd_result; }
+#define SIMD_ENTRY_VOID(name, params, call) \
+    void name params { INSTRUMENT_BEGIN(name); call INSTRUMENT_END(name, count); }
+
+#if defined AGK_SIMD_DISPATCH
+
+#if ! defined __GNUC__ || ! (defined __x86_64__ || defined __i386__)
+#error "AGK_SIMD_DISPATCH needs GCC or clang on x86"
+#endif
+
+#include "dispatch.h"
+
+#define SIMD_DECLARE_TIERS(ret, name, params) \
+    ret name##_scalar params; \
+    ret name##_sse2 params; \
+    ret name##_avx2 params; \
+    ret name##_avx512 params;
+
+#define SIMD_SWITCH(call, name, args) \
+    switch (simd_tier()) { \
+    case SIMD_TIER_AVX512:  call(name##_avx512 args); break; \
+    case SIMD_TIER_AVX2:    call(name##_avx2 args); break; \
+    case SIMD_TIER_SSE2:    call(name##_sse2 args); break; \
+    case SIMD_TIER_SCALAR:  call(name##_scalar args); break; \
+    default:                call(name##_scalar args); break; \
+    }
+
+#define SIMD_CALL_RESULT(expression)    simd_result = expression
+#define SIMD_CALL_VOID(expression)      expression
+
+#if defined SIMD_KERNEL_BUILD
+#define SIMD_DISPATCH(ret, name, params, args)      SIMD_DECLARE_TIERS(ret, name, params)
+#define SIMD_DISPATCH_VOID(name, params, args)      SIMD_DECLARE_TIERS(void, name, params)
+#else
+#define SIMD_DISPATCH(ret, name, params, args) \
+    SIMD_DECLARE_TIERS(ret, name, params) \
+    SIMD_ENTRY(ret, name, params, SIMD_SWITCH(SIMD_CALL_RESULT, name, args))
+#define SIMD_DISPATCH_VOID(name, params, args) \
+    SIMD_DECLARE_TIERS(void, name, params) \
+    SIMD_ENTRY_VOID(name, params, SIMD_SWITCH(SIMD_CALL_VOID, name, args))
+#endif
+
+#elif defined AGK_INSTRUMENT
+
+#define SIMD_DISPATCH(ret, name, params, args) \
+    ret name##_kernel params; \
+    SIMD_ENTRY(ret, name, params, simd_result = name##_kernel args;)
+#define SIMD_DISPATCH_VOID(name, params, args) \
+    void name##_kernel params; \
+    SIMD_ENTRY_VOID(name, params, name##_kernel args;)
+
+#else
+
+#define SIMD_DISPATCH(ret, name, params, args)
+#define SIMD_DISPATCH_VOID(name, params, args)
+
+#endif
+
+#if defined SIMD_HAVE_AVX2 || defined SIMD_HAVE_SSE2
+#include <immintrin.h>
+#endif
+
+// Newton-Raphson steps after the 12 bit rsqrt estimate in double precision: 2 leave a relative error near 1e-13,
+// 3 reach the rounding error of a sqrt and a division.
+#define SIMD_RSQRT_STEPS_PD     3
+
+// Largest |x| of simd_sincos4_pd: up to 2^20 quadrants the products of the quadrant with the three parts of pi/2 are exact.
+#define SIMD_SINCOS_MAX         1e6
+
+
+
+#if defined SIMD_HAVE_AVX2
+//===============================================================================================================
+//---------------------------------------------------------------------------------------------------------------
+// Transposes 4 x y z triples held in order in [a] [b] [c], i.e. (x0 y0 z0 x1) (y1 z1 x2 y2) (z2 x3 y3 z3), into lanes.
+static inline void simd_deinterleave_xyz4(__m256d a, __m256d b, __m256d c, __m256d * x, __m256d * y, __m256d * z)
+{
+    __m256d t0 = _mm256_permute2f128_pd(a, b, 0x30);        // x0 y0 x2 y2
+    __m256d t1 = _mm256_permute2f128_pd(a, c, 0x21);        // z0 x1 z2 x3
+    __m256d t2 = _mm256_permute2f128_pd(b, c, 0x30);        // y1 z1 y3 z3
+
+    *x = _mm256_blend_pd(t0, t1, 0xA);
+    *y = _mm256_shuffle_pd(t0, t2, 0x5);
+    *z = _mm256_blend_pd(t1, t2, 0xA);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// Loads 4 consecutive x y z triples from [src] (12 doubles, no alignment needed) and transposes them into lanes.
+static inline void simd_load_xyz4(const double * src, __m256d * x, __m256d * y, __m256d * z)
+{
+    simd_deinterleave_xyz4(_mm256_loadu_pd(src), _mm256_loadu_pd(src + 4), _mm256_loadu_pd(src + 8), x, y, z);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// Inverse of simd_load_xyz4.
+static inline void simd_store_xyz4(double * dst, __m256d x, __m256d y, __m256d z)
+{
+    __m256d t0 = _mm256_shuffle_pd(x, y, 0x0);              // x0 y0 x2 y2
+    __m256d t1 = _mm256_blend_pd(z, x, 0xA);                // z0 x1 z2 x3
+    __m256d t2 = _mm256_shuffle_pd(y, z, 0xF);              // y1 z1 y3 z3
+
+    _mm256_storeu_pd(dst,     _mm256_permute2f128_pd(t0, t1, 0x20));
+    _mm256_storeu_pd(dst + 4, _mm256_permute2f128_pd(t2, t0, 0x30));
+    _mm256_storeu_pd(dst + 8, _mm256_permute2f128_pd(t1, t2, 0x31));
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// The low 32 bits of each of the 4 64 bit lanes of [v], e.g. bit fields shifted down in 64 bit lanes for
+// _mm256_cvtepi32_pd.
+static inline __m128i simd_low32_epi64(__m256i v)
+{
+    return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// Transposes the 4x4 matrix held in rows [r0] .. [r3]. Turns 4 loaded quaternions (w x y z) into w, x, y and z
+// lanes and back.
+static inline void simd_transpose4(__m256d * r0, __m256d * r1, __m256d * r2, __m256d * r3)
+{
+    __m256d t0 = _mm256_unpacklo_pd(*r0, *r1);             // r0[0] r1[0] r0[2] r1[2]
+    __m256d t1 = _mm256_unpackhi_pd(*r0, *r1);             // r0[1] r1[1] r0[3] r1[3]
+    __m256d t2 = _mm256_unpacklo_pd(*r2, *r3);
+    __m256d t3 = _mm256_unpackhi_pd(*r2, *r3);
+
+    *r0 = _mm256_permute2f128_pd(t0, t2, 0x20);
+    *r1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+    *r2 = _mm256_permute2f128_pd(t0, t2, 0x31);
+    *r3 = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// 1/sqrt(x) from the 12 bit single precision estimate, refined by SIMD_RSQRT_STEPS_PD Newton-Raphson steps
+// y' = y (3 - x y^2) / 2. Each step roughly squares the relative error. [x] must lie in the float range (1e-38 .. 1e38).
+static inline __m256d simd_rsqrt4_pd(__m256d x)
+{
+    __m256d y = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(x)));
+    __m256d half_x = _mm256_mul_pd(x, _mm256_set1_pd(0.5));
+    __m256d three_halves = _mm256_set1_pd(1.5);
+    int i;
+
+    for (i = 0; i < SIMD_RSQRT_STEPS_PD; i++) {
+        y = _mm256_mul_pd(y, _mm256_fnmadd_pd(half_x, _mm256_mul_pd(y, y), three_halves));
+    }
+    return y;
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// Sine and cosine of the lanes of [x], |x| <= SIMD_SINCOS_MAX. [x] is reduced by the nearest multiple of pi/2 (pi/2
+// split in three 33 bit parts, as in fdlibm) to r in [-pi/4, pi/4], whose sine and cosine are polynomials:
+// the minimax ones of fdlibm's __kernel_sin / __kernel_cos, within 2 ulp of libm, or with [fast] the Taylor
+// polynomials of degree 9 and 8, 5 terms fewer for an absolute error below 3e-8.
+static inline void simd_sincos4_pd(__m256d x, int fast, __m256d * s, __m256d * c)
+{
+    __m256d j = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(6.36619772367581382433e-01)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d one = _mm256_set1_pd(1);
+    __m256d r, z, ps, pc, swap;
+    __m256i q, q1 = _mm256_set1_epi64x(1), q2 = _mm256_set1_epi64x(2);
+
+    r = _mm256_fnmadd_pd(j, _mm256_set1_pd(1.57079632673412561417e+00), x);
+    r = _mm256_fnmadd_pd(j, _mm256_set1_pd(6.07710050630396597660e-11), r);
+    r = _mm256_fnmadd_pd(j, _mm256_set1_pd(2.02226624871116645580e-21), r);
+    z = _mm256_mul_pd(r, r);
+
+    if (fast) {
+        ps = _mm256_fmadd_pd(z, _mm256_set1_pd(1.0/362880), _mm256_set1_pd(-1.0/5040));
+        ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(1.0/120));
+        ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(-1.0/6));
+        pc = _mm256_fmadd_pd(z, _mm256_set1_pd(1.0/40320), _mm256_set1_pd(-1.0/720));
+        pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(1.0/24));
+    } else {
+        ps = _mm256_fmadd_pd(z, _mm256_set1_pd(1.58969099521155010221e-10), _mm256_set1_pd(-2.50507602534068634195e-08));
+        ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(2.75573137070700676789e-06));
+        ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(-1.98412698298579493134e-04));
+        ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(8.33333333332248946124e-03));
+        ps = _mm256_fmadd_pd(z, ps, _mm256_set1_pd(-1.66666666666666324348e-01));
+        pc = _mm256_fmadd_pd(z, _mm256_set1_pd(-1.13596475577881948265e-11), _mm256_set1_pd(2.08757232129817482790e-09));
+        pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(-2.75573143513906633035e-07));
+        pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(2.48015872894767294178e-05));
+        pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(-1.38888888888741095749e-03));
+        pc = _mm256_fmadd_pd(z, pc, _mm256_set1_pd(4.16666666666666019037e-02));
+    }
+    ps = _mm256_fmadd_pd(_mm256_mul_pd(r, z), ps, r);
+    pc = _mm256_fmadd_pd(_mm256_mul_pd(z, z), pc, _mm256_fnmadd_pd(_mm256_set1_pd(0.5), z, one));
+
+    // Quadrant j mod 4: sin x = (sin r, cos r, -sin r, -cos r) and cos x = (cos r, -sin r, -cos r, sin r)
+    q = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(j));
+    swap = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(q, q1), q1));
+    *s = _mm256_xor_pd(_mm256_blendv_pd(ps, pc, swap),
+                       _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(q, q2), 62)));
+    *c = _mm256_xor_pd(_mm256_blendv_pd(pc, ps, swap),
+                       _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(_mm256_add_epi64(q, q1), q2), 62)));
+}
+
+#elif defined SIMD_HAVE_SSE2
+//===============================================================================================================
+//---------------------------------------------------------------------------------------------------------------
+// Loads 2 consecutive x y z triples from [src] (6 doubles) and transposes them into lanes.
+// The 3 registers hold (x0 y0) (z0 x1) (y1 z1).
+static inline void simd_load_xyz2(const double * src, __m128d * x, __m128d * y, __m128d * z)
+{
+    __m128d a = _mm_loadu_pd(src);
+    __m128d b = _mm_loadu_pd(src + 2);
+    __m128d c = _mm_loadu_pd(src + 4);
+
+    *x = _mm_shuffle_pd(a, b, 0x2);
+    *y = _mm_shuffle_pd(a, c, 0x1);
+    *z = _mm_shuffle_pd(b, c, 0x2);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// Inverse of simd_load_xyz2.
+static inline void simd_store_xyz2(double * dst, __m128d x, __m128d y, __m128d z)
+{
+    _mm_storeu_pd(dst,     _mm_shuffle_pd(x, y, 0x0));
+    _mm_storeu_pd(dst + 2, _mm_shuffle_pd(z, x, 0x2));
+    _mm_storeu_pd(dst + 4, _mm_shuffle_pd(y, z, 0x3));
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// 2 lane version of simd_rsqrt4_pd.
+static inline __m128d simd_rsqrt2_pd(__m128d x)
+{
+    __m128d y = _mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(x)));
+    __m128d half_x = _mm_mul_pd(x, _mm_set1_pd(0.5));
+    __m128d three_halves = _mm_set1_pd(1.5);
+    int i;
+
+    for (i = 0; i < SIMD_RSQRT_STEPS_PD; i++) {
+        y = _mm_mul_pd(y, _mm_sub_pd(three_halves, _mm_mul_pd(half_x, _mm_mul_pd(y, y))));
+    }
+    return y;
+}
+#endif
+
+
+#if defined SIMD_HAVE_AVX2 || defined SIMD_HAVE_SSE2
+//===============================================================================================================
+//---------------------------------------------------------------------------------------------------------------
+// Single precision simd_deinterleave_xyz4.
+static inline void simd_deinterleave_xyz4f(__m128 a, __m128 b, __m128 c, __m128 * x, __m128 * y, __m128 * z)
+{
+    __m128 t = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 3, 2));                 // x2 y2 z2 x3
+
+    *x = _mm_shuffle_ps(a, t, _MM_SHUFFLE(3, 0, 3, 0));
+    *y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),        // y0 y0 y1 y1
+                        _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),        // y2 y2 y3 y3
+                        _MM_SHUFFLE(2, 0, 2, 0));
+    *z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),        // z0 z0 z1 z1
+                        _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)),        // z2 z2 z3 z3
+                        _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// Single precision: loads 4 consecutive x y z triples from [src] (12 floats) and transposes them into lanes.
+// The 3 registers hold (x0 y0 z0 x1) (y1 z1 x2 y2) (z2 x3 y3 z3).
+static inline void simd_load_xyz4f(const float * src, __m128 * x, __m128 * y, __m128 * z)
+{
+    simd_deinterleave_xyz4f(_mm_loadu_ps(src), _mm_loadu_ps(src + 4), _mm_loadu_ps(src + 8), x, y, z);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// Inverse of simd_load_xyz4f.
+static inline void simd_store_xyz4f(float * dst, __m128 x, __m128 y, __m128 z)
+{
+    __m128 xy01 = _mm_unpacklo_ps(x, y);                                      // x0 y0 x1 y1
+    __m128 zx01 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0));              // z0 z0 x1 x1
+    __m128 yz11 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1));              // y1 y1 z1 z1
+    __m128 xy22 = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2));              // x2 x2 y2 y2
+    __m128 zx23 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2));              // z2 z2 x3 x3
+    __m128 yz33 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3));              // y3 y3 z3 z3
+
+    _mm_storeu_ps(dst,     _mm_shuffle_ps(xy01, zx01, _MM_SHUFFLE(2, 0, 1, 0)));
+    _mm_storeu_ps(dst + 4, _mm_shuffle_ps(yz11, xy22, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(dst + 8, _mm_shuffle_ps(zx23, yz33, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// Single precision 1/sqrt(x): the 12 bit estimate and one Newton-Raphson step.
+static inline __m128 simd_rsqrt4_ps(__m128 x)
+{
+    __m128 y = _mm_rsqrt_ps(x);
+    __m128 half_x = _mm_mul_ps(x, _mm_set1_ps(0.5f));
+
+    return _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(half_x, _mm_mul_ps(y, y))));
+}
+#endif
+
+
+
+//===============================================================================================================
+//---------------------------------------------------------------------------------------------------------------
+// Number of set bits of a movemask result (at most 8 lanes).
+static inline int simd_mask_count(int bits)
+{
+    int count = 0;
+
+    for (; bits != 0; bits &= bits - 1) {
+        count++;
+    }
+    return count;
+}
+
+
+#endif      // SIMD_H
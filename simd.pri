@@ -0,0 +1,34 @@
+# Runtime dispatch of the batch kernels, see dispatch.h and simd.h.
+# Every source holding kernels is compiled once more per instruction set tier. SIMD_KERNEL_BUILD restricts those
+# builds to the kernels and suffixes their names with the tier. The tier flags come after the project flags, so they
+# override a -march given there.
+
+DEFINES += AGK_SIMD_DISPATCH
+
+SIMD_KERNEL_SOURCES = \
+    quaternion.c \
+    vector3.c \
+    matrix44.c \
+    dualquat.c \
+    skinning.c \
+    integrate.c \
+    quatpack.c \
+    vec3pack.c \
+    vec3index.c
+
+SIMD_TIERS = scalar sse2 avx2 avx512
+SIMD_TIER_FLAGS_scalar = -mno-avx -DSIMD_KERNEL_BUILD=SIMD_LEVEL_SCALAR
+SIMD_TIER_FLAGS_sse2 = -mno-avx -DSIMD_KERNEL_BUILD=SIMD_LEVEL_SSE2
+SIMD_TIER_FLAGS_avx2 = -mavx2 -mfma -mf16c -DSIMD_KERNEL_BUILD=SIMD_LEVEL_AVX2
+SIMD_TIER_FLAGS_avx512 = -mavx2 -mfma -mf16c -mavx512f -mavx512vl -mavx512dq -DSIMD_KERNEL_BUILD=SIMD_LEVEL_AVX512
+
+for(tier, SIMD_TIERS) {
+    compiler = simd_$${tier}
+    $${compiler}.name = $${tier} kernels of ${QMAKE_FILE_IN}
+    $${compiler}.input = SIMD_KERNEL_SOURCES
+    $${compiler}.output = ${QMAKE_FILE_BASE}_$${tier}.o
+    $${compiler}.commands = $(CC) -c $(CFLAGS) $(INCPATH) $$eval(SIMD_TIER_FLAGS_$${tier}) ${QMAKE_FILE_IN} -o ${QMAKE_FILE_OUT}
+    $${compiler}.dependency_type = TYPE_C
+    $${compiler}.variable_out = OBJECTS
+    QMAKE_EXTRA_COMPILERS += $${compiler}
+}
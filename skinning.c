@@ -0,0 +1,409 @@
+//
+//
+//
+//
+//
+
+// The quat_ / vec3_ scalar functions are used per vertex, take the header-only versions so they inline
+#define AGK_INLINE
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <tgmath.h>
+#include <float.h>              // for FLT_EPSILON in comparison precision
+#include <string.h>
+
+#include "skinning.h"
+#include "dualquat.h"
+#include "quaternion.h"
+#include "vector3.h"
+#include "parallel.h"
+#include "simd.h"
+
+
+#define SKIN_PARALLEL_GRAIN     4096    // vertices per parallel_for chunk, about 300 KB of streamed data
+
+
+
+//==========================================================================================================================================
+// Skinning kernel, one per tier under runtime dispatch (simd.h)
+SIMD_DISPATCH_VOID(skin_dualquat, (const DualQuaternion * bones, const uint16_t * indices, const float * weights,
+                                   const Vector3 * positions, const Vector3 * normals,
+                                   Vector3 * out_positions, Vector3 * out_normals, size_t count),
+                   (bones, indices, weights, positions, normals, out_positions, out_normals, count))
+
+#if defined SIMD_KERNELS
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Scalar reference of the vector kernel for one vertex. Its stack frame is too large for gcc to inline it.
+static void skin_vertex(const DualQuaternion * bones, const uint16_t * index, const float * weight,
+                        const Vector3 * position, const Vector3 * normal,
+                        Vector3 * out_position, Vector3 * out_normal)
+{
+    const Quaternion pivot = bones[index[0]].real;
+    DualQuaternion b = {{0}}, bone;
+    Vector3 rv, c, t, p;
+    double w, inv_len;
+    int i, j;
+
+    for (i = 0; i < SKIN_INFLUENCES; i++) {
+        bone = bones[index[i]];
+        w = (quat_dot(bone.real, pivot) < 0) ? -weight[i] : weight[i];
+        for (j = 0; j < 8; j++) {
+            b.dq[j] += w * bone.dq[j];
+        }
+    }
+
+    inv_len = 1 / quat_len( b.real );
+    for (j = 0; j < 8; j++) {
+        b.dq[j] *= inv_len;
+    }
+
+    // p + 2 rv x (rv x p + w p), plus the translation
+    rv = vec3_from_values( b.real.x, b.real.y, b.real.z );
+    t = dualquat_get_translation( b );
+
+    p = *position;
+    c = vec3_add( vec3_cross(rv, p), vec3_scalar_mul(p, b.real.w) );
+    *out_position = vec3_add( vec3_add(p, vec3_scalar_mul(vec3_cross(rv, c), 2)), t );
+
+    if (normal != NULL) {
+        p = *normal;
+        c = vec3_add( vec3_cross(rv, p), vec3_scalar_mul(p, b.real.w) );
+        *out_normal = vec3_add( p, vec3_scalar_mul(vec3_cross(rv, c), 2) );
+    }
+}
+
+#if defined SIMD_HAVE_AVX2
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Lane-wise p + 2 rv x (rv x p + w p) for unit quaternions (w, rx, ry, rz).
+static inline void skin_rotate4(__m256d w, __m256d rx, __m256d ry, __m256d rz, __m256d * x, __m256d * y, __m256d * z)
+{
+    __m256d cx = _mm256_fmadd_pd(w, *x, _mm256_fmsub_pd(ry, *z, _mm256_mul_pd(rz, *y)));
+    __m256d cy = _mm256_fmadd_pd(w, *y, _mm256_fmsub_pd(rz, *x, _mm256_mul_pd(rx, *z)));
+    __m256d cz = _mm256_fmadd_pd(w, *z, _mm256_fmsub_pd(rx, *y, _mm256_mul_pd(ry, *x)));
+    __m256d two = _mm256_set1_pd(2);
+
+    *x = _mm256_fmadd_pd(two, _mm256_fmsub_pd(ry, cz, _mm256_mul_pd(rz, cy)), *x);
+    *y = _mm256_fmadd_pd(two, _mm256_fmsub_pd(rz, cx, _mm256_mul_pd(rx, cz)), *y);
+    *z = _mm256_fmadd_pd(two, _mm256_fmsub_pd(rx, cy, _mm256_mul_pd(ry, cx)), *z);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Vertices [k] .. [k + 3], one per lane. Not inlined either, the call is amortised over the 4 vertices.
+static void skin_block4(const DualQuaternion * bones, const uint16_t * index, const float * weight,
+                        const Vector3 * positions, const Vector3 * normals,
+                        Vector3 * out_positions, Vector3 * out_normals)
+{
+    __m128 wf[4] = {_mm_loadu_ps(weight), _mm_loadu_ps(weight + 4), _mm_loadu_ps(weight + 8), _mm_loadu_ps(weight + 12)};
+    __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d real[4], dual[4], br[4], bd[4], pivot[4];
+    __m256d w, dot, inv_len, tx, ty, tz, x, y, z;
+    int i, j;
+
+    _MM_TRANSPOSE4_PS(wf[0], wf[1], wf[2], wf[3]);          // wf[i] = weight of influence i of the 4 vertices
+
+    for (i = 0; i < SKIN_INFLUENCES; i++) {
+        for (j = 0; j < 4; j++) {
+            br[j] = _mm256_loadu_pd(bones[index[SKIN_INFLUENCES*j + i]].dq);
+            bd[j] = _mm256_loadu_pd(bones[index[SKIN_INFLUENCES*j + i]].dq + 4);
+        }
+        simd_transpose4( &br[0], &br[1], &br[2], &br[3] );
+        simd_transpose4( &bd[0], &bd[1], &bd[2], &bd[3] );
+
+        w = _mm256_cvtps_pd(wf[i]);
+        if (i == 0) {
+            for (j = 0; j < 4; j++) {
+                pivot[j] = br[j];
+                real[j] = _mm256_mul_pd(w, br[j]);
+                dual[j] = _mm256_mul_pd(w, bd[j]);
+            }
+            continue;
+        }
+
+        // Flip the weight of bones on the other hemisphere than the pivot
+        dot = _mm256_mul_pd(br[0], pivot[0]);
+        for (j = 1; j < 4; j++) {
+            dot = _mm256_fmadd_pd(br[j], pivot[j], dot);
+        }
+        w = _mm256_xor_pd(w, _mm256_and_pd(dot, sign));
+
+        for (j = 0; j < 4; j++) {
+            real[j] = _mm256_fmadd_pd(w, br[j], real[j]);
+            dual[j] = _mm256_fmadd_pd(w, bd[j], dual[j]);
+        }
+    }
+
+    dot = _mm256_mul_pd(real[0], real[0]);
+    for (j = 1; j < 4; j++) {
+        dot = _mm256_fmadd_pd(real[j], real[j], dot);
+    }
+    inv_len = _mm256_div_pd(_mm256_set1_pd(1), _mm256_sqrt_pd(dot));
+    for (j = 0; j < 4; j++) {
+        real[j] = _mm256_mul_pd(real[j], inv_len);
+        dual[j] = _mm256_mul_pd(dual[j], inv_len);
+    }
+
+    // Translation 2 (rw dv - dw rv + rv x dv), as in dualquat_get_translation
+    tx = _mm256_fmsub_pd(real[0], dual[1], _mm256_mul_pd(dual[0], real[1]));
+    ty = _mm256_fmsub_pd(real[0], dual[2], _mm256_mul_pd(dual[0], real[2]));
+    tz = _mm256_fmsub_pd(real[0], dual[3], _mm256_mul_pd(dual[0], real[3]));
+    tx = _mm256_add_pd(tx, _mm256_fmsub_pd(real[2], dual[3], _mm256_mul_pd(real[3], dual[2])));
+    ty = _mm256_add_pd(ty, _mm256_fmsub_pd(real[3], dual[1], _mm256_mul_pd(real[1], dual[3])));
+    tz = _mm256_add_pd(tz, _mm256_fmsub_pd(real[1], dual[2], _mm256_mul_pd(real[2], dual[1])));
+
+    simd_load_xyz4( positions->v, &x, &y, &z );
+    skin_rotate4( real[0], real[1], real[2], real[3], &x, &y, &z );
+    simd_store_xyz4( out_positions->v, _mm256_add_pd(x, _mm256_add_pd(tx, tx)),
+                                       _mm256_add_pd(y, _mm256_add_pd(ty, ty)),
+                                       _mm256_add_pd(z, _mm256_add_pd(tz, tz)) );
+
+    if (normals != NULL) {
+        simd_load_xyz4( normals->v, &x, &y, &z );
+        skin_rotate4( real[0], real[1], real[2], real[3], &x, &y, &z );
+        simd_store_xyz4( out_normals->v, x, y, z );
+    }
+}
+#endif
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(skin_dualquat)(const DualQuaternion * bones,
+                            const uint16_t * indices, const float * weights,
+                            const Vector3 * positions, const Vector3 * normals,
+                            Vector3 * out_positions, Vector3 * out_normals,
+                            size_t count)
+{
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2
+    for (k = 0; k + 4 <= count; k += 4) {
+        skin_block4( bones, indices + SKIN_INFLUENCES*k, weights + SKIN_INFLUENCES*k,
+                     positions + k, (normals != NULL) ? normals + k : NULL,
+                     out_positions + k, (normals != NULL) ? out_normals + k : NULL );
+    }
+#endif
+
+    for (; k < count; k++) {
+        skin_vertex( bones, indices + SKIN_INFLUENCES*k, weights + SKIN_INFLUENCES*k,
+                     positions + k, (normals != NULL) ? normals + k : NULL,
+                     out_positions + k, (normals != NULL) ? out_normals + k : NULL );
+    }
+}
+
+#endif      // SIMD_KERNELS
+
+
+
+#if ! defined SIMD_KERNEL_BUILD
+//==========================================================================================================================================
+// Multi-threaded skinning. Each chunk is an independent call of skin_dualquat.
+//------------------------------------------------------------------------------------------------------------------------------------------
+typedef struct skin_job {
+    const DualQuaternion * bones;
+    const uint16_t * indices;
+    const float * weights;
+    const Vector3 * positions;
+    const Vector3 * normals;
+    Vector3 * out_positions;
+    Vector3 * out_normals;
+} SkinJob;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void skin_dualquat_task(void * context, size_t begin, size_t end)
+{
+    SkinJob * job = context;
+    bool has_normals = (job->normals != NULL);
+
+    skin_dualquat( job->bones, job->indices + SKIN_INFLUENCES*begin, job->weights + SKIN_INFLUENCES*begin,
+                   job->positions + begin, has_normals ? job->normals + begin : NULL,
+                   job->out_positions + begin, has_normals ? job->out_normals + begin : NULL,
+                   end - begin );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void skin_dualquat_parallel(const DualQuaternion * bones,
+                            const uint16_t * indices, const float * weights,
+                            const Vector3 * positions, const Vector3 * normals,
+                            Vector3 * out_positions, Vector3 * out_normals,
+                            size_t count)
+{
+    SkinJob job = {bones, indices, weights, positions, normals, out_positions, out_normals};
+    parallel_for( count, SKIN_PARALLEL_GRAIN, skin_dualquat_task, &job );
+}
+
+#endif      // ! SIMD_KERNEL_BUILD
+
+
+
+
+
+
+
+
+
+//==========================================================================================================================================
+// Unit testing facilities
+#if defined SKINNING_UNITTEST && ! defined SIMD_KERNEL_BUILD
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+
+#include <stdlib.h>
+
+
+
+#define TEST_BONES 5
+
+DualQuaternion testbones[TEST_BONES];
+
+
+// Bone [b] of the test skeleton, every one a different rotation and translation
+static void make_bones(void)
+{
+    int b;
+
+    for (b = 0; b < TEST_BONES; b++) {
+        testbones[b] = dualquat_from_rotation_translation( quat_from_euler_angles(0.4*b, -0.9 + 0.3*b, 1.7 - b),
+                                                           vec3_from_values(b, -0.5*b, 2.0) );
+    }
+}
+
+// Influences of vertex [k]: varying bone sets, one to four non-zero weights
+static void make_influences(size_t k, uint16_t * index, float * weight)
+{
+    int i, used = (int) (k % SKIN_INFLUENCES) + 1;
+
+    for (i = 0; i < SKIN_INFLUENCES; i++) {
+        index[i] = (uint16_t) ((k + 2*(size_t) i) % TEST_BONES);
+        weight[i] = (i < used) ? 1.0f / (float) used : 0.0f;
+    }
+}
+
+// Reference: blend, renormalise with dualquat_norm and transform
+static Vector3 reference_point(const uint16_t * index, const float * weight, Vector3 p, bool is_normal)
+{
+    DualQuaternion b = {{0}};
+    double w;
+    int i, j;
+
+    for (i = 0; i < SKIN_INFLUENCES; i++) {
+        w = weight[i];
+        if (quat_dot(testbones[index[i]].real, testbones[index[0]].real) < 0) {
+            w = -w;
+        }
+        for (j = 0; j < 8; j++) {
+            b.dq[j] += w * testbones[index[i]].dq[j];
+        }
+    }
+
+    b = dualquat_norm( b );
+    return is_normal ? dualquat_transform_dir(b, p) : dualquat_transform_point(b, p);
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// A single influence reproduces the bone transform, and a bone given as its antipodal dual quaternion blends the same.
+void test_skin_single_bone(void)
+{
+    uint16_t index[4] = {2, 0, 0, 0};
+    float weight[4] = {1, 0, 0, 0};
+    DualQuaternion bones[2];
+    Vector3 p = {1.5, -2.0, 0.25}, n = {0, 0, 1};
+    Vector3 op, on, op2;
+    int j;
+
+    make_bones();
+    skin_dualquat( testbones, index, weight, &p, &n, &op, &on, 1 );
+    g_assert_true(  vec3_equal(op, dualquat_transform_point(testbones[2], p))  );
+    g_assert_true(  vec3_equal(on, dualquat_transform_dir(testbones[2], n))  );
+
+    bones[0] = testbones[1];
+    bones[1] = testbones[3];
+    index[0] = 0;
+    index[1] = 1;
+    weight[0] = weight[1] = 0.5f;
+    skin_dualquat( bones, index, weight, &p, NULL, &op, NULL, 1 );
+    for (j = 0; j < 8; j++) {
+        bones[1].dq[j] = -bones[1].dq[j];
+    }
+    skin_dualquat( bones, index, weight, &p, NULL, &op2, NULL, 1 );
+    g_assert_true(  vec3_equal(op, op2)  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Odd count so that both the vector kernel and the scalar tail are exercised, in place.
+void test_skin_dualquat(void)
+{
+    uint16_t index[11 * SKIN_INFLUENCES];
+    float weight[11 * SKIN_INFLUENCES];
+    Vector3 p[11], n[11];
+    size_t k;
+
+    make_bones();
+    for (k = 0; k < 11; k++) {
+        make_influences( k, index + SKIN_INFLUENCES*k, weight + SKIN_INFLUENCES*k );
+        p[k] = vec3_from_values( -4.5 + (double) k, 1.0 - 0.5 * (double) k, 0.25 * (double) k );
+        n[k] = vec3_norm( vec3_from_values(1.0, (double) k, -2.0) );
+    }
+
+    skin_dualquat( testbones, index, weight, p, n, p, n, 11 );
+    for (k = 0; k < 11; k++) {
+        g_assert_true(  vec3_equal(p[k], reference_point(index + SKIN_INFLUENCES*k, weight + SKIN_INFLUENCES*k,
+                                                         vec3_from_values(-4.5 + (double) k, 1.0 - 0.5 * (double) k, 0.25 * (double) k),
+                                                         false))  );
+        g_assert_true(  vec3_equal(n[k], reference_point(index + SKIN_INFLUENCES*k, weight + SKIN_INFLUENCES*k,
+                                                         vec3_norm(vec3_from_values(1.0, (double) k, -2.0)), true))  );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Large enough to be split across the pool; every vertex must match the single threaded result.
+void test_skin_dualquat_parallel(void)
+{
+    enum { count = 50001 };
+    uint16_t * index = malloc( sizeof(uint16_t) * SKIN_INFLUENCES * count );
+    float * weight = malloc( sizeof(float) * SKIN_INFLUENCES * count );
+    Vector3 * p = malloc( sizeof(Vector3) * count );
+    Vector3 * serial = malloc( sizeof(Vector3) * count );
+    Vector3 * parallel = malloc( sizeof(Vector3) * count );
+    size_t k;
+
+    make_bones();
+    for (k = 0; k < count; k++) {
+        make_influences( k, index + SKIN_INFLUENCES*k, weight + SKIN_INFLUENCES*k );
+        p[k] = vec3_from_values( 0.001 * (double) k, 1.0, -0.5 );
+    }
+
+    skin_dualquat( testbones, index, weight, p, NULL, serial, NULL, count );
+    skin_dualquat_parallel( testbones, index, weight, p, NULL, parallel, NULL, count );
+    g_assert_true(  memcmp(serial, parallel, sizeof(Vector3) * count) == 0  );
+
+    free( index );
+    free( weight );
+    free( p );
+    free( serial );
+    free( parallel );
+}
+
+
+
+void setuptests(void)
+{
+    g_test_add_func("/set_skin/test_skin_single_bone", test_skin_single_bone);
+    g_test_add_func("/set_skin/test_skin_dualquat", test_skin_dualquat);
+    g_test_add_func("/set_skin/test_skin_dualquat_parallel", test_skin_dualquat_parallel);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // SKINNING_UNITTEST
@@ -0,0 +1,49 @@
+//
+//
+//
+//
+//
+
+#if ! defined SKINNING_H
+#define SKINNING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector3.h"
+#include "dualquat.h"
+
+
+#define SKIN_INFLUENCES     4           // bone influences per vertex
+
+
+
+//==========================================================================================================================================
+// Dual quaternion linear blend skinning (Kavan et al.): per vertex the bone transforms are blended as dual quaternions,
+// each weight taking the sign that puts its bone on the same hemisphere as the first influence, then divided by the
+// length of the blended real part. Unlike blending matrices this does not shrink the mesh around twisting joints.
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Skins [count] vertices in one pass.
+// @param [bones] bone transforms (bind pose to current pose), as unit dual quaternions
+// @param [indices] SKIN_INFLUENCES bone indices per vertex
+// @param [weights] SKIN_INFLUENCES weights per vertex, summing to 1. Unused influences have weight 0 and any valid index.
+// @param [normals] may be NULL, [out_normals] is then not written
+//
+// The outputs may be the same arrays as the inputs. Vectorised over 4 vertices with AVX2, where the cost is dominated
+// by reading the streams rather than by the arithmetic.
+void skin_dualquat(const DualQuaternion * bones,
+                   const uint16_t * indices, const float * weights,
+                   const Vector3 * positions, const Vector3 * normals,
+                   Vector3 * out_positions, Vector3 * out_normals,
+                   size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// skin_dualquat split across the parallel_for pool, for large meshes.
+void skin_dualquat_parallel(const DualQuaternion * bones,
+                            const uint16_t * indices, const float * weights,
+                            const Vector3 * positions, const Vector3 * normals,
+                            Vector3 * out_positions, Vector3 * out_normals,
+                            size_t count);
+
+
+#endif      // SKINNING_H
@@ -0,0 +1,698 @@
+//
+//
+//
+//
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "vec3index.h"
+#include "vector3.h"
+#include "parallel.h"
+#include "simd.h"
+
+
+#define VEC3_INDEX_TASKS_PER_THREAD     8           // subtrees per thread of vec3_index_build_parallel
+#define VEC3_INDEX_QUERY_GRAIN          64          // queries per parallel_for chunk
+
+
+// The match order, heap, quickselect, builds and parallel queries shared with quatindex.c
+#define INDEX_FN(name)              vec3_index_##name
+#define INDEX_T                     Vec3Index
+#define INDEX_POINT_T               Vector3
+#define INDEX_MATCH_T               Vec3IndexMatch
+#define INDEX_MATCH_KEY             distance
+#define INDEX_BUILD_T               Vec3Index
+#define INDEX_NODE_POINTS           0
+#define INDEX_TASKS_PER_THREAD      VEC3_INDEX_TASKS_PER_THREAD
+#define INDEX_QUERY_GRAIN           VEC3_INDEX_QUERY_GRAIN
+#include "index_impl.h"
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret position of the first point of the upper half of the node of [n] points, where its axis and split are stored
+static inline size_t vec3_index_split(size_t begin, size_t n)
+{
+    return begin + n / 2;
+}
+
+
+
+#if ! defined SIMD_KERNEL_BUILD
+//==========================================================================================================================================
+// Construction
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline void vec3_index_swap(Vec3Index * index, size_t a, size_t b)
+{
+    double x = index->x[a], y = index->y[a], z = index->z[a];
+    size_t id = index->id[a];
+
+    index->x[a] = index->x[b];      index->x[b] = x;
+    index->y[a] = index->y[b];      index->y[b] = y;
+    index->z[a] = index->z[b];      index->z[b] = z;
+    index->id[a] = index->id[b];    index->id[b] = id;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Splits the node [begin, end) in two halves along the axis of its widest extent, unless it is a leaf.
+// @param [parallel] unused, every node is split by a single thread
+// @ret false for a leaf
+static bool vec3_index_split_node(Vec3Index * index, size_t begin, size_t end, bool parallel)
+{
+    const double * c[3] = {index->x, index->y, index->z};
+    double lo[3], hi[3];
+    size_t n = end - begin, split, k;
+    int a, axis = 0;
+
+    (void) parallel;
+    if (n <= VEC3_INDEX_LEAF) {
+        return false;
+    }
+
+    for (a = 0; a < 3; a++) {
+        lo[a] = hi[a] = c[a][begin];
+        for (k = begin + 1; k < end; k++) {
+            lo[a] = (c[a][k] < lo[a]) ? c[a][k] : lo[a];
+            hi[a] = (c[a][k] > hi[a]) ? c[a][k] : hi[a];
+        }
+        if (hi[a] - lo[a] > hi[axis] - lo[axis]) {
+            axis = a;
+        }
+    }
+
+    split = vec3_index_split( begin, n );
+    vec3_index_select( index, c[axis], begin, end, split );
+    index->split[split] = c[axis][split];
+    index->axis[split] = (unsigned char) axis;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Allocates [index] and fills it with [points] in their given order.
+static bool vec3_index_init(Vec3Index * index, const Vector3 * points, size_t count)
+{
+    size_t k;
+
+    index->x = malloc( sizeof(double) * (count + 1) );
+    index->y = malloc( sizeof(double) * (count + 1) );
+    index->z = malloc( sizeof(double) * (count + 1) );
+    index->id = malloc( sizeof(size_t) * (count + 1) );
+    index->split = malloc( sizeof(double) * (count + 1) );
+    index->axis = malloc( count + 1 );
+    index->count = count;
+
+    if (index->x == NULL || index->y == NULL || index->z == NULL || index->id == NULL || index->split == NULL ||
+        index->axis == NULL) {
+        vec3_index_free( index );
+        return false;
+    }
+
+    for (k = 0; k < count; k++) {
+        index->x[k] = points[k].x;
+        index->y[k] = points[k].y;
+        index->z[k] = points[k].z;
+        index->id[k] = k;
+        index->split[k] = 0;
+        index->axis[k] = 0;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool vec3_index_build(Vec3Index * index, const Vector3 * points, size_t count)
+{
+    if (!vec3_index_init(index, points, count)) {
+        return false;
+    }
+    vec3_index_build_subtree( index, 0, count );
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool vec3_index_build_parallel(Vec3Index * index, const Vector3 * points, size_t count)
+{
+    if (!vec3_index_init(index, points, count)) {
+        return false;
+    }
+    if (!vec3_index_build_levels(index, count)) {
+        vec3_index_free( index );
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void vec3_index_free(Vec3Index * index)
+{
+    free( index->x );
+    free( index->y );
+    free( index->z );
+    free( index->id );
+    free( index->split );
+    free( index->axis );
+    index->x = NULL;
+    index->y = NULL;
+    index->z = NULL;
+    index->id = NULL;
+    index->split = NULL;
+    index->axis = NULL;
+    index->count = 0;
+}
+
+
+
+//==========================================================================================================================================
+// Single queries, over the batch kernels
+//------------------------------------------------------------------------------------------------------------------------------------------
+size_t vec3_index_knn(const Vec3Index * index, Vector3 q, size_t k, Vec3IndexMatch * out)
+{
+    k = (k < index->count) ? k : index->count;
+    vec3_index_knn_array( index, &q, 1, k, out );
+    return k;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+size_t vec3_index_radius(const Vec3Index * index, Vector3 q, double radius, Vec3IndexMatch * out, size_t max)
+{
+    size_t found;
+
+    vec3_index_radius_array( index, &q, 1, radius, out, max, &found );
+    return found;
+}
+
+#endif      // ! SIMD_KERNEL_BUILD
+
+
+
+//==========================================================================================================================================
+// Batch query kernels, one set per tier under runtime dispatch (simd.h)
+SIMD_DISPATCH_VOID(vec3_index_knn_array, (const Vec3Index * index, const Vector3 * queries, size_t count, size_t k,
+                                          Vec3IndexMatch * out),
+                   (index, queries, count, k, out))
+SIMD_DISPATCH_VOID(vec3_index_radius_array, (const Vec3Index * index, const Vector3 * queries, size_t count,
+                                             double radius, Vec3IndexMatch * out, size_t max, size_t * found),
+                   (index, queries, count, radius, out, max, found))
+
+#if defined SIMD_KERNELS
+
+// A query in progress. The matches so far are a max-heap on vec3_index_before, the worst on top, holding squared
+// distances until the end.
+typedef struct vec3_index_search {
+    const Vec3Index * index;
+    double q[3];
+    Vec3IndexMatch * heap;
+    size_t k;
+    size_t size;
+    size_t found;                       // matches within [limit], counted even when the heap is full
+    double limit;                       // squared distance beyond which nothing matches
+    bool shrink;                        // narrows tau to the worst match once the heap is full, for the k-NN queries
+    double tau;                         // squared distance beyond which nothing is searched
+    double offset[3];                   // distance along each axis from the query to the box of the node searched
+} Vec3IndexSearch;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Offers the point [k] of the index at the squared distance [d] to the search.
+static void vec3_index_consider(Vec3IndexSearch * s, size_t k, double d)
+{
+    Vec3IndexMatch m = {s->index->id[k], d};
+
+    if (d > s->limit) {
+        return;
+    }
+    s->found++;
+
+    if (vec3_index_heap_offer( s->heap, &s->size, s->k, m ) && s->shrink && s->size == s->k) {
+        s->tau = s->heap[0].distance;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Scans the leaf [begin, end), a vector of points at a time, offering the ones within tau. The squared distances are
+// summed in the same order in every tier, so that all of them find the same matches.
+static void vec3_index_scan_leaf(Vec3IndexSearch * s, size_t begin, size_t end)
+{
+    const Vec3Index * index = s->index;
+    size_t k = begin;
+    double dx, dy, dz;
+    int i, mask;
+
+#if defined SIMD_HAVE_AVX2
+    __m256d qx = _mm256_set1_pd(s->q[0]), qy = _mm256_set1_pd(s->q[1]), qz = _mm256_set1_pd(s->q[2]);
+    __m256d vx, vy, vz, d;
+    double dd[4];
+
+    for (; k + 4 <= end; k += 4) {
+        vx = _mm256_sub_pd( _mm256_loadu_pd(index->x + k), qx );
+        vy = _mm256_sub_pd( _mm256_loadu_pd(index->y + k), qy );
+        vz = _mm256_sub_pd( _mm256_loadu_pd(index->z + k), qz );
+        d = _mm256_add_pd( _mm256_add_pd(_mm256_mul_pd(vx, vx), _mm256_mul_pd(vy, vy)), _mm256_mul_pd(vz, vz) );
+        mask = _mm256_movemask_pd( _mm256_cmp_pd(d, _mm256_set1_pd(s->tau), _CMP_LE_OQ) );
+        if (mask != 0) {
+            _mm256_storeu_pd( dd, d );
+            for (i = 0; i < 4; i++) {
+                if (mask & (1 << i)) {
+                    vec3_index_consider( s, k + (size_t) i, dd[i] );
+                }
+            }
+        }
+    }
+#elif defined SIMD_HAVE_SSE2
+    __m128d qx = _mm_set1_pd(s->q[0]), qy = _mm_set1_pd(s->q[1]), qz = _mm_set1_pd(s->q[2]);
+    __m128d vx, vy, vz, d;
+    double dd[2];
+
+    for (; k + 2 <= end; k += 2) {
+        vx = _mm_sub_pd( _mm_loadu_pd(index->x + k), qx );
+        vy = _mm_sub_pd( _mm_loadu_pd(index->y + k), qy );
+        vz = _mm_sub_pd( _mm_loadu_pd(index->z + k), qz );
+        d = _mm_add_pd( _mm_add_pd(_mm_mul_pd(vx, vx), _mm_mul_pd(vy, vy)), _mm_mul_pd(vz, vz) );
+        mask = _mm_movemask_pd( _mm_cmple_pd(d, _mm_set1_pd(s->tau)) );
+        if (mask != 0) {
+            _mm_storeu_pd( dd, d );
+            for (i = 0; i < 2; i++) {
+                if (mask & (1 << i)) {
+                    vec3_index_consider( s, k + (size_t) i, dd[i] );
+                }
+            }
+        }
+    }
+#else
+    (void) i;
+    (void) mask;
+#endif
+
+    for (; k < end; k++) {
+        dx = index->x[k] - s->q[0];
+        dy = index->y[k] - s->q[1];
+        dz = index->z[k] - s->q[2];
+        dx = dx*dx + dy*dy + dz*dz;
+        if (dx <= s->tau) {
+            vec3_index_consider( s, k, dx );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Searches the node [begin, end).
+static void vec3_index_search_node(Vec3IndexSearch * s, size_t begin, size_t end)
+{
+    const Vec3Index * index = s->index;
+    size_t split;
+    double diff, offset, box;
+    int axis;
+
+    if (end - begin <= VEC3_INDEX_LEAF) {
+        vec3_index_scan_leaf( s, begin, end );
+        return;
+    }
+
+    split = vec3_index_split( begin, end - begin );
+    axis = index->axis[split];
+    diff = s->q[axis] - index->split[split];
+
+    // The nearer half first
+    if (diff < 0) {
+        vec3_index_search_node( s, begin, split );
+        begin = split;
+    } else {
+        vec3_index_search_node( s, split, end );
+        end = split;
+    }
+
+    // The other one if the ball of radius tau around the query reaches its box, the box of this node cut at the split.
+    // Summed like the squared distances of the points, so that a point at the distance of the box is never skipped.
+    offset = s->offset[axis];
+    s->offset[axis] = fabs( diff );
+    box = s->offset[0]*s->offset[0] + s->offset[1]*s->offset[1] + s->offset[2]*s->offset[2];
+    if (box <= s->tau) {
+        vec3_index_search_node( s, begin, end );
+    }
+    s->offset[axis] = offset;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Runs a query keeping the best [k] matches within the squared distance [limit] in [out], sorted.
+// @param [shrink] stops searching beyond the k-th match, so that the count of the matches within [limit] is no more
+//                 than [k]
+// @ret the number of matches within [limit]
+static size_t vec3_index_query(const Vec3Index * index, Vector3 q, size_t k, double limit, bool shrink,
+                               Vec3IndexMatch * out)
+{
+    Vec3IndexSearch s;
+    size_t i;
+
+    s.index = index;
+    s.q[0] = q.x;
+    s.q[1] = q.y;
+    s.q[2] = q.z;
+    s.heap = out;
+    s.k = k;
+    s.size = 0;
+    s.found = 0;
+    s.limit = limit;
+    s.shrink = shrink;
+    s.tau = limit;
+    s.offset[0] = s.offset[1] = s.offset[2] = 0;
+
+    if (index->count > 0) {
+        vec3_index_search_node( &s, 0, index->count );
+    }
+
+    qsort( out, s.size, sizeof(Vec3IndexMatch), vec3_index_compare );
+    for (i = 0; i < s.size; i++) {
+        out[i].distance = sqrt( out[i].distance );
+    }
+    return s.found;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_index_knn_array)(const Vec3Index * index, const Vector3 * queries, size_t count, size_t k,
+                                   Vec3IndexMatch * out)
+{
+    size_t j, i, n = (k < index->count) ? k : index->count;
+
+    if (k == 0) {
+        return;
+    }
+    for (j = 0; j < count; j++) {
+        vec3_index_query( index, queries[j], k, HUGE_VAL, true, out + j*k );
+        for (i = n; i < k; i++) {
+            out[j*k + i].id = VEC3_INDEX_NONE;
+            out[j*k + i].distance = HUGE_VAL;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @ret the largest squared distance whose square root is within [radius], so that a point is matched exactly when the
+//      distance reported for it is within [radius], which radius * radius rounded down would miss; -1 for a negative
+//      [radius]
+static double vec3_index_limit(double radius)
+{
+    double limit;
+
+    if (!(radius >= 0)) {
+        return -1;
+    }
+    limit = radius * radius;
+    while (sqrt(limit) > radius) {
+        limit = nextafter( limit, 0 );
+    }
+    while (limit < HUGE_VAL && sqrt(nextafter(limit, HUGE_VAL)) <= radius) {
+        limit = nextafter( limit, HUGE_VAL );
+    }
+    return limit;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_index_radius_array)(const Vec3Index * index, const Vector3 * queries, size_t count, double radius,
+                                      Vec3IndexMatch * out, size_t max, size_t * found)
+{
+    double limit = vec3_index_limit( radius );
+    size_t j;
+
+    for (j = 0; j < count; j++) {
+        found[j] = vec3_index_query( index, queries[j], max, limit, false, out + j*max );
+    }
+}
+
+#endif      // SIMD_KERNELS
+
+
+
+
+
+
+
+//==========================================================================================================================================
+//==========================================================================================================================================
+//==========================================================================================================================================
+#if defined VEC3INDEX_UNITTEST && ! defined SIMD_KERNEL_BUILD
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+#include "dispatch.h"
+
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Pseudo random coordinate in [-1, 1)
+static double test_vec3_index_random(unsigned * seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return (double) (*seed >> 8) / (double) (1u << 24) * 2 - 1;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Every node below [begin, end) has no coordinate above its split in its lower half and none below it in its upper
+// half, along its axis, when the split coordinate is repeated on both sides.
+static void test_vec3_index_node(const Vec3Index * index, size_t begin, size_t end)
+{
+    const double * c[3] = {index->x, index->y, index->z};
+    size_t split, k;
+    int axis;
+
+    if (end - begin <= VEC3_INDEX_LEAF) {
+        return;
+    }
+    split = vec3_index_split( begin, end - begin );
+    axis = index->axis[split];
+    g_assert_cmpint(  axis, <, 3  );
+    for (k = begin; k < end; k++) {
+        if (k < split) {
+            g_assert_cmpfloat(  c[axis][k], <=, index->split[split]  );
+        } else {
+            g_assert_cmpfloat(  c[axis][k], >=, index->split[split]  );
+        }
+    }
+    test_vec3_index_node( index, begin, split );
+    test_vec3_index_node( index, split, end );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Builds the index of the [count] points [p], serially and in parallel, then runs the k-NN and radius [r] queries under
+// every tier this build supports. The matches are those of a scan over all the points and the same in every tier, bit
+// for bit, the squared distances being summed in the same order by every leaf scan.
+static void test_vec3_index_cloud(const Vector3 * p, size_t count, const Vector3 * query, size_t queries, size_t k,
+                                  double r)
+{
+    enum { most = 1000, most_queries = 16, most_k = 12, max = 40 };
+    static Vec3IndexMatch all[most], knn[most_queries * most_k], radius[most_queries * max];
+    static Vec3IndexMatch knn_first[most_queries * most_k], radius_first[most_queries * max];
+    static size_t found[most_queries], found_first[most_queries];
+    SimdTier supported = simd_tier_supported(), initial = simd_tier();
+    Vec3Index index, parallel;
+    double dx, dy, dz;
+    size_t j, i, within;
+    bool first = true;
+    int t;
+
+    g_assert_cmpuint(  count, <=, most  );
+    g_assert_cmpuint(  queries, <=, most_queries  );
+    g_assert_cmpuint(  k, <=, most_k  );
+
+    g_assert_true(  vec3_index_build(&index, p, count)  );
+    g_assert_true(  vec3_index_build_parallel(&parallel, p, count)  );
+    g_assert_cmpint(  memcmp(index.id, parallel.id, sizeof(size_t) * count), ==, 0  );
+    g_assert_cmpint(  memcmp(index.split, parallel.split, sizeof(double) * count), ==, 0  );
+    g_assert_cmpint(  memcmp(index.axis, parallel.axis, count), ==, 0  );
+    vec3_index_free( &parallel );
+    test_vec3_index_node( &index, 0, count );
+
+    for (t = (int) SIMD_TIER_SCALAR; t <= (int) supported; t++) {
+        if (!simd_set_tier((SimdTier) t)) {
+            continue;                       // built without AGK_SIMD_DISPATCH: only the supported tier
+        }
+        memset( radius, 0, sizeof(radius) );
+        vec3_index_knn_array( &index, query, queries, k, knn );
+        vec3_index_radius_array( &index, query, queries, r, radius, max, found );
+
+        if (!first) {
+            g_assert_cmpint(  memcmp(knn, knn_first, sizeof(Vec3IndexMatch) * queries * k), ==, 0  );
+            g_assert_cmpint(  memcmp(radius, radius_first, sizeof(Vec3IndexMatch) * queries * max), ==, 0  );
+            g_assert_cmpint(  memcmp(found, found_first, sizeof(size_t) * queries), ==, 0  );
+            continue;
+        }
+        first = false;
+        memcpy( knn_first, knn, sizeof(Vec3IndexMatch) * queries * k );
+        memcpy( radius_first, radius, sizeof(Vec3IndexMatch) * queries * max );
+        memcpy( found_first, found, sizeof(size_t) * queries );
+
+        for (j = 0; j < queries; j++) {
+            for (i = 0; i < count; i++) {
+                dx = p[i].x - query[j].x;
+                dy = p[i].y - query[j].y;
+                dz = p[i].z - query[j].z;
+                all[i].id = i;
+                all[i].distance = sqrt( dx*dx + dy*dy + dz*dz );
+            }
+            qsort( all, count, sizeof(all[0]), vec3_index_compare );
+
+            for (i = 0; i < k && i < count; i++) {
+                g_assert_cmpuint(  knn[j*k + i].id, ==, all[i].id  );
+                g_assert_cmpfloat(  knn[j*k + i].distance, ==, all[i].distance  );
+            }
+            for (within = 0; within < count && all[within].distance <= r; within++) {
+            }
+            g_assert_cmpuint(  found[j], ==, within  );
+            for (i = 0; i < within && i < max; i++) {
+                g_assert_cmpuint(  radius[j*max + i].id, ==, all[i].id  );
+                g_assert_cmpfloat(  radius[j*max + i].distance, ==, all[i].distance  );
+            }
+        }
+    }
+    simd_set_tier( initial );
+    vec3_index_free( &index );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Integer lattice: every split coordinate is shared by a whole plane of points on both sides of the split, and the
+// queries have matches at exactly the radius across those planes and ties between equidistant points.
+void test_vec3_index_split_planes(void)
+{
+    enum { side = 10, count = side * side * side, queries = 6 };
+    static Vector3 p[count];
+    Vector3 query[queries] = {
+        {{4, 5, 3}},                        // on a lattice point: itself and its 6 neighbours at exactly 1
+        {{4.5, 4.5, 4.5}},                  // at a cell centre: 8 points at the same distance
+        {{4.5, 5, 3}},                      // between 2 lattice points, on 2 of the split planes
+        {{0, 0, 0}},                        // on a corner
+        {{-3, 4.5, 12}},                    // outside
+        {{9, 9, 4.5}}
+    };
+    Vec3IndexMatch match[8];
+    Vec3Index index;
+    size_t k, n;
+
+    // In a scrambled order, so that the select has to move the points of each plane
+    for (k = 0; k < count; k++) {
+        n = (k * 379) % count;
+        p[k] = vec3_from_values( (double) (n % side), (double) (n / side % side), (double) (n / side / side) );
+    }
+
+    test_vec3_index_cloud( p, count, query, queries, 9, 1.0 );
+    test_vec3_index_cloud( p, count, query, queries, 5, sqrt(0.75) );
+
+    g_assert_true(  vec3_index_build(&index, p, count)  );
+    g_assert_cmpuint(  vec3_index_radius(&index, query[0], 1.0, match, 8), ==, 7  );
+    g_assert_cmpuint(  vec3_index_radius(&index, query[1], sqrt(0.75), match, 8), ==, 8  );
+    n = vec3_index_knn( &index, query[1], 8, match );
+    g_assert_cmpuint(  n, ==, 8  );
+    for (k = 1; k < 8; k++) {
+        g_assert_cmpfloat(  match[k].distance, ==, match[0].distance  );
+        g_assert_cmpuint(  match[k].id, >, match[k - 1].id  );            // ties in the order of their id
+    }
+    vec3_index_free( &index );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Clouds with no extent along an axis, a plane then a line, whose splits all fall on the other axes.
+void test_vec3_index_flat(void)
+{
+    enum { count = 701, queries = 5 };
+    static Vector3 p[count];
+    Vector3 query[queries];
+    Vec3Index index;
+    unsigned seed = 3;
+    size_t k;
+
+    for (k = 0; k < count; k++) {
+        p[k].x = 8 * test_vec3_index_random( &seed );
+        p[k].y = 3 * test_vec3_index_random( &seed );
+        p[k].z = 2.5;
+    }
+    for (k = 0; k < queries; k++) {
+        query[k] = vec3_from_values( 8 * test_vec3_index_random(&seed), 3 * test_vec3_index_random(&seed), 2.5 );
+    }
+    query[3].z = 2.75;                      // off the plane
+    query[4] = p[100];
+
+    test_vec3_index_cloud( p, count, query, queries, 10, 0.4 );
+    g_assert_true(  vec3_index_build(&index, p, count)  );
+    for (k = 0; k < count; k++) {
+        g_assert_cmpuint(  index.axis[k], !=, 2  );
+    }
+    vec3_index_free( &index );
+
+    // A line along z, with every z value twice
+    for (k = 0; k < count; k++) {
+        p[k] = vec3_from_values( -1, 3, (double) (k % (count / 2)) * 0.125 );
+    }
+    query[0] = vec3_from_values( -1, 3, 10 );
+    query[1] = vec3_from_values( -1, 3, 10.0625 );
+    query[2] = vec3_from_values( 0, 3, 20 );
+    test_vec3_index_cloud( p, count, query, queries, 12, 0.25 );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// A cloud of a single repeated point: every select is all ties, every node has no extent, and every match ties with all
+// the others.
+void test_vec3_index_duplicates(void)
+{
+    enum { count = 997, queries = 3, max = 40 };
+    static Vector3 p[count];
+    Vector3 query[queries] = {{{1.25, -3, 7}}, {{1.25, -3, 8}}, {{0, 0, 0}}};
+    Vec3IndexMatch match[max];
+    Vec3Index index;
+    size_t k, n;
+
+    for (k = 0; k < count; k++) {
+        p[k] = query[0];
+    }
+    test_vec3_index_cloud( p, count, query, queries, 12, 1.0 );
+
+    g_assert_true(  vec3_index_build(&index, p, count)  );
+    n = vec3_index_knn( &index, query[1], 12, match );
+    g_assert_cmpuint(  n, ==, 12  );
+    for (k = 0; k < n; k++) {
+        g_assert_cmpuint(  match[k].id, ==, k  );
+        g_assert_cmpfloat(  match[k].distance, ==, 1.0  );
+    }
+    g_assert_cmpuint(  vec3_index_radius(&index, query[0], 0, match, max), ==, count  );
+    g_assert_cmpuint(  match[max - 1].id, ==, max - 1  );
+    g_assert_cmpuint(  vec3_index_radius(&index, query[1], 0.999, match, max), ==, 0  );
+    n = vec3_index_radius( &index, query[2], -1, match, max );
+    g_assert_cmpuint(  n, ==, 0  );
+    n = vec3_index_knn( &index, query[2], 0, match );
+    g_assert_cmpuint(  n, ==, 0  );
+    vec3_index_free( &index );
+
+    // Fewer points than asked for
+    g_assert_true(  vec3_index_build(&index, p, 3)  );
+    vec3_index_knn_array( &index, query, 1, 5, match );
+    g_assert_cmpuint(  match[2].id, ==, 2  );
+    g_assert_cmpuint(  match[3].id, ==, VEC3_INDEX_NONE  );
+    g_assert_true(  isinf(match[4].distance)  );
+    vec3_index_free( &index );
+    g_assert_cmpuint(  index.count, ==, 0  );
+}
+
+
+
+void setuptests(void)
+{
+    g_test_add_func("/set_vec3index/test_vec3_index_split_planes", test_vec3_index_split_planes);
+    g_test_add_func("/set_vec3index/test_vec3_index_flat", test_vec3_index_flat);
+    g_test_add_func("/set_vec3index/test_vec3_index_duplicates", test_vec3_index_duplicates);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // VEC3INDEX_UNITTEST
@@ -0,0 +1,102 @@
+//
+//
+//
+//
+//
+
+#if ! defined VEC3INDEX_H
+#define VEC3INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "vector3.h"
+
+
+// Nearest neighbour index over point clouds, for the closest points to a position or the points within a distance of
+// it without scanning all of them. The distance is the euclidean one.
+//
+// The index is a k-d tree: every node splits its points in two halves at the median of the axis along which they are
+// spread the widest, and a query visits the half it falls in first and the other only if the ball of its current
+// k-th match reaches into the box of that half.
+//
+// The tree is implicit: the points are reordered so that every node is a range, its lower half then its upper half,
+// each range of VEC3_INDEX_LEAF or fewer points being a leaf. Only the axis and the split coordinate of every node are
+// stored, at the first point of its upper half, with no pointers. The coordinates are held in three separate arrays,
+// so that a leaf is scanned a vector of points at a time.
+#define VEC3_INDEX_LEAF         16                  // most points of a leaf
+#define VEC3_INDEX_NONE         ((size_t) -1)       // id of the missing matches of vec3_index_knn_array
+
+
+typedef struct vec3_index_match {
+    size_t id;                          // position of the point in the array given to vec3_index_build
+    double distance;                    // between the query and that point
+} Vec3IndexMatch;
+
+// The fields are read-only.
+typedef struct vec3_index {
+    double * x;                         // coordinates of the points, in tree order
+    double * y;
+    double * z;
+    size_t * id;                        // position of point k in the array given to vec3_index_build
+    double * split;                     // at the first point of the upper half of every node: its split coordinate
+    unsigned char * axis;               // at the same place: its axis, 0 1 or 2 for x y or z
+    size_t count;
+} Vec3Index;
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Builds the index of [count] points. [points] is copied and may be released afterwards.
+// @ret false if out of memory, leaving [index] empty
+bool vec3_index_build(Vec3Index * index, const Vector3 * points, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// vec3_index_build with the parallel_for pool: the upper nodes are split first, the subtrees below are built one per
+// task. Gives the same index.
+bool vec3_index_build_parallel(Vec3Index * index, const Vector3 * points, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Releases the memory of [index], which is left empty.
+void vec3_index_free(Vec3Index * index);
+
+
+
+//==========================================================================================================================================
+// Queries. Matches at the same distance come in the order of their id.
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The [k] points closest to [q], closest first.
+// @param [out] receives min(k, count) matches
+// @ret number of matches, min(k, count)
+size_t vec3_index_knn(const Vec3Index * index, Vector3 q, size_t k, Vec3IndexMatch * out);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The points within [radius] of [q], closest first.
+// @param [out] receives the first min(max, found) matches
+// @ret number of points within [radius], which may exceed [max]
+size_t vec3_index_radius(const Vec3Index * index, Vector3 q, double radius, Vec3IndexMatch * out, size_t max);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// vec3_index_knn of [count] queries.
+// @param [out] receives k matches per query, query j at out + j*k; the missing ones when the index holds fewer than [k]
+//              points have the id VEC3_INDEX_NONE and an infinite distance
+void vec3_index_knn_array(const Vec3Index * index, const Vector3 * queries, size_t count, size_t k,
+                          Vec3IndexMatch * out);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// vec3_index_radius of [count] queries.
+// @param [out] receives up to [max] matches per query, query j at out + j*max
+// @param [found] receives the return value of vec3_index_radius for every query
+void vec3_index_radius_array(const Vec3Index * index, const Vector3 * queries, size_t count, double radius,
+                             Vec3IndexMatch * out, size_t max, size_t * found);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The _array queries split across the parallel_for pool.
+void vec3_index_knn_array_parallel(const Vec3Index * index, const Vector3 * queries, size_t count, size_t k,
+                                   Vec3IndexMatch * out);
+void vec3_index_radius_array_parallel(const Vec3Index * index, const Vector3 * queries, size_t count, double radius,
+                                      Vec3IndexMatch * out, size_t max, size_t * found);
+
+
+#endif      // VEC3INDEX_H
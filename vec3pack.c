@@ -0,0 +1,786 @@
+//
+//
+//
+//
+//
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+#include <string.h>
+#include <assert.h>             // for static_assert of padding inside the struct
+
+#include "vec3pack.h"
+#include "vector3.h"
+#include "simd.h"
+
+
+#if ! defined SIMD_KERNEL_BUILD
+
+static Vector3h test_vec3h_alignment;
+static_assert( sizeof(test_vec3h_alignment) == sizeof(test_vec3h_alignment.v),
+               "Error: padding detected. Vector3h arrays can not be read as one stream of halves!\n");
+
+static Vector3q16 test_vec3q16_alignment;
+static_assert( sizeof(test_vec3q16_alignment) == sizeof(test_vec3q16_alignment.v),
+               "Error: padding detected. Vector3q16 arrays can not be read as one stream of codes!\n");
+
+#endif
+
+
+
+//==========================================================================================================================================
+// Scalar conversions. The vectorised paths use the same operations in the same order, so that both give the same bits.
+//------------------------------------------------------------------------------------------------------------------------------------------
+// IEEE half precision from single precision, rounded to nearest even like _mm_cvtps_ph
+static uint16_t vec3pack_half_from_float(float f)
+{
+    uint32_t x, sign, absx, mant, q, rem, half;
+    int shift;
+
+    memcpy( &x, &f, sizeof(x) );
+    sign = (x >> 16) & 0x8000;
+    absx = x & 0x7fffffff;
+
+    if (absx > 0x7f800000) {
+        return (uint16_t) (sign | 0x7e00 | ((absx >> 13) & 0x3ff));            // NaN, kept quiet
+    }
+    if (absx >= 0x477ff000) {
+        return (uint16_t) (sign | 0x7c00);                                     // from 65520 up, infinity
+    }
+    if (absx >= 0x38800000) {
+        // Normal: rebias the exponent from 127 to 15, the carry of the rounding may move into the exponent
+        absx -= 0x38000000;
+        return (uint16_t) (sign | ((absx + 0x0fff + ((absx >> 13) & 1)) >> 13));
+    }
+    if (absx < 0x33000000) {
+        return (uint16_t) sign;                                                // below half of the smallest subnormal
+    }
+
+    // Subnormal: the value counted in units of 2^-24
+    mant = (absx & 0x7fffff) | 0x800000;
+    shift = 126 - (int) (absx >> 23);
+    q = mant >> shift;
+    rem = mant & ((1u << shift) - 1);
+    half = 1u << (shift - 1);
+    if (rem > half || (rem == half && (q & 1))) {
+        q++;
+    }
+    return (uint16_t) (sign | q);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static float vec3pack_float_from_half(uint16_t h)
+{
+    uint32_t sign = (uint32_t) (h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t x;
+    float f;
+
+    if (exponent == 0) {
+        f = (float) mant * 5.9604644775390625e-8f;                              // subnormal, mant * 2^-24 is exact
+        return sign ? -f : f;
+    }
+    if (exponent == 31) {
+        x = sign | 0x7f800000 | (mant << 13);
+    } else {
+        x = sign | ((exponent + 112) << 23) | (mant << 13);
+    }
+    memcpy( &f, &x, sizeof(f) );
+    return f;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline uint32_t vec3pack_code(double v, double min, double inv_step, double max_code)
+{
+    double t = (v - min) * inv_step;
+
+    if (!(t >= 0)) {                                                           // also sends NaN to 0, like _mm256_max_pd
+        t = 0;
+    } else if (t > max_code) {
+        t = max_code;
+    }
+    return (uint32_t) (t + 0.5);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline double vec3pack_value(uint32_t code, double min, double step)
+{
+    return min + (double) code * step;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// dot(p, vec) from the codes of p: [c0] is dot(min, vec) and [w] holds step * vec per axis
+static inline double vec3pack_dot(uint32_t x, uint32_t y, uint32_t z, double c0, const double w[3])
+{
+    return ((c0 + (double) x * w[0]) + (double) y * w[1]) + (double) z * w[2];
+}
+
+
+
+#if ! defined SIMD_KERNEL_BUILD
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+Vec3Quantization vec3_quantization_from_bounds(Vector3 min, Vector3 max, int bits)
+{
+    Vec3Quantization q;
+    double extent;
+    int k;
+
+    q.min = min;
+    q.max_code = (double) ((1u << bits) - 1u);
+
+    for (k = 0; k < 3; k++) {
+        extent = max.v[k] - min.v[k];
+        if (extent > 0) {
+            q.step.v[k] = extent / q.max_code;
+            q.inv_step.v[k] = q.max_code / extent;
+        } else {
+            q.step.v[k] = 0;
+            q.inv_step.v[k] = 0;
+        }
+    }
+
+    return q;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Vector3h vec3h_from_vec3(Vector3 vec)
+{
+    Vector3h r;
+    int k;
+
+    for (k = 0; k < 3; k++) {
+        r.v[k] = vec3pack_half_from_float( (float) vec.v[k] );
+    }
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Vector3 vec3_from_vec3h(Vector3h vec)
+{
+    Vector3 r;
+    int k;
+
+    for (k = 0; k < 3; k++) {
+        r.v[k] = (double) vec3pack_float_from_half( vec.v[k] );
+    }
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Vector3q16 vec3q16_from_vec3(Vector3 vec, Vec3Quantization quant)
+{
+    Vector3q16 r;
+    int k;
+
+    for (k = 0; k < 3; k++) {
+        r.v[k] = (uint16_t) vec3pack_code( vec.v[k], quant.min.v[k], quant.inv_step.v[k], quant.max_code );
+    }
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Vector3 vec3_from_vec3q16(Vector3q16 vec, Vec3Quantization quant)
+{
+    Vector3 r;
+    int k;
+
+    for (k = 0; k < 3; k++) {
+        r.v[k] = vec3pack_value( vec.v[k], quant.min.v[k], quant.step.v[k] );
+    }
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Vector3q21 vec3q21_from_vec3(Vector3 vec, Vec3Quantization quant)
+{
+    Vector3q21 r = 0;
+    int k;
+
+    for (k = 0; k < 3; k++) {
+        r |= (uint64_t) vec3pack_code( vec.v[k], quant.min.v[k], quant.inv_step.v[k], quant.max_code ) << (21 * k);
+    }
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+Vector3 vec3_from_vec3q21(Vector3q21 vec, Vec3Quantization quant)
+{
+    Vector3 r;
+    int k;
+
+    for (k = 0; k < 3; k++) {
+        r.v[k] = vec3pack_value( (uint32_t) (vec >> (21 * k)) & 0x1fffff, quant.min.v[k], quant.step.v[k] );
+    }
+    return r;
+}
+
+
+
+#endif      // ! SIMD_KERNEL_BUILD
+
+
+
+//==========================================================================================================================================
+// Batch kernels, one set per tier under runtime dispatch (simd.h)
+SIMD_DISPATCH_VOID(vec3h_from_vec3_array, (const Vector3 * in, Vector3h * out, size_t count), (in, out, count))
+SIMD_DISPATCH_VOID(vec3_from_vec3h_array, (const Vector3h * in, Vector3 * out, size_t count), (in, out, count))
+SIMD_DISPATCH_VOID(vec3h_add_array, (const Vector3h * a, const Vector3h * b, Vector3h * out, size_t count),
+                   (a, b, out, count))
+SIMD_DISPATCH_VOID(vec3h_scale_array, (const Vector3h * in, float scalar, Vector3h * out, size_t count),
+                   (in, scalar, out, count))
+SIMD_DISPATCH_VOID(vec3h_dot_array, (const Vector3h * a, const Vector3h * b, float * out, size_t count),
+                   (a, b, out, count))
+SIMD_DISPATCH_VOID(vec3q16_from_vec3_array, (const Vector3 * in, Vec3Quantization quant, Vector3q16 * out,
+                                             size_t count),
+                   (in, quant, out, count))
+SIMD_DISPATCH_VOID(vec3_from_vec3q16_array, (const Vector3q16 * in, Vec3Quantization quant, Vector3 * out,
+                                             size_t count),
+                   (in, quant, out, count))
+SIMD_DISPATCH_VOID(vec3q16_dot_array, (const Vector3q16 * in, Vec3Quantization quant, Vector3 vec, double * out,
+                                       size_t count),
+                   (in, quant, vec, out, count))
+SIMD_DISPATCH_VOID(vec3q21_from_vec3_array, (const Vector3 * in, Vec3Quantization quant, Vector3q21 * out,
+                                             size_t count),
+                   (in, quant, out, count))
+SIMD_DISPATCH_VOID(vec3_from_vec3q21_array, (const Vector3q21 * in, Vec3Quantization quant, Vector3 * out,
+                                             size_t count),
+                   (in, quant, out, count))
+SIMD_DISPATCH_VOID(vec3q21_dot_array, (const Vector3q21 * in, Vec3Quantization quant, Vector3 vec, double * out,
+                                       size_t count),
+                   (in, quant, vec, out, count))
+
+#if defined SIMD_KERNELS
+
+//==========================================================================================================================================
+// Half precision arrays are handled as one stream of 3 * count halves, except for the dot product.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3h_from_vec3_array)(const Vector3 * in, Vector3h * out, size_t count)
+{
+    const double * src = in->v;
+    uint16_t * dst = out->v;
+    size_t n = 3 * count, k = 0;
+
+#if defined SIMD_HAVE_F16C
+    for (; k + 4 <= n; k += 4) {
+        _mm_storel_epi64( (__m128i *) (dst + k),
+                          _mm_cvtps_ph(_mm256_cvtpd_ps(_mm256_loadu_pd(src + k)), _MM_FROUND_TO_NEAREST_INT) );
+    }
+#endif
+
+    for (; k < n; k++) {
+        dst[k] = vec3pack_half_from_float( (float) src[k] );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_from_vec3h_array)(const Vector3h * in, Vector3 * out, size_t count)
+{
+    const uint16_t * src = in->v;
+    double * dst = out->v;
+    size_t n = 3 * count, k = 0;
+
+#if defined SIMD_HAVE_F16C
+    __m256 f;
+
+    for (; k + 8 <= n; k += 8) {
+        f = _mm256_cvtph_ps( _mm_loadu_si128((const __m128i *) (src + k)) );
+        _mm256_storeu_pd( dst + k, _mm256_cvtps_pd(_mm256_castps256_ps128(f)) );
+        _mm256_storeu_pd( dst + k + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(f, 1)) );
+    }
+#endif
+
+    for (; k < n; k++) {
+        dst[k] = (double) vec3pack_float_from_half( src[k] );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3h_add_array)(const Vector3h * a, const Vector3h * b, Vector3h * out, size_t count)
+{
+    const uint16_t * sa = a->v;
+    const uint16_t * sb = b->v;
+    uint16_t * dst = out->v;
+    size_t n = 3 * count, k = 0;
+
+#if defined SIMD_HAVE_F16C
+    __m256 fa, fb;
+
+    for (; k + 8 <= n; k += 8) {
+        fa = _mm256_cvtph_ps( _mm_loadu_si128((const __m128i *) (sa + k)) );
+        fb = _mm256_cvtph_ps( _mm_loadu_si128((const __m128i *) (sb + k)) );
+        _mm_storeu_si128( (__m128i *) (dst + k), _mm256_cvtps_ph(_mm256_add_ps(fa, fb), _MM_FROUND_TO_NEAREST_INT) );
+    }
+#endif
+
+    for (; k < n; k++) {
+        dst[k] = vec3pack_half_from_float( vec3pack_float_from_half(sa[k]) + vec3pack_float_from_half(sb[k]) );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3h_scale_array)(const Vector3h * in, float scalar, Vector3h * out, size_t count)
+{
+    const uint16_t * src = in->v;
+    uint16_t * dst = out->v;
+    size_t n = 3 * count, k = 0;
+
+#if defined SIMD_HAVE_F16C
+    const __m256 s = _mm256_set1_ps( scalar );
+    __m256 f;
+
+    for (; k + 8 <= n; k += 8) {
+        f = _mm256_cvtph_ps( _mm_loadu_si128((const __m128i *) (src + k)) );
+        _mm_storeu_si128( (__m128i *) (dst + k), _mm256_cvtps_ph(_mm256_mul_ps(f, s), _MM_FROUND_TO_NEAREST_INT) );
+    }
+#endif
+
+    for (; k < n; k++) {
+        dst[k] = vec3pack_half_from_float( vec3pack_float_from_half(src[k]) * scalar );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3h_dot_array)(const Vector3h * a, const Vector3h * b, float * out, size_t count)
+{
+    const uint16_t * sa = a->v;
+    const uint16_t * sb = b->v;
+    size_t k = 0;
+    float x, y, z;
+
+#if defined SIMD_HAVE_F16C
+    __m128 p[3], px, py, pz;
+    int j;
+
+    // 4 vectors are 12 halves: the products of 3 groups of 4 are transposed into x, y and z lanes and summed
+    for (; k + 4 <= count; k += 4) {
+        for (j = 0; j < 3; j++) {
+            p[j] = _mm_mul_ps( _mm_cvtph_ps(_mm_loadl_epi64((const __m128i *) (sa + 3*k + 4*(size_t) j))),
+                               _mm_cvtph_ps(_mm_loadl_epi64((const __m128i *) (sb + 3*k + 4*(size_t) j))) );
+        }
+        simd_deinterleave_xyz4f( p[0], p[1], p[2], &px, &py, &pz );
+        _mm_storeu_ps( out + k, _mm_add_ps(_mm_add_ps(px, py), pz) );
+    }
+#endif
+
+    for (; k < count; k++) {
+        x = vec3pack_float_from_half( sa[3*k] ) * vec3pack_float_from_half( sb[3*k] );
+        y = vec3pack_float_from_half( sa[3*k + 1] ) * vec3pack_float_from_half( sb[3*k + 1] );
+        z = vec3pack_float_from_half( sa[3*k + 2] ) * vec3pack_float_from_half( sb[3*k + 2] );
+        out[k] = (x + y) + z;
+    }
+}
+
+
+
+//==========================================================================================================================================
+// Vector3q16 arrays are one stream of codes too: 4 vectors are 12 codes, and the per axis constants are laid out in
+// 3 registers that repeat the x y z pattern, (x y z x) (y z x y) (z x y z).
+//------------------------------------------------------------------------------------------------------------------------------------------
+#if defined SIMD_HAVE_AVX2
+static inline void vec3pack_pattern(Vector3 v, __m256d p[3])
+{
+    p[0] = _mm256_setr_pd( v.x, v.y, v.z, v.x );
+    p[1] = _mm256_setr_pd( v.y, v.z, v.x, v.y );
+    p[2] = _mm256_setr_pd( v.z, v.x, v.y, v.z );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The 12 16 bit codes at [src] as doubles in 3 registers
+static inline void vec3pack_load_q16(const uint16_t * src, __m256d c[3])
+{
+    __m128i lo = _mm_loadu_si128( (const __m128i *) src );
+    __m128i hi = _mm_loadl_epi64( (const __m128i *) (src + 8) );
+
+    c[0] = _mm256_cvtepi32_pd( _mm_cvtepu16_epi32(lo) );
+    c[1] = _mm256_cvtepi32_pd( _mm_cvtepu16_epi32(_mm_srli_si128(lo, 8)) );
+    c[2] = _mm256_cvtepi32_pd( _mm_cvtepu16_epi32(hi) );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// vec3pack_code of 4 values
+static inline __m128i vec3pack_code4(__m256d v, __m256d min, __m256d inv_step, __m256d max_code)
+{
+    __m256d t = _mm256_mul_pd( _mm256_sub_pd(v, min), inv_step );
+
+    t = _mm256_min_pd( _mm256_max_pd(t, _mm256_setzero_pd()), max_code );
+    return _mm256_cvttpd_epi32( _mm256_add_pd(t, _mm256_set1_pd(0.5)) );
+}
+#endif
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3q16_from_vec3_array)(const Vector3 * in, Vec3Quantization quant, Vector3q16 * out, size_t count)
+{
+    const double * src = in->v;
+    uint16_t * dst = out->v;
+    size_t n = 3 * count, k = 0;
+    int axis;
+
+#if defined SIMD_HAVE_AVX2
+    const __m256d max_code = _mm256_set1_pd( quant.max_code );
+    __m256d min[3], inv[3];
+    __m128i c[3];
+    int j;
+
+    vec3pack_pattern( quant.min, min );
+    vec3pack_pattern( quant.inv_step, inv );
+
+    for (; k + 12 <= n; k += 12) {
+        for (j = 0; j < 3; j++) {
+            c[j] = vec3pack_code4( _mm256_loadu_pd(src + k + 4*(size_t) j), min[j], inv[j], max_code );
+        }
+        _mm_storeu_si128( (__m128i *) (dst + k), _mm_packus_epi32(c[0], c[1]) );
+        _mm_storel_epi64( (__m128i *) (dst + k + 8), _mm_packus_epi32(c[2], c[2]) );
+    }
+#endif
+
+    for (; k < n; k++) {
+        axis = (int) (k % 3);
+        dst[k] = (uint16_t) vec3pack_code( src[k], quant.min.v[axis], quant.inv_step.v[axis], quant.max_code );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_from_vec3q16_array)(const Vector3q16 * in, Vec3Quantization quant, Vector3 * out, size_t count)
+{
+    const uint16_t * src = in->v;
+    double * dst = out->v;
+    size_t n = 3 * count, k = 0;
+    int axis;
+
+#if defined SIMD_HAVE_AVX2
+    __m256d min[3], step[3], c[3];
+    int j;
+
+    vec3pack_pattern( quant.min, min );
+    vec3pack_pattern( quant.step, step );
+
+    for (; k + 12 <= n; k += 12) {
+        vec3pack_load_q16( src + k, c );
+        for (j = 0; j < 3; j++) {
+            _mm256_storeu_pd( dst + k + 4*(size_t) j, _mm256_add_pd(min[j], _mm256_mul_pd(c[j], step[j])) );
+        }
+    }
+#endif
+
+    for (; k < n; k++) {
+        axis = (int) (k % 3);
+        dst[k] = vec3pack_value( src[k], quant.min.v[axis], quant.step.v[axis] );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3q16_dot_array)(const Vector3q16 * in, Vec3Quantization quant, Vector3 vec, double * out, size_t count)
+{
+    const uint16_t * src = in->v;
+    double c0 = quant.min.x * vec.x + quant.min.y * vec.y + quant.min.z * vec.z;
+    double w[3] = { quant.step.x * vec.x, quant.step.y * vec.y, quant.step.z * vec.z };
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2
+    __m256d wp[3], c[3], x, y, z;
+    int j;
+
+    vec3pack_pattern( vec3_from_values(w[0], w[1], w[2]), wp );
+
+    for (; k + 4 <= count; k += 4) {
+        vec3pack_load_q16( src + 3*k, c );
+        for (j = 0; j < 3; j++) {
+            c[j] = _mm256_mul_pd( c[j], wp[j] );
+        }
+        simd_deinterleave_xyz4( c[0], c[1], c[2], &x, &y, &z );
+        _mm256_storeu_pd( out + k, _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_set1_pd(c0), x), y), z) );
+    }
+#endif
+
+    for (; k < count; k++) {
+        out[k] = vec3pack_dot( src[3*k], src[3*k + 1], src[3*k + 2], c0, w );
+    }
+}
+
+
+
+//==========================================================================================================================================
+// Vector3q21 packs a whole vector in each 64 bit lane, so 4 vectors are transposed into x, y and z lanes directly.
+//------------------------------------------------------------------------------------------------------------------------------------------
+#if defined SIMD_HAVE_AVX2
+static inline void vec3pack_load_q21(const Vector3q21 * src, __m256d * x, __m256d * y, __m256d * z)
+{
+    const __m256i mask = _mm256_set1_epi64x( 0x1fffff );
+    __m256i p = _mm256_loadu_si256( (const __m256i *) src );
+
+    *x = _mm256_cvtepi32_pd( simd_low32_epi64(_mm256_and_si256(p, mask)) );
+    *y = _mm256_cvtepi32_pd( simd_low32_epi64(_mm256_and_si256(_mm256_srli_epi64(p, 21), mask)) );
+    *z = _mm256_cvtepi32_pd( simd_low32_epi64(_mm256_srli_epi64(p, 42)) );
+}
+#endif
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3q21_from_vec3_array)(const Vector3 * in, Vec3Quantization quant, Vector3q21 * out, size_t count)
+{
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2
+    const __m256d max_code = _mm256_set1_pd( quant.max_code );
+    __m256d x, y, z;
+    __m256i p;
+
+    for (; k + 4 <= count; k += 4) {
+        simd_load_xyz4( in[k].v, &x, &y, &z );
+        p = _mm256_cvtepu32_epi64( vec3pack_code4(x, _mm256_set1_pd(quant.min.x), _mm256_set1_pd(quant.inv_step.x), max_code) );
+        p = _mm256_or_si256( p, _mm256_slli_epi64(_mm256_cvtepu32_epi64(vec3pack_code4(y, _mm256_set1_pd(quant.min.y),
+                                                       _mm256_set1_pd(quant.inv_step.y), max_code)), 21) );
+        p = _mm256_or_si256( p, _mm256_slli_epi64(_mm256_cvtepu32_epi64(vec3pack_code4(z, _mm256_set1_pd(quant.min.z),
+                                                       _mm256_set1_pd(quant.inv_step.z), max_code)), 42) );
+        _mm256_storeu_si256( (__m256i *) (out + k), p );
+    }
+#endif
+
+    for (; k < count; k++) {
+        out[k] = vec3q21_from_vec3( in[k], quant );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_from_vec3q21_array)(const Vector3q21 * in, Vec3Quantization quant, Vector3 * out, size_t count)
+{
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2
+    __m256d x, y, z;
+
+    for (; k + 4 <= count; k += 4) {
+        vec3pack_load_q21( in + k, &x, &y, &z );
+        simd_store_xyz4( out[k].v, _mm256_add_pd(_mm256_set1_pd(quant.min.x), _mm256_mul_pd(x, _mm256_set1_pd(quant.step.x))),
+                                   _mm256_add_pd(_mm256_set1_pd(quant.min.y), _mm256_mul_pd(y, _mm256_set1_pd(quant.step.y))),
+                                   _mm256_add_pd(_mm256_set1_pd(quant.min.z), _mm256_mul_pd(z, _mm256_set1_pd(quant.step.z))) );
+    }
+#endif
+
+    for (; k < count; k++) {
+        out[k] = vec3_from_vec3q21( in[k], quant );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3q21_dot_array)(const Vector3q21 * in, Vec3Quantization quant, Vector3 vec, double * out, size_t count)
+{
+    double c0 = quant.min.x * vec.x + quant.min.y * vec.y + quant.min.z * vec.z;
+    double w[3] = { quant.step.x * vec.x, quant.step.y * vec.y, quant.step.z * vec.z };
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2
+    __m256d x, y, z, d;
+
+    for (; k + 4 <= count; k += 4) {
+        vec3pack_load_q21( in + k, &x, &y, &z );
+        d = _mm256_add_pd( _mm256_set1_pd(c0), _mm256_mul_pd(x, _mm256_set1_pd(w[0])) );
+        d = _mm256_add_pd( d, _mm256_mul_pd(y, _mm256_set1_pd(w[1])) );
+        _mm256_storeu_pd( out + k, _mm256_add_pd(d, _mm256_mul_pd(z, _mm256_set1_pd(w[2]))) );
+    }
+#endif
+
+    for (; k < count; k++) {
+        out[k] = vec3pack_dot( (uint32_t) in[k] & 0x1fffff, (uint32_t) (in[k] >> 21) & 0x1fffff, (uint32_t) (in[k] >> 42),
+                               c0, w );
+    }
+}
+
+#endif      // SIMD_KERNELS
+
+
+
+
+
+
+
+
+
+//==========================================================================================================================================
+// Unit testing facilities
+#if defined VEC3PACK_UNITTEST && ! defined SIMD_KERNEL_BUILD
+
+// You only need to include <glib-2.0/glib.h> for this to function.
+// BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
+// if you want an IDE like QT Creator to do name highlighting and auto completion
+
+#include <glib-2.0/glib.h>      // testing facilities
+#include <glib/gtestutils.h>
+
+
+
+#define TESTCOUNT   1001
+
+// Points spread over [-50, 50] x [0, 10] x [-1, 1]; the first few sit on the corners of that box or outside of it
+static void test_points(Vector3 * p)
+{
+    unsigned seed = 4242;
+    double r[3];
+    size_t k;
+    int j;
+
+    for (k = 0; k < TESTCOUNT; k++) {
+        for (j = 0; j < 3; j++) {
+            seed = seed * 1103515245u + 12345u;
+            r[j] = (double) (seed >> 8) / (double) (1u << 24);
+        }
+        p[k] = vec3_from_values( -50.0 + 100.0 * r[0], 10.0 * r[1], -1.0 + 2.0 * r[2] );
+    }
+    p[0] = vec3_from_values( -50.0, 0.0, -1.0 );
+    p[1] = vec3_from_values( 50.0, 10.0, 1.0 );
+    p[2] = vec3_from_values( -60.0, 11.0, -1.5 );
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Known encodings, including the rounding ties and the subnormal and overflow ranges, and the round trip of every half
+void test_vec3h_conversion(void)
+{
+    const struct {
+        float f;
+        uint16_t h;
+    } known[] = {
+        { 1.0f, 0x3c00 }, { -2.0f, 0xc000 }, { 0.0f, 0x0000 }, { 65504.0f, 0x7bff }, { 65519.0f, 0x7bff },
+        { 65520.0f, 0x7c00 }, { 1e10f, 0x7c00 }, { 6.103515625e-5f, 0x0400 }, { 5.9604644775390625e-8f, 0x0001 },
+        { 2.98023223876953125e-8f, 0x0000 }, { 8.94069671630859375e-8f, 0x0002 }, { 1e-10f, 0x0000 },
+        { 1.00048828125f, 0x3c00 }, { 1.00146484375f, 0x3c02 }, { 0.333333333f, 0x3555 }
+    };
+    Vector3 v = {{ 1.0, -0.5, 1000.5 }};
+    size_t k;
+    float f;
+
+    for (k = 0; k < sizeof(known) / sizeof(known[0]); k++) {
+        g_assert_cmphex( vec3pack_half_from_float(known[k].f), ==, known[k].h );
+    }
+
+    for (k = 0; k < 0x10000; k++) {
+        if ((k & 0x7c00) == 0x7c00 && (k & 0x3ff) != 0) {
+            continue;                                                       // NaN
+        }
+        f = vec3pack_float_from_half( (uint16_t) k );
+        g_assert_cmphex( vec3pack_half_from_float(f), ==, k );
+    }
+
+    g_assert_true(  vec3_equal(vec3_from_vec3h(vec3h_from_vec3(v)), v)  );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void test_vec3q_conversion(void)
+{
+    Vec3Quantization q16 = vec3_quantization_from_bounds( vec3_from_values(-50.0, 0.0, -1.0),
+                                                          vec3_from_values(50.0, 10.0, 1.0), VEC3_Q16_BITS );
+    Vec3Quantization q21 = vec3_quantization_from_bounds( vec3_from_values(-50.0, 0.0, -1.0),
+                                                          vec3_from_values(50.0, 10.0, 1.0), VEC3_Q21_BITS );
+    Vec3Quantization flat = vec3_quantization_from_bounds( vec3_from_values(0.0, 0.0, 0.0),
+                                                           vec3_from_values(1.0, 1.0, 0.0), VEC3_Q16_BITS );
+    Vector3 p[TESTCOUNT], r;
+    size_t k;
+    int j;
+
+    test_points( p );
+    for (k = 3; k < TESTCOUNT; k++) {
+        r = vec3_from_vec3q16( vec3q16_from_vec3(p[k], q16), q16 );
+        for (j = 0; j < 3; j++) {
+            g_assert_cmpfloat( fabs(r.v[j] - p[k].v[j]), <=, q16.step.v[j] * 0.5 * (1 + 1e-9) );
+        }
+        r = vec3_from_vec3q21( vec3q21_from_vec3(p[k], q21), q21 );
+        for (j = 0; j < 3; j++) {
+            g_assert_cmpfloat( fabs(r.v[j] - p[k].v[j]), <=, q21.step.v[j] * 0.5 * (1 + 1e-9) );
+        }
+    }
+
+    // The corners are exact, points outside are clamped onto the box
+    g_assert_true(  vec3_equal(vec3_from_vec3q16(vec3q16_from_vec3(p[0], q16), q16), p[0])  );
+    g_assert_true(  vec3_equal(vec3_from_vec3q21(vec3q21_from_vec3(p[1], q21), q21), p[1])  );
+    r = vec3_from_vec3q16( vec3q16_from_vec3(p[2], q16), q16 );
+    g_assert_true(  vec3_equal(r, vec3_from_values(-50.0, 10.0, -1.0))  );
+
+    r = vec3_from_vec3q16( vec3q16_from_vec3(vec3_from_values(0.5, 0.25, 3.0), flat), flat );
+    g_assert_cmpfloat( r.z, ==, 0.0 );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The batch functions give the same bits as the single value ones, also for the arithmetic on packed arrays
+void test_vec3pack_array(void)
+{
+    Vec3Quantization q16 = vec3_quantization_from_bounds( vec3_from_values(-50.0, 0.0, -1.0),
+                                                          vec3_from_values(50.0, 10.0, 1.0), VEC3_Q16_BITS );
+    Vec3Quantization q21 = vec3_quantization_from_bounds( vec3_from_values(-50.0, 0.0, -1.0),
+                                                          vec3_from_values(50.0, 10.0, 1.0), VEC3_Q21_BITS );
+    Vector3 normal = vec3_norm( vec3_from_values(0.3, -0.8, 0.5) );
+    Vector3 p[TESTCOUNT], r[TESTCOUNT], s;
+    Vector3h h[TESTCOUNT], h2[TESTCOUNT], sh;
+    Vector3q16 c16[TESTCOUNT], s16;
+    Vector3q21 c21[TESTCOUNT];
+    double d[TESTCOUNT];
+    float df[TESTCOUNT], x, y, z;
+    size_t k;
+
+    test_points( p );
+
+    vec3h_from_vec3_array( p, h, TESTCOUNT );
+    vec3_from_vec3h_array( h, r, TESTCOUNT );
+    for (k = 0; k < TESTCOUNT; k++) {
+        sh = vec3h_from_vec3( p[k] );
+        g_assert_true(  memcmp(&sh, &h[k], sizeof(sh)) == 0  );
+        s = vec3_from_vec3h( h[k] );
+        g_assert_true(  memcmp(&s, &r[k], sizeof(s)) == 0  );
+    }
+
+    vec3h_scale_array( h, 0.25f, h2, TESTCOUNT );
+    vec3h_add_array( h, h2, h2, TESTCOUNT );
+    vec3h_dot_array( h, h2, df, TESTCOUNT );
+    for (k = 0; k < TESTCOUNT; k++) {
+        s = vec3_from_vec3h( h[k] );
+        sh = vec3h_from_vec3( vec3_add(s, vec3_from_vec3h(vec3h_from_vec3(vec3_scalar_mul(s, 0.25)))) );
+        g_assert_true(  memcmp(&sh, &h2[k], sizeof(sh)) == 0  );
+
+        x = (float) s.x * vec3pack_float_from_half( h2[k].v[0] );
+        y = (float) s.y * vec3pack_float_from_half( h2[k].v[1] );
+        z = (float) s.z * vec3pack_float_from_half( h2[k].v[2] );
+        g_assert_cmpfloat( df[k], ==, (x + y) + z );
+    }
+
+    vec3q16_from_vec3_array( p, q16, c16, TESTCOUNT );
+    vec3_from_vec3q16_array( c16, q16, r, TESTCOUNT );
+    vec3q16_dot_array( c16, q16, normal, d, TESTCOUNT );
+    for (k = 0; k < TESTCOUNT; k++) {
+        s16 = vec3q16_from_vec3( p[k], q16 );
+        g_assert_true(  memcmp(&s16, &c16[k], sizeof(s16)) == 0  );
+        s = vec3_from_vec3q16( c16[k], q16 );
+        g_assert_true(  memcmp(&s, &r[k], sizeof(s)) == 0  );
+        g_assert_cmpfloat( fabs(d[k] - vec3_dot(r[k], normal)), <, 1e-12 );
+    }
+
+    vec3q21_from_vec3_array( p, q21, c21, TESTCOUNT );
+    vec3_from_vec3q21_array( c21, q21, r, TESTCOUNT );
+    vec3q21_dot_array( c21, q21, normal, d, TESTCOUNT );
+    for (k = 0; k < TESTCOUNT; k++) {
+        g_assert_cmpuint( c21[k], ==, vec3q21_from_vec3(p[k], q21) );
+        s = vec3_from_vec3q21( c21[k], q21 );
+        g_assert_true(  memcmp(&s, &r[k], sizeof(s)) == 0  );
+        g_assert_cmpfloat( fabs(d[k] - vec3_dot(r[k], normal)), <, 1e-12 );
+    }
+}
+
+
+
+void setuptests(void)
+{
+    g_test_add_func("/set_vec3pack/test_vec3h_conversion", test_vec3h_conversion);
+    g_test_add_func("/set_vec3pack/test_vec3q_conversion", test_vec3q_conversion);
+    g_test_add_func("/set_vec3pack/test_vec3pack_array", test_vec3pack_array);
+}
+
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions();
+    setuptests();
+    return g_test_run();
+}
+
+#endif          // VEC3PACK_UNITTEST
@@ -0,0 +1,106 @@
+//
+//
+//
+//
+//
+
+#if ! defined VEC3PACK_H
+#define VEC3PACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector3.h"
+
+
+// Compact storage of Vector3 points, 6 or 8 bytes instead of 24:
+//
+//  format       bytes  encoding                                     error per component
+//  Vector3h       6    IEEE half precision floats                   relative 2^-11 (4.9e-4), |v| <= 65504
+//  Vector3q16     6    16 bit codes over the box of a quantization  extent / (2 * 65535)
+//  Vector3q21     8    21 bit codes over the box of a quantization  extent / (2 * 2097151)
+//
+// Half precision suits data centred on the origin such as normals or offsets, fixed point suits points spread over a
+// known box, whose precision is then the same everywhere in it. Half precision values are rounded to single precision
+// first, then to half precision, both to nearest even.
+typedef struct vector3h {
+    uint16_t v[3];
+} Vector3h;
+
+typedef struct vector3q16 {
+    uint16_t v[3];
+} Vector3q16;
+
+typedef uint64_t Vector3q21;                // x | y << 21 | z << 42
+
+#define VEC3_Q16_BITS       16
+#define VEC3_Q21_BITS       21
+
+
+// Mapping between a box and the fixed point codes: code = round((p - min) / step), clamped to the box.
+// Make one with vec3_quantization_from_bounds and the bits of the format it is used with.
+typedef struct vec3_quantization {
+    Vector3 min;
+    Vector3 step;                           // extent of one code along each axis
+    Vector3 inv_step;                       // 0 on the axes where the box is flat
+    double max_code;
+} Vec3Quantization;
+
+
+
+//==========================================================================================================================================
+//------------------------------------------------------------------------------------------------------------------------------------------
+// @param [min] [max] corners of the box holding the points
+// @param [bits] VEC3_Q16_BITS or VEC3_Q21_BITS
+Vec3Quantization vec3_quantization_from_bounds(Vector3 min, Vector3 max, int bits);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Single values. Points outside the box of [quant] are clamped onto it.
+Vector3h vec3h_from_vec3(Vector3 vec);
+Vector3 vec3_from_vec3h(Vector3h vec);
+Vector3q16 vec3q16_from_vec3(Vector3 vec, Vec3Quantization quant);
+Vector3 vec3_from_vec3q16(Vector3q16 vec, Vec3Quantization quant);
+Vector3q21 vec3q21_from_vec3(Vector3 vec, Vec3Quantization quant);
+Vector3 vec3_from_vec3q21(Vector3q21 vec, Vec3Quantization quant);
+
+
+
+//==========================================================================================================================================
+// Batch conversions of [count] vectors, giving the same bits as the single value functions. Vectorised over 4 vectors
+// with AVX2, the half precision ones with F16C.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void vec3h_from_vec3_array(const Vector3 * in, Vector3h * out, size_t count);
+void vec3_from_vec3h_array(const Vector3h * in, Vector3 * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void vec3q16_from_vec3_array(const Vector3 * in, Vec3Quantization quant, Vector3q16 * out, size_t count);
+void vec3_from_vec3q16_array(const Vector3q16 * in, Vec3Quantization quant, Vector3 * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+void vec3q21_from_vec3_array(const Vector3 * in, Vec3Quantization quant, Vector3q21 * out, size_t count);
+void vec3_from_vec3q21_array(const Vector3q21 * in, Vec3Quantization quant, Vector3 * out, size_t count);
+
+
+
+//==========================================================================================================================================
+// Arithmetic straight on packed arrays: the vectors are decoded into registers only, never into a Vector3 array.
+//------------------------------------------------------------------------------------------------------------------------------------------
+// out[k] = a[k] + b[k] in single precision, rounded back to half precision. [out] may be [a] or [b].
+void vec3h_add_array(const Vector3h * a, const Vector3h * b, Vector3h * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// out[k] = in[k] * [scalar] in single precision, rounded back to half precision. [out] may be [in].
+void vec3h_scale_array(const Vector3h * in, float scalar, Vector3h * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// out[k] = dot(a[k], b[k]) in single precision
+void vec3h_dot_array(const Vector3h * a, const Vector3h * b, float * out, size_t count);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// out[k] = dot(in[k], [vec]) in double precision, e.g. the signed distances of the points to a plane of normal [vec]
+// when [vec] is unit. Computed from the codes as dot(min, vec) + sum of code * step * vec, without decoding the points.
+void vec3q16_dot_array(const Vector3q16 * in, Vec3Quantization quant, Vector3 vec, double * out, size_t count);
+void vec3q21_dot_array(const Vector3q21 * in, Vec3Quantization quant, Vector3 vec, double * out, size_t count);
+
+
+#endif      // VEC3PACK_H
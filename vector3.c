@@ -8,6 +8,14 @@
 
 
 
+// This file provides the out-of-line symbols, it is never built in header-only mode (see vector3.h).
+// Its kernel builds (simd.h) provide none of them, and take the inline versions for the scalar loops.
+#if defined SIMD_KERNEL_BUILD
+#define AGK_INLINE
+#else
+#undef AGK_INLINE
+#endif
+
 #include <stdio.h>
 #include <tgmath.h>
 #include <string.h>
@@ -15,153 +23,730 @@
 #include <assert.h>         // for static_assert of padding inside the struct
 
 #include "vector3.h"
+#include "simd.h"           // SSE2 / AVX2 kernels of the batch functions
+
 
 
+#if ! defined SIMD_KERNEL_BUILD
 
 static Vector3 test_vec3_alignment;
 static_assert( sizeof(test_vec3_alignment) == sizeof(test_vec3_alignment.v),
                "Error: padding detected. Vector3 can not be represented correctly!  Going nowhere without my Vector3!\n" );
 
+static Vector3f test_vec3f_alignment;
+static_assert( sizeof(test_vec3f_alignment) == sizeof(test_vec3f_alignment.v),
+               "Error: padding detected. Vector3f can not be represented correctly!  Going nowhere without my Vector3f!\n" );
+
+
+//===============================================================================================================
+// Both precisions are generated from the same source
+#define VEC3_T          Vector3
+#define VEC3_REAL       double
+#define VEC3_FN(name)   vec3_##name
+#define VEC3_MATH(name) name
+#include "vector3_impl.h"
+
+#define VEC3_T          Vector3f
+#define VEC3_REAL       float
+#define VEC3_FN(name)   vec3f_##name
+#define VEC3_MATH(name) name##f
+#include "vector3_impl.h"
 
-static int i = 0;           // used for counting in loops
 
 
 //===============================================================================================================
 //---------------------------------------------------------------------------------------------------------------
-Vector3 vec3_from_zeroes(void)
+Vector3f vec3f_from_vec3(Vector3 vec)
 {
-    Vector3 r = {0.0, 0.0, 0.0};
+    Vector3f r = {{(float) vec.x, (float) vec.y, (float) vec.z}};
     return r;
 }
 
 //---------------------------------------------------------------------------------------------------------------
-Vector3 vec3_from_values(double x, double y, double z)
+Vector3 vec3_from_vec3f(Vector3f vec)
 {
-    Vector3 r;
-    r.x = x;
-    r.y = y;
-    r.z = z;
+    Vector3 r = {{vec.x, vec.y, vec.z}};
     return r;
 }
 
 //---------------------------------------------------------------------------------------------------------------
-Vector3 vec3_from_points(Vector3 from, Vector3 to)
+void vec3_print(Vector3 a)
 {
-    Vector3 vec = {to.x - from.x,
-                   to.y - from.y,
-                   to.z - from.z};
-
-    return vec;
+    printf( "(%f, %f, %f)\n", a.x, a.y, a.z );
 }
 
 //---------------------------------------------------------------------------------------------------------------
-Vector3 vec3_from_array(double *buffer)
+void vec3f_print(Vector3f a)
 {
-    Vector3 r;
-    memcpy( &r.v, buffer, sizeof(double) * 3 );
-    return r;
+    printf( "(%f, %f, %f)\n", (double) a.x, (double) a.y, (double) a.z );
 }
 
 
 
+#endif      // ! SIMD_KERNEL_BUILD
+
+
 
 //===============================================================================================================
+// Batch normalisation. norm_array is the renorm kernel with a negative epsilon, which selects every vector.
+SIMD_DISPATCH_VOID(vec3_norm_array, (const Vector3 * in, Vector3 * out, size_t count), (in, out, count))
+SIMD_DISPATCH(size_t, vec3_renorm_array, (Vector3 * vec, size_t count, double epsilon), (vec, count, epsilon))
+SIMD_DISPATCH_VOID(vec3f_norm_array, (const Vector3f * in, Vector3f * out, size_t count), (in, out, count))
+SIMD_DISPATCH(size_t, vec3f_renorm_array, (Vector3f * vec, size_t count, float epsilon), (vec, count, epsilon))
+
+#if defined SIMD_KERNELS
 //---------------------------------------------------------------------------------------------------------------
-double vec3_len_squared(Vector3 vec)
+static size_t vec3_renorm_kernel(const Vector3 * in, Vector3 * out, size_t count, double epsilon)
 {
-    double len_squared = 0.0;
-
-    for (i = 0; i < 3; i++) {
-        len_squared += (vec.v[i] * vec.v[i]);
+    size_t k = 0, changed = 0;
+
+#if defined SIMD_HAVE_AVX2
+    {
+        const double * src = in->v;
+        double * dst = out->v;
+        __m256d one = _mm256_set1_pd(1), eps = _mm256_set1_pd(epsilon), sign = _mm256_set1_pd(-0.0);
+        __m256d x, y, z, len2, mask, scale;
+        int bits;
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            simd_load_xyz4(src + 3*k, &x, &y, &z);
+
+            len2 = _mm256_fmadd_pd(z, z, _mm256_fmadd_pd(y, y, _mm256_mul_pd(x, x)));
+            mask = _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(len2, one)), eps, _CMP_NLE_UQ);    // nan counts as drifted
+            bits = _mm256_movemask_pd(mask);
+            if (bits == 0) {
+                continue;
+            }
+
+            scale = _mm256_blendv_pd(one, simd_rsqrt4_pd(len2), mask);
+            simd_store_xyz4(dst + 3*k, _mm256_mul_pd(x, scale), _mm256_mul_pd(y, scale), _mm256_mul_pd(z, scale));
+            changed += (size_t) simd_mask_count(bits);
+        }
+    }
+#elif defined SIMD_HAVE_SSE2
+    {
+        const double * src = in->v;
+        double * dst = out->v;
+        __m128d one = _mm_set1_pd(1), eps = _mm_set1_pd(epsilon), sign = _mm_set1_pd(-0.0);
+        __m128d x, y, z, len2, mask, scale;
+        int bits;
+
+        for (k = 0; k + 2 <= count; k += 2) {
+            simd_load_xyz2(src + 3*k, &x, &y, &z);
+
+            len2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(x, x), _mm_mul_pd(y, y)), _mm_mul_pd(z, z));
+            mask = _mm_cmpnle_pd(_mm_andnot_pd(sign, _mm_sub_pd(len2, one)), eps);
+            bits = _mm_movemask_pd(mask);
+            if (bits == 0) {
+                continue;
+            }
+
+            scale = _mm_or_pd(_mm_and_pd(mask, simd_rsqrt2_pd(len2)), _mm_andnot_pd(mask, one));
+            simd_store_xyz2(dst + 3*k, _mm_mul_pd(x, scale), _mm_mul_pd(y, scale), _mm_mul_pd(z, scale));
+            changed += (size_t) simd_mask_count(bits);
+        }
+    }
+#endif
+
+    for (; k < count; k++) {
+        if (fabs( vec3_len_squared(in[k]) - 1 ) <= epsilon) {
+            out[k] = in[k];
+            continue;
+        }
+        out[k] = vec3_norm(in[k]);
+        changed++;
     }
 
-    return len_squared;
+    return changed;
 }
 
 //---------------------------------------------------------------------------------------------------------------
-double vec3_len(Vector3 vec)
+void SIMD_FN(vec3_norm_array)(const Vector3 * in, Vector3 * out, size_t count)
 {
-    return sqrt( vec3_len_squared(vec) );
+    vec3_renorm_kernel(in, out, count, -1);
 }
 
 //---------------------------------------------------------------------------------------------------------------
-Vector3 vec3_norm(Vector3 vec)
+size_t SIMD_FN(vec3_renorm_array)(Vector3 * vec, size_t count, double epsilon)
 {
-    double len = vec3_len(vec);
-    return vec3_scalar_div( vec, len );
+    return vec3_renorm_kernel(vec, vec, count, epsilon);
 }
 
+
 //---------------------------------------------------------------------------------------------------------------
-Vector3 vec3_scalar_div( Vector3 vec, double scalar )
+static size_t vec3f_renorm_kernel(const Vector3f * in, Vector3f * out, size_t count, float epsilon)
 {
-    return vec3_scalar_mul( vec, 1.0/scalar );
+    size_t k = 0, changed = 0;
+
+#if defined SIMD_HAVE_AVX2 || defined SIMD_HAVE_SSE2
+    {
+        const float * src = in->v;
+        float * dst = out->v;
+        __m128 one = _mm_set1_ps(1), eps = _mm_set1_ps(epsilon), sign = _mm_set1_ps(-0.0f);
+        __m128 x, y, z, len2, mask, scale;
+        int bits;
+
+        for (k = 0; k + 4 <= count; k += 4) {
+            simd_load_xyz4f(src + 3*k, &x, &y, &z);
+
+            len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+            mask = _mm_cmpnle_ps(_mm_andnot_ps(sign, _mm_sub_ps(len2, one)), eps);
+            bits = _mm_movemask_ps(mask);
+            if (bits == 0) {
+                continue;
+            }
+
+            scale = _mm_or_ps(_mm_and_ps(mask, simd_rsqrt4_ps(len2)), _mm_andnot_ps(mask, one));
+            simd_store_xyz4f(dst + 3*k, _mm_mul_ps(x, scale), _mm_mul_ps(y, scale), _mm_mul_ps(z, scale));
+            changed += (size_t) simd_mask_count(bits);
+        }
+    }
+#endif
+
+    for (; k < count; k++) {
+        if (fabs( vec3f_len_squared(in[k]) - 1 ) <= epsilon) {
+            out[k] = in[k];
+            continue;
+        }
+        out[k] = vec3f_norm(in[k]);
+        changed++;
+    }
+
+    return changed;
 }
 
 //---------------------------------------------------------------------------------------------------------------
-Vector3 vec3_scalar_mul( Vector3 vec, double scalar )
+void SIMD_FN(vec3f_norm_array)(const Vector3f * in, Vector3f * out, size_t count)
 {
-    Vector3 r;
-    for (i = 0; i < 3; i++) {
-        r.v[i] = (vec.v[i] * scalar);
-    }
+    vec3f_renorm_kernel(in, out, count, -1);
+}
 
-    return r;
+//---------------------------------------------------------------------------------------------------------------
+size_t SIMD_FN(vec3f_renorm_array)(Vector3f * vec, size_t count, float epsilon)
+{
+    return vec3f_renorm_kernel(vec, vec, count, epsilon);
 }
 
+#endif      // SIMD_KERNELS
+
 
 
 //===============================================================================================================
+// Batch algebra
+SIMD_DISPATCH_VOID(vec3_dot_array, (const Vector3 * restrict a, const Vector3 * restrict b, double * restrict out,
+                                    size_t count),
+                   (a, b, out, count))
+SIMD_DISPATCH_VOID(vec3_cross_array, (const Vector3 * restrict a, const Vector3 * restrict b, Vector3 * restrict out,
+                                      size_t count),
+                   (a, b, out, count))
+SIMD_DISPATCH_VOID(vec3_cross_array_inplace, (Vector3 * restrict a, const Vector3 * restrict b, size_t count),
+                   (a, b, count))
+SIMD_DISPATCH_VOID(vec3_add_array, (const Vector3 * restrict a, const Vector3 * restrict b, Vector3 * restrict out,
+                                    size_t count),
+                   (a, b, out, count))
+SIMD_DISPATCH_VOID(vec3_add_array_inplace, (Vector3 * restrict a, const Vector3 * restrict b, size_t count),
+                   (a, b, count))
+SIMD_DISPATCH_VOID(vec3_project_plane_array, (const Vector3 * restrict vec, const Vector3 * restrict normal,
+                                              Vector3 * restrict out, size_t count),
+                   (vec, normal, out, count))
+SIMD_DISPATCH_VOID(vec3_project_plane_array_inplace, (Vector3 * restrict vec, const Vector3 * restrict normal,
+                                                      size_t count),
+                   (vec, normal, count))
+SIMD_DISPATCH_VOID(vec3_dot_soa, (const double * restrict ax, const double * restrict ay, const double * restrict az,
+                                  const double * restrict bx, const double * restrict by, const double * restrict bz,
+                                  double * restrict out, size_t count),
+                   (ax, ay, az, bx, by, bz, out, count))
+SIMD_DISPATCH_VOID(vec3_cross_soa, (const double * restrict ax, const double * restrict ay, const double * restrict az,
+                                    const double * restrict bx, const double * restrict by, const double * restrict bz,
+                                    double * restrict out_x, double * restrict out_y, double * restrict out_z,
+                                    size_t count),
+                   (ax, ay, az, bx, by, bz, out_x, out_y, out_z, count))
+SIMD_DISPATCH_VOID(vec3_cross_soa_inplace, (double * restrict ax, double * restrict ay, double * restrict az,
+                                            const double * restrict bx, const double * restrict by,
+                                            const double * restrict bz, size_t count),
+                   (ax, ay, az, bx, by, bz, count))
+SIMD_DISPATCH_VOID(vec3_add_soa, (const double * restrict ax, const double * restrict ay, const double * restrict az,
+                                  const double * restrict bx, const double * restrict by, const double * restrict bz,
+                                  double * restrict out_x, double * restrict out_y, double * restrict out_z,
+                                  size_t count),
+                   (ax, ay, az, bx, by, bz, out_x, out_y, out_z, count))
+SIMD_DISPATCH_VOID(vec3_add_soa_inplace, (double * restrict ax, double * restrict ay, double * restrict az,
+                                          const double * restrict bx, const double * restrict by,
+                                          const double * restrict bz, size_t count),
+                   (ax, ay, az, bx, by, bz, count))
+SIMD_DISPATCH_VOID(vec3_project_plane_soa, (const double * restrict x, const double * restrict y,
+                                            const double * restrict z, const double * restrict nx,
+                                            const double * restrict ny, const double * restrict nz,
+                                            double * restrict out_x, double * restrict out_y, double * restrict out_z,
+                                            size_t count),
+                   (x, y, z, nx, ny, nz, out_x, out_y, out_z, count))
+SIMD_DISPATCH_VOID(vec3_project_plane_soa_inplace, (double * restrict x, double * restrict y, double * restrict z,
+                                                    const double * restrict nx, const double * restrict ny,
+                                                    const double * restrict nz, size_t count),
+                   (x, y, z, nx, ny, nz, count))
+SIMD_DISPATCH_VOID(vec3_norm_soa, (const double * restrict x, const double * restrict y, const double * restrict z,
+                                   double * restrict out_x, double * restrict out_y, double * restrict out_z,
+                                   size_t count),
+                   (x, y, z, out_x, out_y, out_z, count))
+SIMD_DISPATCH_VOID(vec3_norm_soa_inplace, (double * restrict x, double * restrict y, double * restrict z, size_t count),
+                   (x, y, z, count))
+SIMD_DISPATCH(size_t, vec3_renorm_soa, (double * restrict x, double * restrict y, double * restrict z, size_t count,
+                                        double epsilon),
+              (x, y, z, count, epsilon))
+
+#if defined SIMD_KERNELS
 //---------------------------------------------------------------------------------------------------------------
-Vector3 vec3_cross(Vector3 a, Vector3 b)
+// One operand of the batch algebra kernels, in either layout: the coordinates of element k are x[k*stride],
+// y[k*stride] and z[k*stride], with a stride of 3 over an array of Vector3 and of 1 over three SoA streams.
+// The kernels read every element before they write it, so an operand may be its own result (the _inplace versions).
+typedef struct vec3_source {
+    const double * x;
+    const double * y;
+    const double * z;
+    size_t stride;
+} Vec3Source;
+
+typedef struct vec3_sink {
+    double * x;
+    double * y;
+    double * z;
+    size_t stride;
+} Vec3Sink;
+
+//---------------------------------------------------------------------------------------------------------------
+static inline Vec3Source vec3_source_aos(const Vector3 * v)
 {
+    Vec3Source s = {v->v, v->v + 1, v->v + 2, 3};
+    return s;
+}
 
-    Vector3 r = {a.y*b.z - a.z*b.y,
-                 a.z*b.x - a.x*b.z,
-                 a.x*b.y - a.y*b.x };
+static inline Vec3Source vec3_source_soa(const double * x, const double * y, const double * z)
+{
+    Vec3Source s = {x, y, z, 1};
+    return s;
+}
+
+static inline Vec3Sink vec3_sink_aos(Vector3 * v)
+{
+    Vec3Sink s = {v->v, v->v + 1, v->v + 2, 3};
+    return s;
+}
+
+static inline Vec3Sink vec3_sink_soa(double * x, double * y, double * z)
+{
+    Vec3Sink s = {x, y, z, 1};
+    return s;
+}
+
+static inline Vec3Source vec3_source_of(Vec3Sink s)
+{
+    Vec3Source r = {s.x, s.y, s.z, s.stride};
     return r;
 }
 
 //---------------------------------------------------------------------------------------------------------------
-double vec3_dot(Vector3 a, Vector3 b)
+static inline Vector3 vec3_source_get(Vec3Source s, size_t k)
 {
-    return (a.x*b.x) + (a.y*b.y) + (a.z*b.z);
+    Vector3 r = {{s.x[k * s.stride], s.y[k * s.stride], s.z[k * s.stride]}};
+    return r;
+}
+
+static inline void vec3_sink_set(Vec3Sink s, size_t k, Vector3 v)
+{
+    s.x[k * s.stride] = v.x;
+    s.y[k * s.stride] = v.y;
+    s.z[k * s.stride] = v.z;
 }
 
+#if defined SIMD_HAVE_AVX2
 //---------------------------------------------------------------------------------------------------------------
-Vector3 vec3_add(Vector3 a, Vector3 b)
+// Elements k .. k+3 of [s] in lanes.
+static inline void vec3_source_load4(Vec3Source s, size_t k, __m256d * x, __m256d * y, __m256d * z)
 {
+    if (s.stride == 3) {
+        simd_load_xyz4(s.x + 3*k, x, y, z);
+    } else {
+        *x = _mm256_loadu_pd(s.x + k);
+        *y = _mm256_loadu_pd(s.y + k);
+        *z = _mm256_loadu_pd(s.z + k);
+    }
+}
 
-    Vector3 r = {a.x + b.x,
-                 a.y + b.y,
-                 a.z + b.z };
-    return r;
+static inline void vec3_sink_store4(Vec3Sink s, size_t k, __m256d x, __m256d y, __m256d z)
+{
+    if (s.stride == 3) {
+        simd_store_xyz4(s.x + 3*k, x, y, z);
+    } else {
+        _mm256_storeu_pd(s.x + k, x);
+        _mm256_storeu_pd(s.y + k, y);
+        _mm256_storeu_pd(s.z + k, z);
+    }
+}
+#elif defined SIMD_HAVE_SSE2
+//---------------------------------------------------------------------------------------------------------------
+// Elements k and k+1 of [s] in lanes.
+static inline void vec3_source_load2(Vec3Source s, size_t k, __m128d * x, __m128d * y, __m128d * z)
+{
+    if (s.stride == 3) {
+        simd_load_xyz2(s.x + 3*k, x, y, z);
+    } else {
+        *x = _mm_loadu_pd(s.x + k);
+        *y = _mm_loadu_pd(s.y + k);
+        *z = _mm_loadu_pd(s.z + k);
+    }
 }
 
-//------------------------------------------------------------------------------------------------------------------------------------------
-bool vec3_equal(Vector3 a, Vector3 b)
+static inline void vec3_sink_store2(Vec3Sink s, size_t k, __m128d x, __m128d y, __m128d z)
 {
-    for(i = 0; i < 3; i++) {
-        if ( fabs(a.v[i] - b.v[i]) > FLT_EPSILON)
-            return false;
+    if (s.stride == 3) {
+        simd_store_xyz2(s.x + 3*k, x, y, z);
+    } else {
+        _mm_storeu_pd(s.x + k, x);
+        _mm_storeu_pd(s.y + k, y);
+        _mm_storeu_pd(s.z + k, z);
+    }
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------
+static void vec3_dot_batch(Vec3Source a, Vec3Source b, double * out, size_t count)
+{
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2
+    __m256d ax, ay, az, bx, by, bz;
+
+    for (; k + 4 <= count; k += 4) {
+        vec3_source_load4(a, k, &ax, &ay, &az);
+        vec3_source_load4(b, k, &bx, &by, &bz);
+        _mm256_storeu_pd(out + k, _mm256_fmadd_pd(az, bz, _mm256_fmadd_pd(ay, by, _mm256_mul_pd(ax, bx))));
+    }
+#elif defined SIMD_HAVE_SSE2
+    __m128d ax, ay, az, bx, by, bz;
+
+    for (; k + 2 <= count; k += 2) {
+        vec3_source_load2(a, k, &ax, &ay, &az);
+        vec3_source_load2(b, k, &bx, &by, &bz);
+        _mm_storeu_pd(out + k, _mm_add_pd(_mm_add_pd(_mm_mul_pd(ax, bx), _mm_mul_pd(ay, by)), _mm_mul_pd(az, bz)));
     }
+#endif
 
-    return true;
+    for (; k < count; k++) {
+        out[k] = vec3_dot(vec3_source_get(a, k), vec3_source_get(b, k));
+    }
 }
 
+//---------------------------------------------------------------------------------------------------------------
+static void vec3_cross_batch(Vec3Source a, Vec3Source b, Vec3Sink out, size_t count)
+{
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2
+    __m256d ax, ay, az, bx, by, bz;
+
+    for (; k + 4 <= count; k += 4) {
+        vec3_source_load4(a, k, &ax, &ay, &az);
+        vec3_source_load4(b, k, &bx, &by, &bz);
+        vec3_sink_store4(out, k, _mm256_fmsub_pd(ay, bz, _mm256_mul_pd(az, by)),
+                                 _mm256_fmsub_pd(az, bx, _mm256_mul_pd(ax, bz)),
+                                 _mm256_fmsub_pd(ax, by, _mm256_mul_pd(ay, bx)));
+    }
+#elif defined SIMD_HAVE_SSE2
+    __m128d ax, ay, az, bx, by, bz;
+
+    for (; k + 2 <= count; k += 2) {
+        vec3_source_load2(a, k, &ax, &ay, &az);
+        vec3_source_load2(b, k, &bx, &by, &bz);
+        vec3_sink_store2(out, k, _mm_sub_pd(_mm_mul_pd(ay, bz), _mm_mul_pd(az, by)),
+                                 _mm_sub_pd(_mm_mul_pd(az, bx), _mm_mul_pd(ax, bz)),
+                                 _mm_sub_pd(_mm_mul_pd(ax, by), _mm_mul_pd(ay, bx)));
+    }
+#endif
+
+    for (; k < count; k++) {
+        vec3_sink_set(out, k, vec3_cross(vec3_source_get(a, k), vec3_source_get(b, k)));
+    }
+}
 
 //---------------------------------------------------------------------------------------------------------------
-Vector3 vec3_project_plane(Vector3 vec, Vector3 normal)
+// out = vec - normal (vec . normal)
+static void vec3_project_plane_batch(Vec3Source vec, Vec3Source normal, Vec3Sink out, size_t count)
 {
-    // @ret: result of projecting vector [ vec ] on plane defined by normal [ normal ]
-    //
-    // @param: [ normal ] should be of UNIT length
-    // @param: [ vec ] vector that you want to project
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2
+    __m256d x, y, z, nx, ny, nz, d;
 
-    double dp = vec3_dot(vec, normal);
-    Vector3 delta = vec3_scalar_mul(normal, -dp);
-    return vec3_add(vec, delta);
+    for (; k + 4 <= count; k += 4) {
+        vec3_source_load4(vec, k, &x, &y, &z);
+        vec3_source_load4(normal, k, &nx, &ny, &nz);
+        d = _mm256_fmadd_pd(z, nz, _mm256_fmadd_pd(y, ny, _mm256_mul_pd(x, nx)));
+        vec3_sink_store4(out, k, _mm256_fnmadd_pd(nx, d, x), _mm256_fnmadd_pd(ny, d, y), _mm256_fnmadd_pd(nz, d, z));
+    }
+#elif defined SIMD_HAVE_SSE2
+    __m128d x, y, z, nx, ny, nz, d;
+
+    for (; k + 2 <= count; k += 2) {
+        vec3_source_load2(vec, k, &x, &y, &z);
+        vec3_source_load2(normal, k, &nx, &ny, &nz);
+        d = _mm_add_pd(_mm_add_pd(_mm_mul_pd(x, nx), _mm_mul_pd(y, ny)), _mm_mul_pd(z, nz));
+        vec3_sink_store2(out, k, _mm_sub_pd(x, _mm_mul_pd(nx, d)), _mm_sub_pd(y, _mm_mul_pd(ny, d)),
+                                 _mm_sub_pd(z, _mm_mul_pd(nz, d)));
+    }
+#endif
+
+    for (; k < count; k++) {
+        vec3_sink_set(out, k, vec3_project_plane(vec3_source_get(vec, k), vec3_source_get(normal, k)));
+    }
 }
 
+//---------------------------------------------------------------------------------------------------------------
+// vec3_norm of every element, by the method of vec3_norm_array
+static void vec3_norm_batch(Vec3Source in, Vec3Sink out, size_t count)
+{
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2
+    __m256d x, y, z, scale;
+
+    for (; k + 4 <= count; k += 4) {
+        vec3_source_load4(in, k, &x, &y, &z);
+        scale = simd_rsqrt4_pd(_mm256_fmadd_pd(z, z, _mm256_fmadd_pd(y, y, _mm256_mul_pd(x, x))));
+        vec3_sink_store4(out, k, _mm256_mul_pd(x, scale), _mm256_mul_pd(y, scale), _mm256_mul_pd(z, scale));
+    }
+#elif defined SIMD_HAVE_SSE2
+    __m128d x, y, z, scale;
+
+    for (; k + 2 <= count; k += 2) {
+        vec3_source_load2(in, k, &x, &y, &z);
+        scale = simd_rsqrt2_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(x, x), _mm_mul_pd(y, y)), _mm_mul_pd(z, z)));
+        vec3_sink_store2(out, k, _mm_mul_pd(x, scale), _mm_mul_pd(y, scale), _mm_mul_pd(z, scale));
+    }
+#endif
+
+    for (; k < count; k++) {
+        vec3_sink_set(out, k, vec3_norm(vec3_source_get(in, k)));
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// vec3_renorm of every element of [vec] in place, by the method of vec3_renorm_array: the vectors within [epsilon]
+// are not written back, nor is a whole vector of lanes of them.
+// @ret number of vectors that were renormalised
+static size_t vec3_renorm_batch(Vec3Sink vec, size_t count, double epsilon)
+{
+    Vec3Source in = vec3_source_of(vec);
+    size_t k = 0, changed = 0;
+    Vector3 v;
+
+#if defined SIMD_HAVE_AVX2
+    __m256d one = _mm256_set1_pd(1), eps = _mm256_set1_pd(epsilon), sign = _mm256_set1_pd(-0.0);
+    __m256d x, y, z, len2, mask, scale;
+    int bits;
+
+    for (; k + 4 <= count; k += 4) {
+        vec3_source_load4(in, k, &x, &y, &z);
+        len2 = _mm256_fmadd_pd(z, z, _mm256_fmadd_pd(y, y, _mm256_mul_pd(x, x)));
+        mask = _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(len2, one)), eps, _CMP_NLE_UQ);    // nan counts as drifted
+        bits = _mm256_movemask_pd(mask);
+        if (bits == 0) {
+            continue;
+        }
+        scale = _mm256_blendv_pd(one, simd_rsqrt4_pd(len2), mask);
+        vec3_sink_store4(vec, k, _mm256_mul_pd(x, scale), _mm256_mul_pd(y, scale), _mm256_mul_pd(z, scale));
+        changed += (size_t) simd_mask_count(bits);
+    }
+#elif defined SIMD_HAVE_SSE2
+    __m128d one = _mm_set1_pd(1), eps = _mm_set1_pd(epsilon), sign = _mm_set1_pd(-0.0);
+    __m128d x, y, z, len2, mask, scale;
+    int bits;
+
+    for (; k + 2 <= count; k += 2) {
+        vec3_source_load2(in, k, &x, &y, &z);
+        len2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(x, x), _mm_mul_pd(y, y)), _mm_mul_pd(z, z));
+        mask = _mm_cmpnle_pd(_mm_andnot_pd(sign, _mm_sub_pd(len2, one)), eps);
+        bits = _mm_movemask_pd(mask);
+        if (bits == 0) {
+            continue;
+        }
+        scale = _mm_or_pd(_mm_and_pd(mask, simd_rsqrt2_pd(len2)), _mm_andnot_pd(mask, one));
+        vec3_sink_store2(vec, k, _mm_mul_pd(x, scale), _mm_mul_pd(y, scale), _mm_mul_pd(z, scale));
+        changed += (size_t) simd_mask_count(bits);
+    }
+#endif
+
+    for (; k < count; k++) {
+        v = vec3_source_get(in, k);
+        if (fabs( vec3_len_squared(v) - 1 ) <= epsilon) {
+            continue;
+        }
+        vec3_sink_set(vec, k, vec3_norm(v));
+        changed++;
+    }
+
+    return changed;
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// out = a + b over [count] doubles. An array of Vector3 is added as one stream of 3 * count doubles.
+static void vec3_add_stream(const double * a, const double * b, double * out, size_t count)
+{
+    size_t k = 0;
+
+#if defined SIMD_HAVE_AVX2
+    for (; k + 4 <= count; k += 4) {
+        _mm256_storeu_pd(out + k, _mm256_add_pd(_mm256_loadu_pd(a + k), _mm256_loadu_pd(b + k)));
+    }
+#elif defined SIMD_HAVE_SSE2
+    for (; k + 2 <= count; k += 2) {
+        _mm_storeu_pd(out + k, _mm_add_pd(_mm_loadu_pd(a + k), _mm_loadu_pd(b + k)));
+    }
+#endif
+
+    for (; k < count; k++) {
+        out[k] = a[k] + b[k];
+    }
+}
+
+
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_dot_array)(const Vector3 * restrict a, const Vector3 * restrict b, double * restrict out,
+                             size_t count)
+{
+    vec3_dot_batch(vec3_source_aos(a), vec3_source_aos(b), out, count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_cross_array)(const Vector3 * restrict a, const Vector3 * restrict b, Vector3 * restrict out,
+                               size_t count)
+{
+    vec3_cross_batch(vec3_source_aos(a), vec3_source_aos(b), vec3_sink_aos(out), count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_cross_array_inplace)(Vector3 * restrict a, const Vector3 * restrict b, size_t count)
+{
+    Vec3Sink out = vec3_sink_aos(a);
+    vec3_cross_batch(vec3_source_of(out), vec3_source_aos(b), out, count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_add_array)(const Vector3 * restrict a, const Vector3 * restrict b, Vector3 * restrict out,
+                             size_t count)
+{
+    vec3_add_stream(a->v, b->v, out->v, 3 * count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_add_array_inplace)(Vector3 * restrict a, const Vector3 * restrict b, size_t count)
+{
+    vec3_add_stream(a->v, b->v, a->v, 3 * count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_project_plane_array)(const Vector3 * restrict vec, const Vector3 * restrict normal,
+                                       Vector3 * restrict out, size_t count)
+{
+    vec3_project_plane_batch(vec3_source_aos(vec), vec3_source_aos(normal), vec3_sink_aos(out), count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_project_plane_array_inplace)(Vector3 * restrict vec, const Vector3 * restrict normal, size_t count)
+{
+    Vec3Sink out = vec3_sink_aos(vec);
+    vec3_project_plane_batch(vec3_source_of(out), vec3_source_aos(normal), out, count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_dot_soa)(const double * restrict ax, const double * restrict ay, const double * restrict az,
+                           const double * restrict bx, const double * restrict by, const double * restrict bz,
+                           double * restrict out, size_t count)
+{
+    vec3_dot_batch(vec3_source_soa(ax, ay, az), vec3_source_soa(bx, by, bz), out, count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_cross_soa)(const double * restrict ax, const double * restrict ay, const double * restrict az,
+                             const double * restrict bx, const double * restrict by, const double * restrict bz,
+                             double * restrict out_x, double * restrict out_y, double * restrict out_z, size_t count)
+{
+    vec3_cross_batch(vec3_source_soa(ax, ay, az), vec3_source_soa(bx, by, bz), vec3_sink_soa(out_x, out_y, out_z),
+                      count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_cross_soa_inplace)(double * restrict ax, double * restrict ay, double * restrict az,
+                                     const double * restrict bx, const double * restrict by, const double * restrict bz,
+                                     size_t count)
+{
+    Vec3Sink out = vec3_sink_soa(ax, ay, az);
+    vec3_cross_batch(vec3_source_of(out), vec3_source_soa(bx, by, bz), out, count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_add_soa)(const double * restrict ax, const double * restrict ay, const double * restrict az,
+                           const double * restrict bx, const double * restrict by, const double * restrict bz,
+                           double * restrict out_x, double * restrict out_y, double * restrict out_z, size_t count)
+{
+    vec3_add_stream(ax, bx, out_x, count);
+    vec3_add_stream(ay, by, out_y, count);
+    vec3_add_stream(az, bz, out_z, count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_add_soa_inplace)(double * restrict ax, double * restrict ay, double * restrict az,
+                                   const double * restrict bx, const double * restrict by, const double * restrict bz,
+                                   size_t count)
+{
+    vec3_add_stream(ax, bx, ax, count);
+    vec3_add_stream(ay, by, ay, count);
+    vec3_add_stream(az, bz, az, count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_project_plane_soa)(const double * restrict x, const double * restrict y, const double * restrict z,
+                                     const double * restrict nx, const double * restrict ny, const double * restrict nz,
+                                     double * restrict out_x, double * restrict out_y, double * restrict out_z,
+                                     size_t count)
+{
+    vec3_project_plane_batch(vec3_source_soa(x, y, z), vec3_source_soa(nx, ny, nz), vec3_sink_soa(out_x, out_y, out_z),
+                              count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_project_plane_soa_inplace)(double * restrict x, double * restrict y, double * restrict z,
+                                             const double * restrict nx, const double * restrict ny,
+                                             const double * restrict nz, size_t count)
+{
+    Vec3Sink out = vec3_sink_soa(x, y, z);
+    vec3_project_plane_batch(vec3_source_of(out), vec3_source_soa(nx, ny, nz), out, count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_norm_soa)(const double * restrict x, const double * restrict y, const double * restrict z,
+                            double * restrict out_x, double * restrict out_y, double * restrict out_z, size_t count)
+{
+    vec3_norm_batch(vec3_source_soa(x, y, z), vec3_sink_soa(out_x, out_y, out_z), count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+void SIMD_FN(vec3_norm_soa_inplace)(double * restrict x, double * restrict y, double * restrict z, size_t count)
+{
+    Vec3Sink out = vec3_sink_soa(x, y, z);
+    vec3_norm_batch(vec3_source_of(out), out, count);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+size_t SIMD_FN(vec3_renorm_soa)(double * restrict x, double * restrict y, double * restrict z, size_t count,
+                                double epsilon)
+{
+    return vec3_renorm_batch(vec3_sink_soa(x, y, z), count, epsilon);
+}
+
+#endif      // SIMD_KERNELS
+
+
 
 
 
@@ -170,7 +755,7 @@ Vector3 vec3_project_plane(Vector3 vec, Vector3 normal)
 
 //==========================================================================================================================================
 // Unit testing facilities
-#ifdef VECTOR3_UNITTEST
+#if defined VECTOR3_UNITTEST && ! defined SIMD_KERNEL_BUILD
 
 // You only need to include <glib-2.0/glib.h> for this to function.
 // BUT when writing unit tests you might need to explicitly include <glib/gtestutils.h>
@@ -351,6 +936,141 @@ void test_vec3_project_plane(void)
 
 
 
+//---------------------------------------------------------------------------------------------------------------
+// Odd count so that both the vector kernel and the scalar tail are exercised. The float kernel is one Newton step
+// short of full precision, hence the looser bound.
+void test_vec3_norm_array(void)
+{
+    Vector3 in[7], out[7];
+    Vector3f inf[7], outf[7], unit[7];
+    int i;
+
+    for (i = 0; i < 7; i++) {
+        in[i] = vec3_from_values( 0.25 * i - 1, 3.0 - i, 1e-4 * i + 0.5 );
+        if (i % 2 == 0) {
+            in[i] = vec3_norm( in[i] );
+        }
+        inf[i] = vec3f_from_vec3( in[i] );
+        unit[i] = inf[i];
+    }
+
+    vec3_norm_array( in, out, 7 );
+    vec3f_norm_array( inf, outf, 7 );
+    for (i = 0; i < 7; i++) {
+        g_assert_true(  vec3_equal(out[i], vec3_norm(in[i]))  );
+        g_assert_cmpfloat( vec3f_len(vec3f_add(outf[i], vec3f_scalar_mul(vec3f_norm(inf[i]), -1))), <, 4e-7f );
+    }
+
+    g_assert_true(  vec3_equal(vec3_renorm(in[1], 1e-12), out[1])  );
+    g_assert_cmpuint( vec3_renorm_array(in, 7, 1e-12), ==, 3 );
+    g_assert_cmpuint( vec3f_renorm_array(inf, 7, 1e-6f), ==, 3 );
+    for (i = 0; i < 7; i++) {
+        g_assert_true(  vec3_equal(in[i], out[i])  );
+        g_assert_true(  memcmp(&inf[i], (i % 2 == 0) ? &unit[i] : &outf[i], sizeof(Vector3f)) == 0  );
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// The batch algebra against the single vector functions, in both layouts and in place. 11 elements leave a tail
+// after the 4 and 2 lane loops.
+void test_vec3_batch_algebra(void)
+{
+    enum { n = 11 };
+    Vector3 a[n], b[n], unit[n], out[n], in_place[n];
+    double dot[n], ax[n], ay[n], az[n], bx[n], by[n], bz[n], ox[n], oy[n], oz[n];
+    Vector3 (*single[])(Vector3, Vector3) = {vec3_cross, vec3_add, vec3_project_plane};
+    Vector3 r;
+    int i, f;
+
+    for (i = 0; i < n; i++) {
+        a[i] = vec3_from_values( 0.25 * i - 1, 3.0 - i, 1e-4 * i + 0.5 );
+        b[i] = vec3_from_values( -0.5 * i, 0.125 * i * i, 2.0 - 0.3 * i );
+        unit[i] = vec3_norm( b[i] );
+        ax[i] = a[i].x;     ay[i] = a[i].y;     az[i] = a[i].z;
+        bx[i] = unit[i].x;  by[i] = unit[i].y;  bz[i] = unit[i].z;
+    }
+
+    vec3_dot_array( a, unit, dot, n );
+    for (i = 0; i < n; i++) {
+        g_assert_cmpfloat(  fabs(dot[i] - vec3_dot(a[i], unit[i])), <, 1e-14  );
+    }
+    vec3_dot_soa( ax, ay, az, bx, by, bz, dot, n );
+    for (i = 0; i < n; i++) {
+        g_assert_cmpfloat(  fabs(dot[i] - vec3_dot(a[i], unit[i])), <, 1e-14  );
+    }
+
+    for (f = 0; f < 3; f++) {
+        memcpy( in_place, a, sizeof(a) );
+        switch (f) {
+        case 0:
+            vec3_cross_array( a, unit, out, n );
+            vec3_cross_array_inplace( in_place, unit, n );
+            vec3_cross_soa( ax, ay, az, bx, by, bz, ox, oy, oz, n );
+            break;
+        case 1:
+            vec3_add_array( a, unit, out, n );
+            vec3_add_array_inplace( in_place, unit, n );
+            vec3_add_soa( ax, ay, az, bx, by, bz, ox, oy, oz, n );
+            break;
+        default:
+            vec3_project_plane_array( a, unit, out, n );
+            vec3_project_plane_array_inplace( in_place, unit, n );
+            vec3_project_plane_soa( ax, ay, az, bx, by, bz, ox, oy, oz, n );
+            break;
+        }
+
+        for (i = 0; i < n; i++) {
+            r = single[f]( a[i], unit[i] );
+            g_assert_true(  vec3_equal(out[i], r)  );
+            g_assert_true(  memcmp(&in_place[i], &out[i], sizeof(Vector3)) == 0  );
+            g_assert_true(  vec3_equal(vec3_from_values(ox[i], oy[i], oz[i]), r)  );
+        }
+    }
+
+    // The SoA in place versions, each over the result of the previous one
+    vec3_cross_soa_inplace( ax, ay, az, bx, by, bz, n );
+    vec3_add_soa_inplace( ax, ay, az, bx, by, bz, n );
+    vec3_project_plane_soa_inplace( ax, ay, az, bx, by, bz, n );
+    vec3_norm_soa( ax, ay, az, ox, oy, oz, n );
+    vec3_norm_soa_inplace( ax, ay, az, n );
+    for (i = 0; i < n; i++) {
+        r = vec3_norm( vec3_project_plane(vec3_add(vec3_cross(a[i], unit[i]), unit[i]), unit[i]) );
+        g_assert_true(  vec3_equal(vec3_from_values(ox[i], oy[i], oz[i]), r)  );
+        g_assert_true(  vec3_equal(vec3_from_values(ax[i], ay[i], az[i]), r)  );
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// The single precision twins come from the same source, so they only have to agree within float precision.
+void test_vec3f_functions(void)
+{
+    Vector3 a = {0.5, 75.000000004, -0.9843454};
+    Vector3 b = {80.0, -6.056, 56.0};
+    Vector3 n = vec3_norm( vec3_from_values(12.0, 3.00023403, -23.0) );
+    Vector3f af = vec3f_from_vec3( a );
+    Vector3f bf = vec3f_from_vec3( b );
+    Vector3f nf = vec3f_from_vec3( n );
+
+    g_assert_true(  vec3f_equal(vec3f_from_vec3(vec3_add(a, b)), vec3f_add(af, bf))  );
+    g_assert_true(  vec3f_equal(vec3f_from_vec3(vec3_norm(b)), vec3f_norm(bf))  );
+    g_assert_true(  vec3f_equal(vec3f_from_vec3(vec3_project_plane(vec3_norm(a), n)), vec3f_project_plane(vec3f_norm(af), nf))  );
+    g_assert_cmpfloat( fabs(vec3f_dot(vec3f_norm(af), nf) - (float) vec3_dot(vec3_norm(a), n)), <, FLT_EPSILON );
+}
+
+//---------------------------------------------------------------------------------------------------------------
+// Both precisions print the same, checked on the stdout of a subprocess.
+void test_vec3_print(void)
+{
+    if (g_test_subprocess()) {
+        vec3_print( vec3_from_values(1.0, -2.5, 0.125) );
+        vec3f_print( vec3f_from_values(1.0f, -2.5f, 0.125f) );
+        return;
+    }
+    g_test_trap_subprocess( NULL, 0, 0 );
+    g_test_trap_assert_passed();
+    g_test_trap_assert_stdout( "(1.000000, -2.500000, 0.125000)\n(1.000000, -2.500000, 0.125000)\n" );
+}
+
 
 void setuptests(void)
 {
@@ -376,6 +1096,12 @@ void setuptests(void)
     g_test_add_func("/set_vec3/test_vec3_add", test_vec3_add);
     g_test_add_func("/set_vec3/test_vec3_equal", test_vec3_equal);
     g_test_add_func("/set_vec3/test_vec3_project_plane", test_vec3_project_plane);
+    g_test_add_func("/set_vec3/test_vec3_norm_array", test_vec3_norm_array);
+    g_test_add_func("/set_vec3/test_vec3_batch_algebra", test_vec3_batch_algebra);
+
+    // Single precision twins
+    g_test_add_func("/set_vec3/test_vec3f_functions", test_vec3f_functions);
+    g_test_add_func("/set_vec3/test_vec3_print", test_vec3_print);
 }
 
 
@@ -9,6 +9,7 @@
 #define VECTOR3_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef union vector3 {
     double v[3];
@@ -22,7 +23,46 @@ typedef union vector3 {
 } Vector3;
 
 
+// Single precision counterpart of Vector3, for buffers that do not need double precision.
+// Every vec3_ function has a vec3f_ twin generated from the same source (vector3_impl.h).
+typedef union vector3f {
+    float v[3];
 
+    struct
+    {
+        float x;
+        float y;
+        float z;
+    };
+} Vector3f;
+
+
+
+#if defined AGK_INLINE
+//===============================================================================================================
+// Header-only mode. Define AGK_INLINE before including any agk header (or pass -DAGK_INLINE) and the single value
+// vec3_ / vec3f_ functions below become static inline definitions, so the compiler can inline them into the caller
+// and keep the small unions in registers instead of going through a call for every operation.
+// vector3.c always builds the out-of-line versions, so code built in either mode links against the same library.
+#include <math.h>
+#include <string.h>
+#include <float.h>
+
+#define VEC3_T          Vector3
+#define VEC3_REAL       double
+#define VEC3_FN(name)   vec3_##name
+#define VEC3_MATH(name) name
+#define VEC3_API        static inline
+#include "vector3_impl.h"
+
+#define VEC3_T          Vector3f
+#define VEC3_REAL       float
+#define VEC3_FN(name)   vec3f_##name
+#define VEC3_MATH(name) name##f
+#define VEC3_API        static inline
+#include "vector3_impl.h"
+
+#else
 //===============================================================================================================
 // Functions to create vector3 objects
 //---------------------------------------------------------------------------------------------------------------
@@ -35,7 +75,7 @@ extern Vector3 vec3_from_values(double x, double y, double z);
 extern Vector3 vec3_from_points(Vector3 from, Vector3 to);
 
 //---------------------------------------------------------------------------------------------------------------
-extern Vector3 vec3_from_array(double *buffer);
+extern Vector3 vec3_from_array(const double *buffer);
 
 
 
@@ -57,7 +97,8 @@ extern double vec3_len(Vector3 vec);
 extern Vector3 vec3_norm(Vector3 vec);
 
 //---------------------------------------------------------------------------------------------------------------
-extern void vec3_print(Vector3 a);
+// Renormalises [vec] only when it has drifted: returns [vec] unchanged if |len_squared - 1| <= [epsilon].
+extern Vector3 vec3_renorm(Vector3 vec, double epsilon);
 
 
 
@@ -80,6 +121,123 @@ extern Vector3 vec3_project_plane(Vector3 vec, Vector3 normal);
 
 
 
+//===============================================================================================================
+// Single precision twins of the functions above, same semantics.
+//---------------------------------------------------------------------------------------------------------------
+extern Vector3f vec3f_from_zeroes(void);
+extern Vector3f vec3f_from_values(float x, float y, float z);
+extern Vector3f vec3f_from_points(Vector3f from, Vector3f to);
+extern Vector3f vec3f_from_array(const float *buffer);
+
+//---------------------------------------------------------------------------------------------------------------
+extern Vector3f vec3f_scalar_div( Vector3f vec, float scalar );
+extern Vector3f vec3f_scalar_mul( Vector3f vec, float scalar );
+extern float vec3f_len_squared(Vector3f vec);
+extern float vec3f_len(Vector3f vec);
+extern Vector3f vec3f_norm(Vector3f vec);
+extern Vector3f vec3f_renorm(Vector3f vec, float epsilon);
+
+//---------------------------------------------------------------------------------------------------------------
+extern float vec3f_dot(Vector3f a, Vector3f b);
+extern Vector3f vec3f_cross(Vector3f a, Vector3f b);
+extern Vector3f vec3f_add(Vector3f a, Vector3f b);
+extern bool vec3f_equal(Vector3f a, Vector3f b);
+extern Vector3f vec3f_project_plane(Vector3f vec, Vector3f normal);
+
+#endif      // AGK_INLINE
+
+
+
+//===============================================================================================================
+//---------------------------------------------------------------------------------------------------------------
+// Prints [a] on stdout as (x, y, z) and a newline.
+extern void vec3_print(Vector3 a);
+extern void vec3f_print(Vector3f a);
+
+//---------------------------------------------------------------------------------------------------------------
+// Conversion between the two precisions. Narrowing rounds to nearest.
+extern Vector3f vec3f_from_vec3(Vector3 vec);
+extern Vector3 vec3_from_vec3f(Vector3f vec);
+
+
+
+//===============================================================================================================
+// Batch operations
+//---------------------------------------------------------------------------------------------------------------
+// Normalises [count] vectors of [in] into [out], which may be the same array. Same method and error bounds as
+// quat_norm_array: reciprocal square root estimate and Newton-Raphson steps, within a few ulp of vec3_norm in double
+// precision and below 4e-7 relative error in single precision.
+extern void vec3_norm_array(const Vector3 * in, Vector3 * out, size_t count);
+
+//---------------------------------------------------------------------------------------------------------------
+// Batch vec3_renorm, in place. Vectors within [epsilon] of unit squared length are not written back.
+// @ret number of vectors that were renormalised
+extern size_t vec3_renorm_array(Vector3 * vec, size_t count, double epsilon);
+
+//---------------------------------------------------------------------------------------------------------------
+extern void vec3f_norm_array(const Vector3f * in, Vector3f * out, size_t count);
+extern size_t vec3f_renorm_array(Vector3f * vec, size_t count, float epsilon);
+
+
+
+//===============================================================================================================
+// Batch algebra: vec3_dot, vec3_cross, vec3_add, vec3_project_plane and vec3_norm of [count] element pairs,
+// out[k] = f(a[k], b[k]), vectorised like vec3_norm_array, in double precision.
+// The arrays of one call must not overlap, as restrict says; the _inplace versions write the result over their first
+// operand instead of into [out]. vec3_norm_array already accepts the same array as [in] and [out].
+//---------------------------------------------------------------------------------------------------------------
+// Arrays of Vector3
+extern void vec3_dot_array(const Vector3 * restrict a, const Vector3 * restrict b, double * restrict out, size_t count);
+extern void vec3_cross_array(const Vector3 * restrict a, const Vector3 * restrict b, Vector3 * restrict out, size_t count);
+extern void vec3_cross_array_inplace(Vector3 * restrict a, const Vector3 * restrict b, size_t count);
+extern void vec3_add_array(const Vector3 * restrict a, const Vector3 * restrict b, Vector3 * restrict out, size_t count);
+extern void vec3_add_array_inplace(Vector3 * restrict a, const Vector3 * restrict b, size_t count);
+
+//---------------------------------------------------------------------------------------------------------------
+// [normal] holds one unit normal per vector.
+extern void vec3_project_plane_array(const Vector3 * restrict vec, const Vector3 * restrict normal,
+                                     Vector3 * restrict out, size_t count);
+extern void vec3_project_plane_array_inplace(Vector3 * restrict vec, const Vector3 * restrict normal, size_t count);
+
+//---------------------------------------------------------------------------------------------------------------
+// Structure-of-arrays variants, every coordinate a separate stream of [count] doubles.
+extern void vec3_dot_soa(const double * restrict ax, const double * restrict ay, const double * restrict az,
+                         const double * restrict bx, const double * restrict by, const double * restrict bz,
+                         double * restrict out, size_t count);
+extern void vec3_cross_soa(const double * restrict ax, const double * restrict ay, const double * restrict az,
+                           const double * restrict bx, const double * restrict by, const double * restrict bz,
+                           double * restrict out_x, double * restrict out_y, double * restrict out_z, size_t count);
+extern void vec3_cross_soa_inplace(double * restrict ax, double * restrict ay, double * restrict az,
+                                   const double * restrict bx, const double * restrict by, const double * restrict bz,
+                                   size_t count);
+extern void vec3_add_soa(const double * restrict ax, const double * restrict ay, const double * restrict az,
+                         const double * restrict bx, const double * restrict by, const double * restrict bz,
+                         double * restrict out_x, double * restrict out_y, double * restrict out_z, size_t count);
+extern void vec3_add_soa_inplace(double * restrict ax, double * restrict ay, double * restrict az,
+                                 const double * restrict bx, const double * restrict by, const double * restrict bz,
+                                 size_t count);
+extern void vec3_project_plane_soa(const double * restrict x, const double * restrict y, const double * restrict z,
+                                   const double * restrict nx, const double * restrict ny, const double * restrict nz,
+                                   double * restrict out_x, double * restrict out_y, double * restrict out_z,
+                                   size_t count);
+extern void vec3_project_plane_soa_inplace(double * restrict x, double * restrict y, double * restrict z,
+                                           const double * restrict nx, const double * restrict ny,
+                                           const double * restrict nz, size_t count);
+
+//---------------------------------------------------------------------------------------------------------------
+// Same method and error bounds as vec3_norm_array.
+extern void vec3_norm_soa(const double * restrict x, const double * restrict y, const double * restrict z,
+                          double * restrict out_x, double * restrict out_y, double * restrict out_z, size_t count);
+extern void vec3_norm_soa_inplace(double * restrict x, double * restrict y, double * restrict z, size_t count);
+
+//---------------------------------------------------------------------------------------------------------------
+// vec3_renorm_array over three streams, in place.
+// @ret number of vectors that were renormalised
+extern size_t vec3_renorm_soa(double * restrict x, double * restrict y, double * restrict z, size_t count,
+                              double epsilon);
+
+
+
 #endif      // VECTOR3_H
 
 
@@ -0,0 +1,177 @@
+//
+//
+//
+//
+//
+//
+// Template of the Vector3 functions, instantiated once per precision by vector3.c, and by vector3.h in AGK_INLINE mode.
+// The includer defines VEC3_T (the union type), VEC3_REAL (its element type), VEC3_FN(name), which must paste [name]
+// onto the function prefix (vec3_ or vec3f_), and VEC3_MATH(name), which names the <math.h> function of that
+// precision (sqrt or sqrtf). VEC3_API is the optional storage class of the definitions.
+// They are #undef'd at the end of this file.
+//
+// No include guard on purpose. Literals are integers so that no instantiation mixes precisions.
+// Every function is defined before its first use, in AGK_INLINE mode there are no prototypes to rely on.
+
+#if ! defined VEC3_API
+#define VEC3_API
+#endif
+
+
+//===============================================================================================================
+//---------------------------------------------------------------------------------------------------------------
+VEC3_API VEC3_T VEC3_FN(from_zeroes)(void)
+{
+    VEC3_T r = {{0, 0, 0}};
+    return r;
+}
+
+//---------------------------------------------------------------------------------------------------------------
+VEC3_API VEC3_T VEC3_FN(from_values)(VEC3_REAL x, VEC3_REAL y, VEC3_REAL z)
+{
+    VEC3_T r;
+    r.x = x;
+    r.y = y;
+    r.z = z;
+    return r;
+}
+
+//---------------------------------------------------------------------------------------------------------------
+VEC3_API VEC3_T VEC3_FN(from_points)(VEC3_T from, VEC3_T to)
+{
+    VEC3_T vec = {{to.x - from.x,
+                   to.y - from.y,
+                   to.z - from.z}};
+
+    return vec;
+}
+
+//---------------------------------------------------------------------------------------------------------------
+VEC3_API VEC3_T VEC3_FN(from_array)(const VEC3_REAL *buffer)
+{
+    VEC3_T r;
+    memcpy( &r.v, buffer, sizeof(VEC3_REAL) * 3 );
+    return r;
+}
+
+
+
+
+//===============================================================================================================
+//---------------------------------------------------------------------------------------------------------------
+VEC3_API VEC3_REAL VEC3_FN(len_squared)(VEC3_T vec)
+{
+    VEC3_REAL len_squared = 0;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        len_squared += (vec.v[i] * vec.v[i]);
+    }
+
+    return len_squared;
+}
+
+//---------------------------------------------------------------------------------------------------------------
+VEC3_API VEC3_REAL VEC3_FN(len)(VEC3_T vec)
+{
+    return VEC3_MATH(sqrt)( VEC3_FN(len_squared)(vec) );
+}
+
+//---------------------------------------------------------------------------------------------------------------
+VEC3_API VEC3_T VEC3_FN(scalar_mul)( VEC3_T vec, VEC3_REAL scalar )
+{
+    VEC3_T r;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        r.v[i] = (vec.v[i] * scalar);
+    }
+
+    return r;
+}
+
+//---------------------------------------------------------------------------------------------------------------
+VEC3_API VEC3_T VEC3_FN(scalar_div)( VEC3_T vec, VEC3_REAL scalar )
+{
+    return VEC3_FN(scalar_mul)( vec, 1/scalar );
+}
+
+//---------------------------------------------------------------------------------------------------------------
+VEC3_API VEC3_T VEC3_FN(norm)(VEC3_T vec)
+{
+    VEC3_REAL len = VEC3_FN(len)(vec);
+    return VEC3_FN(scalar_div)( vec, len );
+}
+
+//---------------------------------------------------------------------------------------------------------------
+VEC3_API VEC3_T VEC3_FN(renorm)(VEC3_T vec, VEC3_REAL epsilon)
+{
+    if (VEC3_MATH(fabs)( VEC3_FN(len_squared)(vec) - 1 ) <= epsilon) {
+        return vec;
+    }
+    return VEC3_FN(norm)(vec);
+}
+
+
+
+//===============================================================================================================
+//---------------------------------------------------------------------------------------------------------------
+VEC3_API VEC3_T VEC3_FN(cross)(VEC3_T a, VEC3_T b)
+{
+
+    VEC3_T r = {{a.y*b.z - a.z*b.y,
+                 a.z*b.x - a.x*b.z,
+                 a.x*b.y - a.y*b.x }};
+    return r;
+}
+
+//---------------------------------------------------------------------------------------------------------------
+VEC3_API VEC3_REAL VEC3_FN(dot)(VEC3_T a, VEC3_T b)
+{
+    return (a.x*b.x) + (a.y*b.y) + (a.z*b.z);
+}
+
+//---------------------------------------------------------------------------------------------------------------
+VEC3_API VEC3_T VEC3_FN(add)(VEC3_T a, VEC3_T b)
+{
+
+    VEC3_T r = {{a.x + b.x,
+                 a.y + b.y,
+                 a.z + b.z }};
+    return r;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+VEC3_API bool VEC3_FN(equal)(VEC3_T a, VEC3_T b)
+{
+    int i;
+
+    for(i = 0; i < 3; i++) {
+        if ( VEC3_MATH(fabs)(a.v[i] - b.v[i]) > FLT_EPSILON)
+            return false;
+    }
+
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------
+VEC3_API VEC3_T VEC3_FN(project_plane)(VEC3_T vec, VEC3_T normal)
+{
+    // @ret: result of projecting vector [ vec ] on plane defined by normal [ normal ]
+    //
+    // @param: [ normal ] should be of UNIT length
+    // @param: [ vec ] vector that you want to project
+
+    VEC3_REAL dp = VEC3_FN(dot)(vec, normal);
+    VEC3_T delta = VEC3_FN(scalar_mul)(normal, -dp);
+    return VEC3_FN(add)(vec, delta);
+}
+
+
+
+#undef VEC3_T
+#undef VEC3_REAL
+#undef VEC3_FN
+#undef VEC3_MATH
+#undef VEC3_API